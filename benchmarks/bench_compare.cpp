@@ -0,0 +1,587 @@
+/**
+ * @file bench_compare.cpp
+ * @brief cayene_bench_compare: record benchmark baselines and detect regressions
+ *
+ * Runs a Google Benchmark binary with fixed repetitions pinned to one CPU,
+ * stores every repetition in a baseline file, and compares two such files
+ * with a Welch t-test. A benchmark is reported as a regression when the
+ * whole confidence interval of its slowdown lies above the threshold, so
+ * noisy results do not fail the check.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <expected>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+
+using Json = nlohmann::json;
+
+constexpr std::string_view baseline_format = "cayene-bench-baseline";
+constexpr int baseline_version = 1;
+
+constexpr int exit_ok = 0;
+constexpr int exit_regression = 1;
+constexpr int exit_usage = 2;
+
+struct Samples
+{
+    std::vector<double> real_time_ns;
+    std::vector<double> cpu_time_ns;
+};
+
+struct Baseline
+{
+    Json context = Json::object();
+    std::map<std::string, Samples> benchmarks;
+};
+
+struct Options
+{
+    std::string bench;
+    std::string out;
+    std::string baseline;
+    std::string filter;
+    std::vector<std::string> positional;
+    int repetitions{10};
+    int cpu{-1};
+    double threshold_percent{5.0};
+    double confidence{0.99};
+    bool use_cpu_time{false};
+};
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+auto mean(const std::vector<double>& values) -> double
+{
+    return std::accumulate(values.begin(), values.end(), 0.0) /
+           static_cast<double>(values.size());
+}
+
+auto variance(const std::vector<double>& values) -> double
+{
+    if (values.size() < 2)
+    {
+        return 0.0;
+    }
+    const double average = mean(values);
+    double sum = 0.0;
+    for (double value : values)
+    {
+        sum += (value - average) * (value - average);
+    }
+    return sum / static_cast<double>(values.size() - 1);
+}
+
+// Upper quantile of the standard normal distribution, by bisection on erfc
+auto normal_quantile(double upper_tail) -> double
+{
+    double low = 0.0;
+    double high = 10.0;
+    for (int i = 0; i < 100; ++i)
+    {
+        const double middle = (low + high) / 2.0;
+        if (0.5 * std::erfc(middle / std::sqrt(2.0)) > upper_tail)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return (low + high) / 2.0;
+}
+
+// Student t quantile via the Cornish-Fisher expansion around the normal one
+auto t_quantile(double upper_tail, double degrees_of_freedom) -> double
+{
+    const double z = normal_quantile(upper_tail);
+    const double v = std::max(degrees_of_freedom, 1.0);
+    const double z3 = z * z * z;
+    const double z5 = z3 * z * z;
+    const double z7 = z5 * z * z;
+    return z + (z3 + z) / (4.0 * v) + (5.0 * z5 + 16.0 * z3 + 3.0 * z) / (96.0 * v * v) +
+           (3.0 * z7 + 19.0 * z5 + 17.0 * z3 - 15.0 * z) / (384.0 * v * v * v);
+}
+
+struct Comparison
+{
+    double base_mean{0.0};
+    double current_mean{0.0};
+    double delta_percent{0.0};
+    double ci_low_percent{0.0};
+    double ci_high_percent{0.0};
+};
+
+// Welch interval for (current - base), expressed relative to the base mean
+auto compare_samples(const std::vector<double>& base, const std::vector<double>& current,
+                     double confidence) -> Comparison
+{
+    Comparison result;
+    result.base_mean = mean(base);
+    result.current_mean = mean(current);
+
+    const double a = variance(base) / static_cast<double>(base.size());
+    const double b = variance(current) / static_cast<double>(current.size());
+    const double standard_error = std::sqrt(a + b);
+
+    double degrees_of_freedom = 1.0;
+    if (a + b > 0.0 && base.size() > 1 && current.size() > 1)
+    {
+        degrees_of_freedom =
+            (a + b) * (a + b) /
+            (a * a / static_cast<double>(base.size() - 1) +
+             b * b / static_cast<double>(current.size() - 1));
+    }
+
+    const double margin = t_quantile((1.0 - confidence) / 2.0, degrees_of_freedom) * standard_error;
+    const double difference = result.current_mean - result.base_mean;
+    result.delta_percent = 100.0 * difference / result.base_mean;
+    result.ci_low_percent = 100.0 * (difference - margin) / result.base_mean;
+    result.ci_high_percent = 100.0 * (difference + margin) / result.base_mean;
+    return result;
+}
+
+// ============================================================================
+// Baseline files
+// ============================================================================
+
+auto to_nanoseconds(double value, std::string_view unit) -> double
+{
+    if (unit == "us")
+    {
+        return value * 1e3;
+    }
+    if (unit == "ms")
+    {
+        return value * 1e6;
+    }
+    if (unit == "s")
+    {
+        return value * 1e9;
+    }
+    return value;
+}
+
+// Google Benchmark JSON output: keep individual repetitions, skip aggregates
+auto from_google_benchmark(const Json& document) -> Baseline
+{
+    Baseline baseline;
+    baseline.context = document.value("context", Json::object());
+    for (const auto& entry : document.at("benchmarks"))
+    {
+        if (entry.value("run_type", "iteration") != "iteration")
+        {
+            continue;
+        }
+        const std::string name = entry.value("run_name", entry.at("name").get<std::string>());
+        const std::string unit = entry.value("time_unit", "ns");
+        auto& samples = baseline.benchmarks[name];
+        samples.real_time_ns.push_back(to_nanoseconds(entry.at("real_time").get<double>(), unit));
+        samples.cpu_time_ns.push_back(to_nanoseconds(entry.at("cpu_time").get<double>(), unit));
+    }
+    return baseline;
+}
+
+auto load_baseline(const std::string& path) -> std::expected<Baseline, std::string>
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return std::unexpected("cannot open " + path);
+    }
+
+    Json document = Json::parse(file, nullptr, false);
+    if (document.is_discarded() || !document.is_object())
+    {
+        return std::unexpected(path + " is not valid JSON");
+    }
+
+    if (document.value("format", "") != baseline_format)
+    {
+        if (!document.contains("benchmarks"))
+        {
+            return std::unexpected(path + " is neither a baseline nor benchmark output");
+        }
+        return from_google_benchmark(document);
+    }
+
+    if (document.value("version", 0) != baseline_version)
+    {
+        return std::unexpected(path + " has an unsupported baseline version");
+    }
+
+    Baseline baseline;
+    baseline.context = document.value("context", Json::object());
+    for (const auto& [name, entry] : document.at("benchmarks").items())
+    {
+        auto& samples = baseline.benchmarks[name];
+        samples.real_time_ns = entry.at("real_time_ns").get<std::vector<double>>();
+        samples.cpu_time_ns = entry.at("cpu_time_ns").get<std::vector<double>>();
+    }
+    return baseline;
+}
+
+auto save_baseline(const Baseline& baseline, const std::string& path) -> bool
+{
+    Json document = {
+        {"format", baseline_format},
+        {"version", baseline_version},
+        {"context", baseline.context},
+        {"benchmarks", Json::object()},
+    };
+    for (const auto& [name, samples] : baseline.benchmarks)
+    {
+        document["benchmarks"][name] = {
+            {"real_time_ns", samples.real_time_ns},
+            {"cpu_time_ns", samples.cpu_time_ns},
+        };
+    }
+
+    std::ofstream file(path);
+    file << document.dump(2) << '\n';
+    return static_cast<bool>(file);
+}
+
+// ============================================================================
+// Running the benchmark binary
+// ============================================================================
+
+auto default_cpu() -> int
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+    {
+        return 0;
+    }
+    // La última CPU permitida suele ser la menos cargada por el sistema
+    for (int cpu = CPU_SETSIZE - 1; cpu >= 0; --cpu)
+    {
+        if (CPU_ISSET(static_cast<std::size_t>(cpu), &set))
+        {
+            return cpu;
+        }
+    }
+    return 0;
+}
+
+auto run_benchmarks(const Options& options) -> std::expected<Baseline, std::string>
+{
+    std::string output_path = "/tmp/cayene_bench_XXXXXX";
+    const int output_fd = mkstemp(output_path.data());
+    if (output_fd < 0)
+    {
+        return std::unexpected("cannot create temporary file");
+    }
+    close(output_fd);
+
+    const int cpu = options.cpu >= 0 ? options.cpu : default_cpu();
+    std::vector<std::string> arguments = {
+        options.bench,
+        "--benchmark_repetitions=" + std::to_string(options.repetitions),
+        "--benchmark_enable_random_interleaving=true",
+        "--benchmark_out_format=json",
+        "--benchmark_out=" + output_path,
+    };
+    if (!options.filter.empty())
+    {
+        arguments.push_back("--benchmark_filter=" + options.filter);
+    }
+
+    std::println(stderr, "Running {} ({} repetitions, pinned to CPU {})", options.bench,
+                 options.repetitions, cpu);
+
+    const pid_t child = fork();
+    if (child == 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(static_cast<std::size_t>(cpu), &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        {
+            std::println(stderr, "warning: cannot pin to CPU {}", cpu);
+        }
+
+        // La salida de consola del benchmark va a stderr, stdout queda para el informe
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        std::vector<char*> argv;
+        for (auto& argument : arguments)
+        {
+            argv.push_back(argument.data());
+        }
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        std::println(stderr, "cannot execute {}", options.bench);
+        _exit(127);
+    }
+    if (child < 0)
+    {
+        return std::unexpected("fork failed");
+    }
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        std::remove(output_path.c_str());
+        return std::unexpected("benchmark binary failed");
+    }
+
+    auto baseline = load_baseline(output_path);
+    std::remove(output_path.c_str());
+    if (baseline)
+    {
+        baseline->context["pinned_cpu"] = cpu;
+        baseline->context["repetitions"] = options.repetitions;
+    }
+    return baseline;
+}
+
+// ============================================================================
+// Report
+// ============================================================================
+
+auto report(const Baseline& base, const Baseline& current, const Options& options) -> int
+{
+    std::println("{:<40} {:>12} {:>12} {:>9} {:>22}  {}", "benchmark", "base ns", "current ns",
+                 "delta", "ci", "verdict");
+
+    int regressions = 0;
+    for (const auto& [name, current_samples] : current.benchmarks)
+    {
+        const auto found = base.benchmarks.find(name);
+        if (found == base.benchmarks.end())
+        {
+            std::println("{:<40} {:>12} {:>12}", name, "-", "new");
+            continue;
+        }
+
+        const auto& base_values =
+            options.use_cpu_time ? found->second.cpu_time_ns : found->second.real_time_ns;
+        const auto& current_values =
+            options.use_cpu_time ? current_samples.cpu_time_ns : current_samples.real_time_ns;
+        if (base_values.empty() || current_values.empty())
+        {
+            continue;
+        }
+
+        const auto comparison = compare_samples(base_values, current_values, options.confidence);
+        std::string verdict = "ok";
+        if (comparison.ci_low_percent > options.threshold_percent)
+        {
+            verdict = "REGRESSION";
+            ++regressions;
+        }
+        else if (comparison.ci_high_percent < -options.threshold_percent)
+        {
+            verdict = "improved";
+        }
+        else if (comparison.delta_percent > options.threshold_percent)
+        {
+            verdict = "noisy";
+        }
+
+        std::println("{:<40} {:>12.1f} {:>12.1f} {:>+8.1f}% [{:>+8.1f}%, {:>+8.1f}%]  {}", name,
+                     comparison.base_mean, comparison.current_mean, comparison.delta_percent,
+                     comparison.ci_low_percent, comparison.ci_high_percent, verdict);
+    }
+
+    for (const auto& [name, samples] : base.benchmarks)
+    {
+        if (!current.benchmarks.contains(name))
+        {
+            std::println("{:<40} {:>12} {:>12}", name, "missing", "-");
+        }
+    }
+
+    std::println("\n{} regression(s) beyond {:.1f}% at {:.0f}% confidence", regressions,
+                 options.threshold_percent, options.confidence * 100.0);
+    return regressions > 0 ? exit_regression : exit_ok;
+}
+
+// ============================================================================
+// Command line
+// ============================================================================
+
+void usage()
+{
+    std::println(stderr,
+                 "usage:\n"
+                 "  cayene_bench_compare run --bench <binary> --out <baseline.json>\n"
+                 "  cayene_bench_compare compare <baseline.json> <current.json>\n"
+                 "  cayene_bench_compare check --bench <binary> --baseline <baseline.json>\n"
+                 "\n"
+                 "options:\n"
+                 "  --repetitions N    repetitions per benchmark (default 10)\n"
+                 "  --cpu K            CPU to pin the benchmark to (default: last allowed)\n"
+                 "  --filter REGEX     forwarded as --benchmark_filter\n"
+                 "  --threshold PCT    slowdown tolerated before failing (default 5)\n"
+                 "  --confidence P     confidence level of the interval (default 0.99)\n"
+                 "  --cpu-time         compare CPU time instead of wall time\n"
+                 "\n"
+                 "compare and check exit with 1 when a regression is significant.");
+}
+
+auto parse_options(int argc, char** argv) -> std::optional<Options>
+{
+    Options options;
+    const std::vector<std::string_view> arguments(argv + 2, argv + argc);
+    for (std::size_t i = 0; i < arguments.size(); ++i)
+    {
+        const std::string_view argument = arguments[i];
+        const auto next = [&]() -> std::optional<std::string>
+        {
+            if (i + 1 >= arguments.size())
+            {
+                return std::nullopt;
+            }
+            return std::string(arguments[++i]);
+        };
+
+        std::optional<std::string> value;
+        if (argument == "--cpu-time")
+        {
+            options.use_cpu_time = true;
+            continue;
+        }
+        if (!argument.starts_with("--"))
+        {
+            options.positional.emplace_back(argument);
+            continue;
+        }
+        if (!(value = next()))
+        {
+            return std::nullopt;
+        }
+
+        if (argument == "--bench")
+        {
+            options.bench = *value;
+        }
+        else if (argument == "--out")
+        {
+            options.out = *value;
+        }
+        else if (argument == "--baseline")
+        {
+            options.baseline = *value;
+        }
+        else if (argument == "--filter")
+        {
+            options.filter = *value;
+        }
+        else if (argument == "--repetitions")
+        {
+            options.repetitions = std::max(2, std::atoi(value->c_str()));
+        }
+        else if (argument == "--cpu")
+        {
+            options.cpu = std::atoi(value->c_str());
+        }
+        else if (argument == "--threshold")
+        {
+            options.threshold_percent = std::atof(value->c_str());
+        }
+        else if (argument == "--confidence")
+        {
+            options.confidence = std::clamp(std::atof(value->c_str()), 0.5, 0.9999);
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+    return options;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        usage();
+        return exit_usage;
+    }
+
+    const std::string_view command = argv[1];
+    const auto options = parse_options(argc, argv);
+    if (!options)
+    {
+        usage();
+        return exit_usage;
+    }
+
+    if (command == "run" && !options->bench.empty() && !options->out.empty())
+    {
+        auto baseline = run_benchmarks(*options);
+        if (!baseline)
+        {
+            std::println(stderr, "error: {}", baseline.error());
+            return exit_usage;
+        }
+        if (!save_baseline(*baseline, options->out))
+        {
+            std::println(stderr, "error: cannot write {}", options->out);
+            return exit_usage;
+        }
+        std::println(stderr, "Baseline with {} benchmarks written to {}",
+                     baseline->benchmarks.size(), options->out);
+        return exit_ok;
+    }
+
+    if (command == "compare" && options->positional.size() == 2)
+    {
+        auto base = load_baseline(options->positional[0]);
+        auto current = load_baseline(options->positional[1]);
+        if (!base || !current)
+        {
+            std::println(stderr, "error: {}", !base ? base.error() : current.error());
+            return exit_usage;
+        }
+        return report(*base, *current, *options);
+    }
+
+    if (command == "check" && !options->bench.empty() && !options->baseline.empty())
+    {
+        auto base = load_baseline(options->baseline);
+        if (!base)
+        {
+            std::println(stderr, "error: {}", base.error());
+            return exit_usage;
+        }
+        auto current = run_benchmarks(*options);
+        if (!current)
+        {
+            std::println(stderr, "error: {}", current.error());
+            return exit_usage;
+        }
+        return report(*base, *current, *options);
+    }
+
+    usage();
+    return exit_usage;
+}
@@ -0,0 +1,251 @@
+/**
+ * @file core_benchmark.cpp
+ * @brief Throughput benchmarks for the core, buildable in embedded mode
+ *
+ * Uses the same payloads and names as cayene_benchmarks so runs of an
+ * embedded build and a default build can be compared with
+ * cayene_bench_compare.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "cayene/core.hpp"
+#include "cayene/registry.hpp"
+#include "payloads.hpp"
+#include "perf_counters.hpp"
+
+namespace
+{
+
+using cayene::CoreDecoder;
+using cayene::Reading;
+using cayene::ReadingBuffer;
+using cayene::RegistryBuilder;
+using cayene::RegistryView;
+using cayene::TimedReading;
+using cayene::TypeTable;
+using cayene::Validation;
+using cayene::bench::Payload;
+using cayene::bench::payloads;
+using cayene::bench::PerfRegion;
+using cayene::bench::set_counters;
+
+void bm_decode_core(benchmark::State& state, const Payload& payload)
+{
+    const CoreDecoder decoder;
+    ReadingBuffer<64> readings;
+    PerfRegion perf;
+    for (auto _ : state)
+    {
+        auto result = decoder.decode(payload.bytes, readings);
+        benchmark::DoNotOptimize(result);
+        benchmark::DoNotOptimize(readings.begin());
+    }
+    perf.finish(state);
+    set_counters(state, payload);
+}
+
+// El mismo payload repartido en tres buffers, como llega de un ring buffer
+void bm_decode_core_fragments(benchmark::State& state, const Payload& payload)
+{
+    const CoreDecoder decoder;
+    const std::span<const uint8_t> bytes(payload.bytes);
+    const std::size_t cut = bytes.size() / 3;
+    const std::array<std::span<const uint8_t>, 3> fragments = {
+        bytes.first(cut), bytes.subspan(cut, cut), bytes.subspan(2 * cut)};
+    std::array<Reading, 64> readings{};
+    std::array<uint8_t, 32> scratch{};
+    PerfRegion perf;
+    for (auto _ : state)
+    {
+        auto result = decoder.decode(fragments, readings, scratch);
+        benchmark::DoNotOptimize(result);
+        benchmark::DoNotOptimize(readings.data());
+    }
+    perf.finish(state);
+    set_counters(state, payload);
+}
+
+void bm_validate(benchmark::State& state, const Payload& payload)
+{
+    const CoreDecoder decoder;
+    PerfRegion perf;
+    for (auto _ : state)
+    {
+        auto result = decoder.validate(payload.bytes);
+        benchmark::DoNotOptimize(result);
+    }
+    perf.finish(state);
+    set_counters(state, payload);
+}
+
+// Un uplink de un dispositivo con búfer: 12 muestras de temperatura y humedad, cada una
+// tras su marca de tiempo
+void bm_decode_records(benchmark::State& state)
+{
+    Payload samples{"timestamped", {}};
+    for (uint8_t sample = 0; sample < 12; ++sample)
+    {
+        samples.bytes.insert(samples.bytes.end(), {0x00, 0x85, 0x65, 0x5F, 0x1A, sample});
+        samples.bytes.insert(samples.bytes.end(),
+                             {0x01, 0x67, 0x00, sample, 0x02, 0x68, 0x01, sample});
+    }
+
+    const CoreDecoder decoder;
+    std::array<TimedReading, 64> records{};
+    PerfRegion perf;
+    for (auto _ : state)
+    {
+        auto result = decoder.decode_records(samples.bytes, records);
+        benchmark::DoNotOptimize(result);
+        benchmark::DoNotOptimize(records.data());
+    }
+    perf.finish(state);
+    set_counters(state, samples);
+}
+
+// Todas las cargas de payloads() en un lote; bytes/s comparables con BM_Validate
+void bm_validate_batch(benchmark::State& state)
+{
+    constexpr TypeTable types = TypeTable::standard();
+    std::vector<std::span<const uint8_t>> batch;
+    int64_t batch_bytes = 0;
+    for (const auto& payload : payloads())
+    {
+        batch.emplace_back(payload.bytes);
+        batch_bytes += static_cast<int64_t>(payload.bytes.size());
+    }
+    std::vector<Validation> results(batch.size());
+
+    PerfRegion perf;
+    for (auto _ : state)
+    {
+        auto valid = cayene::validate_batch(types, batch, results);
+        benchmark::DoNotOptimize(valid);
+        benchmark::DoNotOptimize(results.data());
+    }
+    perf.finish(state);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batch.size()));
+    state.SetBytesProcessed(state.iterations() * batch_bytes);
+}
+
+// Imagen con N tenants de 8 tipos propios cada uno
+auto registry_image(std::size_t tenants) -> std::vector<std::byte>
+{
+    RegistryBuilder builder;
+    for (std::size_t tenant = 0; tenant < tenants; ++tenant)
+    {
+        const std::string id = std::format("tenant-{:06}", tenant);
+        (void)builder.add_tenant(id);
+        for (uint8_t type_id = 0xC0; type_id < 0xC8; ++type_id)
+        {
+            (void)builder.add_type(id, type_id, std::format("custom-{:02x}", type_id),
+                                   1 + (tenant + type_id) % 8);
+        }
+    }
+    return builder.serialize();
+}
+
+// Un tipo de longitud variable: una traza de 10 puntos GPS (6 bytes cada uno) y una temperatura
+void bm_decode_prefixed(benchmark::State& state)
+{
+    Payload track{"prefixed", {0x01, 0xCA, 10}};
+    for (uint8_t point = 0; point < 10; ++point)
+    {
+        track.bytes.insert(track.bytes.end(), {0x06, 0x76, point, 0xF2, 0x96, point});
+    }
+    track.bytes.insert(track.bytes.end(), {0x02, 0x67, 0x01, 0x10});
+
+    CoreDecoder decoder;
+    decoder.add_prefixed_type(0xCA, 6);
+    ReadingBuffer<64> readings;
+    PerfRegion perf;
+    for (auto _ : state)
+    {
+        auto result = decoder.decode(track.bytes, readings);
+        benchmark::DoNotOptimize(result);
+        benchmark::DoNotOptimize(readings.begin());
+    }
+    perf.finish(state);
+    set_counters(state, track);
+}
+
+// Lo que paga un worker al arrancar: validar la imagen completa
+void bm_registry_open(benchmark::State& state)
+{
+    const auto image = registry_image(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        auto view = RegistryView::from_bytes(image);
+        benchmark::DoNotOptimize(view);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(image.size()));
+}
+
+// Lo que costaba antes: registrar cada tipo de cada tenant
+void bm_registry_build(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        auto image = registry_image(static_cast<std::size_t>(state.range(0)));
+        benchmark::DoNotOptimize(image.data());
+    }
+}
+
+void bm_registry_find(benchmark::State& state)
+{
+    const auto tenants = static_cast<std::size_t>(state.range(0));
+    const auto image = registry_image(tenants);
+    const auto view = RegistryView::from_bytes(image);
+    const std::string id = std::format("tenant-{:06}", tenants / 3);
+    for (auto _ : state)
+    {
+        auto tenant = view->find(id);
+        benchmark::DoNotOptimize(tenant);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    for (const auto& payload : payloads())
+    {
+        benchmark::RegisterBenchmark(("BM_DecodeCore/" + payload.name).c_str(), bm_decode_core,
+                                     payload);
+        benchmark::RegisterBenchmark(("BM_DecodeCoreFragments/" + payload.name).c_str(),
+                                     bm_decode_core_fragments, payload);
+        benchmark::RegisterBenchmark(("BM_Validate/" + payload.name).c_str(), bm_validate,
+                                     payload);
+    }
+    benchmark::RegisterBenchmark("BM_ValidateBatch", bm_validate_batch);
+    benchmark::RegisterBenchmark("BM_DecodeRecords", bm_decode_records);
+    benchmark::RegisterBenchmark("BM_DecodePrefixed", bm_decode_prefixed);
+
+    benchmark::RegisterBenchmark("BM_RegistryOpen", bm_registry_open)->Arg(100)->Arg(5000);
+    benchmark::RegisterBenchmark("BM_RegistryBuild", bm_registry_build)->Arg(100)->Arg(5000);
+    benchmark::RegisterBenchmark("BM_RegistryFind", bm_registry_find)->Arg(100)->Arg(5000);
+
+    cayene::bench::take_perf_counters_flag(argc, argv);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
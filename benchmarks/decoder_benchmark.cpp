@@ -0,0 +1,137 @@
+/**
+ * @file decoder_benchmark.cpp
+ * @brief Throughput benchmarks for the Json and readings decode paths
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "cayene/decoder.hpp"
+#include "cayene/type_config.hpp"
+#include "payloads.hpp"
+#include "perf_counters.hpp"
+
+namespace
+{
+
+using cayene::Decoder;
+using cayene::Reading;
+using cayene::TypeCatalog;
+using cayene::bench::Payload;
+using cayene::bench::payloads;
+using cayene::bench::PerfRegion;
+using cayene::bench::set_counters;
+
+void bm_decode_json(benchmark::State& state, const Payload& payload)
+{
+    Decoder decoder;
+    std::vector<uint8_t> bytes = payload.bytes;
+    PerfRegion perf;
+    for (auto _ : state)
+    {
+        auto result = decoder.decode(bytes);
+        benchmark::DoNotOptimize(result);
+    }
+    perf.finish(state);
+    set_counters(state, payload);
+}
+
+void bm_decode_readings(benchmark::State& state, const Payload& payload)
+{
+    Decoder decoder;
+    std::array<Reading, 64> readings{};
+    PerfRegion perf;
+    for (auto _ : state)
+    {
+        auto result = decoder.decode_readings(payload.bytes, readings);
+        benchmark::DoNotOptimize(result);
+        benchmark::DoNotOptimize(readings.data());
+    }
+    perf.finish(state);
+    set_counters(state, payload);
+}
+
+// Fichero con @p ports entradas de fPort y 16 tipos de dos campos cada una
+auto catalog_config(int ports) -> std::string
+{
+    std::string text = R"({"version": 1, "fports": {)";
+    for (int port = 1; port <= ports; ++port)
+    {
+        text += std::format(R"({}"{}": {{"types": [)", port == 1 ? "" : ",", port);
+        for (int type = 0; type < 16; ++type)
+        {
+            text += std::format(R"({}{{"type_id": {}, "name": "T{}_{}", "fields": [)"
+                                R"({{"name": "a", "format": "u16", "scale": 10}},)"
+                                R"({{"name": "b", "format": "i8"}}]}})",
+                                type == 0 ? "" : ",", 200 + type, port, type);
+        }
+        text += "]}";
+    }
+    return text + "}}";
+}
+
+// Reload cost: parse, validate and compile every profile
+void bm_catalog_parse(benchmark::State& state)
+{
+    const std::string text = catalog_config(static_cast<int>(state.range(0)));
+    for (auto _ : state)
+    {
+        auto catalog = TypeCatalog::parse(text);
+        benchmark::DoNotOptimize(catalog);
+    }
+    state.counters["definitions"] = static_cast<double>(state.range(0) * 16);
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+}
+
+// Port and type lookups on the decode path
+void bm_catalog_decode_readings(benchmark::State& state)
+{
+    auto catalog = TypeCatalog::parse(catalog_config(200));
+    const std::vector<uint8_t> payload = {0x01, 0xC8, 0x01, 0x90, 0xFE, 0x02, 0xCF,
+                                          0x00, 0x10, 0x05, 0x03, 0x67, 0x01, 0x10};
+    std::array<Reading, 8> readings{};
+    uint8_t fport = 0;
+    for (auto _ : state)
+    {
+        fport = static_cast<uint8_t>(fport % 200 + 1);
+        auto result = catalog->decode_readings(fport, payload, readings);
+        benchmark::DoNotOptimize(result);
+        benchmark::DoNotOptimize(readings.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(payload.size()));
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    cayene::bench::take_perf_counters_flag(argc, argv);
+
+    for (const auto& payload : payloads())
+    {
+        benchmark::RegisterBenchmark(("BM_DecodeJson/" + payload.name).c_str(), bm_decode_json,
+                                     payload);
+        benchmark::RegisterBenchmark(("BM_DecodeReadings/" + payload.name).c_str(),
+                                     bm_decode_readings, payload);
+    }
+
+    benchmark::RegisterBenchmark("BM_CatalogParse", bm_catalog_parse)->Arg(16)->Arg(250);
+    benchmark::RegisterBenchmark("BM_CatalogDecodeReadings", bm_catalog_decode_readings);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
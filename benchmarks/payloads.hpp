@@ -0,0 +1,72 @@
+#ifndef CAYENE_BENCH_PAYLOADS_HPP
+#define CAYENE_BENCH_PAYLOADS_HPP
+
+/**
+ * @file payloads.hpp
+ * @brief Payload fixtures shared by the benchmark executables
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace cayene::bench
+{
+
+struct Payload
+{
+    std::string name;
+    std::vector<uint8_t> bytes;
+};
+
+inline auto payloads() -> const std::vector<Payload>&
+{
+    static const std::vector<Payload> fixtures = []
+    {
+        std::vector<Payload> result;
+        result.push_back({"temperature", {0x01, 0x67, 0x01, 0x10}});
+        result.push_back({"mixed",
+                          {0x03, 0x67, 0x01, 0x10, 0x05, 0x67, 0x00, 0xFF, 0x06, 0x71, 0x04,
+                           0xD2, 0xFB, 0x2E, 0x00, 0x00, 0x01, 0x67, 0xFF, 0xD7, 0x01, 0x88,
+                           0x06, 0x76, 0x5f, 0x0d, 0x69, 0xf6, 0x00, 0x03, 0xe8}});
+        result.push_back(
+            {"gps", {0x01, 0x88, 0x06, 0x76, 0x5f, 0x0d, 0x69, 0xf6, 0x00, 0x03, 0xe8}});
+
+        // Frame multi-sensor grande: 24 canales de temperatura, humedad y presencia
+        Payload large{"large", {}};
+        for (uint8_t channel = 0; channel < 24; ++channel)
+        {
+            switch (channel % 3)
+            {
+                case 0:
+                    large.bytes.insert(large.bytes.end(), {channel, 0x67, 0x00, channel});
+                    break;
+                case 1:
+                    large.bytes.insert(large.bytes.end(), {channel, 0x68, 0x01, channel});
+                    break;
+                default:
+                    large.bytes.insert(large.bytes.end(), {channel, 0x66, 0x01});
+                    break;
+            }
+        }
+        result.push_back(std::move(large));
+        return result;
+    }();
+    return fixtures;
+}
+
+inline void set_counters(benchmark::State& state, const Payload& payload)
+{
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(payload.bytes.size()));
+}
+
+}  // namespace cayene::bench
+
+#endif  // CAYENE_BENCH_PAYLOADS_HPP
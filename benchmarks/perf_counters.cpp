@@ -0,0 +1,239 @@
+/**
+ * @file perf_counters.cpp
+ * @brief perf_event_open backed counters for the benchmark suite
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "perf_counters.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <print>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace cayene::bench
+{
+
+namespace
+{
+
+struct EventConfig
+{
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr auto cache_miss_config(uint64_t cache) -> uint64_t
+{
+    return cache | (uint64_t{PERF_COUNT_HW_CACHE_OP_READ} << 8U) |
+           (uint64_t{PERF_COUNT_HW_CACHE_RESULT_MISS} << 16U);
+}
+
+constexpr std::array<EventConfig, perf_event_count> event_configs = {{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, cache_miss_config(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, cache_miss_config(PERF_COUNT_HW_CACHE_LL)},
+}};
+
+// read_format: value, time enabled, time running
+struct ReadValue
+{
+    uint64_t value;
+    uint64_t time_enabled;
+    uint64_t time_running;
+};
+
+auto open_event(const EventConfig& event) -> int
+{
+    perf_event_attr attributes{};
+    attributes.size = sizeof(attributes);
+    attributes.type = event.type;
+    attributes.config = event.config;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // Hilo actual, cualquier CPU, sin grupo
+    return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+
+std::unique_ptr<PerfCounters> global_counters;
+
+}  // namespace
+
+auto perf_event_name(PerfEvent event) -> std::string_view
+{
+    switch (event)
+    {
+        case PerfEvent::Cycles:
+            return "cycles";
+        case PerfEvent::Instructions:
+            return "instructions";
+        case PerfEvent::BranchMisses:
+            return "branch-misses";
+        case PerfEvent::L1dMisses:
+            return "L1d-misses";
+        case PerfEvent::LlcMisses:
+            return "LLC-misses";
+    }
+    return "unknown";
+}
+
+PerfCounters::PerfCounters()
+{
+    for (std::size_t i = 0; i < perf_event_count; ++i)
+    {
+        fds_[i] = open_event(event_configs[i]);
+        if (fds_[i] < 0 && error_.empty())
+        {
+            error_ = std::string(perf_event_name(static_cast<PerfEvent>(i))) + ": " +
+                     std::strerror(errno);
+        }
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int fd : fds_)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+}
+
+auto PerfCounters::available() const -> bool
+{
+    for (int fd : fds_)
+    {
+        if (fd >= 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PerfCounters::start()
+{
+    for (int fd : fds_)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+auto PerfCounters::stop() -> PerfValues
+{
+    for (int fd : fds_)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    PerfValues values{};
+    for (std::size_t i = 0; i < perf_event_count; ++i)
+    {
+        ReadValue raw{};
+        if (fds_[i] < 0 || read(fds_[i], &raw, sizeof(raw)) != sizeof(raw) ||
+            raw.time_running == 0)
+        {
+            continue;
+        }
+        // Escalado si el kernel multiplexó el contador
+        values[i] = static_cast<uint64_t>(static_cast<double>(raw.value) *
+                                          static_cast<double>(raw.time_enabled) /
+                                          static_cast<double>(raw.time_running));
+    }
+    return values;
+}
+
+auto enable_perf_counters() -> bool
+{
+    global_counters = std::make_unique<PerfCounters>();
+    if (!global_counters->available())
+    {
+        std::println(stderr,
+                     "perf counters unavailable ({}), check /proc/sys/kernel/perf_event_paranoid",
+                     global_counters->error());
+        global_counters.reset();
+        return false;
+    }
+    if (!global_counters->error().empty())
+    {
+        std::println(stderr, "some perf counters unavailable: {}", global_counters->error());
+    }
+    return true;
+}
+
+auto take_perf_counters_flag(int& argc, char** argv) -> bool
+{
+    constexpr std::string_view flag = "--perf_counters";
+
+    bool found = false;
+    int kept = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (flag == argv[i])
+        {
+            found = true;
+            continue;
+        }
+        argv[kept++] = argv[i];
+    }
+    argc = kept;
+
+    return found && enable_perf_counters();
+}
+
+PerfRegion::PerfRegion() : counters_(global_counters.get())
+{
+    if (counters_ != nullptr)
+    {
+        counters_->start();
+    }
+}
+
+void PerfRegion::finish(benchmark::State& state)
+{
+    if (counters_ == nullptr)
+    {
+        return;
+    }
+
+    const PerfValues values = counters_->stop();
+    const auto iterations = static_cast<double>(state.iterations());
+    for (std::size_t i = 0; i < perf_event_count; ++i)
+    {
+        if (values[i])
+        {
+            state.counters[std::string(perf_event_name(static_cast<PerfEvent>(i))) + "/op"] =
+                static_cast<double>(*values[i]) / iterations;
+        }
+    }
+
+    const auto& cycles = values[static_cast<std::size_t>(PerfEvent::Cycles)];
+    const auto& instructions = values[static_cast<std::size_t>(PerfEvent::Instructions)];
+    if (cycles && instructions && *cycles > 0)
+    {
+        state.counters["IPC"] = static_cast<double>(*instructions) / static_cast<double>(*cycles);
+    }
+}
+
+}  // namespace cayene::bench
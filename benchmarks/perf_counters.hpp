@@ -0,0 +1,98 @@
+#ifndef CAYENE_BENCH_PERF_COUNTERS_HPP
+#define CAYENE_BENCH_PERF_COUNTERS_HPP
+
+/**
+ * @file perf_counters.hpp
+ * @brief Hardware performance counters for the benchmark suite
+ *
+ * Wraps perf_event_open for the calling thread: cycles, instructions,
+ * branch misses, L1d read misses and LLC read misses. Each event is opened
+ * on its own, so a PMU or container that refuses some of them still
+ * reports the rest; when none can be opened the benchmarks simply run
+ * without the extra counters.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <benchmark/benchmark.h>
+
+namespace cayene::bench
+{
+
+enum class PerfEvent : std::uint8_t
+{
+    Cycles = 0,
+    Instructions = 1,
+    BranchMisses = 2,
+    L1dMisses = 3,
+    LlcMisses = 4
+};
+
+inline constexpr std::size_t perf_event_count = 5;
+
+auto perf_event_name(PerfEvent event) -> std::string_view;
+
+using PerfValues = std::array<std::optional<uint64_t>, perf_event_count>;
+
+class PerfCounters
+{
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    PerfCounters(PerfCounters&&) = delete;
+    PerfCounters& operator=(PerfCounters&&) = delete;
+
+    [[nodiscard]] auto available() const -> bool;
+    // Reason the first event could not be opened, empty if all opened
+    [[nodiscard]] auto error() const -> const std::string& { return error_; }
+
+    void start();
+    // Values since start(), scaled for multiplexing, nullopt for missing events
+    auto stop() -> PerfValues;
+
+private:
+    std::array<int, perf_event_count> fds_{};
+    std::string error_;
+};
+
+/**
+ * @brief Enables counter collection for the whole benchmark run
+ *
+ * Returns true if any event could be opened; otherwise prints why once.
+ */
+auto enable_perf_counters() -> bool;
+
+// Removes --perf_counters from argv, before Google Benchmark rejects it, and enables collection
+auto take_perf_counters_flag(int& argc, char** argv) -> bool;
+
+/**
+ * @brief Counts one benchmark's timed loop when collection is enabled
+ *
+ * Construct right before the `for (auto _ : state)` loop and call finish()
+ * right after it to add cycles/op, instructions/op, IPC, branch-misses/op,
+ * L1d-misses/op and LLC-misses/op to the benchmark's counters.
+ */
+class PerfRegion
+{
+public:
+    PerfRegion();
+    void finish(benchmark::State& state);
+
+private:
+    PerfCounters* counters_;
+};
+
+}  // namespace cayene::bench
+
+#endif  // CAYENE_BENCH_PERF_COUNTERS_HPP
@@ -0,0 +1,27 @@
+/**
+ * @file size_core.cpp
+ * @brief Smallest program decoding with the core, measured by cayene_size_report
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+
+#include "cayene/core.hpp"
+
+int main()
+{
+    std::array<uint8_t, 256> payload{};
+    const std::size_t size = std::fread(payload.data(), 1, payload.size(), stdin);
+
+    const cayene::CoreDecoder decoder;
+    cayene::ReadingBuffer<64> readings;
+    auto res = decoder.decode(std::span(payload).first(size), readings);
+
+    std::printf("%zu\n", res ? *res : 0);
+    return res ? 0 : 1;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file size_json.cpp
+ * @brief Same program as size_core.cpp on the Json layer, measured by cayene_size_report
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+
+#include "cayene/decoder.hpp"
+
+int main()
+{
+    std::array<uint8_t, 256> payload{};
+    const std::size_t size = std::fread(payload.data(), 1, payload.size(), stdin);
+
+    cayene::Decoder decoder;
+    auto res = decoder.decode(std::span(payload).first(size));
+
+    std::printf("%zu\n", res ? res->size() : 0);
+    return res ? 0 : 1;
+}
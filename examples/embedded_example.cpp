@@ -0,0 +1,43 @@
+/**
+ * @file embedded_example.cpp
+ * @brief Decoding on a gateway with the core only: no JSON, exceptions or heap
+ */
+
+#include <cstdint>
+#include <cstdio>
+
+#include "cayene/core.hpp"
+
+int main()
+{
+    using namespace cayene;
+
+    // Temp 1      Acc                     GPS
+    // 03 67 01 10 06 71 04 D2 FB 2E 00 00 01 88 06 76 5f 0d 69 f6 00 03 e8
+    static constexpr uint8_t payload[] = {0x03, 0x67, 0x01, 0x10, 0x06, 0x71, 0x04, 0xD2,
+                                          0xFB, 0x2E, 0x00, 0x00, 0x01, 0x88, 0x06, 0x76,
+                                          0x5f, 0x0d, 0x69, 0xf6, 0x00, 0x03, 0xe8};
+
+    const CoreDecoder decoder;
+    ReadingBuffer<16> readings;
+
+    auto res = decoder.decode(payload, readings);
+    if (!res)
+    {
+        std::printf("Decoding error: %d\n", static_cast<int>(res.error()));
+        return -1;
+    }
+
+    for (const Reading& reading : readings)
+    {
+        std::printf("channel=%u type=0x%02x", static_cast<unsigned>(reading.channel),
+                    static_cast<unsigned>(reading.type_id));
+        for (std::size_t component = 0; component < reading.component_count; ++component)
+        {
+            std::printf(" %g", reading.value(component));
+        }
+        std::printf("\n");
+    }
+
+    return 0;
+}
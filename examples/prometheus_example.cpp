@@ -0,0 +1,45 @@
+/**
+ * @file prometheus_example.cpp
+ * @brief Serves decoder metrics for Prometheus while decoding in a loop
+ *
+ * Build with -DCAYENE_ENABLE_METRICS=ON, run, then:
+ *   curl -s localhost:9464/metrics
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <print>
+#include <thread>
+#include <vector>
+
+#include "cayene/decoder.hpp"
+#include "cayene/prometheus.hpp"
+
+int main()
+{
+    using namespace cayene;
+
+    metrics::PrometheusExporter exporter(9464);
+    auto port = exporter.start();
+    if (!port)
+    {
+        std::println("Cannot start exporter: {}", port.error().message());
+        return -1;
+    }
+    std::println("Serving metrics on http://127.0.0.1:{}/metrics", *port);
+
+    Decoder decoder;
+    std::vector<uint8_t> payload = {0x03, 0x67, 0x01, 0x10, 0x05, 0x67, 0x00, 0xFF,
+                                    0x06, 0x71, 0x04, 0xD2, 0xFB, 0x2E, 0x00, 0x00};
+    std::vector<uint8_t> truncated = {0x01, 0x67, 0x01};
+
+    for (;;)
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            (void)decoder.decode(payload);
+        }
+        (void)decoder.decode(truncated);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
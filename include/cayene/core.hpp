@@ -0,0 +1,363 @@
+#ifndef CAYENE_CORE_HPP
+#define CAYENE_CORE_HPP
+
+/**
+ * @file core.hpp
+ * @brief Allocation-free decoder core, usable without JSON, exceptions or RTTI
+ *
+ * CoreDecoder validates a payload against a flat 256-entry table of field
+ * sizes and writes the fields as Readings into caller-provided storage. It
+ * is built into the cayene_core library, which never links nlohmann_json
+ * and is compiled with -fno-exceptions -fno-rtti, so it can be used on
+ * gateways with CAYENE_EMBEDDED. Decoder builds its Json output on top.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string_view>
+
+#include "error.hpp"
+#include "reading.hpp"
+
+namespace cayene
+{
+
+inline constexpr std::size_t type_table_size = 256;
+// Largest field a type can declare, a LoRaWAN frame is at most 242 bytes
+inline constexpr std::size_t max_field_size = 255;
+
+// A payload split across several receive buffers, in order
+using PayloadFragments = std::span<const std::span<const uint8_t>>;
+
+// Views of other byte buffers as a payload, without copying
+inline auto as_payload(std::string_view bytes) -> std::span<const uint8_t>
+{
+    return {reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()};
+}
+
+inline auto as_payload(std::span<const std::byte> bytes) -> std::span<const uint8_t>
+{
+    return {reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()};
+}
+
+// Cayenne LPP Unix Time field: seconds since the epoch, unsigned big endian
+inline constexpr uint8_t unix_time_type_id = 0x85;
+inline constexpr std::size_t unix_time_size = 4;
+
+// One sample of a payload that carries several, see decode_records
+struct TimedReading
+{
+    // Seconds since the epoch
+    uint32_t timestamp{0};
+    Reading reading;
+};
+
+struct StandardType
+{
+    uint8_t type_id;
+    uint8_t size;
+    std::string_view name;
+};
+
+// Cayenne LPP v1 standard types
+inline constexpr std::array<StandardType, 12> v1_standard_types = {{
+    {0x00, 1, "Digital Input"},
+    {0x01, 1, "Digital Output"},
+    {0x02, 2, "Analog Input"},
+    {0x03, 2, "Analog Output"},
+    {0x65, 2, "Luminosity"},
+    {0x66, 1, "Presence"},
+    {0x67, 2, "Temperature"},
+    {0x68, 2, "Humidity"},
+    {0x71, 6, "Accelerometer"},
+    {0x73, 2, "Barometer"},
+    {0x86, 6, "Gyrometer"},
+    {0x88, 9, "GPS"},
+}};
+
+/**
+ * @brief Field size and kind of every type id, indexed directly by the id
+ *
+ * A size of 0 marks a type without a fixed size: unregistered, or
+ * length-prefixed, whose fields start with a byte that counts the units
+ * after it. Decoders only look at the unit table when the size is 0, where
+ * an unknown type would fail anyway, so fixed-size fields cost the same as
+ * without length-prefixed types. The table is trivially copyable with a
+ * fixed layout, so registry images (registry.hpp) embed it as is.
+ */
+class TypeTable
+{
+public:
+    constexpr TypeTable() = default;
+
+    static constexpr auto standard() -> TypeTable
+    {
+        TypeTable table;
+        for (const auto& type : v1_standard_types)
+        {
+            table.add(type.type_id, type.size, true);
+        }
+        return table;
+    }
+
+    /**
+     * @brief Registers @p type_id with a fixed field size
+     *
+     * @return false if the type is already registered or @p size is not in
+     *         [1, max_field_size]
+     */
+    constexpr auto add(uint8_t type_id, std::size_t size, bool standard = false) -> bool
+    {
+        if (contains(type_id) || size == 0 || size > max_field_size)
+        {
+            return false;
+        }
+        sizes_[type_id] = static_cast<uint8_t>(size);
+        standard_[type_id] = standard;
+        return true;
+    }
+
+    /**
+     * @brief Registers @p type_id as a length-prefixed type
+     *
+     * The first byte of a field counts the units of @p unit bytes after it,
+     * so a field is 1 + count * unit bytes; a polyline of 6-byte points has
+     * a unit of 6, a generic blob a unit of 1. Fields longer than
+     * max_field_size are rejected as malformed.
+     *
+     * @return false if the type is already registered or @p unit is not in
+     *         [1, max_field_size]
+     */
+    constexpr auto add_prefixed(uint8_t type_id, std::size_t unit) -> bool
+    {
+        if (contains(type_id) || unit == 0 || unit > max_field_size)
+        {
+            return false;
+        }
+        units_[type_id] = static_cast<uint8_t>(unit);
+        return true;
+    }
+
+    [[nodiscard]] constexpr auto contains(uint8_t type_id) const -> bool
+    {
+        return sizes_[type_id] != 0 || units_[type_id] != 0;
+    }
+
+    // Fixed field size, 0 for unregistered and length-prefixed types
+    [[nodiscard]] constexpr auto size(uint8_t type_id) const -> std::size_t
+    {
+        return sizes_[type_id];
+    }
+
+    [[nodiscard]] constexpr auto is_prefixed(uint8_t type_id) const -> bool
+    {
+        return units_[type_id] != 0;
+    }
+
+    // Bytes per unit of a length-prefixed type, 0 for the others
+    [[nodiscard]] constexpr auto unit(uint8_t type_id) const -> std::size_t
+    {
+        return units_[type_id];
+    }
+
+    // Size of a field of a length-prefixed type whose first byte is @p length, 0 for the others
+    [[nodiscard]] constexpr auto prefixed_size(uint8_t type_id, uint8_t length) const
+        -> std::size_t
+    {
+        return units_[type_id] == 0 ? 0 : 1 + std::size_t{length} * units_[type_id];
+    }
+
+    [[nodiscard]] constexpr auto is_standard(uint8_t type_id) const -> bool
+    {
+        return standard_[type_id];
+    }
+
+private:
+    std::array<uint8_t, type_table_size> sizes_{};
+    std::array<bool, type_table_size> standard_{};
+    std::array<uint8_t, type_table_size> units_{};
+};
+
+/**
+ * @brief Decodes @p encoded_payload against @p types into @p readings
+ *
+ * The function behind CoreDecoder::decode, for tables the caller does not
+ * want to copy, such as the ones inside a mapped registry image.
+ *
+ * @return Number of readings written
+ */
+auto decode_readings(const TypeTable& types, std::span<const uint8_t> encoded_payload,
+                     std::span<Reading> readings) -> std::expected<std::size_t, Error>;
+
+/**
+ * @brief decode_readings over a payload split across several buffers
+ *
+ * The fragments are walked in place, never coalesced. Readings point into
+ * them, except fields that straddle two fragments: those are copied into
+ * @p scratch, which must outlive the readings. Fails with BufferTooSmall if
+ * @p scratch runs out; it never needs more than the payload size.
+ */
+auto decode_readings(const TypeTable& types, PayloadFragments fragments,
+                     std::span<Reading> readings, std::span<uint8_t> scratch)
+    -> std::expected<std::size_t, Error>;
+
+/**
+ * @brief Decodes a payload of timestamped samples into time-series records
+ *
+ * Devices that buffer readings send several samples per uplink, each group
+ * after a Unix Time field (type 0x85, 4 bytes). Every other field becomes a
+ * record stamped with the last Unix Time before it, or with @p timestamp
+ * before the first one, so repeated channels are all kept. Unix Time fields
+ * produce no record and are recognized whether or not @p types registers
+ * 0x85. Errors are those of decode_readings.
+ *
+ * @return Number of records written
+ */
+auto decode_records(const TypeTable& types, std::span<const uint8_t> encoded_payload,
+                    std::span<TimedReading> records, uint32_t timestamp = 0)
+    -> std::expected<std::size_t, Error>;
+
+template <std::size_t N>
+class ReadingBuffer;
+
+// Same, filling a ReadingBuffer; on error the buffer is left empty
+template <std::size_t N>
+auto decode_readings(const TypeTable& types, std::span<const uint8_t> encoded_payload,
+                     ReadingBuffer<N>& buffer) -> std::expected<std::size_t, Error>;
+
+/**
+ * @brief Checks the framing of @p encoded_payload without decoding it
+ *
+ * Walks only the channel and type headers against @p types and fails with
+ * the error decode_readings or Decoder::decode would return: PayloadEmpty,
+ * UnkwownDataType or BadPayloadFormat. Nothing is written, counted or
+ * traced, so it is cheap enough to drop malformed frames before queueing.
+ *
+ * @return Number of fields in the payload, to size the output of a decode
+ */
+auto validate(const TypeTable& types, std::span<const uint8_t> encoded_payload)
+    -> std::expected<std::size_t, Error>;
+
+// Same, against the Cayenne LPP v1 standard types
+auto validate(std::span<const uint8_t> encoded_payload) -> std::expected<std::size_t, Error>;
+
+// Outcome of validate() for one payload of a batch
+struct Validation
+{
+    Error error{Error::None};
+    // 0 unless error is None
+    std::size_t field_count{0};
+};
+
+/**
+ * @brief validate() over a batch of payloads, e.g. one recvmmsg() worth
+ *
+ * results[i] describes payloads[i]. Fails with BufferTooSmall, without
+ * checking anything, if @p results is shorter than @p payloads.
+ *
+ * @return Number of valid payloads
+ */
+auto validate_batch(const TypeTable& types, std::span<const std::span<const uint8_t>> payloads,
+                    std::span<Validation> results) -> std::expected<std::size_t, Error>;
+
+/**
+ * @brief Fixed-capacity output of CoreDecoder, meant to live on the stack
+ */
+template <std::size_t N>
+class ReadingBuffer
+{
+public:
+    [[nodiscard]] static constexpr auto capacity() -> std::size_t { return N; }
+    [[nodiscard]] auto size() const -> std::size_t { return count_; }
+    [[nodiscard]] auto empty() const -> bool { return count_ == 0; }
+
+    [[nodiscard]] auto operator[](std::size_t index) const -> const Reading&
+    {
+        return readings_[index];
+    }
+
+    [[nodiscard]] auto begin() const -> const Reading* { return readings_.data(); }
+    [[nodiscard]] auto end() const -> const Reading* { return readings_.data() + count_; }
+
+    [[nodiscard]] auto readings() const -> std::span<const Reading>
+    {
+        return std::span(readings_).first(count_);
+    }
+
+private:
+    template <std::size_t M>
+    friend auto decode_readings(const TypeTable& types, std::span<const uint8_t> encoded_payload,
+                                ReadingBuffer<M>& buffer) -> std::expected<std::size_t, Error>;
+
+    std::array<Reading, N> readings_{};
+    std::size_t count_{0};
+};
+
+template <std::size_t N>
+auto decode_readings(const TypeTable& types, std::span<const uint8_t> encoded_payload,
+                     ReadingBuffer<N>& buffer) -> std::expected<std::size_t, Error>
+{
+    auto result = decode_readings(types, encoded_payload, std::span<Reading>(buffer.readings_));
+    buffer.count_ = result ? *result : 0;
+    return result;
+}
+
+class CoreDecoder
+{
+public:
+    // Decoder for the Cayenne LPP v1 standard types
+    CoreDecoder();
+    explicit CoreDecoder(const TypeTable& types);
+
+    /**
+     * @brief Decodes into caller-provided storage
+     *
+     * Each field is written to @p readings as raw integers; nothing is
+     * allocated. Fails with BufferTooSmall if the payload has more fields
+     * than @p readings can hold.
+     *
+     * @return Number of readings written
+     */
+    auto decode(std::span<const uint8_t> encoded_payload, std::span<Reading> readings) const
+        -> std::expected<std::size_t, Error>;
+
+    // Scatter-gather input, see decode_readings(const TypeTable&, PayloadFragments, ...)
+    auto decode(PayloadFragments fragments, std::span<Reading> readings,
+                std::span<uint8_t> scratch) const -> std::expected<std::size_t, Error>;
+
+    template <std::size_t N>
+    auto decode(std::span<const uint8_t> encoded_payload, ReadingBuffer<N>& buffer) const
+        -> std::expected<std::size_t, Error>
+    {
+        return decode_readings(types_, encoded_payload, buffer);
+    }
+
+    // See cayene::decode_records
+    auto decode_records(std::span<const uint8_t> encoded_payload, std::span<TimedReading> records,
+                        uint32_t timestamp = 0) const -> std::expected<std::size_t, Error>;
+
+    // See cayene::validate
+    auto validate(std::span<const uint8_t> encoded_payload) const
+        -> std::expected<std::size_t, Error>;
+
+    // Registers a custom type, whose readings carry only their bytes
+    auto add_type(uint8_t type_id, std::size_t size) -> bool;
+
+    // Registers a length-prefixed type, see TypeTable::add_prefixed; the bytes include the length
+    auto add_prefixed_type(uint8_t type_id, std::size_t unit) -> bool;
+
+    [[nodiscard]] auto types() const -> const TypeTable& { return types_; }
+
+private:
+    TypeTable types_;
+};
+
+}  // namespace cayene
+
+#endif  // CAYENE_CORE_HPP
@@ -19,10 +19,10 @@ public:
     std::size_t size{0};
     uint8_t type_id{0};
     bool standard{false};
-    std::function<nlohmann::json(const std::span<uint8_t>&)> decoder_function;
+    std::function<nlohmann::json(std::span<const uint8_t>)> decoder_function;
 
     DataType(uint8_t type_id, std::string name, std::size_t size, bool standard = true,
-             std::function<nlohmann::json(const std::span<uint8_t>&)> decoder_function = nullptr)
+             std::function<nlohmann::json(std::span<const uint8_t>)> decoder_function = nullptr)
         : name(std::move(name)),
           size(size),
           type_id(type_id),
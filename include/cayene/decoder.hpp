@@ -13,52 +13,155 @@
 #include <cstddef>
 #include <cstdint>
 #include <expected>
+#include <functional>
 #include <span>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include <nlohmann/json.hpp>
 #include <sys/types.h>
+#include <sys/uio.h>
 
+#include "core.hpp"
 #include "data_type.hpp"
 #include "error.hpp"
+#include "reading.hpp"
+#include "registry.hpp"
 
 namespace cayene
 {
 using namespace nlohmann;
 using Json = nlohmann::json;
 
+namespace detail
+{
+class FragmentCursor;
+}
+
 class Decoder
 {
 private:
     std::unordered_map<uint8_t, DataType> data_types_;
+    // Sizes of the same types, used by decode_readings
+    CoreDecoder core_;
 
 public:
+    using DecoderFunction = std::function<Json(std::span<const uint8_t>)>;
+
     Decoder();
+    // Types of one tenant of a registry image, see registry.hpp
+    explicit Decoder(const TenantView& tenant);
     ~Decoder();
 
-    auto decode(const std::span<uint8_t>& encoded_payload) -> std::expected<Json, Error>;
-    void add_data_type(uint8_t type_id, const std::string& name, std::size_t size);
+    Decoder(const Decoder&) = default;
+    Decoder(Decoder&&) noexcept = default;
+    Decoder& operator=(const Decoder&) = default;
+    Decoder& operator=(Decoder&&) noexcept = default;
+
+    // Decoder that only knows the types added later, e.g. for an fPort with its own set
+    static auto without_standard_types() -> Decoder;
+
+    auto decode(std::span<const uint8_t> encoded_payload) const -> std::expected<Json, Error>;
+
+    // Same bytes from a string or std::byte buffer, without copying
+    auto decode(std::string_view encoded_payload) const -> std::expected<Json, Error>
+    {
+        return decode(as_payload(encoded_payload));
+    }
+
+    auto decode(std::span<const std::byte> encoded_payload) const -> std::expected<Json, Error>
+    {
+        return decode(as_payload(encoded_payload));
+    }
+
+    /**
+     * @brief Decodes a payload split across several receive buffers
+     *
+     * The fragments are read in place; only a field that straddles two of
+     * them is copied, to the stack, before it is converted.
+     */
+    auto decode(PayloadFragments fragments) const -> std::expected<Json, Error>;
+
+    // Same, straight from the buffers of a readv()/recvmsg()
+    auto decode(std::span<const iovec> buffers) const -> std::expected<Json, Error>;
+
+    /**
+     * @brief Decodes into caller-provided storage without building Json
+     *
+     * Same validation as decode(), but each field is written to @p readings as
+     * raw integers and nothing is allocated. Fails with BufferTooSmall if the
+     * payload has more fields than @p readings can hold. See CoreDecoder.
+     *
+     * @return Number of readings written
+     */
+    auto decode_readings(std::span<const uint8_t> encoded_payload,
+                         std::span<Reading> readings) const -> std::expected<std::size_t, Error>;
+
+    // Scatter-gather input, see decode_readings(const TypeTable&, PayloadFragments, ...)
+    auto decode_readings(PayloadFragments fragments, std::span<Reading> readings,
+                         std::span<uint8_t> scratch) const -> std::expected<std::size_t, Error>;
+
+    // Several timestamped samples per payload, see cayene::decode_records in core.hpp
+    auto decode_records(std::span<const uint8_t> encoded_payload, std::span<TimedReading> records,
+                        uint32_t timestamp = 0) const -> std::expected<std::size_t, Error>;
+
+    // Framing check only, see cayene::validate in core.hpp
+    auto validate(std::span<const uint8_t> encoded_payload) const
+        -> std::expected<std::size_t, Error>;
+
+    /**
+     * @brief Registers a custom type
+     *
+     * Without @p decoder_function the field decodes to an array of its bytes.
+     * Type definition files (type_config.hpp) register their layouts here.
+     *
+     * @return false if the type already exists or @p size is not in [1, 255]
+     */
+    bool add_data_type(uint8_t type_id, const std::string& name, std::size_t size,
+                       DecoderFunction decoder_function = nullptr);
+
+    /**
+     * @brief Registers a length-prefixed custom type, see TypeTable::add_prefixed
+     *
+     * @p decoder_function receives the whole field, length byte first.
+     *
+     * @return false if the type already exists or @p unit is not in [1, 255]
+     */
+    bool add_prefixed_data_type(uint8_t type_id, const std::string& name, std::size_t unit,
+                                DecoderFunction decoder_function = nullptr);
+
+    // Field sizes of the registered types, for framing without decoding
+    [[nodiscard]] auto types() const -> const TypeTable& { return core_.types(); }
 
 private:
-    static int16_t bytes_to_int16(const std::span<uint8_t>& data_span);
-    static uint16_t bytes_to_uint16(const std::span<uint8_t>& data_span);
-    static int32_t bytes_to_int24(const std::span<uint8_t>& data_span);
-    static uint32_t bytes_to_uint24(const std::span<uint8_t>& data_span);
+    struct NoStandardTypes
+    {
+    };
+    explicit Decoder(NoStandardTypes /*tag*/);
+
+    // Contiguous payloads get their own loop; the cursor is only for split ones
+    auto decode_payload(std::span<const uint8_t> encoded_payload) const
+        -> std::expected<Json, Error>;
+    auto decode_payload(detail::FragmentCursor& cursor) const -> std::expected<Json, Error>;
+    // Key and value of one delimited field; false if a standard type id is not handled
+    auto decode_field(Json& decoded_json, uint8_t channel, const DataType& data_type,
+                      std::span<const uint8_t> field_span) const -> bool;
 
     // Decoding functions for standard data types
     // Is assumed that the data_span passed to these functions has the correct size
-    static uint8_t decode_digital_input(const std::span<uint8_t>& data_span);
-    static uint8_t decode_digital_output(const std::span<uint8_t>& data_span);
-    static double decode_analog_input(const std::span<uint8_t>& data_span);
-    static double decode_analog_output(const std::span<uint8_t>& data_span);
-    static uint16_t decode_luminosity(const std::span<uint8_t>& data_span);
-    static uint8_t decode_presence(const std::span<uint8_t>& data_span);
-    static double decode_temperature(const std::span<uint8_t>& data_span);
-    static double decode_humidity(const std::span<uint8_t>& data_span);
-    static Json decode_accelerometer(const std::span<uint8_t>& data_span);
-    static double decode_barometer(const std::span<uint8_t>& data_span);
-    static double decode_gyrometer(const std::span<uint8_t>& data_span);
-    static Json decode_gps(const std::span<uint8_t>& data_span);
+    static uint8_t decode_digital_input(std::span<const uint8_t> data_span);
+    static uint8_t decode_digital_output(std::span<const uint8_t> data_span);
+    static double decode_analog_input(std::span<const uint8_t> data_span);
+    static double decode_analog_output(std::span<const uint8_t> data_span);
+    static uint16_t decode_luminosity(std::span<const uint8_t> data_span);
+    static uint8_t decode_presence(std::span<const uint8_t> data_span);
+    static double decode_temperature(std::span<const uint8_t> data_span);
+    static double decode_humidity(std::span<const uint8_t> data_span);
+    static Json decode_accelerometer(std::span<const uint8_t> data_span);
+    static double decode_barometer(std::span<const uint8_t> data_span);
+    static double decode_gyrometer(std::span<const uint8_t> data_span);
+    static Json decode_gps(std::span<const uint8_t> data_span);
 };
 
 }  // namespace cayene
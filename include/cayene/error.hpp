@@ -10,6 +10,7 @@
  */
 
 #include <cstdint>
+#include <string_view>
 
 namespace cayene
 {
@@ -20,8 +21,30 @@ enum class Error : std::uint8_t
     Unexcepted = 1,
     UnkwownDataType = 2,
     BadPayloadFormat = 3,
-    PayloadEmpty = 4
+    PayloadEmpty = 4,
+    BufferTooSmall = 5
 };
+
+// Enumerator name of @p error, e.g. for metric labels and HTTP responses
+constexpr auto error_name(Error error) -> std::string_view
+{
+    switch (error)
+    {
+        case Error::None:
+            return "None";
+        case Error::Unexcepted:
+            return "Unexcepted";
+        case Error::UnkwownDataType:
+            return "UnkwownDataType";
+        case Error::BadPayloadFormat:
+            return "BadPayloadFormat";
+        case Error::PayloadEmpty:
+            return "PayloadEmpty";
+        case Error::BufferTooSmall:
+            return "BufferTooSmall";
+    }
+    return "Unknown";
+}
 }
 
 #endif  // CAYENE_DECODER_ERROR_HPP
\ No newline at end of file
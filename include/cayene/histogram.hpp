@@ -0,0 +1,174 @@
+#ifndef CAYENE_HISTOGRAM_HPP
+#define CAYENE_HISTOGRAM_HPP
+
+/**
+ * @file histogram.hpp
+ * @brief Log-linear (HDR style) histograms for latency recording
+ *
+ * Values below 2^sub_bucket_bits get an exact bucket each. Above that every
+ * power of two is split into 2^(sub_bucket_bits - 1) equal buckets, so a
+ * bucket is never wider than ~3% of the values it holds. Bucket
+ * layout is fixed at compile time, which makes histograms recorded on
+ * different threads mergeable by adding counts.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace cayene::metrics
+{
+
+inline constexpr unsigned histogram_sub_bucket_bits = 6;
+// ~18 minutes in nanoseconds, larger values are clamped
+inline constexpr uint64_t histogram_max_value = (uint64_t{1} << 40U) - 1;
+
+constexpr auto histogram_bucket_index(uint64_t value) -> std::size_t
+{
+    constexpr uint64_t linear_limit = uint64_t{1} << histogram_sub_bucket_bits;
+    constexpr uint64_t half = linear_limit / 2;
+
+    value = std::min(value, histogram_max_value);
+    if (value < linear_limit)
+    {
+        return static_cast<std::size_t>(value);
+    }
+    const auto shift = static_cast<unsigned>(std::bit_width(value)) - histogram_sub_bucket_bits;
+    return static_cast<std::size_t>(shift * half + (value >> shift));
+}
+
+constexpr auto histogram_bucket_lower(std::size_t index) -> uint64_t
+{
+    constexpr std::size_t linear_limit = std::size_t{1} << histogram_sub_bucket_bits;
+    constexpr std::size_t half = linear_limit / 2;
+
+    if (index < linear_limit)
+    {
+        return index;
+    }
+    const auto shift = static_cast<unsigned>(index / half - 1);
+    const uint64_t sub_bucket = half + index % half;
+    return sub_bucket << shift;
+}
+
+constexpr auto histogram_bucket_upper(std::size_t index) -> uint64_t
+{
+    return histogram_bucket_lower(index + 1) - 1;
+}
+
+inline constexpr std::size_t histogram_bucket_count =
+    histogram_bucket_index(histogram_max_value) + 1;
+
+/**
+ * @brief Plain histogram, used for snapshots, merging and percentile queries
+ */
+class Histogram
+{
+public:
+    void record(uint64_t value, uint64_t count = 1)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        counts_[histogram_bucket_index(value)] += count;
+        total_ += count;
+        sum_ += value * count;
+        max_ = std::max(max_, value);
+    }
+
+    // Raises the tracked maximum without adding a sample, used when re-bucketing
+    void record_max(uint64_t value) { max_ = std::max(max_, value); }
+
+    void merge(const Histogram& other)
+    {
+        for (std::size_t i = 0; i < histogram_bucket_count; ++i)
+        {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    /**
+     * @brief Value at quantile q in [0, 1]
+     *
+     * Reports the upper edge of the bucket holding the quantile (capped at
+     * the recorded maximum), i.e. the highest value equivalent to it.
+     */
+    [[nodiscard]] auto percentile(double q) const -> uint64_t
+    {
+        if (total_ == 0)
+        {
+            return 0;
+        }
+        q = std::clamp(q, 0.0, 1.0);
+        auto rank = static_cast<uint64_t>(q * static_cast<double>(total_) + 0.5);
+        rank = std::clamp<uint64_t>(rank, 1, total_);
+
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < histogram_bucket_count; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+            {
+                return std::min(histogram_bucket_upper(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    [[nodiscard]] auto count() const -> uint64_t { return total_; }
+    [[nodiscard]] auto sum() const -> uint64_t { return sum_; }
+    [[nodiscard]] auto max() const -> uint64_t { return max_; }
+    [[nodiscard]] auto bucket(std::size_t index) const -> uint64_t { return counts_[index]; }
+
+private:
+    std::array<uint64_t, histogram_bucket_count> counts_{};
+    uint64_t total_{0};
+    uint64_t sum_{0};
+    uint64_t max_{0};
+};
+
+/**
+ * @brief Histogram written by a single thread and read concurrently
+ *
+ * Same single-writer rule as the metric shards: recording is a relaxed load
+ * and store, readers copy counts out with relaxed loads and never block the
+ * writer.
+ */
+class AtomicHistogram
+{
+public:
+    void record(uint64_t value)
+    {
+        auto& bucket = counts_[histogram_bucket_index(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (value > max_.load(std::memory_order_relaxed))
+        {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    [[nodiscard]] auto bucket(std::size_t index) const -> uint64_t
+    {
+        return counts_[index].load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto max() const -> uint64_t { return max_.load(std::memory_order_relaxed); }
+
+private:
+    std::array<std::atomic<uint64_t>, histogram_bucket_count> counts_{};
+    std::atomic<uint64_t> max_{0};
+};
+
+}  // namespace cayene::metrics
+
+#endif  // CAYENE_HISTOGRAM_HPP
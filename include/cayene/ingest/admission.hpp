@@ -0,0 +1,127 @@
+#ifndef CAYENE_INGEST_ADMISSION_HPP
+#define CAYENE_INGEST_ADMISSION_HPP
+
+/**
+ * @file admission.hpp
+ * @brief Per-device rate limiting in front of the decoder
+ *
+ * A device flooding uplinks (typically a firmware bug) should not take
+ * decode capacity from everyone else. AdmissionControl gives every device
+ * a token bucket of `rate` tokens per second holding up to `burst`
+ * tokens; an uplink without a token is dropped before it is decoded.
+ *
+ * The buckets live in a fixed open-addressing table of cache-line sized
+ * slots keyed by a 64-bit hash of the device id. Each bucket is kept as
+ * its theoretical arrival time (the GCRA form of a token bucket), so
+ * admit() is one compare-and-swap on the device's slot and never takes a
+ * lock. A device's slot is claimed the first time it is seen; claiming
+ * makes concurrent lookups of that slot wait until it is initialized.
+ * Slots are never evicted: size the table for the fleet. When no slot is
+ * free within max_probes, admit_untracked decides.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cayene::ingest
+{
+
+struct AdmissionPolicy
+{
+    // Sustained uplinks per second; 0 disables the limit
+    double rate{1.0};
+    // Uplinks accepted back to back after an idle period
+    double burst{10.0};
+};
+
+struct AdmissionConfig
+{
+    AdmissionPolicy policy{};
+    // Devices with their own policy, e.g. gateways that batch readings
+    std::map<std::string, AdmissionPolicy, std::less<>> device_policies{};
+    // Rounded up to a power of two; 64 bytes each
+    std::size_t capacity{16384};
+    std::size_t max_probes{32};
+    // Devices that find the table full: fail open or closed
+    bool admit_untracked{true};
+};
+
+struct AdmissionStats
+{
+    uint64_t devices{0};
+    uint64_t admitted{0};
+    uint64_t dropped{0};
+    // Devices that got no slot; decided by admit_untracked
+    uint64_t untracked{0};
+};
+
+struct DeviceAdmission
+{
+    // Truncated to 31 bytes
+    std::string device_id;
+    uint64_t admitted{0};
+    uint64_t dropped{0};
+};
+
+class AdmissionControl
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit AdmissionControl(AdmissionConfig config = {});
+
+    /**
+     * @brief Takes a token from the bucket of @p device_id; thread safe
+     * @return false if the device is over its rate and the uplink must be dropped
+     */
+    auto admit(std::string_view device_id, Clock::time_point now = Clock::now()) -> bool;
+
+    [[nodiscard]] auto stats() const -> AdmissionStats;
+    [[nodiscard]] auto device(std::string_view device_id) const -> std::optional<DeviceAdmission>;
+    // The @p count devices with the most dropped uplinks, most first
+    [[nodiscard]] auto top_dropped(std::size_t count) const -> std::vector<DeviceAdmission>;
+
+private:
+    static constexpr std::size_t name_size = 32;
+
+    struct alignas(64) Slot
+    {
+        // 0 free, 1 being claimed, otherwise the device hash
+        std::atomic<uint64_t> key{0};
+        // Theoretical arrival time in ns; the bucket is full when it is <= now
+        std::atomic<int64_t> arrival{0};
+        std::atomic<uint64_t> admitted{0};
+        std::atomic<uint64_t> dropped{0};
+        // Written before the key is published
+        int64_t interval{0};
+        int64_t tolerance{0};
+    };
+
+    [[nodiscard]] auto find(uint64_t hash) const -> const Slot*;
+    auto find_or_claim(uint64_t hash, std::string_view device_id) -> Slot*;
+    [[nodiscard]] auto index_of(const Slot& slot) const -> std::size_t;
+    [[nodiscard]] auto snapshot(const Slot& slot) const -> DeviceAdmission;
+
+    AdmissionConfig config_;
+    std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    // Device ids, cold: only read by the reporting functions
+    std::unique_ptr<std::array<char, name_size>[]> names_;
+    std::atomic<uint64_t> untracked_{0};
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_ADMISSION_HPP
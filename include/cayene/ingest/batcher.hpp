@@ -0,0 +1,182 @@
+#ifndef CAYENE_INGEST_BATCHER_HPP
+#define CAYENE_INGEST_BATCHER_HPP
+
+/**
+ * @file batcher.hpp
+ * @brief Adaptive micro-batching stage in front of the decoder
+ *
+ * Receivers submit() raw uplinks; a worker thread decodes them in batches
+ * and hands each batch to the handler in one call. A batch is closed when
+ * it reaches the target size or when its oldest uplink would otherwise
+ * miss the latency budget, whichever comes first.
+ *
+ * The target adapts to the traffic. The worker keeps moving averages of
+ * the gap between arrivals and of the decode time per uplink, and sizes
+ * batches so that filling and decoding one fits in the budget:
+ *
+ *     target = budget / (arrival_gap + decode_cost), clamped to
+ *              [min_batch, max_batch]
+ *
+ * Under light traffic the target drops to one and every uplink is decoded
+ * as soon as it arrives; under load batches grow up to max_batch. drain()
+ * closes the open batch at once instead of waiting for its deadline.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "cayene/histogram.hpp"
+#include "cayene/type_config.hpp"
+#include "envelope.hpp"
+
+namespace cayene::ingest
+{
+
+struct BatcherConfig
+{
+    // Longest an uplink may wait in the batcher, decode included
+    std::chrono::microseconds latency_budget{2000};
+    std::size_t min_batch{1};
+    std::size_t max_batch{256};
+    // submit() refuses uplinks beyond this many waiting
+    std::size_t max_queued{4096};
+    // Weight of a new sample in the moving averages
+    double smoothing{0.125};
+};
+
+struct BatcherStats
+{
+    uint64_t uplinks{0};
+    // Payload rejected by the decoder; not handed to the handler
+    uint64_t rejected{0};
+    // Refused by submit() because the queue was full
+    uint64_t dropped{0};
+    uint64_t batches{0};
+    // Batches closed by reaching the target vs. by the deadline
+    uint64_t size_closed{0};
+    uint64_t deadline_closed{0};
+    // Current controller state
+    std::size_t target_batch{1};
+    std::chrono::nanoseconds arrival_gap{0};
+    std::chrono::nanoseconds decode_cost{0};
+    // Uplinks per batch, and nanoseconds from submit() to decode
+    metrics::Histogram batch_sizes;
+    metrics::Histogram queue_delay;
+};
+
+struct BatchedUplink
+{
+    Uplink uplink;
+    Json decoded;
+    // Passed through from submit(), e.g. the MQTT topic and packet id
+    std::string_view source;
+    uint64_t tag{0};
+};
+
+/**
+ * Called from the worker thread with every decoded batch. The views in the
+ * uplinks are only valid during the call.
+ */
+using BatchHandler = std::function<void(std::span<const BatchedUplink> batch)>;
+
+/**
+ * Called from the worker thread after the handler with the tags of every
+ * uplink of the batch, rejected ones included: the batcher is done with
+ * them, so a receiver can acknowledge them.
+ */
+using DoneHandler = std::function<void(std::span<const uint64_t> tags)>;
+
+class MicroBatcher
+{
+public:
+    MicroBatcher(BatcherConfig config, TypeCatalog catalog, BatchHandler handler,
+                 DoneHandler done = nullptr);
+    // Decodes and hands over whatever is still queued
+    ~MicroBatcher();
+
+    MicroBatcher(const MicroBatcher&) = delete;
+    MicroBatcher& operator=(const MicroBatcher&) = delete;
+    MicroBatcher(MicroBatcher&&) = delete;
+    MicroBatcher& operator=(MicroBatcher&&) = delete;
+
+    /**
+     * @brief Queues a copy of @p uplink and @p source; thread safe
+     * @return false if max_queued uplinks are already waiting
+     */
+    auto submit(const Uplink& uplink, std::string_view source = {}, uint64_t tag = 0) -> bool;
+
+    // Closes the open batch and blocks until everything submitted so far has been handed over
+    void drain();
+
+    [[nodiscard]] auto stats() const -> BatcherStats;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Owned copy of an Uplink; entries are reused so strings keep their capacity
+    struct Entry
+    {
+        EnvelopeFormat format{EnvelopeFormat::TheThingsStack};
+        std::string device_id;
+        uint8_t fport{0};
+        std::vector<uint8_t> payload;
+        std::string source;
+        uint64_t tag{0};
+        Clock::time_point arrival;
+    };
+
+    struct Queue
+    {
+        std::vector<Entry> entries;
+        std::size_t size{0};
+    };
+
+    void run();
+    void decode_batch(const Queue& queue, std::size_t first, std::size_t count);
+    // Batch size that fits the budget with the current averages
+    [[nodiscard]] auto compute_target() const -> std::size_t;
+    [[nodiscard]] auto deadline() const -> Clock::time_point;
+
+    BatcherConfig config_;
+    TypeCatalog catalog_;
+    BatchHandler handler_;
+    DoneHandler done_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable batch_ready_;
+    std::condition_variable batch_done_;
+    // Producers append to front_; the worker swaps it with back_ and decodes
+    Queue front_;
+    Queue back_;
+    Clock::time_point last_arrival_;
+    double arrival_gap_ns_{0};
+    double decode_cost_ns_{0};
+    std::size_t target_{1};
+    uint64_t submitted_{0};
+    uint64_t handed_over_{0};
+    // drain() waits for everything up to here: those batches close without a deadline
+    uint64_t flush_to_{0};
+    bool closing_{false};
+    BatcherStats stats_;
+
+    // Worker only
+    std::vector<BatchedUplink> batch_;
+    std::vector<uint64_t> tags_;
+    std::thread thread_;
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_BATCHER_HPP
@@ -0,0 +1,128 @@
+#ifndef CAYENE_INGEST_CALIBRATION_HPP
+#define CAYENE_INGEST_CALIBRATION_HPP
+
+/**
+ * @file calibration.hpp
+ * @brief Per-sensor linear calibration of raw readings
+ *
+ * CalibrationTable holds a gain and offset per (device, channel, type).
+ * The LPP scale of the type is folded into the gain when the table is
+ * built, so calibrate() turns a raw integer into its calibrated value with
+ * one multiply-add instead of a division followed by the calibration:
+ *
+ *     value = raw * (gain / scale) + offset
+ *
+ * Devices are found through a minimal perfect hash (perfect_hash.hpp);
+ * the coefficients of a device are contiguous in flat arrays. calibrate()
+ * first gathers raw components and coefficients of a batch of readings
+ * into small arrays, then runs the multiply-add over them in a loop the
+ * compiler vectorizes.
+ *
+ * Calibration file format, one sensor per line, '#' starts a comment:
+ *
+ *     device_id,channel,type_id,gain[,offset]
+ *
+ * type_id is decimal or 0x-prefixed hex. gain and offset apply to the
+ * value in its unit, to every component of multi-component types.
+ *
+ * annotate() is the output stage of the daemons (--calibration): it
+ * replaces the decoded Json values of calibrated sensors with their
+ * calibrated values.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "cayene/error.hpp"
+#include "cayene/ingest/envelope.hpp"
+#include "cayene/ingest/perfect_hash.hpp"
+#include "cayene/reading.hpp"
+#include "cayene/type_config.hpp"
+
+namespace cayene::ingest
+{
+
+struct CalibrationEntry
+{
+    std::string device_id;
+    uint8_t channel{0};
+    uint8_t type_id{0};
+    double gain{1.0};
+    double offset{0.0};
+};
+
+class CalibrationTable
+{
+public:
+    // Invalid if a (device, channel, type) appears twice
+    static auto build(std::span<const CalibrationEntry> entries)
+        -> std::expected<CalibrationTable, ConfigError>;
+    static auto parse(std::string_view text) -> std::expected<CalibrationTable, ConfigError>;
+    static auto load(const std::string& path) -> std::expected<CalibrationTable, ConfigError>;
+
+    /**
+     * @brief Writes the calibrated value of every component of @p readings
+     *
+     * Values are written to @p values in reading order, one per component;
+     * custom types have none. Readings without coefficients get the plain
+     * LPP scale, as Reading::value(). Nothing is allocated. Fails with
+     * BufferTooSmall, writing nothing, if @p values is too short.
+     *
+     * @return Number of values written
+     */
+    auto calibrate(std::string_view device_id, std::span<const Reading> readings,
+                   std::span<double> values) const -> std::expected<std::size_t, Error>;
+
+    /**
+     * @brief Writes the calibrated values of @p uplink into `object["decoded"]`
+     *
+     * @p readings are the raw readings of the uplink's payload, decoded once
+     * by the caller and shared with the other stages. Only sensors with
+     * coefficients are rewritten, in place: a number for single-component
+     * types, the members of the Accelerometer and GPS objects otherwise.
+     * Devices without coefficients cost one hash lookup.
+     *
+     * @return Number of sensors rewritten
+     */
+    auto annotate(const Uplink& uplink, std::span<const Reading> readings, Json& object) const
+        -> std::size_t;
+
+    // Sensors with coefficients
+    [[nodiscard]] auto size() const -> std::size_t { return fields_.size(); }
+    [[nodiscard]] auto devices() const -> std::size_t { return device_keys_.size(); }
+    [[nodiscard]] auto memory_bytes() const -> std::size_t;
+
+private:
+    struct Coefficients
+    {
+        // gain / scale of each component
+        std::array<double, 3> multiplier{};
+        double offset{0.0};
+    };
+
+    // Range of the device's sensors in fields_; empty if it has none
+    [[nodiscard]] auto sensors(std::string_view device_id) const
+        -> std::pair<std::size_t, std::size_t>;
+
+    PerfectHash hash_;
+    // Indexed by the slot of the device
+    std::vector<uint64_t> device_keys_;
+    std::vector<uint32_t> first_;
+    // channel << 8 | type_id of each sensor, sensors of a device contiguous
+    std::vector<uint16_t> fields_;
+    std::vector<Coefficients> coefficients_;
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_CALIBRATION_HPP
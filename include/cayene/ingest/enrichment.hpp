@@ -0,0 +1,172 @@
+#ifndef CAYENE_INGEST_ENRICHMENT_HPP
+#define CAYENE_INGEST_ENRICHMENT_HPP
+
+/**
+ * @file enrichment.hpp
+ * @brief Device metadata join over a minimal perfect hash
+ *
+ * DeviceIndex maps device ids (DevEUIs) to their site, tenant and
+ * calibration. It is built once from the device list: a minimal perfect
+ * hash (perfect_hash.hpp) gives every device its own slot in a flat array
+ * of 24-byte records, with a 4-byte displacement per bucket of about four
+ * devices. A lookup reads one displacement and one record; the record
+ * stores the device key, so unknown devices are rejected. Site and tenant
+ * names are interned once per index.
+ *
+ * DeviceEnricher owns the current index and rebuilds it on a background
+ * thread when the device list file changes. Lookups always see a
+ * complete index, the old one until the new one is swapped in.
+ *
+ * Device list format, one device per line, '#' starts a comment:
+ *
+ *     device_id,site,tenant[,gain[,offset]]
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "cayene/decoder.hpp"
+#include "cayene/ingest/perfect_hash.hpp"
+#include "cayene/type_config.hpp"
+
+namespace cayene::ingest
+{
+
+struct DeviceMetadata
+{
+    std::string device_id;
+    std::string site;
+    std::string tenant;
+    // Applied by the consumer as gain * value + offset
+    float gain{1.0F};
+    float offset{0.0F};
+};
+
+struct DeviceInfo
+{
+    std::string_view site;
+    std::string_view tenant;
+    float gain{1.0F};
+    float offset{0.0F};
+};
+
+class DeviceIndex
+{
+public:
+    // Invalid if a device id appears twice
+    static auto build(std::span<const DeviceMetadata> devices)
+        -> std::expected<DeviceIndex, ConfigError>;
+    static auto parse(std::string_view text) -> std::expected<DeviceIndex, ConfigError>;
+    static auto load(const std::string& path) -> std::expected<DeviceIndex, ConfigError>;
+
+    [[nodiscard]] auto find(std::string_view device_id) const -> std::optional<DeviceInfo>;
+
+    /**
+     * @brief Adds a "device" member with the metadata of @p device_id to @p object
+     * @return false, leaving @p object alone, if the device is unknown
+     */
+    auto enrich(std::string_view device_id, Json& object) const -> bool;
+
+    [[nodiscard]] auto size() const -> std::size_t { return records_.size(); }
+    // Displacements, records and interned names
+    [[nodiscard]] auto memory_bytes() const -> std::size_t;
+
+private:
+    struct Record
+    {
+        uint64_t key{0};
+        uint32_t site{0};
+        uint32_t tenant{0};
+        float gain{1.0F};
+        float offset{0.0F};
+    };
+
+    PerfectHash hash_;
+    std::vector<Record> records_;
+    std::vector<std::string> names_;
+};
+
+struct EnricherStats
+{
+    uint64_t reloads{0};
+    uint64_t failed_reloads{0};
+    std::size_t devices{0};
+    // Message of the last failed reload, empty after a successful one
+    std::string last_error;
+};
+
+class DeviceEnricher
+{
+public:
+    /**
+     * @brief Loads @p path and watches it for changes
+     *
+     * The file is checked every @p check_interval; a changed file is
+     * rebuilt on the watcher thread and swapped in if it is valid.
+     */
+    static auto open(const std::string& path,
+                     std::chrono::milliseconds check_interval = std::chrono::seconds(5))
+        -> std::expected<std::unique_ptr<DeviceEnricher>, ConfigError>;
+
+    ~DeviceEnricher();
+
+    DeviceEnricher(const DeviceEnricher&) = delete;
+    DeviceEnricher& operator=(const DeviceEnricher&) = delete;
+    DeviceEnricher(DeviceEnricher&&) = delete;
+    DeviceEnricher& operator=(DeviceEnricher&&) = delete;
+
+    // Index to use for a whole batch; stays valid after a reload
+    [[nodiscard]] auto index() const -> std::shared_ptr<const DeviceIndex>
+    {
+        return index_.load(std::memory_order_acquire);
+    }
+
+    // See DeviceIndex::enrich; thread safe
+    auto enrich(std::string_view device_id, Json& object) const -> bool
+    {
+        return index()->enrich(device_id, object);
+    }
+
+    // Checks the file now instead of at the next interval
+    void reload();
+
+    [[nodiscard]] auto stats() const -> EnricherStats;
+
+private:
+    DeviceEnricher(std::string path, std::chrono::milliseconds check_interval,
+                   DeviceIndex index, std::filesystem::file_time_type modified);
+
+    void watch();
+    void check();
+
+    std::string path_;
+    std::chrono::milliseconds check_interval_;
+    std::atomic<std::shared_ptr<const DeviceIndex>> index_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_{false};
+    std::filesystem::file_time_type modified_;
+    EnricherStats stats_;
+    std::thread thread_;
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_ENRICHMENT_HPP
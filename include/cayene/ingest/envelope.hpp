@@ -0,0 +1,84 @@
+#ifndef CAYENE_INGEST_ENVELOPE_HPP
+#define CAYENE_INGEST_ENVELOPE_HPP
+
+/**
+ * @file envelope.hpp
+ * @brief Uplink extraction from LoRaWAN network server webhooks
+ *
+ * Network servers wrap the device payload in a JSON envelope with the
+ * payload in base64. parse_envelope() pulls out the device, the fPort and
+ * the payload without building a DOM: it scans only the members it needs
+ * and decodes the base64 into caller-provided storage.
+ *
+ * Supported envelopes:
+ * - The Things Stack v3: end_device_ids.device_id, uplink_message.f_port,
+ *   uplink_message.frm_payload
+ * - ChirpStack v4: deviceInfo.devEui, fPort, data
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string_view>
+
+namespace cayene::ingest
+{
+
+enum class EnvelopeFormat : std::uint8_t
+{
+    TheThingsStack,
+    ChirpStack
+};
+
+enum class EnvelopeError : std::uint8_t
+{
+    Malformed = 1,
+    UnknownFormat = 2,
+    // Uplinks without application payload, e.g. MAC-only frames on fPort 0
+    MissingPayload = 3,
+    BadBase64 = 4,
+    PayloadTooLarge = 5
+};
+
+struct Uplink
+{
+    EnvelopeFormat format{EnvelopeFormat::TheThingsStack};
+    // Raw JSON string contents, escapes are not resolved
+    std::string_view device_id;
+    uint8_t fport{0};
+    std::span<const uint8_t> payload;
+};
+
+// Largest output of base64_decode for @p encoded_size characters
+constexpr auto base64_decoded_size(std::size_t encoded_size) -> std::size_t
+{
+    return (encoded_size + 3) / 4 * 3;
+}
+
+/**
+ * @brief Decodes standard base64 (padding optional) into @p out
+ *
+ * @return Bytes written, BadBase64 on invalid input, PayloadTooLarge if
+ *         @p out is too small
+ */
+auto base64_decode(std::string_view text, std::span<uint8_t> out)
+    -> std::expected<std::size_t, EnvelopeError>;
+
+/**
+ * @brief Extracts the uplink of a webhook body
+ *
+ * The payload is decoded into @p payload_storage; the device id points
+ * into @p body.
+ */
+auto parse_envelope(std::string_view body, std::span<uint8_t> payload_storage)
+    -> std::expected<Uplink, EnvelopeError>;
+
+auto envelope_error_name(EnvelopeError error) -> std::string_view;
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_ENVELOPE_HPP
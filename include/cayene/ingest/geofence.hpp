@@ -0,0 +1,174 @@
+#ifndef CAYENE_INGEST_GEOFENCE_HPP
+#define CAYENE_INGEST_GEOFENCE_HPP
+
+/**
+ * @file geofence.hpp
+ * @brief Geofence enter/exit events from GPS readings
+ *
+ * GeofenceIndex holds polygons in the raw GPS units of LPP (1e-4 degree)
+ * and tests points in those units, with exact 64-bit integer arithmetic:
+ * a GPS Reading is evaluated as decoded, never converted to doubles. A
+ * uniform grid over the polygons' bounding box lists, for each cell, the
+ * polygons whose bounding box overlaps it, so a point is only tested
+ * against the few polygons near it.
+ *
+ * GeofenceTracker keeps the polygons each device was last inside and
+ * reports only the transitions. It is sharded by device and safe to call
+ * from every decode worker.
+ *
+ * Polygons do not cross the antimeridian. Geofence file format:
+ *
+ *     {"fences": [{"name": "depot", "polygon": [[lat, lon], ...]}, ...]}
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "cayene/ingest/envelope.hpp"
+#include "cayene/reading.hpp"
+#include "cayene/type_config.hpp"
+
+namespace cayene::ingest
+{
+
+inline constexpr uint8_t gps_type_id = 0x88;
+
+// Raw LPP GPS coordinates, 1e-4 degree
+struct GeoPoint
+{
+    int32_t lat{0};
+    int32_t lon{0};
+};
+
+struct Geofence
+{
+    std::string name;
+    // At least 3 vertices, the last one joined to the first
+    std::vector<GeoPoint> polygon;
+};
+
+class GeofenceIndex
+{
+public:
+    // Invalid if a polygon has fewer than 3 vertices or a name repeats
+    static auto build(std::vector<Geofence> fences) -> std::expected<GeofenceIndex, ConfigError>;
+    static auto parse(std::string_view text) -> std::expected<GeofenceIndex, ConfigError>;
+    static auto load(const std::string& path) -> std::expected<GeofenceIndex, ConfigError>;
+
+    /**
+     * @brief Ids of the fences containing @p point, ascending, into @p fences
+     *
+     * @p fences is cleared first. Points on an edge may fall either way.
+     */
+    void containing(GeoPoint point, std::vector<uint32_t>& fences) const;
+
+    [[nodiscard]] auto name(uint32_t fence) const -> std::string_view
+    {
+        return fences_[fence].name;
+    }
+    [[nodiscard]] auto size() const -> std::size_t { return fences_.size(); }
+    [[nodiscard]] auto cells() const -> std::size_t { return cell_start_.size() - 1; }
+
+private:
+    struct Box
+    {
+        GeoPoint min;
+        GeoPoint max;
+    };
+
+    [[nodiscard]] auto inside(uint32_t fence, GeoPoint point) const -> bool;
+
+    std::vector<Geofence> fences_;
+    std::vector<Box> boxes_;
+    // Grid over the bounding box of every fence
+    Box bounds_{};
+    int64_t cell_size_{1};
+    std::size_t columns_{0};
+    std::size_t rows_{0};
+    // Fences of cell c are cell_fences_[cell_start_[c], cell_start_[c + 1])
+    std::vector<uint32_t> cell_start_{0};
+    std::vector<uint32_t> cell_fences_;
+};
+
+enum class GeofenceTransition : std::uint8_t
+{
+    Enter,
+    Exit
+};
+
+struct GeofenceEvent
+{
+    uint32_t fence{0};
+    GeofenceTransition transition{GeofenceTransition::Enter};
+};
+
+class GeofenceTracker
+{
+public:
+    explicit GeofenceTracker(std::shared_ptr<const GeofenceIndex> index);
+
+    /**
+     * @brief Moves @p device_id to @p point; thread safe
+     *
+     * A device seen for the first time enters every fence it is inside.
+     * Events are appended to @p events, exits first.
+     *
+     * @return Number of events appended
+     */
+    auto update(std::string_view device_id, GeoPoint point, std::vector<GeofenceEvent>& events)
+        -> std::size_t;
+
+    // Same for every GPS reading of an uplink, in order; other readings are skipped
+    auto update(std::string_view device_id, std::span<const Reading> readings,
+                std::vector<GeofenceEvent>& events) -> std::size_t;
+
+    /**
+     * @brief Updates the device of @p uplink and lists its transitions in @p object
+     *
+     * @p readings are the raw readings of the uplink's payload, decoded once
+     * by the caller and shared with the other stages. Transitions go to a
+     * "geofence" array of {"fence", "event"} members, "event" being "enter"
+     * or "exit"; @p object is left alone if there are none.
+     *
+     * @return Number of transitions
+     */
+    auto annotate(const Uplink& uplink, std::span<const Reading> readings, Json& object)
+        -> std::size_t;
+
+    // Same, decoding the payload with the types of its fPort in @p catalog
+    auto annotate(const TypeCatalog& catalog, const Uplink& uplink, Json& object)
+        -> std::size_t;
+
+    [[nodiscard]] auto index() const -> const GeofenceIndex& { return *index_; }
+    // Devices inside at least one fence; the others are not kept
+    [[nodiscard]] auto devices() const -> std::size_t;
+
+private:
+    static constexpr std::size_t shard_count = 64;
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        // Fences each device is inside, ascending
+        std::unordered_map<uint64_t, std::vector<uint32_t>> inside;
+    };
+
+    std::shared_ptr<const GeofenceIndex> index_;
+    std::array<Shard, shard_count> shards_;
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_GEOFENCE_HPP
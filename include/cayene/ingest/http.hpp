@@ -0,0 +1,74 @@
+#ifndef CAYENE_INGEST_HTTP_HPP
+#define CAYENE_INGEST_HTTP_HPP
+
+/**
+ * @file http.hpp
+ * @brief Zero-copy HTTP/1.1 request parser for the webhook ingest server
+ *
+ * parse_request() reads one request from the front of a connection buffer
+ * and fills an HttpRequest with views into that buffer: nothing is copied
+ * or allocated. Only what webhooks need is supported: Content-Length
+ * bodies, keep-alive and pipelining; chunked bodies are rejected.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string_view>
+
+namespace cayene::ingest
+{
+
+inline constexpr std::size_t max_http_headers = 32;
+
+struct HttpHeader
+{
+    std::string_view name;
+    std::string_view value;
+};
+
+struct HttpRequest
+{
+    std::string_view method;
+    std::string_view target;
+    // 0 for HTTP/1.0, 1 for HTTP/1.1
+    int version_minor{1};
+    std::array<HttpHeader, max_http_headers> headers{};
+    std::size_t header_count{0};
+    std::string_view body;
+    // Whether the connection stays open after the response
+    bool keep_alive{true};
+
+    // Value of header @p name (case-insensitive), empty if absent
+    [[nodiscard]] auto header(std::string_view name) const -> std::string_view;
+};
+
+enum class HttpError : std::uint8_t
+{
+    Malformed = 1,
+    // Headers or body larger than the limits, or too many headers
+    TooLarge = 2,
+    // Transfer-Encoding other than identity
+    NotImplemented = 3
+};
+
+/**
+ * @brief Parses the request at the front of @p buffer
+ *
+ * @param max_body Largest Content-Length accepted
+ * @return Bytes the request takes in @p buffer, or 0 if it is not complete
+ *         yet. @p request points into @p buffer and is valid while it is.
+ */
+auto parse_request(std::string_view buffer, HttpRequest& request, std::size_t max_body)
+    -> std::expected<std::size_t, HttpError>;
+
+// Status line for @p error, e.g. "400 Bad Request"
+auto http_status(HttpError error) -> std::string_view;
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_HTTP_HPP
@@ -0,0 +1,124 @@
+#ifndef CAYENE_INGEST_HTTP_SERVER_HPP
+#define CAYENE_INGEST_HTTP_SERVER_HPP
+
+/**
+ * @file http_server.hpp
+ * @brief Webhook ingest server: HTTP uplinks in, decoded Json out
+ *
+ * Each worker thread runs its own edge-triggered epoll loop over its own
+ * SO_REUSEPORT listening socket, so connections are spread by the kernel
+ * and never shared between threads. A read drains the socket, then every
+ * complete request in the buffer is handled in turn (pipelining) and all
+ * the responses leave in one send. Requests are parsed in place in the
+ * connection buffer, payloads are base64-decoded into a per-connection
+ * arena and decoded inline with the TypeCatalog profile of their fPort.
+ *
+ * Responses: 204 for a decoded uplink, 400 with the error name if the
+ * envelope or the payload is invalid, 404/405 for other targets/methods.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "admission.hpp"
+#include "cayene/reading.hpp"
+#include "cayene/type_config.hpp"
+#include "envelope.hpp"
+
+namespace cayene::ingest
+{
+
+struct HttpServerConfig
+{
+    std::string bind_address{"127.0.0.1"};
+    // 0 picks an ephemeral port
+    uint16_t port{0};
+    // Worker threads, 0 for one per CPU
+    unsigned threads{1};
+    // Pin worker i to CPU i
+    bool pin_threads{false};
+    // Target the network server posts to
+    std::string path{"/uplink"};
+    std::size_t max_body_size{64 * 1024};
+    // Unsent responses past which a connection is not read until the client catches up
+    std::size_t max_pending_output{256 * 1024};
+    // Largest decoded payload; the line writers decode max_payload_readings per uplink
+    std::size_t max_payload_size{max_payload_bytes};
+    // Per-device rate limit checked before decoding, answered with 429
+    std::optional<AdmissionConfig> admission{};
+};
+
+struct HttpServerStats
+{
+    uint64_t connections{0};
+    uint64_t requests{0};
+    uint64_t uplinks{0};
+    // Envelope or payload rejected, answered with 400
+    uint64_t rejected{0};
+    // Unparseable HTTP, the connection is closed
+    uint64_t bad_requests{0};
+    // Over the device's rate, answered with 429
+    uint64_t throttled{0};
+};
+
+/**
+ * Called from the worker threads for every decoded uplink; must be thread
+ * safe. @p decoded is only valid during the call.
+ */
+using UplinkHandler = std::function<void(const Uplink& uplink, const Json& decoded)>;
+
+class HttpServer
+{
+public:
+    HttpServer(HttpServerConfig config, TypeCatalog catalog, UplinkHandler handler = nullptr);
+    ~HttpServer();
+
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+    HttpServer(HttpServer&&) = delete;
+    HttpServer& operator=(HttpServer&&) = delete;
+
+    /**
+     * @brief Binds every worker's socket and starts serving
+     * @return The port actually bound
+     */
+    auto start() -> std::expected<uint16_t, std::error_code>;
+    void stop();
+
+    [[nodiscard]] auto port() const -> uint16_t { return config_.port; }
+    [[nodiscard]] auto running() const -> bool { return running_.load(); }
+    [[nodiscard]] auto stats() const -> HttpServerStats;
+    [[nodiscard]] auto catalog() const -> const TypeCatalog& { return catalog_; }
+    // Per-device counters, nullptr without config.admission
+    [[nodiscard]] auto admission() const -> const AdmissionControl* { return admission_.get(); }
+
+private:
+    class Worker;
+
+    HttpServerConfig config_;
+    TypeCatalog catalog_;
+    UplinkHandler handler_;
+    // Shared by the workers: a device's bucket is the same whichever one it reaches
+    std::unique_ptr<AdmissionControl> admission_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    // Counters of workers from previous start()/stop() cycles
+    HttpServerStats retired_;
+    std::atomic<bool> running_{false};
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_HTTP_SERVER_HPP
@@ -0,0 +1,130 @@
+#ifndef CAYENE_INGEST_LANES_HPP
+#define CAYENE_INGEST_LANES_HPP
+
+/**
+ * @file lanes.hpp
+ * @brief Priority lanes: alarm readings ahead of bulk telemetry
+ *
+ * Presence and digital input changes are alarms that should be handled
+ * within milliseconds, while GPS or accelerometer telemetry can wait for a
+ * larger batch. classify_lane() peeks at the type ids of the first fields
+ * of a payload, without decoding, and LanedBatcher routes each uplink to
+ * the MicroBatcher of its lane.
+ *
+ * Each lane has its own queue and its own worker thread, so the alarm lane
+ * keeps its capacity however far behind the bulk lane is: a full bulk
+ * queue refuses bulk uplinks only, and a slow bulk batch never delays an
+ * alarm batch.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <span>
+#include <string_view>
+
+#include "batcher.hpp"
+#include "cayene/core.hpp"
+#include "cayene/type_config.hpp"
+#include "envelope.hpp"
+
+namespace cayene::ingest
+{
+
+enum class Lane : std::uint8_t
+{
+    Alarm = 0,
+    Bulk = 1
+};
+
+inline constexpr std::size_t lane_count = 2;
+
+auto lane_name(Lane lane) -> std::string_view;
+
+/**
+ * @brief Set of type ids that send a payload to the alarm lane
+ */
+class AlarmTypes
+{
+public:
+    // Digital Input (0x00) and Presence (0x66)
+    AlarmTypes() : AlarmTypes({0x00, 0x66}) {}
+    AlarmTypes(std::initializer_list<uint8_t> type_ids)
+    {
+        for (const uint8_t type_id : type_ids)
+        {
+            alarm_[type_id] = true;
+        }
+    }
+
+    [[nodiscard]] auto contains(uint8_t type_id) const -> bool { return alarm_[type_id]; }
+
+private:
+    std::array<bool, type_table_size> alarm_{};
+};
+
+/**
+ * @brief Lane of a payload from the type ids of its first @p peek_fields fields
+ *
+ * Walks the channel/type headers with the sizes in @p types. Payloads with
+ * an unknown type or a truncated field go to the bulk lane; the decoder
+ * rejects them there.
+ */
+auto classify_lane(std::span<const uint8_t> encoded_payload, const TypeTable& types,
+                   const AlarmTypes& alarm_types, std::size_t peek_fields) -> Lane;
+
+struct LaneConfig
+{
+    AlarmTypes alarm_types;
+    // Fields inspected per payload; alarms are usually sent first
+    std::size_t peek_fields{4};
+    // Small batches and a short budget: alarms are rare and urgent
+    BatcherConfig alarm{.latency_budget = std::chrono::microseconds(200),
+                        .max_batch = 16,
+                        .max_queued = 1024};
+    BatcherConfig bulk{};
+};
+
+/**
+ * Called from the worker thread of @p lane; the two lanes may call it
+ * concurrently, so it must be thread safe.
+ */
+using LaneHandler = std::function<void(Lane lane, std::span<const BatchedUplink> batch)>;
+
+class LanedBatcher
+{
+public:
+    // @p done gets the tags of both lanes; like the handler it must be thread safe
+    LanedBatcher(LaneConfig config, const TypeCatalog& catalog, LaneHandler handler,
+                 DoneHandler done = nullptr);
+
+    /**
+     * @brief Classifies @p uplink and queues a copy in its lane; thread safe
+     * @return false if that lane's queue is full
+     */
+    auto submit(const Uplink& uplink, std::string_view source = {}, uint64_t tag = 0) -> bool;
+
+    // Closes the open batches and blocks until everything submitted so far has been handed over
+    void drain();
+
+    [[nodiscard]] auto stats(Lane lane) const -> BatcherStats;
+
+private:
+    [[nodiscard]] auto batcher(Lane lane) -> MicroBatcher&;
+
+    LaneConfig config_;
+    // Only for the per-fPort type sizes used by classify_lane()
+    TypeCatalog catalog_;
+    MicroBatcher alarm_;
+    MicroBatcher bulk_;
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_LANES_HPP
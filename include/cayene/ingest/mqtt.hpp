@@ -0,0 +1,104 @@
+#ifndef CAYENE_INGEST_MQTT_HPP
+#define CAYENE_INGEST_MQTT_HPP
+
+/**
+ * @file mqtt.hpp
+ * @brief MQTT 3.1.1 packet codec for the ingest layer
+ *
+ * parse_packet() reads one control packet from the front of a receive
+ * buffer and fills an MqttPacket with views into that buffer, like
+ * parse_request() does for HTTP. The append_* functions serialize the
+ * packets a QoS 0/1 subscriber exchanges with its broker; the broker side
+ * ones (CONNACK, SUBACK, PUBLISH, PINGRESP) exist for stub brokers in tests
+ * and tools.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace cayene::ingest
+{
+
+enum class MqttPacketType : std::uint8_t
+{
+    Connect = 1,
+    Connack = 2,
+    Publish = 3,
+    Puback = 4,
+    Subscribe = 8,
+    Suback = 9,
+    Pingreq = 12,
+    Pingresp = 13,
+    Disconnect = 14
+};
+
+struct MqttPacket
+{
+    MqttPacketType type{MqttPacketType::Connect};
+    // Low nibble of the fixed header
+    uint8_t flags{0};
+    // Variable header and payload
+    std::span<const uint8_t> body;
+
+    // PUBLISH with QoS > 0, PUBACK, SUBSCRIBE and SUBACK
+    uint16_t packet_id{0};
+    // PUBLISH only
+    uint8_t qos{0};
+    std::string_view topic;
+    std::span<const uint8_t> payload;
+};
+
+enum class MqttError : std::uint8_t
+{
+    Malformed = 1,
+    // Remaining length above the limit
+    TooLarge = 2,
+    // Packet types other than the ones in MqttPacketType, or QoS 2
+    Unsupported = 3
+};
+
+/**
+ * @brief Parses the control packet at the front of @p buffer
+ *
+ * @param max_packet Largest packet accepted, fixed header included
+ * @return Bytes the packet takes in @p buffer, or 0 if it is not complete
+ *         yet. @p packet points into @p buffer and is valid while it is.
+ */
+auto parse_packet(std::span<const uint8_t> buffer, MqttPacket& packet, std::size_t max_packet)
+    -> std::expected<std::size_t, MqttError>;
+
+/**
+ * @brief Whether @p topic matches the subscription @p filter
+ *
+ * Supports the single-level '+' and multi-level '#' wildcards.
+ */
+auto topic_matches(std::string_view filter, std::string_view topic) -> bool;
+
+auto mqtt_error_name(MqttError error) -> std::string_view;
+
+// Client to broker
+void append_connect(std::vector<uint8_t>& out, std::string_view client_id, uint16_t keep_alive,
+                    bool clean_session);
+void append_subscribe(std::vector<uint8_t>& out, uint16_t packet_id, std::string_view filter,
+                      uint8_t qos);
+void append_puback(std::vector<uint8_t>& out, uint16_t packet_id);
+void append_pingreq(std::vector<uint8_t>& out);
+void append_disconnect(std::vector<uint8_t>& out);
+
+// Broker to client
+void append_connack(std::vector<uint8_t>& out, uint8_t return_code);
+void append_suback(std::vector<uint8_t>& out, uint16_t packet_id, uint8_t granted_qos);
+void append_publish(std::vector<uint8_t>& out, std::string_view topic,
+                    std::span<const uint8_t> payload, uint8_t qos, uint16_t packet_id);
+void append_pingresp(std::vector<uint8_t>& out);
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_MQTT_HPP
@@ -0,0 +1,201 @@
+#ifndef CAYENE_INGEST_MQTT_SUBSCRIBER_HPP
+#define CAYENE_INGEST_MQTT_SUBSCRIBER_HPP
+
+/**
+ * @file mqtt_subscriber.hpp
+ * @brief Non-blocking MQTT 3.1.1 subscriber for network server uplinks
+ *
+ * ChirpStack (application/+/device/+/event/up) and The Things Stack
+ * (v3/+/devices/+/up) publish the same JSON envelopes over MQTT as over
+ * webhooks. MqttSubscriber subscribes with QoS 1 and is driven by poll():
+ * each call drains the socket, parses every complete PUBLISH in the
+ * receive buffer in place, decodes the uplinks in batches of up to
+ * max_batch and hands each batch to the handler. The PUBACKs of a batch
+ * are sent once the handler returns, in a single write, so a crash before
+ * that makes the broker redeliver (at-least-once).
+ *
+ * With config.lanes poll() submits the batch to a LanedBatcher and goes
+ * back to reading: the lane workers decode it, alarms ahead of bulk
+ * telemetry, and call the handler. Each worker queues the PUBACKs of the
+ * messages it has handed over and wakes poll() through ack_fd() to send
+ * them, so they still follow the hand-over.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "admission.hpp"
+#include "cayene/reading.hpp"
+#include "cayene/type_config.hpp"
+#include "envelope.hpp"
+#include "lanes.hpp"
+#include "mqtt.hpp"
+
+namespace cayene::ingest
+{
+
+struct MqttConfig
+{
+    // IPv4 address of the broker
+    std::string host{"127.0.0.1"};
+    uint16_t port{1883};
+    std::string client_id{"cayene"};
+    std::string topic{"application/+/device/+/event/up"};
+    // Seconds; a PINGREQ is sent when nothing else was
+    uint16_t keep_alive{60};
+    // false keeps the subscription and unacked messages across reconnects
+    bool clean_session{true};
+    // Uplinks decoded and handed over together
+    std::size_t max_batch{64};
+    std::size_t max_packet_size{64 * 1024};
+    // Largest decoded payload; the line writers decode max_payload_readings per uplink
+    std::size_t max_payload_size{max_payload_bytes};
+    // Per-device rate limit checked before decoding
+    std::optional<AdmissionConfig> admission{};
+    // Decode on alarm and bulk lane workers instead of inside poll()
+    std::optional<LaneConfig> lanes{};
+};
+
+struct MqttStats
+{
+    uint64_t messages{0};
+    uint64_t uplinks{0};
+    // Envelope or payload rejected; still acknowledged so it is not redelivered
+    uint64_t rejected{0};
+    // Over the device's rate; acknowledged and dropped
+    uint64_t throttled{0};
+    uint64_t batches{0};
+};
+
+struct MqttUplink
+{
+    std::string_view topic;
+    Uplink uplink;
+    Json decoded;
+};
+
+/**
+ * Called from poll() with every decoded batch. The views in the uplinks
+ * are only valid during the call. With config.lanes it is called from the
+ * two lane workers instead, possibly at the same time, so it must be
+ * thread safe.
+ */
+using MqttBatchHandler = std::function<void(std::span<const MqttUplink> batch)>;
+
+class MqttSubscriber
+{
+public:
+    MqttSubscriber(MqttConfig config, TypeCatalog catalog, MqttBatchHandler handler = nullptr);
+    ~MqttSubscriber();
+
+    MqttSubscriber(const MqttSubscriber&) = delete;
+    MqttSubscriber& operator=(const MqttSubscriber&) = delete;
+    MqttSubscriber(MqttSubscriber&&) = delete;
+    MqttSubscriber& operator=(MqttSubscriber&&) = delete;
+
+    /**
+     * @brief Connects, sends CONNECT and SUBSCRIBE and waits for the CONNACK
+     *
+     * The SUBACK is checked by poll(). Reconnecting is up to the caller.
+     */
+    auto connect(std::chrono::milliseconds timeout = std::chrono::seconds(5))
+        -> std::expected<void, std::error_code>;
+
+    /**
+     * @brief Waits up to @p timeout for data and processes it
+     * @return Uplinks delivered to the handler (with config.lanes, handed
+     *         over by the lane workers since the last call), or the error
+     *         that closed the connection
+     */
+    auto poll(std::chrono::milliseconds timeout) -> std::expected<std::size_t, std::error_code>;
+
+    // Waits for the lanes, sends their PUBACKs and DISCONNECT and closes the socket
+    void disconnect();
+
+    // Socket to wait on from an external event loop, -1 if not connected
+    [[nodiscard]] auto fd() const -> int { return fd_; }
+    // Readable when the lane workers have PUBACKs for poll(); -1 without config.lanes
+    [[nodiscard]] auto ack_fd() const -> int { return ack_fd_; }
+    // With config.lanes, rejected includes the payloads the lanes rejected
+    [[nodiscard]] auto stats() const -> MqttStats;
+    [[nodiscard]] auto catalog() const -> const TypeCatalog& { return catalog_; }
+    // Per-device counters, nullptr without config.admission
+    [[nodiscard]] auto admission() const -> const AdmissionControl* { return admission_.get(); }
+    // Per-lane counters, nullptr without config.lanes
+    [[nodiscard]] auto lanes() const -> const LanedBatcher* { return lanes_.get(); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // true if the buffer filled up before the socket was drained
+    auto receive() -> std::expected<bool, std::error_code>;
+    auto process_packets() -> std::expected<std::size_t, std::error_code>;
+    auto on_publish(const MqttPacket& packet) -> std::size_t;
+    auto deliver_batch() -> std::size_t;
+    auto deliver_laned() -> std::size_t;
+    void on_lane_batch(Lane lane, std::span<const BatchedUplink> batch);
+    void on_lane_done(std::span<const uint64_t> packet_ids);
+    // Appends the PUBACKs queued by the lane workers; returns the uplinks they handed over
+    auto collect_lane_acks() -> std::size_t;
+    auto flush() -> std::expected<void, std::error_code>;
+    void close();
+
+    MqttConfig config_;
+    TypeCatalog catalog_;
+    MqttBatchHandler handler_;
+    std::unique_ptr<AdmissionControl> admission_;
+    int fd_{-1};
+    uint16_t subscribe_id_{1};
+    Clock::time_point last_sent_;
+
+    std::vector<uint8_t> input_;
+    std::size_t input_size_{0};
+    // Packets that arrived with the CONNACK, not yet processed
+    bool buffered_{false};
+    std::vector<uint8_t> output_;
+    std::size_t output_sent_{0};
+
+    // Envelopes of the batch being filled, payloads in consecutive arena slots
+    std::vector<Uplink> pending_;
+    std::vector<std::string_view> pending_topics_;
+    // Acknowledged by the lane workers once handed over; 0 for QoS 0
+    std::vector<uint16_t> pending_packet_ids_;
+    std::vector<uint8_t> arena_;
+    std::vector<MqttUplink> batch_;
+    // PUBACKs owed once the current batch is handed over
+    std::vector<uint16_t> acks_;
+
+    MqttStats stats_;
+
+    // Entries each lane worker reuses between its batches
+    std::array<std::vector<MqttUplink>, lane_count> lane_batches_;
+    // Guards uplinks and batches in stats_, and lane_acks_, between the lane workers and poll()
+    mutable std::mutex lane_mutex_;
+    // PUBACKs owed by the lane workers, sent by poll()
+    std::vector<uint16_t> lane_acks_;
+    // stats_.uplinks at the last collect_lane_acks()
+    uint64_t reported_uplinks_{0};
+    // eventfd the lane workers signal when lane_acks_ stops being empty
+    int ack_fd_{-1};
+    // Last member: its workers are joined before anything they use goes away
+    std::unique_ptr<LanedBatcher> lanes_;
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_MQTT_SUBSCRIBER_HPP
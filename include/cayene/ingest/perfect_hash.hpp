@@ -0,0 +1,66 @@
+#ifndef CAYENE_INGEST_PERFECT_HASH_HPP
+#define CAYENE_INGEST_PERFECT_HASH_HPP
+
+/**
+ * @file perfect_hash.hpp
+ * @brief Minimal perfect hash over a fixed set of 64-bit keys
+ *
+ * PerfectHash maps each of n distinct keys to its own slot in [0, n)
+ * (PTHash-style hash and displace): keys are spread over buckets of about
+ * four, and every bucket stores the 4-byte displacement that places its
+ * keys on free slots. A lookup is two hashes and one displacement read.
+ * Keys outside the set also land on some slot, so tables built on it keep
+ * the key of every slot to reject them.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace cayene::ingest
+{
+
+/**
+ * @brief 64-bit key of a device id
+ *
+ * 16 hex digits (a DevEUI, either case) are read as their value; any other
+ * id is hashed.
+ */
+auto device_key(std::string_view device_id) -> uint64_t;
+
+class PerfectHash
+{
+public:
+    PerfectHash() = default;
+
+    /**
+     * @brief Builds the hash of @p keys, which must be distinct
+     * @return nullopt if no displacement fits, in practice only for duplicates
+     */
+    static auto build(std::span<const uint64_t> keys) -> std::optional<PerfectHash>;
+
+    // Slot of @p key; below size() unless the hash is empty
+    [[nodiscard]] auto operator()(uint64_t key) const -> std::size_t;
+
+    [[nodiscard]] auto size() const -> std::size_t { return count_; }
+    [[nodiscard]] auto empty() const -> bool { return count_ == 0; }
+    [[nodiscard]] auto memory_bytes() const -> std::size_t
+    {
+        return pilots_.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    uint64_t seed_{0};
+    std::size_t count_{0};
+    std::vector<uint32_t> pilots_;
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_PERFECT_HASH_HPP
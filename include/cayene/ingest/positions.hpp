@@ -0,0 +1,181 @@
+#ifndef CAYENE_INGEST_POSITIONS_HPP
+#define CAYENE_INGEST_POSITIONS_HPP
+
+/**
+ * @file positions.hpp
+ * @brief Last known position of every device, with box, radius and nearest queries
+ *
+ * Decode workers call PositionIndex::update() with each GPS reading; the
+ * position of the device is replaced in a sharded map under a short lock.
+ * A publisher thread periodically turns the map into an immutable
+ * PositionSnapshot and swaps it in, then bumps a generation counter. Each
+ * querying thread caches the snapshot pointer and reloads it only when the
+ * generation changes, so between publishes snapshot() is one atomic load
+ * and queries share no written cache line with updates, the publisher or
+ * each other.
+ *
+ * A snapshot is a flat array of 32-byte entries sorted by a fixed grid
+ * cell (cell_size raw units, 0.01 degree by default). A box query does one
+ * binary search per grid row it spans and then scans contiguous entries.
+ * Radius and nearest queries work on boxes and check great-circle
+ * distances. Coordinates are raw LPP GPS units (1e-4 degree, geofence.hpp);
+ * boxes do not cross the antimeridian.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cayene/ingest/geofence.hpp"
+#include "cayene/reading.hpp"
+
+namespace cayene::ingest
+{
+
+struct TrackedPosition
+{
+    // Valid while the snapshot is
+    std::string_view device_id;
+    GeoPoint point;
+    std::chrono::system_clock::time_point seen;
+};
+
+class PositionSnapshot
+{
+public:
+    // Positions with min <= point <= max, in no particular order
+    void within_box(GeoPoint min, GeoPoint max, std::vector<TrackedPosition>& positions) const;
+
+    // Positions within @p meters of @p center, in no particular order
+    void within_radius(GeoPoint center, double meters,
+                       std::vector<TrackedPosition>& positions) const;
+
+    // The @p count positions closest to @p center, closest first
+    void nearest(GeoPoint center, std::size_t count,
+                 std::vector<TrackedPosition>& positions) const;
+
+    [[nodiscard]] auto size() const -> std::size_t { return entries_.size(); }
+    [[nodiscard]] auto built() const -> std::chrono::system_clock::time_point { return built_; }
+
+private:
+    friend class PositionIndex;
+
+    struct Entry
+    {
+        uint64_t cell{0};
+        GeoPoint point;
+        int64_t seen_ns{0};
+        uint32_t name{0};
+        uint16_t name_size{0};
+    };
+
+    template <typename Visit>
+    void visit_box(GeoPoint min, GeoPoint max, Visit&& visit) const;
+
+    [[nodiscard]] auto position(const Entry& entry) const -> TrackedPosition;
+
+    int32_t cell_size_{1};
+    uint64_t columns_{1};
+    std::vector<Entry> entries_;
+    // Device ids of every entry, back to back
+    std::string names_;
+    std::chrono::system_clock::time_point built_;
+};
+
+struct PositionIndexConfig
+{
+    // Grid cell in raw units; 100 is 0.01 degree, about 1.1 km of latitude
+    int32_t cell_size{100};
+    // How often a changed map is published; 0 publishes only on publish()
+    std::chrono::milliseconds snapshot_interval{1000};
+};
+
+class PositionIndex
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    explicit PositionIndex(PositionIndexConfig config = {});
+    ~PositionIndex();
+
+    PositionIndex(const PositionIndex&) = delete;
+    PositionIndex& operator=(const PositionIndex&) = delete;
+    PositionIndex(PositionIndex&&) = delete;
+    PositionIndex& operator=(PositionIndex&&) = delete;
+
+    /**
+     * @brief Replaces the position of @p device_id; thread safe
+     * @return false, ignoring it, if @p point is not a valid coordinate
+     */
+    auto update(std::string_view device_id, GeoPoint point, Clock::time_point now = Clock::now())
+        -> bool;
+
+    // Same with the last GPS reading of an uplink; false if there is none
+    auto update(std::string_view device_id, std::span<const Reading> readings,
+                Clock::time_point now = Clock::now()) -> bool;
+
+    /**
+     * @brief Latest published snapshot, from this thread's cache
+     *
+     * The reference is rebound by the next snapshot() call on the same
+     * thread; copy the shared_ptr to keep a snapshot across calls. The cache
+     * holds the last snapshot a thread saw until that next call or its exit.
+     */
+    [[nodiscard]] auto snapshot() const -> const std::shared_ptr<const PositionSnapshot>&;
+
+    // Builds and swaps in a snapshot of the current positions now
+    void publish();
+
+    [[nodiscard]] auto devices() const -> std::size_t;
+
+private:
+    static constexpr std::size_t shard_count = 64;
+
+    struct Latest
+    {
+        std::string device_id;
+        GeoPoint point;
+        Clock::time_point seen;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, Latest> devices;
+    };
+
+    void run();
+
+    PositionIndexConfig config_;
+    std::array<Shard, shard_count> shards_;
+    // Updates since the last snapshot; a quiet map is not republished
+    std::atomic<uint64_t> updates_{0};
+    std::atomic<std::shared_ptr<const PositionSnapshot>> snapshot_;
+    // Stored after snapshot_; unique across indexes, so it alone keys the thread caches.
+    // Away from updates_, which every update() writes
+    alignas(64) std::atomic<uint64_t> generation_;
+
+    std::mutex publish_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_{false};
+    std::thread thread_;
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_POSITIONS_HPP
@@ -0,0 +1,179 @@
+#ifndef CAYENE_INGEST_SINK_HPP
+#define CAYENE_INGEST_SINK_HPP
+
+/**
+ * @file sink.hpp
+ * @brief Batched output sinks for serialized decoder output
+ *
+ * Producers call write() with one serialized message (e.g. a JSON line);
+ * it is copied into the front slab under a short lock and write() returns.
+ * A flush thread swaps the front and back slabs when flush_bytes are
+ * buffered or flush_interval has passed since the first message, and
+ * writes the whole back slab while producers keep filling the front one:
+ *
+ * - Stream sinks (file, stdout, Unix stream socket) write newline
+ *   terminated messages with writev(), one iovec per slab chunk.
+ * - Datagram sinks (UDP, Unix datagram socket) send one datagram per
+ *   message with sendmmsg(), up to UIO_MAXIOV messages per call.
+ *
+ * Slabs are lists of fixed-size chunks that are kept between flushes, so
+ * a busy sink does not allocate. When both slabs are full write() blocks
+ * until the flush thread catches up.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace cayene::ingest
+{
+
+struct SinkConfig
+{
+    // Flush once this many bytes are buffered...
+    std::size_t flush_bytes{256 * 1024};
+    // ...or this long after the first buffered message
+    std::chrono::milliseconds flush_interval{20};
+    // write() blocks while the front slab holds this much
+    std::size_t max_buffered_bytes{8 * 1024 * 1024};
+    // Slab chunk size; larger messages get a chunk of their own
+    std::size_t chunk_size{64 * 1024};
+};
+
+struct SinkStats
+{
+    uint64_t messages{0};
+    uint64_t bytes{0};
+    uint64_t flushes{0};
+    // writev/sendmmsg calls
+    uint64_t syscalls{0};
+    // Messages lost to write errors (e.g. no UDP listener)
+    uint64_t errors{0};
+};
+
+enum class SinkKind : std::uint8_t
+{
+    // Newline-terminated messages on a byte stream
+    Stream,
+    // One datagram per message
+    Datagram
+};
+
+class OutputSink
+{
+public:
+    /**
+     * @brief Opens a sink from a destination string
+     *
+     * "stdout", "udp:HOST:PORT" (IPv4), "unix:PATH" (stream socket),
+     * "unixgram:PATH" (datagram socket), anything else is a file opened
+     * for appending.
+     */
+    static auto open(std::string_view destination, SinkConfig config = {})
+        -> std::expected<std::unique_ptr<OutputSink>, std::error_code>;
+
+    static auto file(const std::string& path, SinkConfig config = {})
+        -> std::expected<std::unique_ptr<OutputSink>, std::error_code>;
+    static auto unix_socket(const std::string& path, SinkKind kind, SinkConfig config = {})
+        -> std::expected<std::unique_ptr<OutputSink>, std::error_code>;
+    static auto udp(const std::string& host, uint16_t port, SinkConfig config = {})
+        -> std::expected<std::unique_ptr<OutputSink>, std::error_code>;
+    // Takes ownership of @p fd
+    static auto from_fd(int fd, SinkKind kind, SinkConfig config = {})
+        -> std::unique_ptr<OutputSink>;
+
+    ~OutputSink();
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+    OutputSink(OutputSink&&) = delete;
+    OutputSink& operator=(OutputSink&&) = delete;
+
+    // Buffers @p message; thread safe. Stream sinks append the newline.
+    void write(std::string_view message);
+
+    // Blocks until everything written so far has been handed to the kernel
+    void flush();
+
+    [[nodiscard]] auto kind() const -> SinkKind { return kind_; }
+    [[nodiscard]] auto stats() const -> SinkStats;
+
+private:
+    class Slab
+    {
+    public:
+        void append(std::string_view message, bool newline, std::size_t chunk_size);
+        void clear();
+
+        [[nodiscard]] auto bytes() const -> std::size_t { return bytes_; }
+        [[nodiscard]] auto empty() const -> bool { return messages_.empty(); }
+        [[nodiscard]] auto message_count() const -> std::size_t { return messages_.size(); }
+        // Replaces @p out with one entry per chunk in use
+        void gather_chunks(std::vector<iovec>& out) const;
+        // One entry per message, newline excluded
+        [[nodiscard]] auto messages() -> std::vector<iovec>& { return messages_; }
+
+    private:
+        struct Chunk
+        {
+            std::unique_ptr<char[]> data;
+            std::size_t capacity{0};
+            std::size_t used{0};
+        };
+
+        std::vector<Chunk> chunks_;
+        std::size_t active_{0};
+        std::vector<iovec> messages_;
+        std::size_t bytes_{0};
+    };
+
+    OutputSink(int fd, SinkKind kind, SinkConfig config);
+
+    void run();
+    // Write @p slab out, counting syscalls and lost messages in @p delta
+    void write_stream(const Slab& slab, SinkStats& delta);
+    void write_datagrams(Slab& slab, SinkStats& delta);
+
+    int fd_;
+    SinkKind kind_;
+    SinkConfig config_;
+    // Sockets are written with MSG_NOSIGNAL
+    bool socket_{false};
+
+    mutable std::mutex mutex_;
+    std::condition_variable flush_wanted_;
+    std::condition_variable flush_done_;
+    Slab front_;
+    Slab back_;
+    std::chrono::steady_clock::time_point first_write_;
+    // Messages accepted and messages handed to the kernel; flush() waits for the latter
+    uint64_t written_{0};
+    uint64_t flushed_{0};
+    bool flush_requested_{false};
+    bool closing_{false};
+    SinkStats stats_;
+
+    // Flush thread only
+    std::vector<iovec> iovecs_;
+    std::vector<mmsghdr> headers_;
+    std::thread thread_;
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_SINK_HPP
@@ -0,0 +1,137 @@
+#ifndef CAYENE_INGEST_VIBRATION_HPP
+#define CAYENE_INGEST_VIBRATION_HPP
+
+/**
+ * @file vibration.hpp
+ * @brief RMS, peak and crest factor of accelerometer streams over sliding windows
+ *
+ * VibrationMonitor keeps a ring buffer of the last `window` raw accelerometer
+ * samples (int16, 1e-3 g) of every device and channel, one array per axis.
+ * Every `hop` new samples it reduces the whole window to per-axis features.
+ * The reduction is a sum of squares and a largest magnitude, done with AVX2
+ * when the CPU has it (checked once at run time) or NEON on AArch64, with a
+ * scalar loop otherwise. Both are exact integer results, so every kernel
+ * gives the same features.
+ *
+ * The monitor is sharded by device and safe to call from every decode worker.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "cayene/ingest/envelope.hpp"
+#include "cayene/reading.hpp"
+#include "cayene/type_config.hpp"
+
+namespace cayene::ingest
+{
+
+inline constexpr uint8_t accelerometer_type_id = 0x71;
+// Largest window: 24 KiB of samples per device and channel
+inline constexpr uint32_t max_vibration_window = 4096;
+
+struct AxisStats
+{
+    uint64_t sum_squares{0};
+    // Largest magnitude; 32768 for a sample of -32768
+    uint32_t peak{0};
+};
+
+// Sum of squares and peak of @p samples with the widest kernel this CPU runs
+auto axis_stats(std::span<const int16_t> samples) -> AxisStats;
+
+struct VibrationFeatures
+{
+    uint8_t channel{0};
+    // Per axis x, y, z: RMS and peak in g; crest factor peak / RMS, 0 for a still axis
+    std::array<double, 3> rms{};
+    std::array<double, 3> peak{};
+    std::array<double, 3> crest{};
+};
+
+struct VibrationConfig
+{
+    // Samples per window, per device and channel; clamped to [1, max_vibration_window]
+    uint32_t window{256};
+    // New samples between two windows; 0 for back to back windows (hop = window)
+    uint32_t hop{0};
+};
+
+class VibrationMonitor
+{
+public:
+    explicit VibrationMonitor(VibrationConfig config = {});
+
+    /**
+     * @brief Appends the accelerometer readings of @p device_id; thread safe
+     *
+     * Other readings are skipped. The features of every window completed by
+     * these samples are appended to @p features, in order.
+     *
+     * @return Number of features appended
+     */
+    auto update(std::string_view device_id, std::span<const Reading> readings,
+                std::vector<VibrationFeatures>& features) -> std::size_t;
+
+    /**
+     * @brief Updates the device of @p uplink and puts features in place of its samples
+     *
+     * @p readings are the raw readings of the uplink's payload, decoded once
+     * by the caller and shared with the other stages; @p catalog tells a
+     * standard accelerometer from a custom type on the same id. The
+     * accelerometer members of `object["decoded"]` are removed, and each
+     * completed window is added to a "vibration" array of {"channel", "rms",
+     * "peak", "crest"} members, each an {x, y, z} object.
+     *
+     * @return Number of completed windows
+     */
+    auto annotate(const TypeCatalog& catalog, const Uplink& uplink,
+                  std::span<const Reading> readings, Json& object) -> std::size_t;
+
+    // Same, decoding the payload with the types of its fPort in @p catalog
+    auto annotate(const TypeCatalog& catalog, const Uplink& uplink, Json& object)
+        -> std::size_t;
+
+    [[nodiscard]] auto config() const -> const VibrationConfig& { return config_; }
+    // Devices with at least one accelerometer sample
+    [[nodiscard]] auto devices() const -> std::size_t;
+
+private:
+    static constexpr std::size_t shard_count = 64;
+
+    struct Ring
+    {
+        uint8_t channel{0};
+        uint32_t next{0};
+        uint32_t filled{0};
+        // Samples since the last window
+        uint32_t pending{0};
+        // window samples of x, then of y, then of z
+        std::vector<int16_t> samples;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        // One ring per accelerometer channel of each device
+        std::unordered_map<uint64_t, std::vector<Ring>> devices;
+    };
+
+    [[nodiscard]] auto window_features(const Ring& ring) const -> VibrationFeatures;
+
+    VibrationConfig config_;
+    std::array<Shard, shard_count> shards_;
+};
+
+}  // namespace cayene::ingest
+
+#endif  // CAYENE_INGEST_VIBRATION_HPP
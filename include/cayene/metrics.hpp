@@ -0,0 +1,255 @@
+#ifndef CAYENE_METRICS_HPP
+#define CAYENE_METRICS_HPP
+
+/**
+ * @file metrics.hpp
+ * @brief Instrumentation hooks for the decode path
+ *
+ * The decoder calls into a metrics policy selected at build time. With
+ * CAYENE_ENABLE_METRICS off the policy is NullPolicy, whose hooks are empty
+ * inline functions and compile away. With it on, ShardedPolicy records into
+ * per-thread, cache-line aligned shards that are only summed when a
+ * snapshot is taken.
+ *
+ * Latency is measured in clock ticks (TSC on x86-64, CLOCK_MONOTONIC
+ * nanoseconds elsewhere) and converted to nanoseconds only in snapshots.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <time.h>
+
+#include "error.hpp"
+#include "histogram.hpp"
+
+#if defined(__x86_64__) && !defined(CAYENE_METRICS_NO_TSC)
+    #include <x86intrin.h>
+    #define CAYENE_METRICS_USE_TSC 1
+#endif
+
+namespace cayene::metrics
+{
+
+inline constexpr std::size_t cache_line_size = 64;
+inline constexpr std::size_t type_id_count = 256;
+inline constexpr std::size_t error_code_count = 6;
+inline constexpr std::size_t payload_size_bucket_count = 16;
+
+static_assert(static_cast<std::size_t>(Error::BufferTooSmall) < error_code_count);
+
+/**
+ * @brief Timed stages of a decode call
+ *
+ * Decode covers the whole call, Key the construction of each "Name_channel"
+ * key and Serialize the conversion of each field into its Json value.
+ */
+enum class Stage : std::uint8_t
+{
+    Decode = 0,
+    Key = 1,
+    Serialize = 2
+};
+
+inline constexpr std::size_t stage_count = 3;
+
+auto stage_name(Stage stage) -> std::string_view;
+
+/**
+ * @brief Cheap monotonic tick source used by the sharded policy
+ */
+struct Clock
+{
+    static auto now() -> uint64_t
+    {
+#ifdef CAYENE_METRICS_USE_TSC
+        return __rdtsc();
+#else
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000U +
+               static_cast<uint64_t>(ts.tv_nsec);
+#endif
+    }
+
+    // Calibrated once against CLOCK_MONOTONIC on first use
+    static auto ns_per_tick() -> double;
+};
+
+/**
+ * @brief Bucket index for a payload size
+ *
+ * Bucket 0 holds empty payloads, bucket i holds sizes in [2^(i-1), 2^i).
+ * The last bucket also absorbs everything larger.
+ */
+constexpr auto payload_size_bucket(std::size_t size) -> std::size_t
+{
+    const auto bucket = static_cast<std::size_t>(std::bit_width(size));
+    return bucket < payload_size_bucket_count ? bucket : payload_size_bucket_count - 1;
+}
+
+/**
+ * @brief Aggregated view of every shard at the time of the call
+ */
+struct Snapshot
+{
+    uint64_t decode_calls{0};
+    uint64_t bytes_processed{0};
+    uint64_t latency_ns_total{0};
+    uint64_t latency_ns_max{0};
+    std::array<uint64_t, type_id_count> fields_by_type{};
+    std::array<uint64_t, error_code_count> errors_by_code{};
+    std::array<uint64_t, payload_size_bucket_count> payload_size_histogram{};
+    std::array<Histogram, stage_count> stage_latency_ns{};
+
+    [[nodiscard]] auto fields_total() const -> uint64_t;
+    [[nodiscard]] auto errors_total() const -> uint64_t;
+    [[nodiscard]] auto latency(Stage stage) const -> const Histogram&
+    {
+        return stage_latency_ns[static_cast<std::size_t>(stage)];
+    }
+};
+
+/**
+ * @brief Per-thread counters
+ *
+ * Only the owning thread writes a shard, so increments are a relaxed load
+ * and store rather than a locked read-modify-write. Readers may observe a
+ * shard mid-update, which is fine for monotonically growing counters.
+ */
+struct alignas(cache_line_size) Shard
+{
+    std::atomic<uint64_t> decode_calls{0};
+    std::atomic<uint64_t> bytes_processed{0};
+    std::atomic<uint64_t> latency_ticks_total{0};
+    std::array<std::atomic<uint64_t>, type_id_count> fields_by_type{};
+    std::array<std::atomic<uint64_t>, error_code_count> errors_by_code{};
+    std::array<std::atomic<uint64_t>, payload_size_bucket_count> payload_size_histogram{};
+    std::array<AtomicHistogram, stage_count> stage_latency_ticks{};
+};
+
+// Shards are owned by a process-wide registry and recycled when a thread exits
+auto acquire_shard() -> Shard*;
+void release_shard(Shard* shard);
+
+/**
+ * @brief Aggregates all shards, live or released
+ */
+auto snapshot() -> Snapshot;
+
+/**
+ * @brief One line per stage with count, p50, p90, p99, p999 and max in ns
+ *
+ * e.g. "stage=decode count=1200 p50_ns=410 p90_ns=530 p99_ns=2100 p999_ns=9800 max_ns=12001"
+ */
+auto latency_report(const Snapshot& snap) -> std::string;
+
+namespace detail
+{
+
+inline void bump(std::atomic<uint64_t>& counter, uint64_t amount = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+class ShardHandle
+{
+public:
+    ShardHandle() : shard_(acquire_shard()) {}
+    ~ShardHandle() { release_shard(shard_); }
+
+    ShardHandle(const ShardHandle&) = delete;
+    ShardHandle& operator=(const ShardHandle&) = delete;
+    ShardHandle(ShardHandle&&) = delete;
+    ShardHandle& operator=(ShardHandle&&) = delete;
+
+    [[nodiscard]] auto get() const -> Shard& { return *shard_; }
+
+private:
+    Shard* shard_;
+};
+
+inline auto local_shard() -> Shard&
+{
+    thread_local ShardHandle handle;
+    return handle.get();
+}
+
+}  // namespace detail
+
+/**
+ * @brief Policy used when instrumentation is disabled, every hook is a no-op
+ */
+struct NullPolicy
+{
+    static constexpr bool enabled = false;
+
+    using TimePoint = int;
+
+    static auto now() -> TimePoint { return 0; }
+    static void record_field(uint8_t /*type_id*/) {}
+    static void record_stage(Stage /*stage*/, TimePoint /*start*/) {}
+    static void record_decode(std::size_t /*payload_size*/, Error /*result*/,
+                              TimePoint /*start*/)
+    {
+    }
+};
+
+/**
+ * @brief Policy that records into the calling thread's shard
+ */
+struct ShardedPolicy
+{
+    static constexpr bool enabled = true;
+
+    using TimePoint = uint64_t;
+
+    static auto now() -> TimePoint { return Clock::now(); }
+
+    static void record_field(uint8_t type_id)
+    {
+        detail::bump(detail::local_shard().fields_by_type[type_id]);
+    }
+
+    static void record_stage(Stage stage, TimePoint start)
+    {
+        const TimePoint end = now();
+        detail::local_shard().stage_latency_ticks[static_cast<std::size_t>(stage)].record(
+            end > start ? end - start : 0);
+    }
+
+    static void record_decode(std::size_t payload_size, Error result, TimePoint start)
+    {
+        const TimePoint end = now();
+        const uint64_t elapsed = end > start ? end - start : 0;
+
+        Shard& shard = detail::local_shard();
+        detail::bump(shard.decode_calls);
+        detail::bump(shard.bytes_processed, payload_size);
+        detail::bump(shard.latency_ticks_total, elapsed);
+        shard.stage_latency_ticks[static_cast<std::size_t>(Stage::Decode)].record(elapsed);
+        detail::bump(shard.payload_size_histogram[payload_size_bucket(payload_size)]);
+        if (result != Error::None)
+        {
+            detail::bump(shard.errors_by_code[static_cast<std::size_t>(result)]);
+        }
+    }
+};
+
+#ifdef CAYENE_ENABLE_METRICS
+using Policy = ShardedPolicy;
+#else
+using Policy = NullPolicy;
+#endif
+
+}  // namespace cayene::metrics
+
+#endif  // CAYENE_METRICS_HPP
@@ -0,0 +1,72 @@
+#ifndef CAYENE_PROMETHEUS_HPP
+#define CAYENE_PROMETHEUS_HPP
+
+/**
+ * @file prometheus.hpp
+ * @brief Prometheus text exposition of decoder metrics
+ *
+ * PrometheusExporter is a deliberately small HTTP/1.0 responder on plain
+ * POSIX sockets: one background thread, one request per connection, and
+ * only GET /metrics. Each scrape takes a metrics::snapshot(), which reads
+ * the per-thread shards without pausing decoding threads.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "metrics.hpp"
+
+namespace cayene::metrics
+{
+
+/**
+ * @brief Renders a snapshot in Prometheus text format 0.0.4
+ */
+auto render_prometheus(const Snapshot& snap) -> std::string;
+
+class PrometheusExporter
+{
+public:
+    /**
+     * @param port TCP port to listen on, 0 picks an ephemeral port
+     * @param bind_address IPv4 address to bind, loopback by default
+     */
+    explicit PrometheusExporter(uint16_t port, std::string bind_address = "127.0.0.1");
+    ~PrometheusExporter();
+
+    PrometheusExporter(const PrometheusExporter&) = delete;
+    PrometheusExporter& operator=(const PrometheusExporter&) = delete;
+    PrometheusExporter(PrometheusExporter&&) = delete;
+    PrometheusExporter& operator=(PrometheusExporter&&) = delete;
+
+    /**
+     * @brief Binds the socket and starts serving
+     * @return The port actually bound
+     */
+    auto start() -> std::expected<uint16_t, std::error_code>;
+    void stop();
+
+    [[nodiscard]] auto port() const -> uint16_t { return port_; }
+    [[nodiscard]] auto running() const -> bool { return running_.load(); }
+
+private:
+    void serve();
+    void handle_connection(int client_fd);
+
+    uint16_t port_;
+    std::string bind_address_;
+    int listen_fd_{-1};
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
+
+}  // namespace cayene::metrics
+
+#endif  // CAYENE_PROMETHEUS_HPP
@@ -0,0 +1,71 @@
+#ifndef CAYENE_READING_HPP
+#define CAYENE_READING_HPP
+
+/**
+ * @file reading.hpp
+ * @brief Allocation-free representation of a decoded field
+ *
+ * A Reading keeps the raw integers exactly as they are encoded in the
+ * payload; value() applies the LPP scale for the type on demand. Fields of
+ * custom types carry no components, only a view of their bytes.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace cayene
+{
+
+/**
+ * @brief Divisor that turns raw component @p component of @p type_id into its unit
+ */
+constexpr auto reading_scale(uint8_t type_id, std::size_t component) -> double
+{
+    switch (type_id)
+    {
+        case 0x02:  // Analog Input
+        case 0x03:  // Analog Output
+        case 0x86:  // Gyrometer
+            return 100.0;
+        case 0x67:  // Temperature
+        case 0x68:  // Humidity
+        case 0x73:  // Barometer
+            return 10.0;
+        case 0x71:  // Accelerometer
+            return 1000.0;
+        case 0x88:  // GPS: latitude, longitude, altitude
+            return component < 2 ? 10000.0 : 100.0;
+        default:
+            return 1.0;
+    }
+}
+
+// Largest payload the ingest receivers take by default; LoRaWAN frames carry at most 242
+inline constexpr std::size_t max_payload_bytes = 256;
+// Readings in a payload of max_payload_bytes: channel, type and at least one data byte each
+inline constexpr std::size_t max_payload_readings = max_payload_bytes / 3;
+
+struct Reading
+{
+    uint8_t channel{0};
+    uint8_t type_id{0};
+    uint8_t component_count{0};
+    std::array<int32_t, 3> raw{};
+    // Bytes of the field inside the decoded payload, valid while the payload is
+    std::span<const uint8_t> bytes;
+
+    // @p component must be below 3; unchecked so the core builds without exceptions
+    [[nodiscard]] auto value(std::size_t component = 0) const -> double
+    {
+        return raw[component] / reading_scale(type_id, component);
+    }
+};
+
+}  // namespace cayene
+
+#endif  // CAYENE_READING_HPP
@@ -0,0 +1,171 @@
+#ifndef CAYENE_REGISTRY_HPP
+#define CAYENE_REGISTRY_HPP
+
+/**
+ * @file registry.hpp
+ * @brief Binary registry images with the data types of every tenant
+ *
+ * RegistryBuilder turns per-tenant type definitions into a single
+ * position-independent image: a header, a tenant directory sorted by id,
+ * one TypeTable and one name index per tenant, and a shared string pool,
+ * all addressed by offsets. MappedRegistry maps such a file read-only, so
+ * every worker process shares the same pages, and RegistryView reads it in
+ * place: decode_readings() runs directly on a tenant's table without
+ * copying it.
+ *
+ * Images use the byte order of the machine that wrote them and are
+ * rejected elsewhere. Part of cayene_core, so usable in embedded builds.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core.hpp"
+
+namespace cayene
+{
+
+inline constexpr uint32_t registry_format_version = 2;
+
+enum class RegistryError : std::uint8_t
+{
+    None = 0,
+    Io = 1,
+    BadMagic = 2,
+    UnsupportedVersion = 3,
+    ForeignByteOrder = 4,
+    Truncated = 5,
+    Corrupt = 6,
+    TenantExists = 7,
+    UnknownTenant = 8,
+    InvalidType = 9
+};
+
+/**
+ * @brief Types of one tenant inside an image, valid while the image is
+ */
+class TenantView
+{
+public:
+    [[nodiscard]] auto id() const -> std::string_view { return id_; }
+    [[nodiscard]] auto types() const -> const TypeTable& { return *types_; }
+    // Name of @p type_id, empty if the tenant does not register it
+    [[nodiscard]] auto name(uint8_t type_id) const -> std::string_view;
+
+private:
+    friend class RegistryView;
+
+    TenantView(std::string_view id, const TypeTable* types, const std::byte* names,
+               std::string_view strings)
+        : id_(id), types_(types), names_(names), strings_(strings)
+    {
+    }
+
+    std::string_view id_;
+    const TypeTable* types_;
+    const std::byte* names_;
+    std::string_view strings_;
+};
+
+/**
+ * @brief Validated, read-only view of an image in memory
+ */
+class RegistryView
+{
+public:
+    /**
+     * @brief Checks the header, the directory and every table of @p image
+     *
+     * After this succeeds lookups do no further checks. @p image must be
+     * 8-byte aligned, as mmap and operator new provide.
+     */
+    static auto from_bytes(std::span<const std::byte> image)
+        -> std::expected<RegistryView, RegistryError>;
+
+    [[nodiscard]] auto tenant_count() const -> std::size_t { return tenant_count_; }
+    [[nodiscard]] auto tenant(std::size_t index) const -> TenantView;
+    // Binary search over the sorted tenant directory
+    [[nodiscard]] auto find(std::string_view tenant_id) const -> std::optional<TenantView>;
+
+private:
+    RegistryView(std::span<const std::byte> image, std::size_t tenant_count)
+        : image_(image), tenant_count_(tenant_count)
+    {
+    }
+
+    std::span<const std::byte> image_;
+    std::size_t tenant_count_;
+};
+
+/**
+ * @brief Registry image file mapped read-only
+ */
+class MappedRegistry
+{
+public:
+    static auto open(const std::string& path) -> std::expected<MappedRegistry, RegistryError>;
+
+    MappedRegistry(MappedRegistry&& other) noexcept;
+    MappedRegistry& operator=(MappedRegistry&& other) noexcept;
+    MappedRegistry(const MappedRegistry&) = delete;
+    MappedRegistry& operator=(const MappedRegistry&) = delete;
+    ~MappedRegistry();
+
+    [[nodiscard]] auto view() const -> const RegistryView& { return view_; }
+
+private:
+    MappedRegistry(void* address, std::size_t size, RegistryView view)
+        : address_(address), size_(size), view_(view)
+    {
+    }
+
+    void* address_;
+    std::size_t size_;
+    RegistryView view_;
+};
+
+/**
+ * @brief Collects tenant definitions and serializes them into an image
+ *
+ * Meant for an offline step or a control process; it allocates freely.
+ */
+class RegistryBuilder
+{
+public:
+    // New tenants start with the Cayenne LPP v1 standard types
+    auto add_tenant(std::string_view tenant_id) -> std::expected<void, RegistryError>;
+    auto add_type(std::string_view tenant_id, uint8_t type_id, std::string_view name,
+                  std::size_t size) -> std::expected<void, RegistryError>;
+    // Length-prefixed type, see TypeTable::add_prefixed
+    auto add_prefixed_type(std::string_view tenant_id, uint8_t type_id, std::string_view name,
+                           std::size_t unit) -> std::expected<void, RegistryError>;
+
+    [[nodiscard]] auto tenant_count() const -> std::size_t { return tenants_.size(); }
+
+    [[nodiscard]] auto serialize() const -> std::vector<std::byte>;
+    // Writes to a temporary file and renames it, mapped readers keep the old image
+    auto write(const std::string& path) const -> std::expected<void, RegistryError>;
+
+private:
+    struct Tenant
+    {
+        TypeTable types;
+        std::map<uint8_t, std::string> names;
+    };
+
+    std::map<std::string, Tenant, std::less<>> tenants_;
+};
+
+}  // namespace cayene
+
+#endif  // CAYENE_REGISTRY_HPP
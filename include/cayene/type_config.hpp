@@ -0,0 +1,182 @@
+#ifndef CAYENE_TYPE_CONFIG_HPP
+#define CAYENE_TYPE_CONFIG_HPP
+
+/**
+ * @file type_config.hpp
+ * @brief Custom type definitions loaded from a JSON file
+ *
+ * A definition file declares custom types (id, name, field layout and
+ * scales) and which of them each LoRaWAN fPort uses:
+ *
+ * @code{.json}
+ * {
+ *   "version": 1,
+ *   "types": [
+ *     { "type_id": "0xC8", "name": "Soil",
+ *       "fields": [ { "name": "moisture", "format": "u16", "scale": 10 },
+ *                   { "name": "conductivity", "format": "u16" } ] },
+ *     { "type_id": 201, "name": "Blob", "size": 4 },
+ *     { "type_id": "0xCA", "name": "Track", "unit": 4,
+ *       "fields": [ { "name": "lat", "format": "i16", "scale": 100 },
+ *                   { "name": "lon", "format": "i16", "scale": 100 } ] }
+ *   ],
+ *   "fports": {
+ *     "10": { "standard": false,
+ *             "types": [ { "type_id": "0xC8", "name": "Counter",
+ *                          "fields": [ { "name": "count", "format": "u32" } ] } ] }
+ *   }
+ * }
+ * @endcode
+ *
+ * A type with a "unit" instead of a "size" has variable length: its first
+ * byte counts the units that follow, each decoded by the fields into one
+ * object of an array (or kept as bytes without fields).
+ *
+ * Top-level types apply to every port; a port entry adds its own types and
+ * may leave out the standard ones. Ports without an entry use the default
+ * profile (standard plus top-level types). TypeCatalog validates the whole
+ * file once and compiles each profile into a Decoder, so resolving a port
+ * and then a type id are both array lookups.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "decoder.hpp"
+
+namespace cayene
+{
+
+// Big-endian integer formats of a field, as in the standard LPP types
+enum class FieldFormat : std::uint8_t
+{
+    U8,
+    I8,
+    U16,
+    I16,
+    U24,
+    I24,
+    U32,
+    I32
+};
+
+constexpr auto field_width(FieldFormat format) -> std::size_t
+{
+    switch (format)
+    {
+        case FieldFormat::U8:
+        case FieldFormat::I8:
+            return 1;
+        case FieldFormat::U16:
+        case FieldFormat::I16:
+            return 2;
+        case FieldFormat::U24:
+        case FieldFormat::I24:
+            return 3;
+        case FieldFormat::U32:
+        case FieldFormat::I32:
+            return 4;
+    }
+    return 0;
+}
+
+struct FieldLayout
+{
+    std::string name;
+    FieldFormat format{FieldFormat::U8};
+    // Divisor applied to the raw integer, 10 for 0.1 resolution like Temperature
+    double scale{1.0};
+};
+
+struct TypeDefinition
+{
+    uint8_t type_id{0};
+    std::string name;
+    std::size_t size{0};
+    // Non-zero for a length-prefixed type (size 0): bytes of each unit after the count byte
+    std::size_t unit{0};
+    // Empty for opaque types, decoded as an array of bytes
+    std::vector<FieldLayout> fields;
+
+    // Raw integer of field @p field in @p bytes, which must be one unit (or size) bytes long
+    [[nodiscard]] auto raw(std::span<const uint8_t> bytes, std::size_t field) const -> int64_t;
+    [[nodiscard]] auto value(std::span<const uint8_t> bytes, std::size_t field) const -> double;
+    // The whole field, count byte included for a length-prefixed type
+    [[nodiscard]] auto to_json(std::span<const uint8_t> bytes) const -> Json;
+};
+
+enum class ConfigErrorCode : std::uint8_t
+{
+    Io = 1,
+    Syntax = 2,
+    Invalid = 3
+};
+
+struct ConfigError
+{
+    ConfigErrorCode code;
+    // What is wrong and where, e.g. "fports.10.types[0]: duplicate type_id 0xc8"
+    std::string message;
+};
+
+class TypeCatalog
+{
+public:
+    static auto parse(std::string_view text) -> std::expected<TypeCatalog, ConfigError>;
+    static auto load(const std::string& path) -> std::expected<TypeCatalog, ConfigError>;
+
+    // Decoder for @p fport, the default profile if the port has no entry
+    [[nodiscard]] auto decoder(uint8_t fport) const -> const Decoder&
+    {
+        return decoders_[port_profiles_[fport]];
+    }
+
+    [[nodiscard]] auto decode(uint8_t fport, std::span<const uint8_t> encoded_payload) const
+        -> std::expected<Json, Error>
+    {
+        return decoder(fport).decode(encoded_payload);
+    }
+
+    [[nodiscard]] auto decode_readings(uint8_t fport, std::span<const uint8_t> encoded_payload,
+                                       std::span<Reading> readings) const
+        -> std::expected<std::size_t, Error>
+    {
+        return decoder(fport).decode_readings(encoded_payload, readings);
+    }
+
+    [[nodiscard]] auto decode_records(uint8_t fport, std::span<const uint8_t> encoded_payload,
+                                      std::span<TimedReading> records,
+                                      uint32_t timestamp = 0) const
+        -> std::expected<std::size_t, Error>
+    {
+        return decoder(fport).decode_records(encoded_payload, records, timestamp);
+    }
+
+    // Layout of a custom type on @p fport, nullptr for standard or unknown types
+    [[nodiscard]] auto definition(uint8_t fport, uint8_t type_id) const -> const TypeDefinition*;
+
+    [[nodiscard]] auto profile_count() const -> std::size_t { return decoders_.size(); }
+    [[nodiscard]] auto definition_count() const -> std::size_t { return definitions_.size(); }
+
+private:
+    TypeCatalog() = default;
+
+    std::vector<TypeDefinition> definitions_;
+    std::vector<Decoder> decoders_;
+    // Per profile: index + 1 into definitions_ of every type id, 0 if none
+    std::vector<std::array<uint32_t, type_table_size>> slots_;
+    std::array<uint16_t, 256> port_profiles_{};
+};
+
+}  // namespace cayene
+
+#endif  // CAYENE_TYPE_CONFIG_HPP
@@ -0,0 +1,487 @@
+/**
+ * @file core.cpp
+ * @brief Implementation of the allocation-free decoder core
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/core.hpp"
+
+#include <cstdint>
+#include <span>
+
+#include "cayene/metrics.hpp"
+#include "decode_detail.hpp"
+#include "probes.hpp"
+
+namespace cayene
+{
+
+namespace
+{
+
+// Rellena los componentes crudos de un tipo estándar, false si no lo es
+auto read_raw(uint8_t type_id, std::span<const uint8_t> data_span, Reading& reading) -> bool
+{
+    switch (type_id)
+    {
+        case 0x00:
+        case 0x01:
+        case 0x66:
+            reading.raw[0] = data_span[0];
+            reading.component_count = 1;
+            return true;
+        case 0x02:
+        case 0x03:
+        case 0x67:
+        case 0x86:
+            reading.raw[0] = detail::bytes_to_int16(data_span);
+            reading.component_count = 1;
+            return true;
+        case 0x65:
+        case 0x68:
+        case 0x73:
+            reading.raw[0] = detail::bytes_to_uint16(data_span);
+            reading.component_count = 1;
+            return true;
+        case 0x71:
+            reading.raw[0] = detail::bytes_to_int16(data_span.subspan(0, 2));
+            reading.raw[1] = detail::bytes_to_int16(data_span.subspan(2, 2));
+            reading.raw[2] = detail::bytes_to_int16(data_span.subspan(4, 2));
+            reading.component_count = 3;
+            return true;
+        case 0x88:
+            reading.raw[0] = detail::bytes_to_int24(data_span.subspan(0, 3));
+            reading.raw[1] = detail::bytes_to_int24(data_span.subspan(3, 3));
+            reading.raw[2] = detail::bytes_to_int24(data_span.subspan(6, 3));
+            reading.component_count = 3;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Rellena la lectura de un campo ya delimitado, false si un tipo estándar no se reconoce
+auto fill_reading(const TypeTable& types, uint8_t channel, uint8_t type_id,
+                  std::span<const uint8_t> field, Reading& reading) -> bool
+{
+    reading.channel = channel;
+    reading.type_id = type_id;
+    reading.component_count = 0;
+    reading.raw = {};
+    reading.bytes = field;
+    return !types.is_standard(type_id) || read_raw(type_id, field, reading);
+}
+
+auto read_payload(const TypeTable& types, std::span<const uint8_t> encoded_payload,
+                  std::span<Reading> readings) -> std::expected<std::size_t, Error>
+{
+    if (encoded_payload.empty())
+    {
+        return {detail::fail(Error::PayloadEmpty, 0, 0)};
+    }
+
+    std::size_t offset = 0;
+    std::size_t count = 0;
+
+    // Mismo criterio que Decoder::decode: canal, tipo y al menos un byte de datos
+    while (offset + 2 < encoded_payload.size())
+    {
+        const uint8_t channel = encoded_payload[offset];
+        const uint8_t type_id = encoded_payload[offset + 1];
+        offset += 2;
+
+        std::size_t size = types.size(type_id);
+        if (size == 0) [[unlikely]]
+        {
+            // Longitud variable: solo se consulta donde un tipo fijo ya habría fallado
+            size = detail::prefixed_field_size(types, type_id, encoded_payload[offset],
+                                               encoded_payload.size() - offset);
+        }
+        if (size == 0)
+        {
+            return {
+                detail::fail(Error::UnkwownDataType, static_cast<std::ptrdiff_t>(offset), type_id)};
+        }
+
+        if (size > encoded_payload.size() - offset)
+        {
+            return {detail::fail(Error::BadPayloadFormat, static_cast<std::ptrdiff_t>(offset),
+                                 type_id)};
+        }
+
+        if (count == readings.size())
+        {
+            return {
+                detail::fail(Error::BufferTooSmall, static_cast<std::ptrdiff_t>(offset), type_id)};
+        }
+
+        CAYENE_PROBE4(decode__field, channel, type_id, size, offset);
+        metrics::Policy::record_field(type_id);
+
+        if (!fill_reading(types, channel, type_id, encoded_payload.subspan(offset, size),
+                          readings[count++]))
+        {
+            return {
+                detail::fail(Error::UnkwownDataType, static_cast<std::ptrdiff_t>(offset), type_id)};
+        }
+
+        offset += size;
+    }
+
+    // Si quedan bytes sin procesar
+    if (offset < encoded_payload.size())
+    {
+        return {detail::fail(Error::BadPayloadFormat, static_cast<std::ptrdiff_t>(offset), 0)};
+    }
+
+    return count;
+}
+
+// Igual que read_payload, pero las marcas de tiempo fechan los campos siguientes
+auto read_records(const TypeTable& types, std::span<const uint8_t> encoded_payload,
+                  std::span<TimedReading> records, uint32_t timestamp)
+    -> std::expected<std::size_t, Error>
+{
+    if (encoded_payload.empty())
+    {
+        return {detail::fail(Error::PayloadEmpty, 0, 0)};
+    }
+
+    std::size_t offset = 0;
+    std::size_t count = 0;
+
+    while (offset + 2 < encoded_payload.size())
+    {
+        const uint8_t channel = encoded_payload[offset];
+        const uint8_t type_id = encoded_payload[offset + 1];
+        offset += 2;
+
+        // La marca de tiempo se reconoce aunque la tabla no registre el tipo
+        const bool unix_time = type_id == unix_time_type_id;
+        std::size_t size = unix_time ? unix_time_size : types.size(type_id);
+        if (size == 0) [[unlikely]]
+        {
+            size = detail::prefixed_field_size(types, type_id, encoded_payload[offset],
+                                               encoded_payload.size() - offset);
+        }
+        if (size == 0)
+        {
+            return {
+                detail::fail(Error::UnkwownDataType, static_cast<std::ptrdiff_t>(offset), type_id)};
+        }
+
+        if (size > encoded_payload.size() - offset)
+        {
+            return {detail::fail(Error::BadPayloadFormat, static_cast<std::ptrdiff_t>(offset),
+                                 type_id)};
+        }
+
+        CAYENE_PROBE4(decode__field, channel, type_id, size, offset);
+        metrics::Policy::record_field(type_id);
+
+        if (unix_time)
+        {
+            timestamp = detail::bytes_to_uint32(encoded_payload.subspan(offset, size));
+            offset += size;
+            continue;
+        }
+
+        if (count == records.size())
+        {
+            return {
+                detail::fail(Error::BufferTooSmall, static_cast<std::ptrdiff_t>(offset), type_id)};
+        }
+
+        TimedReading& record = records[count++];
+        record.timestamp = timestamp;
+        if (!fill_reading(types, channel, type_id, encoded_payload.subspan(offset, size),
+                          record.reading))
+        {
+            return {
+                detail::fail(Error::UnkwownDataType, static_cast<std::ptrdiff_t>(offset), type_id)};
+        }
+
+        offset += size;
+    }
+
+    if (offset < encoded_payload.size())
+    {
+        return {detail::fail(Error::BadPayloadFormat, static_cast<std::ptrdiff_t>(offset), 0)};
+    }
+
+    return count;
+}
+
+// Igual que read_payload, con cabeceras y campos que pueden cruzar fragmentos
+auto read_fragments(const TypeTable& types, detail::FragmentCursor& cursor,
+                    std::span<Reading> readings, std::span<uint8_t> scratch)
+    -> std::expected<std::size_t, Error>
+{
+    if (cursor.size() == 0)
+    {
+        return {detail::fail(Error::PayloadEmpty, 0, 0)};
+    }
+
+    std::size_t count = 0;
+    std::size_t scratch_used = 0;
+
+    while (cursor.offset() + 2 < cursor.size())
+    {
+        const uint8_t channel = cursor.next();
+        const uint8_t type_id = cursor.next();
+        const std::size_t offset = cursor.offset();
+
+        std::size_t size = types.size(type_id);
+        if (size == 0) [[unlikely]]
+        {
+            size = detail::prefixed_field_size(types, type_id, cursor.peek(),
+                                               cursor.size() - offset);
+        }
+        if (size == 0)
+        {
+            return {
+                detail::fail(Error::UnkwownDataType, static_cast<std::ptrdiff_t>(offset), type_id)};
+        }
+
+        if (size > cursor.size() - offset)
+        {
+            return {detail::fail(Error::BadPayloadFormat, static_cast<std::ptrdiff_t>(offset),
+                                 type_id)};
+        }
+
+        std::span<uint8_t> field_scratch;
+        if (!cursor.contiguous(size))
+        {
+            if (size > scratch.size() - scratch_used)
+            {
+                return {detail::fail(Error::BufferTooSmall, static_cast<std::ptrdiff_t>(offset),
+                                     type_id)};
+            }
+            field_scratch = scratch.subspan(scratch_used, size);
+            scratch_used += size;
+        }
+
+        if (count == readings.size())
+        {
+            return {
+                detail::fail(Error::BufferTooSmall, static_cast<std::ptrdiff_t>(offset), type_id)};
+        }
+
+        CAYENE_PROBE4(decode__field, channel, type_id, size, offset);
+        metrics::Policy::record_field(type_id);
+
+        if (!fill_reading(types, channel, type_id, cursor.take(size, field_scratch),
+                          readings[count++]))
+        {
+            return {
+                detail::fail(Error::UnkwownDataType, static_cast<std::ptrdiff_t>(offset), type_id)};
+        }
+    }
+
+    if (cursor.offset() < cursor.size())
+    {
+        return {detail::fail(Error::BadPayloadFormat,
+                             static_cast<std::ptrdiff_t>(cursor.offset()), 0)};
+    }
+
+    return count;
+}
+
+// Clasificación con selects, de menor a mayor prioridad como en read_payload
+auto walk_result(std::size_t offset, std::size_t length, std::size_t size, std::size_t count)
+    -> Validation
+{
+    const bool stopped = offset + 2 < length;
+    Error error = offset < length ? Error::BadPayloadFormat : Error::None;
+    error = stopped && size == 0 ? Error::UnkwownDataType : error;
+    error = length == 0 ? Error::PayloadEmpty : error;
+    return {error, error == Error::None ? count : 0};
+}
+
+// Sigue a walk_fields desde un campo de longitud variable; aparte para que el bucle de los
+// tipos fijos no reserve registros para este caso
+[[gnu::noinline]] auto walk_prefixed(const TypeTable& types,
+                                     std::span<const uint8_t> encoded_payload,
+                                     std::size_t offset, std::size_t count) -> Validation
+{
+    const uint8_t* data = encoded_payload.data();
+    const std::size_t length = encoded_payload.size();
+    std::size_t size = 1;
+
+    while (offset + 2 < length)
+    {
+        const uint8_t type_id = data[offset + 1];
+        size = types.size(type_id);
+        if (size == 0)
+        {
+            size = detail::prefixed_field_size(types, type_id, data[offset + 2],
+                                               length - offset - 2);
+        }
+        const std::size_t next = offset + 2 + size;
+        if ((size == 0) | (next > length))
+        {
+            break;
+        }
+        offset = next;
+        ++count;
+    }
+
+    return walk_result(offset, length, size, count);
+}
+
+// Recorre solo las cabeceras de canal y tipo, sin leer los datos
+auto walk_fields(const TypeTable& types, std::span<const uint8_t> encoded_payload) -> Validation
+{
+    const uint8_t* data = encoded_payload.data();
+    const std::size_t length = encoded_payload.size();
+    std::size_t offset = 0;
+    std::size_t count = 0;
+    std::size_t size = 1;
+
+    while (offset + 2 < length)
+    {
+        size = types.size(data[offset + 1]);
+        const std::size_t next = offset + 2 + size;
+        // Tipo desconocido (tamaño 0) o campo truncado: un solo salto, casi nunca tomado
+        if ((size == 0) | (next > length))
+        {
+            break;
+        }
+        offset = next;
+        ++count;
+    }
+
+    // Tamaño 0 de un tipo prefijado: el campo se mide con su byte de longitud
+    if (size == 0 && offset + 2 < length && types.is_prefixed(data[offset + 1]))
+    {
+        return walk_prefixed(types, encoded_payload, offset, count);
+    }
+    return walk_result(offset, length, size, count);
+}
+
+constexpr TypeTable standard_types = TypeTable::standard();
+
+}  // namespace
+
+auto validate(const TypeTable& types, std::span<const uint8_t> encoded_payload)
+    -> std::expected<std::size_t, Error>
+{
+    const Validation result = walk_fields(types, encoded_payload);
+    if (result.error != Error::None)
+    {
+        return std::unexpected(result.error);
+    }
+    return result.field_count;
+}
+
+auto validate(std::span<const uint8_t> encoded_payload) -> std::expected<std::size_t, Error>
+{
+    return validate(standard_types, encoded_payload);
+}
+
+auto validate_batch(const TypeTable& types, std::span<const std::span<const uint8_t>> payloads,
+                    std::span<Validation> results) -> std::expected<std::size_t, Error>
+{
+    if (results.size() < payloads.size())
+    {
+        return std::unexpected(Error::BufferTooSmall);
+    }
+
+    std::size_t valid = 0;
+    for (std::size_t i = 0; i < payloads.size(); ++i)
+    {
+        results[i] = walk_fields(types, payloads[i]);
+        valid += static_cast<std::size_t>(results[i].error == Error::None);
+    }
+    return valid;
+}
+
+auto decode_readings(const TypeTable& types, std::span<const uint8_t> encoded_payload,
+                     std::span<Reading> readings) -> std::expected<std::size_t, Error>
+{
+    CAYENE_PROBE2(decode__entry, encoded_payload.data(), encoded_payload.size());
+
+    const auto start = metrics::Policy::now();
+    auto result = read_payload(types, encoded_payload, readings);
+    const Error error = result ? Error::None : result.error();
+    metrics::Policy::record_decode(encoded_payload.size(), error, start);
+
+    CAYENE_PROBE3(decode__return, encoded_payload.size(), static_cast<int>(error),
+                  result ? *result : 0);
+    return result;
+}
+
+auto decode_readings(const TypeTable& types, PayloadFragments fragments,
+                     std::span<Reading> readings, std::span<uint8_t> scratch)
+    -> std::expected<std::size_t, Error>
+{
+    detail::FragmentCursor cursor(fragments);
+    CAYENE_PROBE2(decode__entry, fragments.data(), cursor.size());
+
+    const auto start = metrics::Policy::now();
+    auto result = read_fragments(types, cursor, readings, scratch);
+    const Error error = result ? Error::None : result.error();
+    metrics::Policy::record_decode(cursor.size(), error, start);
+
+    CAYENE_PROBE3(decode__return, cursor.size(), static_cast<int>(error), result ? *result : 0);
+    return result;
+}
+
+auto decode_records(const TypeTable& types, std::span<const uint8_t> encoded_payload,
+                    std::span<TimedReading> records, uint32_t timestamp)
+    -> std::expected<std::size_t, Error>
+{
+    CAYENE_PROBE2(decode__entry, encoded_payload.data(), encoded_payload.size());
+
+    const auto start = metrics::Policy::now();
+    auto result = read_records(types, encoded_payload, records, timestamp);
+    const Error error = result ? Error::None : result.error();
+    metrics::Policy::record_decode(encoded_payload.size(), error, start);
+
+    CAYENE_PROBE3(decode__return, encoded_payload.size(), static_cast<int>(error),
+                  result ? *result : 0);
+    return result;
+}
+
+CoreDecoder::CoreDecoder() : types_(TypeTable::standard()) {}
+
+CoreDecoder::CoreDecoder(const TypeTable& types) : types_(types) {}
+
+auto CoreDecoder::decode(std::span<const uint8_t> encoded_payload,
+                         std::span<Reading> readings) const -> std::expected<std::size_t, Error>
+{
+    return decode_readings(types_, encoded_payload, readings);
+}
+
+auto CoreDecoder::decode(PayloadFragments fragments, std::span<Reading> readings,
+                         std::span<uint8_t> scratch) const -> std::expected<std::size_t, Error>
+{
+    return decode_readings(types_, fragments, readings, scratch);
+}
+
+auto CoreDecoder::decode_records(std::span<const uint8_t> encoded_payload,
+                                 std::span<TimedReading> records, uint32_t timestamp) const
+    -> std::expected<std::size_t, Error>
+{
+    return cayene::decode_records(types_, encoded_payload, records, timestamp);
+}
+
+auto CoreDecoder::validate(std::span<const uint8_t> encoded_payload) const
+    -> std::expected<std::size_t, Error>
+{
+    return cayene::validate(types_, encoded_payload);
+}
+
+auto CoreDecoder::add_type(uint8_t type_id, std::size_t size) -> bool
+{
+    return types_.add(type_id, size);
+}
+
+auto CoreDecoder::add_prefixed_type(uint8_t type_id, std::size_t unit) -> bool
+{
+    return types_.add_prefixed(type_id, unit);
+}
+
+}  // namespace cayene
@@ -0,0 +1,164 @@
+#ifndef CAYENE_DECODE_DETAIL_HPP
+#define CAYENE_DECODE_DETAIL_HPP
+
+/**
+ * @file decode_detail.hpp
+ * @brief Helpers shared by the core and the Json decode paths
+ *
+ * Callers guarantee the spans are long enough, so these never check bounds
+ * and never throw.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+
+#include "cayene/core.hpp"
+#include "cayene/error.hpp"
+#include "probes.hpp"
+
+namespace cayene::detail
+{
+
+// Punto único de salida con error, para que el tracepoint vea todos los casos
+inline auto fail(Error error, [[maybe_unused]] std::ptrdiff_t offset,
+                 [[maybe_unused]] uint8_t type_id) -> std::unexpected<Error>
+{
+    CAYENE_PROBE3(decode__error, static_cast<int>(error), offset, type_id);
+    return std::unexpected(error);
+}
+
+// Tamaño de un campo sin tamaño fijo, a partir de su primer byte; 0 si el tipo no está
+// registrado. Uno mayor que max_field_size no cabe en ningún scratch: se devuelve
+// @p remaining + 1 para que el llamante lo rechace como truncado
+inline auto prefixed_field_size(const TypeTable& types, uint8_t type_id, uint8_t length,
+                                std::size_t remaining) -> std::size_t
+{
+    const std::size_t size = types.prefixed_size(type_id, length);
+    return size > max_field_size ? remaining + 1 : size;
+}
+
+inline auto bytes_to_uint16(std::span<const uint8_t> data_span) -> uint16_t
+{
+    return static_cast<uint16_t>(data_span[0] << 8 | data_span[1]);
+}
+
+inline auto bytes_to_int16(std::span<const uint8_t> data_span) -> int16_t
+{
+    uint16_t unsigned_value = bytes_to_uint16(data_span);
+    // Si el valor es mayor que el máximo positivo de int16_t, es negativo
+    if (unsigned_value > 0x7FFF)
+    {
+        return static_cast<int16_t>(unsigned_value - 0x10000);
+    }
+
+    return static_cast<int16_t>(unsigned_value);
+}
+
+inline auto bytes_to_uint24(std::span<const uint8_t> data_span) -> uint32_t
+{
+    return static_cast<uint32_t>(data_span[0] << 16 | data_span[1] << 8 | data_span[2]) &
+           0x00FFFFFF;
+}
+
+inline auto bytes_to_uint32(std::span<const uint8_t> data_span) -> uint32_t
+{
+    return static_cast<uint32_t>(data_span[0]) << 24U | bytes_to_uint24(data_span.subspan(1, 3));
+}
+
+inline auto bytes_to_int24(std::span<const uint8_t> data_span) -> int32_t
+{
+    uint32_t unsigned_value = bytes_to_uint24(data_span);
+    // Si el valor es mayor que el máximo positivo de int24_t, es negativo
+    if (unsigned_value > 0x7FFFFF)
+    {
+        return static_cast<int32_t>(unsigned_value - 0x1000000);
+    }
+
+    return static_cast<int32_t>(unsigned_value);
+}
+
+/**
+ * Reads a payload split across several buffers as if it were contiguous.
+ * Empty fragments are skipped; callers check size() - offset() before
+ * reading.
+ */
+class FragmentCursor
+{
+public:
+    explicit FragmentCursor(std::span<const std::span<const uint8_t>> fragments)
+        : fragments_(fragments)
+    {
+        for (const auto& fragment : fragments)
+        {
+            size_ += fragment.size();
+        }
+        skip_exhausted();
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t { return size_; }
+    [[nodiscard]] auto offset() const -> std::size_t { return offset_; }
+
+    // El próximo byte, sin avanzar
+    [[nodiscard]] auto peek() const -> uint8_t { return fragments_[index_][position_]; }
+
+    auto next() -> uint8_t
+    {
+        const uint8_t byte = fragments_[index_][position_];
+        advance(1);
+        return byte;
+    }
+
+    // Si los próximos @p count bytes están en un mismo fragmento
+    [[nodiscard]] auto contiguous(std::size_t count) const -> bool
+    {
+        return fragments_[index_].size() - position_ >= count;
+    }
+
+    // Los próximos @p count bytes: una vista si son contiguos, si no una copia en @p scratch
+    auto take(std::size_t count, std::span<uint8_t> scratch) -> std::span<const uint8_t>
+    {
+        if (contiguous(count))
+        {
+            const auto view = fragments_[index_].subspan(position_, count);
+            advance(count);
+            return view;
+        }
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            scratch[i] = next();
+        }
+        return scratch.first(count);
+    }
+
+private:
+    void advance(std::size_t count)
+    {
+        position_ += count;
+        offset_ += count;
+        skip_exhausted();
+    }
+
+    void skip_exhausted()
+    {
+        while (index_ < fragments_.size() && position_ == fragments_[index_].size())
+        {
+            ++index_;
+            position_ = 0;
+        }
+    }
+
+    std::span<const std::span<const uint8_t>> fragments_;
+    std::size_t index_{0};
+    std::size_t position_{0};
+    std::size_t offset_{0};
+    std::size_t size_{0};
+};
+
+}  // namespace cayene::detail
+
+#endif  // CAYENE_DECODE_DETAIL_HPP
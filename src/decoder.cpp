@@ -8,16 +8,38 @@
 
 #include "cayene/decoder.hpp"
 
+#include <array>
 #include <cstdint>
 #include <span>
+#include <utility>
+#include <vector>
 
 #include <sys/types.h>
 
+#include "cayene/metrics.hpp"
 #include "cayene_v1_defintions.hpp"
+#include "decode_detail.hpp"
+#include "probes.hpp"
 
 namespace cayene
 {
 
+using detail::bytes_to_int16;
+using detail::bytes_to_int24;
+using detail::bytes_to_uint16;
+using detail::fail;
+
+namespace
+{
+
+// Tipos propios sin layout: el array de bytes tal cual
+auto decode_bytes(std::span<const uint8_t> data_span) -> Json
+{
+    return Json(std::vector<uint8_t>(data_span.begin(), data_span.end()));
+}
+
+}  // namespace
+
 Decoder::Decoder()
 {
     auto standard_data_types = definitions::get_v1_standard_data_types();
@@ -28,199 +50,361 @@ Decoder::Decoder()
     }
 }
 
+Decoder::Decoder(const TenantView& tenant) : core_(tenant.types())
+{
+    const TypeTable& types = tenant.types();
+    for (std::size_t id = 0; id < type_table_size; ++id)
+    {
+        const auto type_id = static_cast<uint8_t>(id);
+        if (types.is_standard(type_id))
+        {
+            data_types_.emplace(type_id, DataType(type_id, std::string(tenant.name(type_id)),
+                                                  types.size(type_id)));
+        }
+        else if (types.contains(type_id))
+        {
+            // size() es 0 en los tipos de longitud variable, como en add_prefixed_data_type
+            data_types_.emplace(type_id,
+                                DataType(type_id, std::string(tenant.name(type_id)),
+                                         types.size(type_id), false, decode_bytes));
+        }
+    }
+}
+
+Decoder::Decoder(NoStandardTypes /*tag*/) : core_(TypeTable{}) {}
+
+auto Decoder::without_standard_types() -> Decoder
+{
+    return Decoder(NoStandardTypes{});
+}
+
 Decoder::~Decoder() = default;
 
-auto Decoder::decode(const std::span<uint8_t>& encoded_payload) -> std::expected<Json, Error>
+auto Decoder::decode(std::span<const uint8_t> encoded_payload) const
+    -> std::expected<Json, Error>
 {
-    if (encoded_payload.size() == 0)
+    CAYENE_PROBE2(decode__entry, encoded_payload.data(), encoded_payload.size());
+
+    const auto start = metrics::Policy::now();
+    auto result = decode_payload(encoded_payload);
+    const Error error = result ? Error::None : result.error();
+    metrics::Policy::record_decode(encoded_payload.size(), error, start);
+
+    CAYENE_PROBE3(decode__return, encoded_payload.size(), static_cast<int>(error),
+                  result ? result->size() : 0);
+    return result;
+}
+
+auto Decoder::decode(PayloadFragments fragments) const -> std::expected<Json, Error>
+{
+    // Un solo fragmento es un payload contiguo: el cursor solo para los partidos
+    if (fragments.size() == 1)
+    {
+        return decode(fragments[0]);
+    }
+
+    detail::FragmentCursor cursor(fragments);
+    CAYENE_PROBE2(decode__entry, fragments.empty() ? nullptr : fragments[0].data(),
+                  cursor.size());
+
+    const auto start = metrics::Policy::now();
+    auto result = decode_payload(cursor);
+    const Error error = result ? Error::None : result.error();
+    metrics::Policy::record_decode(cursor.size(), error, start);
+
+    CAYENE_PROBE3(decode__return, cursor.size(), static_cast<int>(error),
+                  result ? result->size() : 0);
+    return result;
+}
+
+auto Decoder::decode(std::span<const iovec> buffers) const -> std::expected<Json, Error>
+{
+    std::vector<std::span<const uint8_t>> fragments;
+    fragments.reserve(buffers.size());
+    for (const iovec& buffer : buffers)
+    {
+        fragments.emplace_back(static_cast<const uint8_t*>(buffer.iov_base), buffer.iov_len);
+    }
+    return decode(PayloadFragments(fragments));
+}
+
+auto Decoder::decode_payload(std::span<const uint8_t> encoded_payload) const
+    -> std::expected<Json, Error>
+{
+    if (encoded_payload.empty())
     {
-        return {std::unexpected(Error::PayloadEmpty)};
+        return {fail(Error::PayloadEmpty, 0, 0)};
     }
 
-    auto current_index = encoded_payload.begin();
     Json decoded_json = Json::object();
+    std::size_t offset = 0;
 
-    while (current_index + 2 < encoded_payload.end())
+    while (offset + 2 < encoded_payload.size())
     {
-        uint8_t channel = *(current_index++);
-        uint8_t type_id = *(current_index++);
+        const uint8_t channel = encoded_payload[offset];
+        const uint8_t type_id = encoded_payload[offset + 1];
+        offset += 2;
 
         // Si el tipo de dato no está registrado
-        if (!data_types_.contains(type_id))
+        const auto found = data_types_.find(type_id);
+        if (found == data_types_.end())
         {
-            return {std::unexpected(Error::UnkwownDataType)};
+            return {fail(Error::UnkwownDataType, static_cast<std::ptrdiff_t>(offset), type_id)};
         }
 
-        DataType& data_type = data_types_.at(type_id);
+        const DataType& data_type = found->second;
+        // Los tipos de longitud variable (size 0) leen su tamaño del primer byte del campo
+        const std::size_t remaining = encoded_payload.size() - offset;
+        const std::size_t size =
+            data_type.size != 0
+                ? data_type.size
+                : detail::prefixed_field_size(core_.types(), type_id, encoded_payload[offset],
+                                              remaining);
         // Si los bytes restantes son menores que el tamaño requerido por el tipo de dato
-        if (current_index + static_cast<std::ptrdiff_t>(data_type.size) > encoded_payload.end())
+        if (size > remaining)
         {
-            return {std::unexpected(Error::BadPayloadFormat)};
+            return {fail(Error::BadPayloadFormat, static_cast<std::ptrdiff_t>(offset), type_id)};
         }
 
-        if (!data_type.standard)
+        CAYENE_PROBE4(decode__field, channel, type_id, size, offset);
+        if (!decode_field(decoded_json, channel, data_type, encoded_payload.subspan(offset, size)))
         {
-            decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                data_type.decoder_function(std::span<uint8_t>(current_index, data_type.size));
+            return {fail(Error::UnkwownDataType, static_cast<std::ptrdiff_t>(offset), type_id)};
+        }
+        offset += size;
+    }
 
-            current_index += static_cast<std::ptrdiff_t>(data_type.size);
-            continue;
+    // Si quedan bytes sin procesar
+    if (offset < encoded_payload.size())
+    {
+        return {fail(Error::BadPayloadFormat, static_cast<std::ptrdiff_t>(offset), 0)};
+    }
+
+    return decoded_json;
+}
+
+auto Decoder::decode_payload(detail::FragmentCursor& cursor) const -> std::expected<Json, Error>
+{
+    if (cursor.size() == 0)
+    {
+        return {fail(Error::PayloadEmpty, 0, 0)};
+    }
+
+    Json decoded_json = Json::object();
+    // Campos partidos entre fragmentos; el tamaño máximo de un campo cabe siempre
+    std::array<uint8_t, max_field_size> scratch{};
+
+    while (cursor.offset() + 2 < cursor.size())
+    {
+        const uint8_t channel = cursor.next();
+        const uint8_t type_id = cursor.next();
+        const auto offset = static_cast<std::ptrdiff_t>(cursor.offset());
+
+        // Si el tipo de dato no está registrado
+        const auto found = data_types_.find(type_id);
+        if (found == data_types_.end())
+        {
+            return {fail(Error::UnkwownDataType, offset, type_id)};
         }
 
-        switch (type_id)
+        const DataType& data_type = found->second;
+        const std::size_t remaining = cursor.size() - cursor.offset();
+        const std::size_t size =
+            data_type.size != 0
+                ? data_type.size
+                : detail::prefixed_field_size(core_.types(), type_id, cursor.peek(), remaining);
+        // Si los bytes restantes son menores que el tamaño requerido por el tipo de dato
+        if (size > remaining)
         {
-            case 0x00:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_digital_input(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            case 0x01:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_digital_output(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            case 0x02:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_analog_input(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            case 0x03:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_analog_output(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            case 0x65:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_luminosity(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            case 0x66:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_presence(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            case 0x67:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_temperature(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            case 0x68:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_humidity(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            case 0x71:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_accelerometer(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            case 0x73:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_barometer(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            case 0x86:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_gyrometer(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            case 0x88:
-                decoded_json[data_type.name + "_" + std::to_string(channel)] =
-                    decode_gps(std::span<uint8_t>(current_index, data_type.size));
-                break;
-            default:
-                return {std::unexpected(Error::UnkwownDataType)};
+            return {fail(Error::BadPayloadFormat, offset, type_id)};
         }
 
-        current_index += static_cast<std::ptrdiff_t>(data_type.size);
+        CAYENE_PROBE4(decode__field, channel, type_id, size, offset);
+        if (!decode_field(decoded_json, channel, data_type, cursor.take(size, scratch)))
+        {
+            return {fail(Error::UnkwownDataType, offset, type_id)};
+        }
     }
 
     // Si quedan bytes sin procesar
-    if (current_index < encoded_payload.end())
+    if (cursor.offset() < cursor.size())
     {
-        return {std::unexpected(Error::BadPayloadFormat)};
+        return {fail(Error::BadPayloadFormat, static_cast<std::ptrdiff_t>(cursor.offset()), 0)};
     }
 
     return decoded_json;
 }
 
-void Decoder::add_data_type(uint8_t type_id, const std::string& name, std::size_t size)
+auto Decoder::decode_field(Json& decoded_json, uint8_t channel, const DataType& data_type,
+                           std::span<const uint8_t> field_span) const -> bool
 {
-    if (!data_types_.contains(type_id))
+    metrics::Policy::record_field(data_type.type_id);
+
+    const auto key_start = metrics::Policy::now();
+    std::string key = data_type.name + "_" + std::to_string(channel);
+    metrics::Policy::record_stage(metrics::Stage::Key, key_start);
+
+    const auto serialize_start = metrics::Policy::now();
+    Json& value = decoded_json[std::move(key)];
+
+    if (!data_type.standard)
+    {
+        value = data_type.decoder_function(field_span);
+        metrics::Policy::record_stage(metrics::Stage::Serialize, serialize_start);
+        return true;
+    }
+
+    switch (data_type.type_id)
     {
-        data_types_.emplace(type_id, DataType(type_id, name, size));
+        case 0x00:
+            value = decode_digital_input(field_span);
+            break;
+        case 0x01:
+            value = decode_digital_output(field_span);
+            break;
+        case 0x02:
+            value = decode_analog_input(field_span);
+            break;
+        case 0x03:
+            value = decode_analog_output(field_span);
+            break;
+        case 0x65:
+            value = decode_luminosity(field_span);
+            break;
+        case 0x66:
+            value = decode_presence(field_span);
+            break;
+        case 0x67:
+            value = decode_temperature(field_span);
+            break;
+        case 0x68:
+            value = decode_humidity(field_span);
+            break;
+        case 0x71:
+            value = decode_accelerometer(field_span);
+            break;
+        case 0x73:
+            value = decode_barometer(field_span);
+            break;
+        case 0x86:
+            value = decode_gyrometer(field_span);
+            break;
+        case 0x88:
+            value = decode_gps(field_span);
+            break;
+        default:
+            return false;
     }
+    metrics::Policy::record_stage(metrics::Stage::Serialize, serialize_start);
+    return true;
 }
 
-uint16_t Decoder::bytes_to_uint16(const std::span<uint8_t>& data_span)
+auto Decoder::decode_readings(std::span<const uint8_t> encoded_payload,
+                              std::span<Reading> readings) const
+    -> std::expected<std::size_t, Error>
 {
-    return static_cast<uint16_t>(data_span.at(0) << 8 | data_span.at(1));
+    return core_.decode(encoded_payload, readings);
 }
 
-int16_t Decoder::bytes_to_int16(const std::span<uint8_t>& data_span)
+auto Decoder::decode_readings(PayloadFragments fragments, std::span<Reading> readings,
+                              std::span<uint8_t> scratch) const
+    -> std::expected<std::size_t, Error>
 {
-    uint16_t unsigned_value = bytes_to_uint16(data_span);
-    // Si el valor es mayor que el máximo positivo de int16_t, es negativo
-    if (unsigned_value > 0x7FFF)
-    {
-        return static_cast<int16_t>(unsigned_value - 0x10000);
-    }
+    return core_.decode(fragments, readings, scratch);
+}
+
+auto Decoder::decode_records(std::span<const uint8_t> encoded_payload,
+                             std::span<TimedReading> records, uint32_t timestamp) const
+    -> std::expected<std::size_t, Error>
+{
+    return core_.decode_records(encoded_payload, records, timestamp);
+}
 
-    return static_cast<int16_t>(unsigned_value);
+auto Decoder::validate(std::span<const uint8_t> encoded_payload) const
+    -> std::expected<std::size_t, Error>
+{
+    return core_.validate(encoded_payload);
 }
 
-uint32_t Decoder::bytes_to_uint24(const std::span<uint8_t>& data_span)
+bool Decoder::add_data_type(uint8_t type_id, const std::string& name, std::size_t size,
+                            DecoderFunction decoder_function)
 {
-    return static_cast<uint32_t>(data_span.at(0) << 16 | data_span.at(1) << 8 | data_span.at(2)) &
-           0x00FFFFFF;
+    // La tabla del núcleo rechaza duplicados y tamaños fuera de rango
+    if (data_types_.contains(type_id) || !core_.add_type(type_id, size))
+    {
+        return false;
+    }
+
+    if (!decoder_function)
+    {
+        decoder_function = decode_bytes;
+    }
+    data_types_.emplace(type_id, DataType(type_id, name, size, false, std::move(decoder_function)));
+    return true;
 }
 
-int32_t Decoder::bytes_to_int24(const std::span<uint8_t>& data_span)
+bool Decoder::add_prefixed_data_type(uint8_t type_id, const std::string& name, std::size_t unit,
+                                     DecoderFunction decoder_function)
 {
-    uint32_t unsigned_value = bytes_to_uint24(data_span);
-    // Si el valor es mayor que el máximo positivo de int24_t, es negativo
-    if (unsigned_value > 0x7FFFFF)
+    if (data_types_.contains(type_id) || !core_.add_prefixed_type(type_id, unit))
     {
-        return static_cast<int32_t>(unsigned_value - 0x1000000);
+        return false;
     }
 
-    return static_cast<int32_t>(unsigned_value);
+    if (!decoder_function)
+    {
+        decoder_function = decode_bytes;
+    }
+    // Tamaño 0: decode_payload lo lee del byte de longitud
+    data_types_.emplace(type_id, DataType(type_id, name, 0, false, std::move(decoder_function)));
+    return true;
 }
 
-uint8_t Decoder::decode_digital_input(const std::span<uint8_t>& data_span)
+uint8_t Decoder::decode_digital_input(std::span<const uint8_t> data_span)
 {
     return data_span.at(0);
 }
 
-uint8_t Decoder::decode_digital_output(const std::span<uint8_t>& data_span)
+uint8_t Decoder::decode_digital_output(std::span<const uint8_t> data_span)
 {
     return data_span.at(0);
 }
 
-double Decoder::decode_analog_input(const std::span<uint8_t>& data_span)
+double Decoder::decode_analog_input(std::span<const uint8_t> data_span)
 {
     auto raw_value = bytes_to_int16(data_span);
     return raw_value / 100.0;
 }
 
-double Decoder::decode_analog_output(const std::span<uint8_t>& data_span)
+double Decoder::decode_analog_output(std::span<const uint8_t> data_span)
 {
     auto raw_value = bytes_to_int16(data_span);
     return raw_value / 100.0;
 }
 
-uint16_t Decoder::decode_luminosity(const std::span<uint8_t>& data_span)
+uint16_t Decoder::decode_luminosity(std::span<const uint8_t> data_span)
 {
     return bytes_to_uint16(data_span);
 }
 
-uint8_t Decoder::decode_presence(const std::span<uint8_t>& data_span)
+uint8_t Decoder::decode_presence(std::span<const uint8_t> data_span)
 {
     return data_span.at(0);
 }
 
-double Decoder::decode_temperature(const std::span<uint8_t>& data_span)
+double Decoder::decode_temperature(std::span<const uint8_t> data_span)
 {
     auto raw_value = bytes_to_int16(data_span);
     return raw_value / 10.0;
 }
 
-double Decoder::decode_humidity(const std::span<uint8_t>& data_span)
+double Decoder::decode_humidity(std::span<const uint8_t> data_span)
 {
     auto raw_value = bytes_to_uint16(data_span);
     return raw_value / 10.0;
 }
 
-Json Decoder::decode_accelerometer(const std::span<uint8_t>& data_span)
+Json Decoder::decode_accelerometer(std::span<const uint8_t> data_span)
 {
     Json accel_json = Json::object();
 
@@ -239,19 +423,19 @@ Json Decoder::decode_accelerometer(const std::span<uint8_t>& data_span)
     return accel_json;
 }
 
-double Decoder::decode_barometer(const std::span<uint8_t>& data_span)
+double Decoder::decode_barometer(std::span<const uint8_t> data_span)
 {
     auto raw_value = bytes_to_uint16(data_span);
     return raw_value / 10.0;
 }
 
-double Decoder::decode_gyrometer(const std::span<uint8_t>& data_span)
+double Decoder::decode_gyrometer(std::span<const uint8_t> data_span)
 {
     auto raw_value = bytes_to_int16(data_span);
     return raw_value / 100.0;
 }
 
-Json Decoder::decode_gps(const std::span<uint8_t>& data_span)
+Json Decoder::decode_gps(std::span<const uint8_t> data_span)
 {
     Json gps_json = Json::object();
 
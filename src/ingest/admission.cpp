@@ -0,0 +1,220 @@
+/**
+ * @file admission.cpp
+ * @brief Implementation of the per-device token buckets
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/admission.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+constexpr uint64_t free_key = 0;
+constexpr uint64_t claiming_key = 1;
+
+// FNV-1a de 64 bits; las claves 0 y 1 están reservadas
+auto device_hash(std::string_view device_id) -> uint64_t
+{
+    uint64_t hash = 0xcbf29ce484222325U;
+    for (const char c : device_id)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3U;
+    }
+    return hash <= claiming_key ? hash + 2 : hash;
+}
+
+// Los bits bajos de FNV se reparten mal: se mezclan los altos antes de enmascarar
+auto home_index(uint64_t hash, std::size_t mask) -> std::size_t
+{
+    return static_cast<std::size_t>(hash ^ (hash >> 29U)) & mask;
+}
+
+auto to_ns(double seconds) -> int64_t
+{
+    return static_cast<int64_t>(seconds * 1e9);
+}
+
+}  // namespace
+
+AdmissionControl::AdmissionControl(AdmissionConfig config)
+    : config_(std::move(config)),
+      mask_(std::bit_ceil(std::max<std::size_t>(config_.capacity, 1)) - 1),
+      slots_(std::make_unique<Slot[]>(mask_ + 1)),
+      names_(std::make_unique<std::array<char, name_size>[]>(mask_ + 1))
+{
+    config_.max_probes = std::clamp<std::size_t>(config_.max_probes, 1, mask_ + 1);
+}
+
+auto AdmissionControl::admit(std::string_view device_id, Clock::time_point now) -> bool
+{
+    Slot* slot = find_or_claim(device_hash(device_id), device_id);
+    if (slot == nullptr)
+    {
+        untracked_.fetch_add(1, std::memory_order_relaxed);
+        return config_.admit_untracked;
+    }
+
+    const int64_t time = std::chrono::nanoseconds(now.time_since_epoch()).count();
+    int64_t arrival = slot->arrival.load(std::memory_order_relaxed);
+    while (true)
+    {
+        // El cubo vacío equivale a una llegada teórica más allá de la tolerancia
+        const int64_t base = std::max(arrival, time);
+        if (base - time > slot->tolerance)
+        {
+            slot->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (slot->arrival.compare_exchange_weak(arrival, base + slot->interval,
+                                                std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+    slot->admitted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+auto AdmissionControl::find(uint64_t hash) const -> const Slot*
+{
+    const std::size_t home = home_index(hash, mask_);
+    for (std::size_t probe = 0; probe < config_.max_probes; ++probe)
+    {
+        const Slot& slot = slots_[(home + probe) & mask_];
+        const uint64_t key = slot.key.load(std::memory_order_acquire);
+        if (key == hash)
+        {
+            return &slot;
+        }
+        // Un hueco libre corta la secuencia: nunca se borra
+        if (key == free_key)
+        {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+auto AdmissionControl::find_or_claim(uint64_t hash, std::string_view device_id) -> Slot*
+{
+    const std::size_t home = home_index(hash, mask_);
+    for (std::size_t probe = 0; probe < config_.max_probes; ++probe)
+    {
+        Slot& slot = slots_[(home + probe) & mask_];
+        uint64_t key = slot.key.load(std::memory_order_acquire);
+        while (true)
+        {
+            if (key == claiming_key)
+            {
+                // Otro hilo está inicializando el hueco; puede ser este mismo dispositivo
+                std::this_thread::yield();
+                key = slot.key.load(std::memory_order_acquire);
+                continue;
+            }
+            if (key != free_key ||
+                slot.key.compare_exchange_strong(key, claiming_key, std::memory_order_acquire))
+            {
+                break;
+            }
+        }
+        if (key == hash)
+        {
+            return &slot;
+        }
+        if (key != free_key)
+        {
+            continue;
+        }
+
+        // Hueco reclamado: política, nombre y publicación de la clave
+        const auto custom = config_.device_policies.find(device_id);
+        const AdmissionPolicy& policy =
+            custom != config_.device_policies.end() ? custom->second : config_.policy;
+        slot.interval = policy.rate > 0 ? to_ns(1.0 / policy.rate) : 0;
+        slot.tolerance =
+            policy.rate > 0 ? to_ns(std::max(policy.burst - 1.0, 0.0) / policy.rate) : 0;
+
+        auto& name = names_[index_of(slot)];
+        const std::size_t size = std::min(device_id.size(), name_size - 1);
+        std::memcpy(name.data(), device_id.data(), size);
+        name[size] = '\0';
+
+        slot.key.store(hash, std::memory_order_release);
+        return &slot;
+    }
+    return nullptr;
+}
+
+auto AdmissionControl::index_of(const Slot& slot) const -> std::size_t
+{
+    return static_cast<std::size_t>(&slot - slots_.get());
+}
+
+auto AdmissionControl::snapshot(const Slot& slot) const -> DeviceAdmission
+{
+    return DeviceAdmission{std::string(names_[index_of(slot)].data()),
+                           slot.admitted.load(std::memory_order_relaxed),
+                           slot.dropped.load(std::memory_order_relaxed)};
+}
+
+auto AdmissionControl::stats() const -> AdmissionStats
+{
+    AdmissionStats stats;
+    for (std::size_t i = 0; i <= mask_; ++i)
+    {
+        const Slot& slot = slots_[i];
+        if (slot.key.load(std::memory_order_acquire) <= claiming_key)
+        {
+            continue;
+        }
+        ++stats.devices;
+        stats.admitted += slot.admitted.load(std::memory_order_relaxed);
+        stats.dropped += slot.dropped.load(std::memory_order_relaxed);
+    }
+    stats.untracked = untracked_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+auto AdmissionControl::device(std::string_view device_id) const -> std::optional<DeviceAdmission>
+{
+    const Slot* slot = find(device_hash(device_id));
+    if (slot == nullptr)
+    {
+        return std::nullopt;
+    }
+    return snapshot(*slot);
+}
+
+auto AdmissionControl::top_dropped(std::size_t count) const -> std::vector<DeviceAdmission>
+{
+    std::vector<DeviceAdmission> devices;
+    for (std::size_t i = 0; i <= mask_; ++i)
+    {
+        const Slot& slot = slots_[i];
+        if (slot.key.load(std::memory_order_acquire) > claiming_key &&
+            slot.dropped.load(std::memory_order_relaxed) != 0)
+        {
+            devices.push_back(snapshot(slot));
+        }
+    }
+    const auto end = devices.begin() + static_cast<std::ptrdiff_t>(std::min(count, devices.size()));
+    std::partial_sort(devices.begin(), end, devices.end(),
+                      [](const DeviceAdmission& a, const DeviceAdmission& b)
+                      { return a.dropped > b.dropped; });
+    devices.erase(end, devices.end());
+    return devices;
+}
+
+}  // namespace cayene::ingest
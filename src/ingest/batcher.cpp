@@ -0,0 +1,229 @@
+/**
+ * @file batcher.cpp
+ * @brief Implementation of the adaptive micro-batching stage
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/batcher.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace cayene::ingest
+{
+
+MicroBatcher::MicroBatcher(BatcherConfig config, TypeCatalog catalog, BatchHandler handler,
+                           DoneHandler done)
+    : config_(config),
+      catalog_(std::move(catalog)),
+      handler_(std::move(handler)),
+      done_(std::move(done))
+{
+    config_.min_batch = std::max<std::size_t>(config_.min_batch, 1);
+    config_.max_batch = std::max(config_.max_batch, config_.min_batch);
+    config_.max_queued = std::max(config_.max_queued, config_.max_batch);
+    target_ = config_.min_batch;
+    batch_.reserve(config_.max_batch);
+    tags_.reserve(config_.max_batch);
+    thread_ = std::thread([this] { run(); });
+}
+
+MicroBatcher::~MicroBatcher()
+{
+    {
+        const std::lock_guard lock(mutex_);
+        closing_ = true;
+    }
+    batch_ready_.notify_one();
+    thread_.join();
+}
+
+auto MicroBatcher::submit(const Uplink& uplink, std::string_view source, uint64_t tag) -> bool
+{
+    const auto now = Clock::now();
+    const std::lock_guard lock(mutex_);
+    if (closing_ || front_.size >= config_.max_queued)
+    {
+        ++stats_.dropped;
+        return false;
+    }
+
+    // Un hueco mayor que el presupuesto ya implica lotes de uno: se recorta
+    // para que el promedio se recupere en pocas llegadas tras un silencio
+    if (submitted_ != 0)
+    {
+        const auto budget = std::chrono::nanoseconds(config_.latency_budget).count();
+        const auto gap = std::min((now - last_arrival_).count(), budget);
+        arrival_gap_ns_ += config_.smoothing * (static_cast<double>(gap) - arrival_gap_ns_);
+        target_ = compute_target();
+    }
+    last_arrival_ = now;
+
+    if (front_.size == front_.entries.size())
+    {
+        front_.entries.emplace_back();
+    }
+    Entry& entry = front_.entries[front_.size++];
+    entry.format = uplink.format;
+    entry.device_id.assign(uplink.device_id);
+    entry.fport = uplink.fport;
+    entry.payload.assign(uplink.payload.begin(), uplink.payload.end());
+    entry.source.assign(source);
+    entry.tag = tag;
+    entry.arrival = now;
+    ++submitted_;
+
+    // El primero arma el plazo del lote; el que completa el objetivo lo cierra
+    if (front_.size == 1 || front_.size >= target_)
+    {
+        batch_ready_.notify_one();
+    }
+    return true;
+}
+
+void MicroBatcher::drain()
+{
+    std::unique_lock lock(mutex_);
+    const uint64_t target = submitted_;
+    if (handed_over_ >= target)
+    {
+        return;
+    }
+    // El lote abierto se cierra ya: esperar su plazo solo retrasaría al que drena
+    flush_to_ = std::max(flush_to_, target);
+    batch_ready_.notify_one();
+    batch_done_.wait(lock, [this, target] { return handed_over_ >= target; });
+}
+
+auto MicroBatcher::stats() const -> BatcherStats
+{
+    const std::lock_guard lock(mutex_);
+    BatcherStats stats = stats_;
+    stats.target_batch = target_;
+    stats.arrival_gap = std::chrono::nanoseconds(static_cast<int64_t>(arrival_gap_ns_));
+    stats.decode_cost = std::chrono::nanoseconds(static_cast<int64_t>(decode_cost_ns_));
+    return stats;
+}
+
+auto MicroBatcher::compute_target() const -> std::size_t
+{
+    const double per_uplink = arrival_gap_ns_ + decode_cost_ns_;
+    if (per_uplink <= 0)
+    {
+        return config_.max_batch;
+    }
+    const double budget = std::chrono::duration<double, std::nano>(config_.latency_budget).count();
+    const double target = std::clamp(budget / per_uplink, static_cast<double>(config_.min_batch),
+                                     static_cast<double>(config_.max_batch));
+    return static_cast<std::size_t>(target);
+}
+
+auto MicroBatcher::deadline() const -> Clock::time_point
+{
+    // Se reserva el tiempo de decodificar el lote dentro del presupuesto
+    const auto reserve = std::chrono::nanoseconds(
+        static_cast<int64_t>(decode_cost_ns_ * static_cast<double>(front_.size)));
+    const auto wait = std::max<std::chrono::nanoseconds>(
+        std::chrono::nanoseconds(config_.latency_budget) - reserve, std::chrono::nanoseconds(0));
+    return front_.entries.front().arrival + wait;
+}
+
+void MicroBatcher::run()
+{
+    std::unique_lock lock(mutex_);
+    while (true)
+    {
+        auto full = [this]
+        { return closing_ || front_.size >= target_ || flush_to_ > handed_over_; };
+        if (front_.size == 0)
+        {
+            batch_ready_.wait(lock, [&] { return closing_ || front_.size != 0; });
+        }
+        else
+        {
+            batch_ready_.wait_until(lock, deadline(), full);
+        }
+
+        if (front_.size == 0)
+        {
+            if (closing_)
+            {
+                return;
+            }
+            continue;
+        }
+        const bool by_size = front_.size >= target_;
+        const bool flushing = flush_to_ > handed_over_;
+        if (!by_size && !closing_ && !flushing && Clock::now() < deadline())
+        {
+            continue;
+        }
+
+        // Los productores siguen llenando la otra cola mientras esta se decodifica
+        std::swap(front_, back_);
+        const uint64_t batch_end = submitted_;
+        ++(by_size ? stats_.size_closed : stats_.deadline_closed);
+        lock.unlock();
+        batch_done_.notify_all();
+
+        // Si el worker se retrasó la cola puede superar max_batch: se trocea
+        for (std::size_t first = 0; first < back_.size; first += config_.max_batch)
+        {
+            decode_batch(back_, first, std::min(config_.max_batch, back_.size - first));
+        }
+
+        lock.lock();
+        back_.size = 0;
+        handed_over_ = batch_end;
+        batch_done_.notify_all();
+    }
+}
+
+void MicroBatcher::decode_batch(const Queue& queue, std::size_t first, std::size_t count)
+{
+    const auto start = Clock::now();
+    batch_.clear();
+    tags_.clear();
+    for (std::size_t i = first; i < first + count; ++i)
+    {
+        const Entry& entry = queue.entries[i];
+        tags_.push_back(entry.tag);
+        auto decoded = catalog_.decode(entry.fport, entry.payload);
+        if (!decoded)
+        {
+            continue;
+        }
+        batch_.push_back(BatchedUplink{
+            Uplink{entry.format, entry.device_id, entry.fport, entry.payload},
+            std::move(*decoded), entry.source, entry.tag});
+    }
+    const auto decoded_at = Clock::now();
+    if (handler_ && !batch_.empty())
+    {
+        handler_(batch_);
+    }
+    if (done_)
+    {
+        done_(tags_);
+    }
+
+    const std::lock_guard lock(mutex_);
+    const double cost = std::chrono::duration<double, std::nano>(decoded_at - start).count() /
+                        static_cast<double>(count);
+    decode_cost_ns_ += config_.smoothing * (cost - decode_cost_ns_);
+    target_ = compute_target();
+
+    stats_.uplinks += batch_.size();
+    stats_.rejected += count - batch_.size();
+    ++stats_.batches;
+    stats_.batch_sizes.record(count);
+    for (std::size_t i = first; i < first + count; ++i)
+    {
+        const auto waited = start - queue.entries[i].arrival;
+        stats_.queue_delay.record(static_cast<uint64_t>(std::max<int64_t>(waited.count(), 0)));
+    }
+}
+
+}  // namespace cayene::ingest
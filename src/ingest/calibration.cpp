@@ -0,0 +1,400 @@
+/**
+ * @file calibration.cpp
+ * @brief Implementation of the per-sensor calibration table
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/calibration.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cayene/core.hpp"
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+// Componentes acumulados antes de cada pasada de multiplicación y suma
+constexpr std::size_t batch_size = 64;
+constexpr std::size_t max_components = 3;
+
+// 1 / escala de cada tipo y componente: sin calibración la división también es un producto
+constexpr auto make_reciprocal_scales()
+{
+    std::array<std::array<double, max_components>, 256> scales{};
+    for (std::size_t type_id = 0; type_id < scales.size(); ++type_id)
+    {
+        for (std::size_t component = 0; component < max_components; ++component)
+        {
+            scales[type_id][component] =
+                1.0 / reading_scale(static_cast<uint8_t>(type_id), component);
+        }
+    }
+    return scales;
+}
+
+constexpr auto reciprocal_scales = make_reciprocal_scales();
+
+auto field_of(uint8_t channel, uint8_t type_id) -> uint16_t
+{
+    return static_cast<uint16_t>(channel << 8U | type_id);
+}
+
+// Miembros de cada componente en el Json del decoder, en el orden de Reading::raw
+auto component_names(uint8_t type_id) -> std::span<const std::string_view>
+{
+    static constexpr std::array<std::string_view, 3> axes = {"x", "y", "z"};
+    static constexpr std::array<std::string_view, 3> position = {"latitude", "longitude",
+                                                                 "altitude"};
+    switch (type_id)
+    {
+        case 0x71:  // Accelerometer
+            return axes;
+        case 0x88:  // GPS
+            return position;
+        default:
+            return {};
+    }
+}
+
+// Clave del campo en el Json del decoder; vacía para tipos no estándar
+auto decoded_key(const Reading& reading) -> std::string
+{
+    const auto* type =
+        std::ranges::find(v1_standard_types, reading.type_id, &StandardType::type_id);
+    if (type == v1_standard_types.end())
+    {
+        return {};
+    }
+    return std::format("{}_{}", type->name, reading.channel);
+}
+
+auto syntax_error(std::size_t line, std::string_view what) -> std::unexpected<ConfigError>
+{
+    return std::unexpected(
+        ConfigError{ConfigErrorCode::Syntax, std::format("line {}: {}", line, what)});
+}
+
+auto parse_double(std::string_view text, double& value) -> bool
+{
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc{} && end == text.data() + text.size();
+}
+
+auto parse_byte(std::string_view text, uint8_t& value) -> bool
+{
+    int base = 10;
+    if (text.starts_with("0x") || text.starts_with("0X"))
+    {
+        text.remove_prefix(2);
+        base = 16;
+    }
+    const auto [end, error] =
+        std::from_chars(text.data(), text.data() + text.size(), value, base);
+    return !text.empty() && error == std::errc{} && end == text.data() + text.size();
+}
+
+}  // namespace
+
+auto CalibrationTable::build(std::span<const CalibrationEntry> entries)
+    -> std::expected<CalibrationTable, ConfigError>
+{
+    CalibrationTable table;
+    if (entries.empty())
+    {
+        return table;
+    }
+
+    std::vector<uint64_t> keys(entries.size());
+    std::ranges::transform(entries, keys.begin(), [](const CalibrationEntry& entry)
+                           { return device_key(entry.device_id); });
+
+    std::vector<uint64_t> devices = keys;
+    std::ranges::sort(devices);
+    const auto [last, end] = std::ranges::unique(devices);
+    devices.erase(last, end);
+
+    auto hash = PerfectHash::build(devices);
+    if (!hash)
+    {
+        return std::unexpected(
+            ConfigError{ConfigErrorCode::Invalid, "cannot build a perfect hash for the devices"});
+    }
+    table.hash_ = std::move(*hash);
+
+    table.device_keys_.resize(devices.size());
+    for (const uint64_t key : devices)
+    {
+        table.device_keys_[table.hash_(key)] = key;
+    }
+
+    // Orden por hueco del dispositivo y campo: los sensores de cada uno quedan juntos
+    std::vector<std::size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    const auto sort_key = [&](std::size_t i)
+    {
+        return std::pair(table.hash_(keys[i]),
+                         field_of(entries[i].channel, entries[i].type_id));
+    };
+    std::ranges::stable_sort(order, {}, sort_key);
+    const auto duplicate = std::ranges::adjacent_find(order, {}, sort_key);
+    if (duplicate != order.end())
+    {
+        const CalibrationEntry& entry = entries[*duplicate];
+        return std::unexpected(ConfigError{
+            ConfigErrorCode::Invalid,
+            std::format("duplicate sensor {} channel {} type 0x{:02x}", entry.device_id,
+                        entry.channel, entry.type_id)});
+    }
+
+    table.first_.assign(devices.size() + 1, 0);
+    table.fields_.reserve(entries.size());
+    table.coefficients_.reserve(entries.size());
+    for (const std::size_t i : order)
+    {
+        const CalibrationEntry& entry = entries[i];
+        ++table.first_[table.hash_(keys[i]) + 1];
+        table.fields_.push_back(field_of(entry.channel, entry.type_id));
+
+        Coefficients coefficients{.offset = entry.offset};
+        for (std::size_t component = 0; component < max_components; ++component)
+        {
+            coefficients.multiplier[component] =
+                entry.gain * reciprocal_scales[entry.type_id][component];
+        }
+        table.coefficients_.push_back(coefficients);
+    }
+    std::partial_sum(table.first_.begin(), table.first_.end(), table.first_.begin());
+    return table;
+}
+
+auto CalibrationTable::parse(std::string_view text)
+    -> std::expected<CalibrationTable, ConfigError>
+{
+    std::vector<CalibrationEntry> entries;
+    std::size_t line_number = 0;
+    while (!text.empty())
+    {
+        const auto end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        ++line_number;
+
+        if (line.ends_with('\r'))
+        {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line.starts_with('#'))
+        {
+            continue;
+        }
+
+        std::vector<std::string_view> fields;
+        while (true)
+        {
+            const auto comma = line.find(',');
+            fields.push_back(line.substr(0, comma));
+            if (comma == std::string_view::npos)
+            {
+                break;
+            }
+            line.remove_prefix(comma + 1);
+        }
+        if (fields.size() < 4 || fields.size() > 5 || fields[0].empty())
+        {
+            return syntax_error(line_number, "expected device_id,channel,type_id,gain[,offset]");
+        }
+
+        CalibrationEntry entry{std::string(fields[0])};
+        if (!parse_byte(fields[1], entry.channel))
+        {
+            return syntax_error(line_number, "bad channel");
+        }
+        if (!parse_byte(fields[2], entry.type_id))
+        {
+            return syntax_error(line_number, "bad type_id");
+        }
+        if (!parse_double(fields[3], entry.gain))
+        {
+            return syntax_error(line_number, "bad gain");
+        }
+        if (fields.size() > 4 && !parse_double(fields[4], entry.offset))
+        {
+            return syntax_error(line_number, "bad offset");
+        }
+        entries.push_back(std::move(entry));
+    }
+    return build(entries);
+}
+
+auto CalibrationTable::load(const std::string& path)
+    -> std::expected<CalibrationTable, ConfigError>
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return std::unexpected(ConfigError{ConfigErrorCode::Io, "cannot open " + path});
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return parse(contents.str());
+}
+
+auto CalibrationTable::sensors(std::string_view device_id) const
+    -> std::pair<std::size_t, std::size_t>
+{
+    if (hash_.empty())
+    {
+        return {0, 0};
+    }
+    const uint64_t key = device_key(device_id);
+    const std::size_t slot = hash_(key);
+    if (device_keys_[slot] != key)
+    {
+        return {0, 0};
+    }
+    return {first_[slot], first_[slot + 1]};
+}
+
+auto CalibrationTable::calibrate(std::string_view device_id, std::span<const Reading> readings,
+                                 std::span<double> values) const
+    -> std::expected<std::size_t, Error>
+{
+    std::size_t total = 0;
+    for (const Reading& reading : readings)
+    {
+        total += std::min<std::size_t>(reading.component_count, max_components);
+    }
+    if (total > values.size())
+    {
+        return std::unexpected(Error::BufferTooSmall);
+    }
+
+    const auto [first, last] = sensors(device_id);
+    const std::span<const uint16_t> fields(fields_.data() + first, last - first);
+
+    // Recogida de operandos y luego una pasada sin saltos que el compilador vectoriza
+    std::array<double, batch_size> raw{};
+    std::array<double, batch_size> multiplier{};
+    std::array<double, batch_size> offset{};
+    std::size_t pending = 0;
+    std::size_t written = 0;
+    const auto flush = [&]
+    {
+        for (std::size_t i = 0; i < pending; ++i)
+        {
+            values[written + i] = raw[i] * multiplier[i] + offset[i];
+        }
+        written += pending;
+        pending = 0;
+    };
+
+    for (const Reading& reading : readings)
+    {
+        // Pocos sensores por dispositivo: la búsqueda lineal gana a la binaria
+        const auto sensor = std::ranges::find(fields, field_of(reading.channel, reading.type_id));
+        const Coefficients* coefficients =
+            sensor == fields.end()
+                ? nullptr
+                : &coefficients_[first + static_cast<std::size_t>(sensor - fields.begin())];
+
+        const std::size_t components =
+            std::min<std::size_t>(reading.component_count, max_components);
+        for (std::size_t component = 0; component < components; ++component)
+        {
+            raw[pending] = reading.raw[component];
+            if (coefficients != nullptr)
+            {
+                multiplier[pending] = coefficients->multiplier[component];
+                offset[pending] = coefficients->offset;
+            }
+            else
+            {
+                multiplier[pending] = reciprocal_scales[reading.type_id][component];
+                offset[pending] = 0.0;
+            }
+            if (++pending == batch_size)
+            {
+                flush();
+            }
+        }
+    }
+    flush();
+    return written;
+}
+
+auto CalibrationTable::annotate(const Uplink& uplink, std::span<const Reading> readings,
+                                Json& object) const -> std::size_t
+{
+    // La mayoría de dispositivos no tiene coeficientes: basta con el hash
+    const auto [first, last] = sensors(uplink.device_id);
+    if (first == last || !object.contains("decoded"))
+    {
+        return 0;
+    }
+
+    thread_local std::vector<double> values;
+    values.resize(readings.size() * max_components);
+    if (!calibrate(uplink.device_id, readings, values))
+    {
+        return 0;
+    }
+
+    const std::span<const uint16_t> fields(fields_.data() + first, last - first);
+    Json& decoded = object["decoded"];
+    std::size_t rewritten = 0;
+    std::size_t next = 0;
+    for (const Reading& reading : readings)
+    {
+        const std::span<const double> calibrated(
+            values.data() + next, std::min<std::size_t>(reading.component_count, max_components));
+        next += calibrated.size();
+        // Sin coeficientes el valor calibrado es el del decoder: se deja como está
+        if (calibrated.empty() ||
+            std::ranges::find(fields, field_of(reading.channel, reading.type_id)) == fields.end())
+        {
+            continue;
+        }
+        const auto value = decoded.find(decoded_key(reading));
+        if (value == decoded.end())
+        {
+            continue;
+        }
+        if (value->is_number())
+        {
+            *value = calibrated[0];
+        }
+        else
+        {
+            const auto names = component_names(reading.type_id);
+            const std::size_t count = std::min(names.size(), calibrated.size());
+            for (std::size_t component = 0; component < count; ++component)
+            {
+                (*value)[names[component]] = calibrated[component];
+            }
+        }
+        ++rewritten;
+    }
+    return rewritten;
+}
+
+auto CalibrationTable::memory_bytes() const -> std::size_t
+{
+    return hash_.memory_bytes() + device_keys_.capacity() * sizeof(uint64_t) +
+           first_.capacity() * sizeof(uint32_t) + fields_.capacity() * sizeof(uint16_t) +
+           coefficients_.capacity() * sizeof(Coefficients);
+}
+
+}  // namespace cayene::ingest
@@ -0,0 +1,304 @@
+/**
+ * @file enrichment.cpp
+ * @brief Implementation of the device metadata index
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/enrichment.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+auto syntax_error(std::size_t line, std::string_view what) -> std::unexpected<ConfigError>
+{
+    return std::unexpected(
+        ConfigError{ConfigErrorCode::Syntax, std::format("line {}: {}", line, what)});
+}
+
+auto parse_float(std::string_view text, float& value) -> bool
+{
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc{} && end == text.data() + text.size();
+}
+
+// Nombres de sitio y tenant compartidos por muchos dispositivos: uno por índice
+class NameTable
+{
+public:
+    explicit NameTable(std::vector<std::string>& names) : names_(names) {}
+
+    auto intern(const std::string& name) -> uint32_t
+    {
+        const auto [entry, inserted] =
+            ids_.try_emplace(name, static_cast<uint32_t>(names_.size()));
+        if (inserted)
+        {
+            names_.push_back(name);
+        }
+        return entry->second;
+    }
+
+private:
+    std::vector<std::string>& names_;
+    std::unordered_map<std::string, uint32_t> ids_;
+};
+
+}  // namespace
+
+auto DeviceIndex::build(std::span<const DeviceMetadata> devices)
+    -> std::expected<DeviceIndex, ConfigError>
+{
+    DeviceIndex index;
+    const std::size_t count = devices.size();
+    if (count == 0)
+    {
+        return index;
+    }
+
+    std::vector<uint64_t> keys(count);
+    std::ranges::transform(devices, keys.begin(), [](const DeviceMetadata& device)
+                           { return device_key(device.device_id); });
+    {
+        std::vector<std::size_t> order(count);
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::ranges::sort(order, {}, [&keys](std::size_t i) { return keys[i]; });
+        const auto duplicate = std::ranges::adjacent_find(
+            order, {}, [&keys](std::size_t i) { return keys[i]; });
+        if (duplicate != order.end())
+        {
+            return std::unexpected(ConfigError{
+                ConfigErrorCode::Invalid, "duplicate device " + devices[*duplicate].device_id});
+        }
+    }
+
+    auto hash = PerfectHash::build(keys);
+    if (!hash)
+    {
+        return std::unexpected(
+            ConfigError{ConfigErrorCode::Invalid, "cannot build a perfect hash for the devices"});
+    }
+    index.hash_ = std::move(*hash);
+
+    NameTable names(index.names_);
+    index.records_.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const DeviceMetadata& device = devices[i];
+        index.records_[index.hash_(keys[i])] =
+            Record{keys[i], names.intern(device.site), names.intern(device.tenant), device.gain,
+                   device.offset};
+    }
+    return index;
+}
+
+auto DeviceIndex::parse(std::string_view text) -> std::expected<DeviceIndex, ConfigError>
+{
+    std::vector<DeviceMetadata> devices;
+    std::size_t line_number = 0;
+    while (!text.empty())
+    {
+        const auto end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        ++line_number;
+
+        if (line.ends_with('\r'))
+        {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line.starts_with('#'))
+        {
+            continue;
+        }
+
+        std::vector<std::string_view> fields;
+        while (true)
+        {
+            const auto comma = line.find(',');
+            fields.push_back(line.substr(0, comma));
+            if (comma == std::string_view::npos)
+            {
+                break;
+            }
+            line.remove_prefix(comma + 1);
+        }
+        if (fields.size() < 3 || fields.size() > 5 || fields[0].empty())
+        {
+            return syntax_error(line_number, "expected device_id,site,tenant[,gain[,offset]]");
+        }
+
+        DeviceMetadata device{std::string(fields[0]), std::string(fields[1]),
+                              std::string(fields[2])};
+        if (fields.size() > 3 && !parse_float(fields[3], device.gain))
+        {
+            return syntax_error(line_number, "bad gain");
+        }
+        if (fields.size() > 4 && !parse_float(fields[4], device.offset))
+        {
+            return syntax_error(line_number, "bad offset");
+        }
+        devices.push_back(std::move(device));
+    }
+    return build(devices);
+}
+
+auto DeviceIndex::load(const std::string& path) -> std::expected<DeviceIndex, ConfigError>
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return std::unexpected(ConfigError{ConfigErrorCode::Io, "cannot open " + path});
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return parse(contents.str());
+}
+
+auto DeviceIndex::find(std::string_view device_id) const -> std::optional<DeviceInfo>
+{
+    if (records_.empty())
+    {
+        return std::nullopt;
+    }
+    const uint64_t key = device_key(device_id);
+    // Una clave ajena también cae en algún hueco: la clave guardada lo descarta
+    const Record& record = records_[hash_(key)];
+    if (record.key != key)
+    {
+        return std::nullopt;
+    }
+    return DeviceInfo{names_[record.site], names_[record.tenant], record.gain, record.offset};
+}
+
+auto DeviceIndex::enrich(std::string_view device_id, Json& object) const -> bool
+{
+    const auto info = find(device_id);
+    if (!info)
+    {
+        return false;
+    }
+    object["device"] = Json{{"site", info->site},
+                            {"tenant", info->tenant},
+                            {"calibration",
+                             {{"gain", static_cast<double>(info->gain)},
+                              {"offset", static_cast<double>(info->offset)}}}};
+    return true;
+}
+
+auto DeviceIndex::memory_bytes() const -> std::size_t
+{
+    std::size_t bytes = hash_.memory_bytes() + records_.capacity() * sizeof(Record);
+    for (const std::string& name : names_)
+    {
+        bytes += sizeof(std::string) + name.capacity();
+    }
+    return bytes;
+}
+
+auto DeviceEnricher::open(const std::string& path, std::chrono::milliseconds check_interval)
+    -> std::expected<std::unique_ptr<DeviceEnricher>, ConfigError>
+{
+    std::error_code error;
+    const auto modified = std::filesystem::last_write_time(path, error);
+    auto index = DeviceIndex::load(path);
+    if (!index)
+    {
+        return std::unexpected(index.error());
+    }
+    return std::unique_ptr<DeviceEnricher>(
+        new DeviceEnricher(path, check_interval, std::move(*index), modified));
+}
+
+DeviceEnricher::DeviceEnricher(std::string path, std::chrono::milliseconds check_interval,
+                               DeviceIndex index, std::filesystem::file_time_type modified)
+    : path_(std::move(path)),
+      check_interval_(check_interval),
+      index_(std::make_shared<const DeviceIndex>(std::move(index))),
+      modified_(modified)
+{
+    stats_.devices = this->index()->size();
+    thread_ = std::thread([this] { watch(); });
+}
+
+DeviceEnricher::~DeviceEnricher()
+{
+    {
+        const std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void DeviceEnricher::reload()
+{
+    {
+        const std::lock_guard lock(mutex_);
+        modified_ = {};
+    }
+    check();
+}
+
+auto DeviceEnricher::stats() const -> EnricherStats
+{
+    const std::lock_guard lock(mutex_);
+    return stats_;
+}
+
+void DeviceEnricher::watch()
+{
+    std::unique_lock lock(mutex_);
+    while (!wake_.wait_for(lock, check_interval_, [this] { return stopping_; }))
+    {
+        lock.unlock();
+        check();
+        lock.lock();
+    }
+}
+
+void DeviceEnricher::check()
+{
+    std::error_code error;
+    const auto modified = std::filesystem::last_write_time(path_, error);
+    {
+        const std::lock_guard lock(mutex_);
+        // Un fichero a medio reemplazar puede no existir un instante: se espera al siguiente
+        if (error || modified == modified_)
+        {
+            return;
+        }
+    }
+
+    // La construcción ocurre fuera del lock y del camino de las búsquedas
+    auto index = DeviceIndex::load(path_);
+
+    const std::lock_guard lock(mutex_);
+    // Un fichero roto no se reintenta hasta que vuelva a cambiar
+    modified_ = modified;
+    if (!index)
+    {
+        ++stats_.failed_reloads;
+        stats_.last_error = index.error().message;
+        return;
+    }
+    stats_.devices = index->size();
+    index_.store(std::make_shared<const DeviceIndex>(std::move(*index)), std::memory_order_release);
+    ++stats_.reloads;
+    stats_.last_error.clear();
+}
+
+}  // namespace cayene::ingest
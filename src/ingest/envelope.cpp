@@ -0,0 +1,362 @@
+/**
+ * @file envelope.cpp
+ * @brief Webhook envelope scanning and base64 decoding
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/envelope.hpp"
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <system_error>
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+constexpr uint8_t base64_invalid = 0xFF;
+
+constexpr auto make_base64_table() -> std::array<uint8_t, 256>
+{
+    std::array<uint8_t, 256> table{};
+    table.fill(base64_invalid);
+    constexpr std::string_view alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (std::size_t i = 0; i < alphabet.size(); ++i)
+    {
+        table[static_cast<unsigned char>(alphabet[i])] = static_cast<uint8_t>(i);
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> base64_table = make_base64_table();
+
+auto is_space(char c) -> bool
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+auto skip_space(std::string_view text, std::size_t pos) -> std::size_t
+{
+    while (pos < text.size() && is_space(text[pos]))
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+// Fin de la cadena que empieza en text[pos] == '"', pasadas las comillas
+auto skip_string(std::string_view text, std::size_t pos) -> std::optional<std::size_t>
+{
+    for (++pos; pos < text.size(); ++pos)
+    {
+        if (text[pos] == '\\')
+        {
+            ++pos;
+        }
+        else if (text[pos] == '"')
+        {
+            return pos + 1;
+        }
+    }
+    return std::nullopt;
+}
+
+// Fin del valor JSON que empieza en text[pos], sin validarlo por completo
+auto skip_value(std::string_view text, std::size_t pos) -> std::optional<std::size_t>
+{
+    if (pos >= text.size())
+    {
+        return std::nullopt;
+    }
+    if (text[pos] == '"')
+    {
+        return skip_string(text, pos);
+    }
+    if (text[pos] == '{' || text[pos] == '[')
+    {
+        std::size_t depth = 0;
+        while (pos < text.size())
+        {
+            const char c = text[pos];
+            if (c == '"')
+            {
+                const auto end = skip_string(text, pos);
+                if (!end)
+                {
+                    return std::nullopt;
+                }
+                pos = *end;
+                continue;
+            }
+            if (c == '{' || c == '[')
+            {
+                ++depth;
+            }
+            else if ((c == '}' || c == ']') && --depth == 0)
+            {
+                return pos + 1;
+            }
+            ++pos;
+        }
+        return std::nullopt;
+    }
+
+    // Número, true, false o null
+    const std::size_t start = pos;
+    while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ']' &&
+           !is_space(text[pos]))
+    {
+        ++pos;
+    }
+    return pos == start ? std::nullopt : std::optional(pos);
+}
+
+/**
+ * Raw text of member @p key of the object @p object, std::nullopt if the
+ * object is malformed and an empty view if the key is absent.
+ */
+auto find_member(std::string_view object, std::string_view key)
+    -> std::optional<std::string_view>
+{
+    std::size_t pos = skip_space(object, 0);
+    if (pos >= object.size() || object[pos] != '{')
+    {
+        return std::nullopt;
+    }
+    pos = skip_space(object, pos + 1);
+    if (pos < object.size() && object[pos] == '}')
+    {
+        return std::string_view{};
+    }
+
+    while (pos < object.size())
+    {
+        if (object[pos] != '"')
+        {
+            return std::nullopt;
+        }
+        const auto key_end = skip_string(object, pos);
+        if (!key_end)
+        {
+            return std::nullopt;
+        }
+        const std::string_view name = object.substr(pos + 1, *key_end - pos - 2);
+
+        pos = skip_space(object, *key_end);
+        if (pos >= object.size() || object[pos] != ':')
+        {
+            return std::nullopt;
+        }
+        pos = skip_space(object, pos + 1);
+        const auto value_end = skip_value(object, pos);
+        if (!value_end)
+        {
+            return std::nullopt;
+        }
+        if (name == key)
+        {
+            return object.substr(pos, *value_end - pos);
+        }
+
+        pos = skip_space(object, *value_end);
+        if (pos < object.size() && object[pos] == '}')
+        {
+            return std::string_view{};
+        }
+        if (pos >= object.size() || object[pos] != ',')
+        {
+            return std::nullopt;
+        }
+        pos = skip_space(object, pos + 1);
+    }
+    return std::nullopt;
+}
+
+// Contenido de una cadena JSON, sin resolver escapes
+auto string_contents(std::string_view value) -> std::optional<std::string_view>
+{
+    if (value.size() < 2 || value.front() != '"' || value.back() != '"')
+    {
+        return std::nullopt;
+    }
+    return value.substr(1, value.size() - 2);
+}
+
+auto port_number(std::string_view value) -> std::optional<uint8_t>
+{
+    unsigned port = 0;
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), port);
+    if (error != std::errc{} || end != value.data() + value.size() || port > 255)
+    {
+        return std::nullopt;
+    }
+    return static_cast<uint8_t>(port);
+}
+
+struct Fields
+{
+    std::optional<std::string_view> device;
+    std::optional<std::string_view> fport;
+    std::optional<std::string_view> payload;
+};
+
+auto locate_fields(std::string_view body, EnvelopeFormat& format)
+    -> std::expected<Fields, EnvelopeError>
+{
+    const auto malformed = std::unexpected(EnvelopeError::Malformed);
+
+    const auto uplink_message = find_member(body, "uplink_message");
+    if (!uplink_message)
+    {
+        return malformed;
+    }
+    if (!uplink_message->empty())
+    {
+        format = EnvelopeFormat::TheThingsStack;
+        const auto ids = find_member(body, "end_device_ids");
+        const auto device = ids && !ids->empty() ? find_member(*ids, "device_id") : ids;
+        const auto fport = find_member(*uplink_message, "f_port");
+        const auto payload = find_member(*uplink_message, "frm_payload");
+        if (!device || !fport || !payload)
+        {
+            return malformed;
+        }
+        return Fields{*device, *fport, *payload};
+    }
+
+    const auto data = find_member(body, "data");
+    const auto device_info = find_member(body, "deviceInfo");
+    if (!data || !device_info)
+    {
+        return malformed;
+    }
+    if (device_info->empty())
+    {
+        return std::unexpected(EnvelopeError::UnknownFormat);
+    }
+    format = EnvelopeFormat::ChirpStack;
+    const auto device = find_member(*device_info, "devEui");
+    const auto fport = find_member(body, "fPort");
+    if (!device || !fport)
+    {
+        return malformed;
+    }
+    return Fields{*device, *fport, *data};
+}
+
+}  // namespace
+
+auto base64_decode(std::string_view text, std::span<uint8_t> out)
+    -> std::expected<std::size_t, EnvelopeError>
+{
+    std::size_t written = 0;
+    uint32_t accumulator = 0;
+    std::size_t bits = 0;
+    std::size_t padding = 0;
+
+    for (const char c : text)
+    {
+        // Algunos serializadores escapan '/' como "\/"
+        if (c == '\\')
+        {
+            continue;
+        }
+        if (c == '=')
+        {
+            ++padding;
+            continue;
+        }
+        const uint8_t sextet = base64_table[static_cast<unsigned char>(c)];
+        if (sextet == base64_invalid || padding != 0)
+        {
+            return std::unexpected(EnvelopeError::BadBase64);
+        }
+
+        accumulator = accumulator << 6U | sextet;
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            if (written == out.size())
+            {
+                return std::unexpected(EnvelopeError::PayloadTooLarge);
+            }
+            out[written++] = static_cast<uint8_t>(accumulator >> bits);
+        }
+    }
+
+    // Los bits sobrantes deben ser relleno a cero, y como mucho dos '='
+    if (padding > 2 || bits >= 6 || (accumulator & ((1U << bits) - 1)) != 0)
+    {
+        return std::unexpected(EnvelopeError::BadBase64);
+    }
+    return written;
+}
+
+auto parse_envelope(std::string_view body, std::span<uint8_t> payload_storage)
+    -> std::expected<Uplink, EnvelopeError>
+{
+    Uplink uplink;
+    const auto fields = locate_fields(body, uplink.format);
+    if (!fields)
+    {
+        return std::unexpected(fields.error());
+    }
+
+    const auto device = string_contents(*fields->device);
+    if (!device)
+    {
+        return std::unexpected(EnvelopeError::Malformed);
+    }
+    uplink.device_id = *device;
+
+    // Sin fPort o sin datos: tramas solo MAC
+    if (fields->fport->empty() || fields->payload->empty())
+    {
+        return std::unexpected(EnvelopeError::MissingPayload);
+    }
+    const auto fport = port_number(*fields->fport);
+    const auto payload = string_contents(*fields->payload);
+    if (!fport || !payload)
+    {
+        return std::unexpected(EnvelopeError::Malformed);
+    }
+    uplink.fport = *fport;
+
+    const auto size = base64_decode(*payload, payload_storage);
+    if (!size)
+    {
+        return std::unexpected(size.error());
+    }
+    uplink.payload = payload_storage.first(*size);
+    return uplink;
+}
+
+auto envelope_error_name(EnvelopeError error) -> std::string_view
+{
+    switch (error)
+    {
+        case EnvelopeError::Malformed:
+            return "Malformed";
+        case EnvelopeError::UnknownFormat:
+            return "UnknownFormat";
+        case EnvelopeError::MissingPayload:
+            return "MissingPayload";
+        case EnvelopeError::BadBase64:
+            return "BadBase64";
+        case EnvelopeError::PayloadTooLarge:
+            return "PayloadTooLarge";
+    }
+    return "Unknown";
+}
+
+}  // namespace cayene::ingest
@@ -0,0 +1,381 @@
+/**
+ * @file geofence.cpp
+ * @brief Implementation of the geofence grid index and tracker
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/geofence.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <unordered_set>
+#include <utility>
+
+#include "cayene/ingest/perfect_hash.hpp"
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+// Celdas por geocerca: pocas candidatas por celda sin que la rejilla crezca sin límite
+constexpr std::size_t cells_per_fence = 4;
+constexpr std::size_t max_cells = std::size_t{1} << 20U;
+constexpr double raw_per_degree = 10000.0;
+
+auto invalid(std::string message) -> std::unexpected<ConfigError>
+{
+    return std::unexpected(ConfigError{ConfigErrorCode::Invalid, std::move(message)});
+}
+
+// Grados del fichero a unidades crudas de LPP; nullopt fuera de rango
+auto parse_coordinate(const Json& value, double limit) -> std::optional<int32_t>
+{
+    if (!value.is_number())
+    {
+        return std::nullopt;
+    }
+    const double degrees = value.get<double>();
+    if (!(degrees >= -limit && degrees <= limit))
+    {
+        return std::nullopt;
+    }
+    return static_cast<int32_t>(std::lround(degrees * raw_per_degree));
+}
+
+}  // namespace
+
+auto GeofenceIndex::build(std::vector<Geofence> fences)
+    -> std::expected<GeofenceIndex, ConfigError>
+{
+    GeofenceIndex index;
+    std::unordered_set<std::string_view> names;
+    for (const Geofence& fence : fences)
+    {
+        if (fence.polygon.size() < 3)
+        {
+            return invalid(
+                std::format("fence '{}': polygon needs at least 3 vertices", fence.name));
+        }
+        if (!names.insert(fence.name).second)
+        {
+            return invalid(std::format("duplicate fence '{}'", fence.name));
+        }
+    }
+    index.fences_ = std::move(fences);
+    if (index.fences_.empty())
+    {
+        return index;
+    }
+
+    index.bounds_ = {{INT32_MAX, INT32_MAX}, {INT32_MIN, INT32_MIN}};
+    for (const Geofence& fence : index.fences_)
+    {
+        Box box{{INT32_MAX, INT32_MAX}, {INT32_MIN, INT32_MIN}};
+        for (const GeoPoint& vertex : fence.polygon)
+        {
+            box.min.lat = std::min(box.min.lat, vertex.lat);
+            box.min.lon = std::min(box.min.lon, vertex.lon);
+            box.max.lat = std::max(box.max.lat, vertex.lat);
+            box.max.lon = std::max(box.max.lon, vertex.lon);
+        }
+        index.boxes_.push_back(box);
+        index.bounds_.min.lat = std::min(index.bounds_.min.lat, box.min.lat);
+        index.bounds_.min.lon = std::min(index.bounds_.min.lon, box.min.lon);
+        index.bounds_.max.lat = std::max(index.bounds_.max.lat, box.max.lat);
+        index.bounds_.max.lon = std::max(index.bounds_.max.lon, box.max.lon);
+    }
+
+    // Celdas cuadradas en unidades crudas, unas cells_per_fence por geocerca
+    const int64_t width = int64_t{index.bounds_.max.lon} - index.bounds_.min.lon + 1;
+    const int64_t height = int64_t{index.bounds_.max.lat} - index.bounds_.min.lat + 1;
+    const auto target =
+        static_cast<double>(std::min(index.fences_.size() * cells_per_fence, max_cells));
+    index.cell_size_ = std::max<int64_t>(
+        1, static_cast<int64_t>(std::ceil(std::sqrt(static_cast<double>(width) *
+                                                    static_cast<double>(height) / target))));
+    index.columns_ = static_cast<std::size_t>((width + index.cell_size_ - 1) / index.cell_size_);
+    index.rows_ = static_cast<std::size_t>((height + index.cell_size_ - 1) / index.cell_size_);
+
+    // Listas por celda en formato CSR: recuento, suma de prefijos y reparto
+    const auto cell_of = [&index](int32_t coordinate, int32_t origin)
+    { return static_cast<std::size_t>((int64_t{coordinate} - origin) / index.cell_size_); };
+    const auto cell_range = [&](const Box& box)
+    {
+        return std::array<std::size_t, 4>{cell_of(box.min.lat, index.bounds_.min.lat),
+                                          cell_of(box.max.lat, index.bounds_.min.lat),
+                                          cell_of(box.min.lon, index.bounds_.min.lon),
+                                          cell_of(box.max.lon, index.bounds_.min.lon)};
+    };
+    index.cell_start_.assign(index.columns_ * index.rows_ + 1, 0);
+    for (const Box& box : index.boxes_)
+    {
+        const auto [first_row, last_row, first_column, last_column] = cell_range(box);
+        for (std::size_t row = first_row; row <= last_row; ++row)
+        {
+            for (std::size_t column = first_column; column <= last_column; ++column)
+            {
+                ++index.cell_start_[row * index.columns_ + column + 1];
+            }
+        }
+    }
+    std::partial_sum(index.cell_start_.begin(), index.cell_start_.end(),
+                     index.cell_start_.begin());
+    index.cell_fences_.resize(index.cell_start_.back());
+    std::vector<uint32_t> fill(index.cell_start_.begin(), index.cell_start_.end() - 1);
+    for (uint32_t fence = 0; fence < index.boxes_.size(); ++fence)
+    {
+        const auto [first_row, last_row, first_column, last_column] =
+            cell_range(index.boxes_[fence]);
+        for (std::size_t row = first_row; row <= last_row; ++row)
+        {
+            for (std::size_t column = first_column; column <= last_column; ++column)
+            {
+                index.cell_fences_[fill[row * index.columns_ + column]++] = fence;
+            }
+        }
+    }
+    return index;
+}
+
+auto GeofenceIndex::parse(std::string_view text) -> std::expected<GeofenceIndex, ConfigError>
+{
+    const Json root = Json::parse(text, nullptr, false);
+    if (root.is_discarded())
+    {
+        return std::unexpected(ConfigError{ConfigErrorCode::Syntax, "not valid JSON"});
+    }
+    if (!root.is_object())
+    {
+        return invalid("root must be an object");
+    }
+    const auto entries = root.find("fences");
+    if (entries == root.end() || !entries->is_array())
+    {
+        return invalid("fences must be an array");
+    }
+
+    std::vector<Geofence> fences;
+    fences.reserve(entries->size());
+    for (std::size_t i = 0; i < entries->size(); ++i)
+    {
+        const Json& entry = (*entries)[i];
+        const std::string where = std::format("fences[{}]", i);
+        if (!entry.is_object())
+        {
+            return invalid(where + ": must be an object");
+        }
+        const auto name = entry.find("name");
+        if (name == entry.end() || !name->is_string() ||
+            name->get_ref<const std::string&>().empty())
+        {
+            return invalid(where + ": fence needs a non-empty name");
+        }
+        const auto polygon = entry.find("polygon");
+        if (polygon == entry.end() || !polygon->is_array())
+        {
+            return invalid(where + ": fence needs a polygon");
+        }
+
+        Geofence fence{name->get<std::string>(), {}};
+        for (std::size_t v = 0; v < polygon->size(); ++v)
+        {
+            const Json& vertex = (*polygon)[v];
+            const auto lat = vertex.is_array() && vertex.size() == 2
+                                 ? parse_coordinate(vertex[0], 90.0)
+                                 : std::nullopt;
+            const auto lon = lat ? parse_coordinate(vertex[1], 180.0) : std::nullopt;
+            if (!lon)
+            {
+                return invalid(std::format("{}.polygon[{}]: expected [lat, lon] in degrees", where,
+                                           v));
+            }
+            fence.polygon.push_back({*lat, *lon});
+        }
+        fences.push_back(std::move(fence));
+    }
+    return build(std::move(fences));
+}
+
+auto GeofenceIndex::load(const std::string& path) -> std::expected<GeofenceIndex, ConfigError>
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return std::unexpected(ConfigError{ConfigErrorCode::Io, "cannot open " + path});
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return parse(contents.str());
+}
+
+void GeofenceIndex::containing(GeoPoint point, std::vector<uint32_t>& fences) const
+{
+    fences.clear();
+    if (fences_.empty() || point.lat < bounds_.min.lat || point.lat > bounds_.max.lat ||
+        point.lon < bounds_.min.lon || point.lon > bounds_.max.lon)
+    {
+        return;
+    }
+    const auto row = static_cast<std::size_t>((int64_t{point.lat} - bounds_.min.lat) / cell_size_);
+    const auto column =
+        static_cast<std::size_t>((int64_t{point.lon} - bounds_.min.lon) / cell_size_);
+    const std::size_t cell = row * columns_ + column;
+
+    // Las geocercas de cada celda están en orden de id: el resultado sale ordenado
+    for (uint32_t i = cell_start_[cell]; i < cell_start_[cell + 1]; ++i)
+    {
+        const uint32_t fence = cell_fences_[i];
+        const Box& box = boxes_[fence];
+        if (point.lat >= box.min.lat && point.lat <= box.max.lat && point.lon >= box.min.lon &&
+            point.lon <= box.max.lon && inside(fence, point))
+        {
+            fences.push_back(fence);
+        }
+    }
+}
+
+// Regla par-impar con el cruce comparado por productos cruzados: sin divisiones ni
+// redondeo, las diferencias crudas caben de sobra en 64 bits
+auto GeofenceIndex::inside(uint32_t fence, GeoPoint point) const -> bool
+{
+    const std::vector<GeoPoint>& polygon = fences_[fence].polygon;
+    bool inside = false;
+    for (std::size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+    {
+        const GeoPoint& a = polygon[i];
+        const GeoPoint& b = polygon[j];
+        if ((a.lat > point.lat) == (b.lat > point.lat))
+        {
+            continue;
+        }
+        // El punto está a la izquierda del cruce del lado a-b con su latitud
+        const int64_t lhs = (int64_t{point.lon} - a.lon) * (int64_t{b.lat} - a.lat);
+        const int64_t rhs = (int64_t{point.lat} - a.lat) * (int64_t{b.lon} - a.lon);
+        if (b.lat > a.lat ? lhs < rhs : lhs > rhs)
+        {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+GeofenceTracker::GeofenceTracker(std::shared_ptr<const GeofenceIndex> index)
+    : index_(std::move(index))
+{
+}
+
+auto GeofenceTracker::update(std::string_view device_id, GeoPoint point,
+                             std::vector<GeofenceEvent>& events) -> std::size_t
+{
+    // Búfer por hilo: el camino habitual no reserva memoria
+    thread_local std::vector<uint32_t> current;
+    index_->containing(point, current);
+
+    const uint64_t key = device_key(device_id);
+    Shard& shard = shards_[(key ^ key >> 32U) % shard_count];
+    const std::lock_guard lock(shard.mutex);
+
+    auto entry = shard.inside.find(key);
+    if (entry == shard.inside.end())
+    {
+        if (current.empty())
+        {
+            return 0;
+        }
+        entry = shard.inside.emplace(key, std::vector<uint32_t>{}).first;
+    }
+    const std::vector<uint32_t>& previous = entry->second;
+
+    const std::size_t before = events.size();
+    for (const uint32_t fence : previous)
+    {
+        if (!std::ranges::binary_search(current, fence))
+        {
+            events.push_back({fence, GeofenceTransition::Exit});
+        }
+    }
+    for (const uint32_t fence : current)
+    {
+        if (!std::ranges::binary_search(previous, fence))
+        {
+            events.push_back({fence, GeofenceTransition::Enter});
+        }
+    }
+
+    // Solo se guardan los dispositivos dentro de alguna geocerca
+    if (current.empty())
+    {
+        shard.inside.erase(entry);
+    }
+    else
+    {
+        entry->second.assign(current.begin(), current.end());
+    }
+    return events.size() - before;
+}
+
+auto GeofenceTracker::update(std::string_view device_id, std::span<const Reading> readings,
+                             std::vector<GeofenceEvent>& events) -> std::size_t
+{
+    std::size_t count = 0;
+    for (const Reading& reading : readings)
+    {
+        if (reading.type_id == gps_type_id)
+        {
+            count += update(device_id, GeoPoint{reading.raw[0], reading.raw[1]}, events);
+        }
+    }
+    return count;
+}
+
+auto GeofenceTracker::annotate(const TypeCatalog& catalog, const Uplink& uplink, Json& object)
+    -> std::size_t
+{
+    std::array<Reading, max_payload_readings> readings{};
+    const auto count = catalog.decode_readings(uplink.fport, uplink.payload, readings);
+    if (!count)
+    {
+        return 0;
+    }
+    return annotate(uplink, std::span(readings).first(*count), object);
+}
+
+auto GeofenceTracker::annotate(const Uplink& uplink, std::span<const Reading> readings,
+                               Json& object) -> std::size_t
+{
+    thread_local std::vector<GeofenceEvent> events;
+    events.clear();
+    if (update(uplink.device_id, readings, events) == 0)
+    {
+        return 0;
+    }
+    Json& list = object["geofence"];
+    for (const GeofenceEvent& event : events)
+    {
+        const bool enter = event.transition == GeofenceTransition::Enter;
+        list.push_back({{"fence", index_->name(event.fence)}, {"event", enter ? "enter" : "exit"}});
+    }
+    return events.size();
+}
+
+auto GeofenceTracker::devices() const -> std::size_t
+{
+    std::size_t count = 0;
+    for (const Shard& shard : shards_)
+    {
+        const std::lock_guard lock(shard.mutex);
+        count += shard.inside.size();
+    }
+    return count;
+}
+
+}  // namespace cayene::ingest
@@ -0,0 +1,199 @@
+/**
+ * @file http.cpp
+ * @brief Implementation of the zero-copy HTTP/1.1 request parser
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/http.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+// Cabeceras de más de esto sin terminar no son un webhook
+constexpr std::size_t max_header_bytes = 8192;
+
+auto lower(char c) -> char
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+auto iequals(std::string_view a, std::string_view b) -> bool
+{
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(),
+                      [](char x, char y) { return lower(x) == lower(y); });
+}
+
+auto trim(std::string_view text) -> std::string_view
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+    {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t'))
+    {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+auto parse_request_line(std::string_view line, HttpRequest& request) -> bool
+{
+    const auto first_space = line.find(' ');
+    const auto last_space = line.rfind(' ');
+    if (first_space == std::string_view::npos || first_space == last_space)
+    {
+        return false;
+    }
+    request.method = line.substr(0, first_space);
+    request.target = line.substr(first_space + 1, last_space - first_space - 1);
+
+    const std::string_view version = line.substr(last_space + 1);
+    if (version == "HTTP/1.1")
+    {
+        request.version_minor = 1;
+    }
+    else if (version == "HTTP/1.0")
+    {
+        request.version_minor = 0;
+    }
+    else
+    {
+        return false;
+    }
+    return !request.method.empty() && !request.target.empty();
+}
+
+}  // namespace
+
+auto HttpRequest::header(std::string_view name) const -> std::string_view
+{
+    for (std::size_t i = 0; i < header_count; ++i)
+    {
+        if (iequals(headers[i].name, name))
+        {
+            return headers[i].value;
+        }
+    }
+    return {};
+}
+
+auto parse_request(std::string_view buffer, HttpRequest& request, std::size_t max_body)
+    -> std::expected<std::size_t, HttpError>
+{
+    const auto header_end = buffer.find("\r\n\r\n");
+    if (header_end == std::string_view::npos)
+    {
+        if (buffer.size() > max_header_bytes)
+        {
+            return std::unexpected(HttpError::TooLarge);
+        }
+        return 0;
+    }
+    // El límite vale también si toda la cabecera llega de una vez
+    if (header_end > max_header_bytes)
+    {
+        return std::unexpected(HttpError::TooLarge);
+    }
+
+    std::string_view head = buffer.substr(0, header_end);
+    const auto line_end = head.find("\r\n");
+    if (!parse_request_line(head.substr(0, line_end), request))
+    {
+        return std::unexpected(HttpError::Malformed);
+    }
+
+    request.header_count = 0;
+    head = line_end == std::string_view::npos ? std::string_view{} : head.substr(line_end + 2);
+    while (!head.empty())
+    {
+        const auto end = head.find("\r\n");
+        const std::string_view line = head.substr(0, end);
+        head = end == std::string_view::npos ? std::string_view{} : head.substr(end + 2);
+
+        const auto colon = line.find(':');
+        if (colon == std::string_view::npos || colon == 0)
+        {
+            return std::unexpected(HttpError::Malformed);
+        }
+        if (request.header_count == max_http_headers)
+        {
+            return std::unexpected(HttpError::TooLarge);
+        }
+        request.headers[request.header_count++] = {line.substr(0, colon),
+                                                   trim(line.substr(colon + 1))};
+    }
+
+    const std::string_view encoding = request.header("Transfer-Encoding");
+    if (!encoding.empty() && !iequals(encoding, "identity"))
+    {
+        return std::unexpected(HttpError::NotImplemented);
+    }
+
+    // Varios Content-Length distintos no dejan claro dónde acaba el cuerpo: un proxy
+    // delante podría leer otro límite (request smuggling, RFC 9112 §6.3)
+    const std::string_view length = request.header("Content-Length");
+    for (std::size_t i = 0; i < request.header_count; ++i)
+    {
+        if (iequals(request.headers[i].name, "Content-Length") &&
+            request.headers[i].value != length)
+        {
+            return std::unexpected(HttpError::Malformed);
+        }
+    }
+
+    std::size_t body_size = 0;
+    if (!length.empty())
+    {
+        const auto [end, error] = std::from_chars(length.data(), length.data() + length.size(),
+                                                  body_size);
+        if (error != std::errc{} || end != length.data() + length.size())
+        {
+            return std::unexpected(HttpError::Malformed);
+        }
+        if (body_size > max_body)
+        {
+            return std::unexpected(HttpError::TooLarge);
+        }
+    }
+
+    const std::size_t body_start = header_end + 4;
+    if (buffer.size() - body_start < body_size)
+    {
+        return 0;
+    }
+    request.body = buffer.substr(body_start, body_size);
+
+    // HTTP/1.1 mantiene la conexión salvo "close"; HTTP/1.0 solo con "keep-alive"
+    const std::string_view connection = request.header("Connection");
+    request.keep_alive = request.version_minor == 1 ? !iequals(connection, "close")
+                                                    : iequals(connection, "keep-alive");
+    return body_start + body_size;
+}
+
+auto http_status(HttpError error) -> std::string_view
+{
+    switch (error)
+    {
+        case HttpError::Malformed:
+            return "400 Bad Request";
+        case HttpError::TooLarge:
+            return "413 Content Too Large";
+        case HttpError::NotImplemented:
+            return "501 Not Implemented";
+    }
+    return "500 Internal Server Error";
+}
+
+}  // namespace cayene::ingest
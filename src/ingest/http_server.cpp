@@ -0,0 +1,548 @@
+/**
+ * @file http_server.cpp
+ * @brief epoll worker loops of the webhook ingest server
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/http_server.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "cayene/ingest/http.hpp"
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+constexpr int max_events = 64;
+constexpr int listen_backlog = 1024;
+constexpr std::size_t initial_buffer_size = 16 * 1024;
+// Cabeceras además del cuerpo máximo
+constexpr std::size_t header_allowance = 16 * 1024;
+
+auto last_error() -> std::error_code
+{
+    return {errno, std::system_category()};
+}
+
+void append_response(std::string& out, std::string_view status, std::string_view body,
+                     bool keep_alive)
+{
+    std::format_to(std::back_inserter(out), "HTTP/1.1 {}\r\n{}", status,
+                   keep_alive ? "" : "Connection: close\r\n");
+    if (status.starts_with("204"))
+    {
+        out += "\r\n";
+        return;
+    }
+    std::format_to(std::back_inserter(out),
+                   "Content-Type: text/plain\r\nContent-Length: {}\r\n\r\n{}", body.size(), body);
+}
+
+// Target sin la query string
+auto target_path(std::string_view target) -> std::string_view
+{
+    return target.substr(0, target.find('?'));
+}
+
+}  // namespace
+
+class HttpServer::Worker
+{
+public:
+    explicit Worker(const HttpServer& server) : server_(server) {}
+
+    ~Worker()
+    {
+        for (auto& [fd, connection] : connections_)
+        {
+            ::close(fd);
+        }
+        for (const int fd : {listen_fd_, wake_fd_, epoll_fd_})
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+    }
+
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+    Worker(Worker&&) = delete;
+    Worker& operator=(Worker&&) = delete;
+
+    auto open(sockaddr_in address) -> std::expected<uint16_t, std::error_code>
+    {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (listen_fd_ < 0 || epoll_fd_ < 0 || wake_fd_ < 0)
+        {
+            return std::unexpected(last_error());
+        }
+
+        // Cada worker tiene su socket en el mismo puerto; el kernel reparte las conexiones
+        int enable = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        auto* generic_address = reinterpret_cast<sockaddr*>(&address);
+        socklen_t address_size = sizeof(address);
+        if (::bind(listen_fd_, generic_address, address_size) < 0 ||
+            ::listen(listen_fd_, listen_backlog) < 0 ||
+            ::getsockname(listen_fd_, generic_address, &address_size) < 0)
+        {
+            return std::unexpected(last_error());
+        }
+
+        epoll_event listener{.events = EPOLLIN | EPOLLET, .data = {.ptr = nullptr}};
+        epoll_event wake{.events = EPOLLIN, .data = {.ptr = &wake_fd_}};
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &listener) < 0 ||
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake) < 0)
+        {
+            return std::unexpected(last_error());
+        }
+        return ntohs(address.sin_port);
+    }
+
+    void run()
+    {
+        std::array<epoll_event, max_events> events{};
+        while (true)
+        {
+            const int ready = ::epoll_wait(epoll_fd_, events.data(), max_events, -1);
+            for (int i = 0; i < ready; ++i)
+            {
+                const epoll_event& event = events[static_cast<std::size_t>(i)];
+                if (event.data.ptr == &wake_fd_)
+                {
+                    return;
+                }
+                if (event.data.ptr == nullptr)
+                {
+                    accept_all();
+                    continue;
+                }
+
+                auto* connection = static_cast<Connection*>(event.data.ptr);
+                if ((event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0U)
+                {
+                    on_readable(*connection);
+                }
+                else if ((event.events & EPOLLOUT) != 0U)
+                {
+                    // El cliente leyó respuestas: se retoma la lectura parada
+                    if (flush(*connection) && connection->paused &&
+                        !backlogged(*connection))
+                    {
+                        on_readable(*connection);
+                    }
+                }
+            }
+        }
+    }
+
+    void wake() const
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = ::write(wake_fd_, &one, sizeof(one));
+    }
+
+    void add_stats(HttpServerStats& stats) const
+    {
+        stats.connections += connections_total_.load(std::memory_order_relaxed);
+        stats.requests += requests_.load(std::memory_order_relaxed);
+        stats.uplinks += uplinks_.load(std::memory_order_relaxed);
+        stats.rejected += rejected_.load(std::memory_order_relaxed);
+        stats.bad_requests += bad_requests_.load(std::memory_order_relaxed);
+        stats.throttled += throttled_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Connection
+    {
+        int fd{-1};
+        // Peticiones recibidas; HttpRequest apunta aquí mientras se atienden
+        std::vector<char> input;
+        std::size_t input_size{0};
+        std::string output;
+        std::size_t output_sent{0};
+        // Payloads decodificados del base64, reutilizado en cada petición
+        std::vector<uint8_t> arena;
+        bool closing{false};
+        // Lectura parada por respuestas sin enviar; EPOLLOUT la reanuda
+        bool paused{false};
+    };
+
+    // Un cliente que encadena peticiones sin leer las respuestas no hace crecer output
+    [[nodiscard]] auto backlogged(const Connection& connection) const -> bool
+    {
+        return connection.output.size() - connection.output_sent >=
+               server_.config_.max_pending_output;
+    }
+
+    void accept_all()
+    {
+        while (true)
+        {
+            const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                return;
+            }
+            int enable = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+            auto connection = std::make_unique<Connection>();
+            connection->fd = fd;
+            connection->input.resize(initial_buffer_size);
+            connection->arena.resize(server_.config_.max_payload_size);
+
+            epoll_event event{.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+                              .data = {.ptr = connection.get()}};
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0)
+            {
+                ::close(fd);
+                continue;
+            }
+            connections_.emplace(fd, std::move(connection));
+            connections_total_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void on_readable(Connection& connection)
+    {
+        // Si la salida se vacía al momento no llegará EPOLLOUT ni un EPOLLIN nuevo para
+        // lo que ya espera en el socket: se sigue leyendo aquí
+        do
+        {
+            read_requests(connection);
+            if (!flush(connection))
+            {
+                return;
+            }
+        } while (connection.paused && !backlogged(connection));
+    }
+
+    void read_requests(Connection& connection)
+    {
+        const std::size_t limit = server_.config_.max_body_size + header_allowance;
+        bool peer_closed = false;
+
+        // Edge-triggered: leer hasta EAGAIN, atendiendo lo completo si el buffer se llena
+        while (!peer_closed && !connection.closing && !backlogged(connection))
+        {
+            if (connection.input_size == connection.input.size())
+            {
+                if (connection.input.size() < limit)
+                {
+                    connection.input.resize(std::min(connection.input.size() * 2, limit));
+                }
+                else if (!handle_requests(connection))
+                {
+                    // Lleno y sin ninguna petición completa
+                    append_response(connection.output, http_status(HttpError::TooLarge), {},
+                                    false);
+                    connection.closing = true;
+                    break;
+                }
+                continue;
+            }
+
+            const ssize_t received =
+                ::recv(connection.fd, connection.input.data() + connection.input_size,
+                       connection.input.size() - connection.input_size, 0);
+            if (received > 0)
+            {
+                connection.input_size += static_cast<std::size_t>(received);
+            }
+            else if (received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                break;
+            }
+            else
+            {
+                peer_closed = true;
+            }
+        }
+
+        handle_requests(connection);
+        connection.paused = !connection.closing && backlogged(connection);
+        // Con la lectura parada quedan peticiones por atender: el cierre se verá al reanudar
+        if (peer_closed && !connection.paused)
+        {
+            connection.closing = true;
+        }
+    }
+
+    // Atiende todas las peticiones completas del buffer; false si no había ninguna
+    auto handle_requests(Connection& connection) -> bool
+    {
+        const std::string_view buffer(connection.input.data(), connection.input_size);
+        std::size_t offset = 0;
+
+        while (!connection.closing && !backlogged(connection))
+        {
+            const auto consumed =
+                parse_request(buffer.substr(offset), request_, server_.config_.max_body_size);
+            if (!consumed)
+            {
+                bad_requests_.fetch_add(1, std::memory_order_relaxed);
+                append_response(connection.output, http_status(consumed.error()), {}, false);
+                connection.closing = true;
+                break;
+            }
+            if (*consumed == 0)
+            {
+                break;
+            }
+            offset += *consumed;
+            handle(connection, request_);
+            connection.closing = !request_.keep_alive;
+        }
+
+        // Lo que queda de una petición a medias pasa al principio del buffer
+        std::memmove(connection.input.data(), connection.input.data() + offset,
+                     connection.input_size - offset);
+        connection.input_size -= offset;
+        return offset != 0;
+    }
+
+    void handle(Connection& connection, const HttpRequest& request)
+    {
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        std::string& out = connection.output;
+
+        if (target_path(request.target) != server_.config_.path)
+        {
+            append_response(out, "404 Not Found", "not found\n", request.keep_alive);
+            return;
+        }
+        if (request.method != "POST")
+        {
+            append_response(out, "405 Method Not Allowed", "POST only\n", request.keep_alive);
+            return;
+        }
+
+        const auto uplink = parse_envelope(request.body, connection.arena);
+        if (!uplink)
+        {
+            // Las tramas sin payload de aplicación son normales, no un error del servidor de red
+            if (uplink.error() == EnvelopeError::MissingPayload)
+            {
+                append_response(out, "204 No Content", {}, request.keep_alive);
+                return;
+            }
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            append_response(out, "400 Bad Request", envelope_error_name(uplink.error()),
+                            request.keep_alive);
+            return;
+        }
+
+        if (server_.admission_ && !server_.admission_->admit(uplink->device_id))
+        {
+            throttled_.fetch_add(1, std::memory_order_relaxed);
+            append_response(out, "429 Too Many Requests", "rate limited\n", request.keep_alive);
+            return;
+        }
+
+        const auto decoded = server_.catalog_.decode(uplink->fport, uplink->payload);
+        if (!decoded)
+        {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            append_response(out, "400 Bad Request", error_name(decoded.error()),
+                            request.keep_alive);
+            return;
+        }
+
+        uplinks_.fetch_add(1, std::memory_order_relaxed);
+        if (server_.handler_)
+        {
+            server_.handler_(*uplink, *decoded);
+        }
+        append_response(out, "204 No Content", {}, request.keep_alive);
+    }
+
+    // false si la conexión se cerró
+    auto flush(Connection& connection) -> bool
+    {
+        while (connection.output_sent < connection.output.size())
+        {
+            const ssize_t sent =
+                ::send(connection.fd, connection.output.data() + connection.output_sent,
+                       connection.output.size() - connection.output_sent, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                // EPOLLOUT avisará cuando se pueda seguir
+                return true;
+            }
+            if (sent < 0)
+            {
+                close(connection);
+                return false;
+            }
+            connection.output_sent += static_cast<std::size_t>(sent);
+        }
+
+        connection.output.clear();
+        connection.output_sent = 0;
+        if (connection.closing)
+        {
+            close(connection);
+            return false;
+        }
+        return true;
+    }
+
+    void close(Connection& connection)
+    {
+        const int fd = connection.fd;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections_.erase(fd);
+    }
+
+    const HttpServer& server_;
+    int listen_fd_{-1};
+    int epoll_fd_{-1};
+    int wake_fd_{-1};
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    HttpRequest request_;
+
+    std::atomic<uint64_t> connections_total_{0};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> uplinks_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> bad_requests_{0};
+    std::atomic<uint64_t> throttled_{0};
+};
+
+HttpServer::HttpServer(HttpServerConfig config, TypeCatalog catalog, UplinkHandler handler)
+    : config_(std::move(config)), catalog_(std::move(catalog)), handler_(std::move(handler))
+{
+    if (config_.admission)
+    {
+        admission_ = std::make_unique<AdmissionControl>(*config_.admission);
+    }
+}
+
+HttpServer::~HttpServer()
+{
+    stop();
+}
+
+auto HttpServer::start() -> std::expected<uint16_t, std::error_code>
+{
+    if (running_.load())
+    {
+        return config_.port;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(config_.port);
+    if (::inet_pton(AF_INET, config_.bind_address.c_str(), &address.sin_addr) != 1)
+    {
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    const unsigned thread_count =
+        config_.threads != 0 ? config_.threads : std::max(1U, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < thread_count; ++i)
+    {
+        auto worker = std::make_unique<Worker>(*this);
+        auto bound = worker->open(address);
+        if (!bound)
+        {
+            workers_.clear();
+            return std::unexpected(bound.error());
+        }
+        // El primero resuelve el puerto efímero; el resto se une a él
+        address.sin_port = htons(*bound);
+        config_.port = *bound;
+        workers_.push_back(std::move(worker));
+    }
+
+    running_.store(true);
+    for (unsigned i = 0; i < thread_count; ++i)
+    {
+        threads_.emplace_back(
+            [this, i]
+            {
+                if (config_.pin_threads)
+                {
+                    cpu_set_t cpus;
+                    CPU_ZERO(&cpus);
+                    CPU_SET(i % std::max(1U, std::thread::hardware_concurrency()), &cpus);
+                    ::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus);
+                }
+                workers_[i]->run();
+            });
+    }
+    return config_.port;
+}
+
+void HttpServer::stop()
+{
+    if (!running_.exchange(false))
+    {
+        return;
+    }
+    for (const auto& worker : workers_)
+    {
+        worker->wake();
+    }
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+    threads_.clear();
+
+    const HttpServerStats totals = stats();
+    workers_.clear();
+    retired_ = totals;
+}
+
+auto HttpServer::stats() const -> HttpServerStats
+{
+    HttpServerStats stats = retired_;
+    for (const auto& worker : workers_)
+    {
+        worker->add_stats(stats);
+    }
+    return stats;
+}
+
+}  // namespace cayene::ingest
@@ -0,0 +1,109 @@
+/**
+ * @file lanes.cpp
+ * @brief Implementation of the priority lanes
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/lanes.hpp"
+
+#include <utility>
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+// Canal y tipo preceden a los datos de cada campo
+constexpr std::size_t field_header_size = 2;
+
+auto lane_handler(Lane lane, const LaneHandler& handler) -> BatchHandler
+{
+    if (!handler)
+    {
+        return nullptr;
+    }
+    return [lane, handler](std::span<const BatchedUplink> batch) { handler(lane, batch); };
+}
+
+}  // namespace
+
+auto lane_name(Lane lane) -> std::string_view
+{
+    switch (lane)
+    {
+        case Lane::Alarm:
+            return "alarm";
+        case Lane::Bulk:
+            return "bulk";
+    }
+    return "unknown";
+}
+
+auto classify_lane(std::span<const uint8_t> encoded_payload, const TypeTable& types,
+                   const AlarmTypes& alarm_types, std::size_t peek_fields) -> Lane
+{
+    std::size_t offset = 0;
+    for (std::size_t field = 0; field < peek_fields; ++field)
+    {
+        if (encoded_payload.size() - offset < field_header_size)
+        {
+            break;
+        }
+        const uint8_t type_id = encoded_payload[offset + 1];
+        if (alarm_types.contains(type_id))
+        {
+            return Lane::Alarm;
+        }
+        // Tipo desconocido: no se puede saltar el campo, el decoder lo rechazará
+        const std::size_t remaining = encoded_payload.size() - offset - field_header_size;
+        std::size_t size = types.size(type_id);
+        if (size == 0 && remaining > 0)
+        {
+            // Longitud variable: el primer byte del campo cuenta las unidades
+            size = types.prefixed_size(type_id, encoded_payload[offset + field_header_size]);
+        }
+        if (size == 0 || remaining < size)
+        {
+            break;
+        }
+        offset += field_header_size + size;
+    }
+    return Lane::Bulk;
+}
+
+LanedBatcher::LanedBatcher(LaneConfig config, const TypeCatalog& catalog, LaneHandler handler,
+                           DoneHandler done)
+    : config_(std::move(config)),
+      catalog_(catalog),
+      alarm_(config_.alarm, catalog, lane_handler(Lane::Alarm, handler), done),
+      bulk_(config_.bulk, catalog, lane_handler(Lane::Bulk, handler), done)
+{
+}
+
+auto LanedBatcher::submit(const Uplink& uplink, std::string_view source, uint64_t tag) -> bool
+{
+    const TypeTable& types = catalog_.decoder(uplink.fport).types();
+    return batcher(classify_lane(uplink.payload, types, config_.alarm_types, config_.peek_fields))
+        .submit(uplink, source, tag);
+}
+
+void LanedBatcher::drain()
+{
+    alarm_.drain();
+    bulk_.drain();
+}
+
+auto LanedBatcher::stats(Lane lane) const -> BatcherStats
+{
+    return lane == Lane::Alarm ? alarm_.stats() : bulk_.stats();
+}
+
+auto LanedBatcher::batcher(Lane lane) -> MicroBatcher&
+{
+    return lane == Lane::Alarm ? alarm_ : bulk_;
+}
+
+}  // namespace cayene::ingest
@@ -0,0 +1,329 @@
+/**
+ * @file mqtt.cpp
+ * @brief Implementation of the MQTT 3.1.1 packet codec
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/mqtt.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+// La longitud restante ocupa como mucho 4 bytes de 7 bits
+constexpr std::size_t max_length_bytes = 4;
+
+constexpr uint8_t connect_flag_clean_session = 0x02;
+constexpr uint8_t subscribe_flags = 0x02;
+
+auto read_u16(std::span<const uint8_t> bytes) -> uint16_t
+{
+    return static_cast<uint16_t>(bytes[0] << 8U | bytes[1]);
+}
+
+void append_u16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(static_cast<uint8_t>(value >> 8U));
+    out.push_back(static_cast<uint8_t>(value & 0xFFU));
+}
+
+void append_string(std::vector<uint8_t>& out, std::string_view text)
+{
+    append_u16(out, static_cast<uint16_t>(text.size()));
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+void append_fixed_header(std::vector<uint8_t>& out, MqttPacketType type, uint8_t flags,
+                         std::size_t remaining)
+{
+    out.push_back(static_cast<uint8_t>(static_cast<unsigned>(type) << 4U | flags));
+    do
+    {
+        auto byte = static_cast<uint8_t>(remaining & 0x7FU);
+        remaining >>= 7U;
+        if (remaining != 0)
+        {
+            byte |= 0x80U;
+        }
+        out.push_back(byte);
+    } while (remaining != 0);
+}
+
+auto known_type(unsigned type) -> bool
+{
+    switch (static_cast<MqttPacketType>(type))
+    {
+        case MqttPacketType::Connect:
+        case MqttPacketType::Connack:
+        case MqttPacketType::Publish:
+        case MqttPacketType::Puback:
+        case MqttPacketType::Subscribe:
+        case MqttPacketType::Suback:
+        case MqttPacketType::Pingreq:
+        case MqttPacketType::Pingresp:
+        case MqttPacketType::Disconnect:
+            return true;
+    }
+    return false;
+}
+
+// Cabecera variable y payload de un PUBLISH
+auto parse_publish(MqttPacket& packet) -> std::expected<void, MqttError>
+{
+    packet.qos = static_cast<uint8_t>(packet.flags >> 1U & 0x03U);
+    if (packet.qos == 3)
+    {
+        return std::unexpected(MqttError::Malformed);
+    }
+    if (packet.qos == 2)
+    {
+        return std::unexpected(MqttError::Unsupported);
+    }
+
+    std::span<const uint8_t> body = packet.body;
+    if (body.size() < 2 || body.size() < 2U + read_u16(body))
+    {
+        return std::unexpected(MqttError::Malformed);
+    }
+    const std::size_t topic_size = read_u16(body);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    packet.topic = {reinterpret_cast<const char*>(body.data() + 2), topic_size};
+    body = body.subspan(2 + topic_size);
+
+    if (packet.qos > 0)
+    {
+        if (body.size() < 2)
+        {
+            return std::unexpected(MqttError::Malformed);
+        }
+        packet.packet_id = read_u16(body);
+        body = body.subspan(2);
+    }
+    packet.payload = body;
+    return {};
+}
+
+}  // namespace
+
+auto parse_packet(std::span<const uint8_t> buffer, MqttPacket& packet, std::size_t max_packet)
+    -> std::expected<std::size_t, MqttError>
+{
+    if (buffer.size() < 2)
+    {
+        return 0;
+    }
+    const unsigned type = buffer[0] >> 4U;
+    if (!known_type(type))
+    {
+        return std::unexpected(MqttError::Unsupported);
+    }
+
+    std::size_t remaining = 0;
+    std::size_t header_size = 1;
+    for (unsigned shift = 0;; shift += 7)
+    {
+        if (header_size == 1 + max_length_bytes)
+        {
+            return std::unexpected(MqttError::Malformed);
+        }
+        if (header_size == buffer.size())
+        {
+            return 0;
+        }
+        const uint8_t byte = buffer[header_size++];
+        remaining |= static_cast<std::size_t>(byte & 0x7FU) << shift;
+        if ((byte & 0x80U) == 0)
+        {
+            break;
+        }
+    }
+
+    const std::size_t total = header_size + remaining;
+    if (total > max_packet)
+    {
+        return std::unexpected(MqttError::TooLarge);
+    }
+    if (buffer.size() < total)
+    {
+        return 0;
+    }
+
+    packet = MqttPacket{};
+    packet.type = static_cast<MqttPacketType>(type);
+    packet.flags = static_cast<uint8_t>(buffer[0] & 0x0FU);
+    packet.body = buffer.subspan(header_size, remaining);
+
+    switch (packet.type)
+    {
+        case MqttPacketType::Publish:
+            if (auto parsed = parse_publish(packet); !parsed)
+            {
+                return std::unexpected(parsed.error());
+            }
+            break;
+        case MqttPacketType::Subscribe:
+            if (packet.flags != subscribe_flags || remaining < 2)
+            {
+                return std::unexpected(MqttError::Malformed);
+            }
+            packet.packet_id = read_u16(packet.body);
+            break;
+        case MqttPacketType::Puback:
+        case MqttPacketType::Suback:
+            if (remaining < 2)
+            {
+                return std::unexpected(MqttError::Malformed);
+            }
+            packet.packet_id = read_u16(packet.body);
+            break;
+        case MqttPacketType::Connack:
+            if (remaining != 2)
+            {
+                return std::unexpected(MqttError::Malformed);
+            }
+            break;
+        case MqttPacketType::Pingreq:
+        case MqttPacketType::Pingresp:
+        case MqttPacketType::Disconnect:
+            if (remaining != 0)
+            {
+                return std::unexpected(MqttError::Malformed);
+            }
+            break;
+        case MqttPacketType::Connect:
+            break;
+    }
+    return total;
+}
+
+auto topic_matches(std::string_view filter, std::string_view topic) -> bool
+{
+    // Los comodines no alcanzan a los temas de sistema ($SYS/...)
+    if (topic.starts_with('$') && (filter.starts_with('+') || filter.starts_with('#')))
+    {
+        return false;
+    }
+
+    while (true)
+    {
+        const auto filter_end = filter.find('/');
+        const std::string_view filter_level = filter.substr(0, filter_end);
+        if (filter_level == "#")
+        {
+            return true;
+        }
+        const auto topic_end = topic.find('/');
+        if (filter_level != "+" && filter_level != topic.substr(0, topic_end))
+        {
+            return false;
+        }
+
+        if (filter_end == std::string_view::npos || topic_end == std::string_view::npos)
+        {
+            // "a/#" también casa con el padre "a"
+            return filter_end == topic_end || (topic_end == std::string_view::npos &&
+                                               filter.substr(filter_end + 1) == "#");
+        }
+        filter.remove_prefix(filter_end + 1);
+        topic.remove_prefix(topic_end + 1);
+    }
+}
+
+auto mqtt_error_name(MqttError error) -> std::string_view
+{
+    switch (error)
+    {
+        case MqttError::Malformed:
+            return "Malformed";
+        case MqttError::TooLarge:
+            return "TooLarge";
+        case MqttError::Unsupported:
+            return "Unsupported";
+    }
+    return "Unknown";
+}
+
+void append_connect(std::vector<uint8_t>& out, std::string_view client_id, uint16_t keep_alive,
+                    bool clean_session)
+{
+    constexpr std::string_view protocol_name = "MQTT";
+    constexpr uint8_t protocol_level = 4;
+
+    append_fixed_header(out, MqttPacketType::Connect, 0,
+                        2 + protocol_name.size() + 4 + 2 + client_id.size());
+    append_string(out, protocol_name);
+    out.push_back(protocol_level);
+    out.push_back(clean_session ? connect_flag_clean_session : 0);
+    append_u16(out, keep_alive);
+    append_string(out, client_id);
+}
+
+void append_subscribe(std::vector<uint8_t>& out, uint16_t packet_id, std::string_view filter,
+                      uint8_t qos)
+{
+    append_fixed_header(out, MqttPacketType::Subscribe, subscribe_flags,
+                        2 + 2 + filter.size() + 1);
+    append_u16(out, packet_id);
+    append_string(out, filter);
+    out.push_back(qos);
+}
+
+void append_puback(std::vector<uint8_t>& out, uint16_t packet_id)
+{
+    append_fixed_header(out, MqttPacketType::Puback, 0, 2);
+    append_u16(out, packet_id);
+}
+
+void append_pingreq(std::vector<uint8_t>& out)
+{
+    append_fixed_header(out, MqttPacketType::Pingreq, 0, 0);
+}
+
+void append_disconnect(std::vector<uint8_t>& out)
+{
+    append_fixed_header(out, MqttPacketType::Disconnect, 0, 0);
+}
+
+void append_connack(std::vector<uint8_t>& out, uint8_t return_code)
+{
+    append_fixed_header(out, MqttPacketType::Connack, 0, 2);
+    out.push_back(0);
+    out.push_back(return_code);
+}
+
+void append_suback(std::vector<uint8_t>& out, uint16_t packet_id, uint8_t granted_qos)
+{
+    append_fixed_header(out, MqttPacketType::Suback, 0, 3);
+    append_u16(out, packet_id);
+    out.push_back(granted_qos);
+}
+
+void append_publish(std::vector<uint8_t>& out, std::string_view topic,
+                    std::span<const uint8_t> payload, uint8_t qos, uint16_t packet_id)
+{
+    append_fixed_header(out, MqttPacketType::Publish, static_cast<uint8_t>(qos << 1U),
+                        2 + topic.size() + (qos > 0 ? 2 : 0) + payload.size());
+    append_string(out, topic);
+    if (qos > 0)
+    {
+        append_u16(out, packet_id);
+    }
+    out.insert(out.end(), payload.begin(), payload.end());
+}
+
+void append_pingresp(std::vector<uint8_t>& out)
+{
+    append_fixed_header(out, MqttPacketType::Pingresp, 0, 0);
+}
+
+}  // namespace cayene::ingest
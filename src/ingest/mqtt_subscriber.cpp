@@ -0,0 +1,626 @@
+/**
+ * @file mqtt_subscriber.cpp
+ * @brief Non-blocking MQTT subscriber with batched decode
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/mqtt_subscriber.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint8_t subscribe_qos = 1;
+constexpr uint8_t suback_failure = 0x80;
+
+auto last_error() -> std::error_code
+{
+    return {errno, std::system_category()};
+}
+
+auto make_error(std::errc error) -> std::unexpected<std::error_code>
+{
+    return std::unexpected(std::make_error_code(error));
+}
+
+// Espera a que fd esté listo para events antes de deadline
+auto wait_for(int fd, short events, Clock::time_point deadline)
+    -> std::expected<void, std::error_code>
+{
+    while (true)
+    {
+        const auto left =
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        if (left.count() <= 0)
+        {
+            return make_error(std::errc::timed_out);
+        }
+        pollfd descriptor{.fd = fd, .events = events, .revents = 0};
+        const int ready = ::poll(&descriptor, 1, static_cast<int>(left.count()));
+        if (ready > 0)
+        {
+            return {};
+        }
+        if (ready < 0 && errno != EINTR)
+        {
+            return std::unexpected(last_error());
+        }
+    }
+}
+
+}  // namespace
+
+MqttSubscriber::MqttSubscriber(MqttConfig config, TypeCatalog catalog, MqttBatchHandler handler)
+    : config_(std::move(config)), catalog_(std::move(catalog)), handler_(std::move(handler))
+{
+    config_.max_batch = std::max<std::size_t>(config_.max_batch, 1);
+    if (config_.admission)
+    {
+        admission_ = std::make_unique<AdmissionControl>(*config_.admission);
+    }
+    if (config_.lanes)
+    {
+        ack_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        lanes_ = std::make_unique<LanedBatcher>(
+            *config_.lanes, catalog_,
+            [this](Lane lane, std::span<const BatchedUplink> batch) { on_lane_batch(lane, batch); },
+            [this](std::span<const uint64_t> packet_ids) { on_lane_done(packet_ids); });
+    }
+}
+
+MqttSubscriber::~MqttSubscriber()
+{
+    disconnect();
+    // Los workers escriben en ack_fd_: se detienen antes de cerrarlo
+    lanes_.reset();
+    if (ack_fd_ >= 0)
+    {
+        ::close(ack_fd_);
+    }
+}
+
+auto MqttSubscriber::connect(std::chrono::milliseconds timeout)
+    -> std::expected<void, std::error_code>
+{
+    close();
+    const auto deadline = Clock::now() + timeout;
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(config_.port);
+    if (::inet_pton(AF_INET, config_.host.c_str(), &address.sin_addr) != 1)
+    {
+        return make_error(std::errc::invalid_argument);
+    }
+
+    fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+    {
+        return std::unexpected(last_error());
+    }
+    int enable = 1;
+    ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (::connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        if (errno != EINPROGRESS)
+        {
+            const auto error = last_error();
+            close();
+            return std::unexpected(error);
+        }
+        int socket_error = 0;
+        socklen_t size = sizeof(socket_error);
+        if (auto ready = wait_for(fd_, POLLOUT, deadline); !ready)
+        {
+            close();
+            return ready;
+        }
+        ::getsockopt(fd_, SOL_SOCKET, SO_ERROR, &socket_error, &size);
+        if (socket_error != 0)
+        {
+            close();
+            return std::unexpected(std::error_code(socket_error, std::system_category()));
+        }
+    }
+
+    // Un PUBLISH completo siempre cabe en la mitad del buffer
+    input_.resize(2 * config_.max_packet_size);
+    arena_.resize(config_.max_batch * config_.max_payload_size);
+    pending_.reserve(config_.max_batch);
+    pending_topics_.reserve(config_.max_batch);
+    pending_packet_ids_.reserve(config_.max_batch);
+
+    // MQTT permite enviar el SUBSCRIBE sin esperar al CONNACK
+    append_connect(output_, config_.client_id, config_.keep_alive, config_.clean_session);
+    append_subscribe(output_, subscribe_id_, config_.topic, subscribe_qos);
+
+    auto fail = [this](std::error_code error) -> std::expected<void, std::error_code>
+    {
+        close();
+        return std::unexpected(error);
+    };
+
+    while (!output_.empty())
+    {
+        if (auto flushed = flush(); !flushed)
+        {
+            return fail(flushed.error());
+        }
+        if (!output_.empty())
+        {
+            if (auto ready = wait_for(fd_, POLLOUT, deadline); !ready)
+            {
+                return fail(ready.error());
+            }
+        }
+    }
+
+    MqttPacket packet;
+    while (true)
+    {
+        const auto consumed =
+            parse_packet({input_.data(), input_size_}, packet, config_.max_packet_size);
+        if (!consumed)
+        {
+            return fail(std::make_error_code(std::errc::protocol_error));
+        }
+        if (*consumed != 0)
+        {
+            if (packet.type != MqttPacketType::Connack)
+            {
+                return fail(std::make_error_code(std::errc::protocol_error));
+            }
+            if (packet.body[1] != 0)
+            {
+                return fail(std::make_error_code(std::errc::connection_refused));
+            }
+            // Lo que llegó detrás del CONNACK lo atiende poll()
+            std::memmove(input_.data(), input_.data() + *consumed, input_size_ - *consumed);
+            input_size_ -= *consumed;
+            buffered_ = input_size_ != 0;
+            return {};
+        }
+
+        if (auto ready = wait_for(fd_, POLLIN, deadline); !ready)
+        {
+            return fail(ready.error());
+        }
+        if (auto received = receive(); !received)
+        {
+            return fail(received.error());
+        }
+    }
+}
+
+auto MqttSubscriber::poll(std::chrono::milliseconds timeout)
+    -> std::expected<std::size_t, std::error_code>
+{
+    if (fd_ < 0)
+    {
+        return make_error(std::errc::not_connected);
+    }
+
+    // Sin tráfico saliente durante keep_alive, el broker espera un PINGREQ
+    const auto keep_alive = std::chrono::seconds(config_.keep_alive);
+    if (config_.keep_alive != 0)
+    {
+        const auto until_ping =
+            std::chrono::duration_cast<std::chrono::milliseconds>(last_sent_ + keep_alive -
+                                                                  Clock::now());
+        timeout = std::clamp(until_ping, std::chrono::milliseconds(0), timeout);
+    }
+    if (buffered_)
+    {
+        timeout = std::chrono::milliseconds(0);
+    }
+
+    // Sin carriles ack_fd_ es -1 y ::poll() lo ignora
+    std::array<pollfd, 2> descriptors{
+        pollfd{.fd = fd_,
+               .events = static_cast<short>(POLLIN | (output_.empty() ? 0 : POLLOUT)),
+               .revents = 0},
+        pollfd{.fd = ack_fd_, .events = POLLIN, .revents = 0}};
+    const int ready =
+        ::poll(descriptors.data(), descriptors.size(), static_cast<int>(timeout.count()));
+    if (ready < 0 && errno != EINTR)
+    {
+        return std::unexpected(last_error());
+    }
+    const pollfd& descriptor = descriptors[0];
+
+    std::size_t delivered = 0;
+    // Lo que quedó en el buffer tras el CONNACK se atiende aunque el socket esté vacío
+    bool more = buffered_ || (descriptor.revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+    buffered_ = false;
+    while (more)
+    {
+        const auto full = receive();
+        if (!full)
+        {
+            close();
+            return std::unexpected(full.error());
+        }
+        const auto processed = process_packets();
+        if (!processed)
+        {
+            close();
+            return std::unexpected(processed.error());
+        }
+        delivered += *processed;
+        more = *full;
+    }
+    if (lanes_)
+    {
+        if ((descriptors[1].revents & POLLIN) != 0)
+        {
+            uint64_t wakeups = 0;
+            [[maybe_unused]] const auto read = ::read(ack_fd_, &wakeups, sizeof(wakeups));
+        }
+        delivered += collect_lane_acks();
+    }
+
+    if (config_.keep_alive != 0 && output_.empty() && Clock::now() - last_sent_ >= keep_alive)
+    {
+        append_pingreq(output_);
+    }
+    if (auto flushed = flush(); !flushed)
+    {
+        close();
+        return std::unexpected(flushed.error());
+    }
+    return delivered;
+}
+
+void MqttSubscriber::disconnect()
+{
+    if (fd_ < 0)
+    {
+        return;
+    }
+    if (lanes_)
+    {
+        // Lo que ya está en los carriles se entrega y se confirma antes de salir
+        lanes_->drain();
+        collect_lane_acks();
+    }
+    append_disconnect(output_);
+    [[maybe_unused]] const auto flushed = flush();
+    close();
+}
+
+auto MqttSubscriber::receive() -> std::expected<bool, std::error_code>
+{
+    while (input_size_ < input_.size())
+    {
+        const ssize_t received =
+            ::recv(fd_, input_.data() + input_size_, input_.size() - input_size_, 0);
+        if (received > 0)
+        {
+            input_size_ += static_cast<std::size_t>(received);
+            continue;
+        }
+        if (received == 0)
+        {
+            return make_error(std::errc::connection_reset);
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return false;
+        }
+        return std::unexpected(last_error());
+    }
+    return true;
+}
+
+auto MqttSubscriber::process_packets() -> std::expected<std::size_t, std::error_code>
+{
+    std::size_t delivered = 0;
+    std::size_t offset = 0;
+    MqttPacket packet;
+
+    while (true)
+    {
+        const auto consumed = parse_packet({input_.data() + offset, input_size_ - offset}, packet,
+                                           config_.max_packet_size);
+        if (!consumed)
+        {
+            return make_error(std::errc::protocol_error);
+        }
+        if (*consumed == 0)
+        {
+            break;
+        }
+        offset += *consumed;
+
+        switch (packet.type)
+        {
+            case MqttPacketType::Publish:
+                delivered += on_publish(packet);
+                break;
+            case MqttPacketType::Suback:
+                if (packet.packet_id == subscribe_id_ &&
+                    (packet.body.size() < 3 || packet.body[2] == suback_failure))
+                {
+                    return make_error(std::errc::permission_denied);
+                }
+                break;
+            case MqttPacketType::Pingresp:
+                break;
+            default:
+                return make_error(std::errc::protocol_error);
+        }
+    }
+
+    // Los topics y device ids apuntan al buffer: se entregan antes de compactarlo
+    delivered += deliver_batch();
+    std::memmove(input_.data(), input_.data() + offset, input_size_ - offset);
+    input_size_ -= offset;
+    return delivered;
+}
+
+auto MqttSubscriber::on_publish(const MqttPacket& packet) -> std::size_t
+{
+    ++stats_.messages;
+    if (packet.qos > 0)
+    {
+        acks_.push_back(packet.packet_id);
+    }
+    // Una sesión persistente puede traer mensajes de suscripciones anteriores
+    if (!topic_matches(config_.topic, packet.topic))
+    {
+        return 0;
+    }
+
+    const auto slot =
+        std::span(arena_).subspan(pending_.size() * config_.max_payload_size,
+                                  config_.max_payload_size);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const std::string_view body(reinterpret_cast<const char*>(packet.payload.data()),
+                                packet.payload.size());
+    const auto uplink = parse_envelope(body, slot);
+    if (!uplink)
+    {
+        if (uplink.error() != EnvelopeError::MissingPayload)
+        {
+            ++stats_.rejected;
+        }
+        return 0;
+    }
+    if (admission_ && !admission_->admit(uplink->device_id))
+    {
+        ++stats_.throttled;
+        return 0;
+    }
+
+    pending_.push_back(*uplink);
+    pending_topics_.push_back(packet.topic);
+    pending_packet_ids_.push_back(packet.qos > 0 ? packet.packet_id : 0);
+    if (lanes_ && packet.qos > 0)
+    {
+        // Lo confirma el worker de su carril cuando lo haya entregado
+        acks_.pop_back();
+    }
+    return pending_.size() == config_.max_batch ? deliver_batch() : 0;
+}
+
+auto MqttSubscriber::deliver_batch() -> std::size_t
+{
+    if (lanes_)
+    {
+        return deliver_laned();
+    }
+
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < pending_.size(); ++i)
+    {
+        auto decoded = catalog_.decode(pending_[i].fport, pending_[i].payload);
+        if (!decoded)
+        {
+            ++stats_.rejected;
+            continue;
+        }
+        // Se reutilizan las entradas de batch_ entre lotes
+        if (count == batch_.size())
+        {
+            batch_.emplace_back();
+        }
+        batch_[count++] = MqttUplink{pending_topics_[i], pending_[i], std::move(*decoded)};
+    }
+
+    if (count != 0)
+    {
+        ++stats_.batches;
+        stats_.uplinks += count;
+        if (handler_)
+        {
+            handler_(std::span<const MqttUplink>(batch_).first(count));
+        }
+    }
+    pending_.clear();
+    pending_topics_.clear();
+    pending_packet_ids_.clear();
+
+    // Confirmación tras el handler: si algo falla antes, el broker reenvía
+    for (const uint16_t id : acks_)
+    {
+        append_puback(output_, id);
+    }
+    acks_.clear();
+    return count;
+}
+
+auto MqttSubscriber::deliver_laned() -> std::size_t
+{
+    // Los workers copian carga y topic: el arena y el buffer de entrada quedan libres
+    for (std::size_t i = 0; i < pending_.size(); ++i)
+    {
+        if (!lanes_->submit(pending_[i], pending_topics_[i], pending_packet_ids_[i]))
+        {
+            // Con la cola del carril llena se espera a que se vacíe y se reintenta
+            lanes_->drain();
+            lanes_->submit(pending_[i], pending_topics_[i], pending_packet_ids_[i]);
+        }
+    }
+    pending_.clear();
+    pending_topics_.clear();
+    pending_packet_ids_.clear();
+
+    // Los mensajes que no llegaron a un carril ya están atendidos
+    for (const uint16_t id : acks_)
+    {
+        append_puback(output_, id);
+    }
+    acks_.clear();
+    // Lo que entreguen los carriles lo cuenta collect_lane_acks()
+    return 0;
+}
+
+void MqttSubscriber::on_lane_batch(Lane lane, std::span<const BatchedUplink> batch)
+{
+    // Cada carril reutiliza sus propias entradas: los dos pueden estar aquí a la vez
+    auto& entries = lane_batches_[static_cast<std::size_t>(lane)];
+    entries.resize(std::max(entries.size(), batch.size()));
+    for (std::size_t i = 0; i < batch.size(); ++i)
+    {
+        entries[i] = MqttUplink{batch[i].source, batch[i].uplink, batch[i].decoded};
+    }
+    if (handler_)
+    {
+        handler_(std::span<const MqttUplink>(entries).first(batch.size()));
+    }
+
+    const std::lock_guard lock(lane_mutex_);
+    ++stats_.batches;
+    stats_.uplinks += batch.size();
+}
+
+void MqttSubscriber::on_lane_done(std::span<const uint64_t> packet_ids)
+{
+    bool wake = false;
+    {
+        const std::lock_guard lock(lane_mutex_);
+        // poll() solo necesita un aviso por cada vez que la lista deja de estar vacía
+        wake = lane_acks_.empty();
+        for (const uint64_t id : packet_ids)
+        {
+            // Un packet id de QoS 1 nunca es 0: 0 marca los mensajes QoS 0
+            if (id != 0)
+            {
+                lane_acks_.push_back(static_cast<uint16_t>(id));
+            }
+        }
+        wake = wake && !lane_acks_.empty();
+    }
+    if (wake)
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] const auto written = ::write(ack_fd_, &one, sizeof(one));
+    }
+}
+
+auto MqttSubscriber::collect_lane_acks() -> std::size_t
+{
+    const std::lock_guard lock(lane_mutex_);
+    for (const uint16_t id : lane_acks_)
+    {
+        append_puback(output_, id);
+    }
+    lane_acks_.clear();
+    const auto delivered = static_cast<std::size_t>(stats_.uplinks - reported_uplinks_);
+    reported_uplinks_ = stats_.uplinks;
+    return delivered;
+}
+
+auto MqttSubscriber::stats() const -> MqttStats
+{
+    const std::lock_guard lock(lane_mutex_);
+    MqttStats stats = stats_;
+    if (lanes_)
+    {
+        // El decoder rechaza en los workers: lo cuentan sus batchers
+        for (const Lane lane : {Lane::Alarm, Lane::Bulk})
+        {
+            stats.rejected += lanes_->stats(lane).rejected;
+        }
+    }
+    return stats;
+}
+
+auto MqttSubscriber::flush() -> std::expected<void, std::error_code>
+{
+    while (output_sent_ < output_.size())
+    {
+        const ssize_t sent = ::send(fd_, output_.data() + output_sent_,
+                                    output_.size() - output_sent_, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            // poll() pedirá POLLOUT mientras quede salida
+            return {};
+        }
+        if (sent < 0)
+        {
+            return std::unexpected(last_error());
+        }
+        output_sent_ += static_cast<std::size_t>(sent);
+        last_sent_ = Clock::now();
+    }
+    output_.clear();
+    output_sent_ = 0;
+    return {};
+}
+
+void MqttSubscriber::close()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    input_size_ = 0;
+    buffered_ = false;
+    output_.clear();
+    output_sent_ = 0;
+    pending_.clear();
+    pending_topics_.clear();
+    pending_packet_ids_.clear();
+    acks_.clear();
+    if (lanes_)
+    {
+        // Los PUBACK que deben los carriles eran de esta conexión: el broker reenviará
+        lanes_->drain();
+        const std::lock_guard lock(lane_mutex_);
+        lane_acks_.clear();
+        reported_uplinks_ = stats_.uplinks;
+    }
+}
+
+}  // namespace cayene::ingest
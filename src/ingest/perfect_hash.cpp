@@ -0,0 +1,200 @@
+/**
+ * @file perfect_hash.cpp
+ * @brief Implementation of the minimal perfect hash
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/perfect_hash.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+// Claves por bucket en media; cada bucket guarda un desplazamiento de 4 bytes
+constexpr std::size_t bucket_size = 4;
+// Semillas probadas antes de rendirse (en la práctica basta la primera)
+constexpr uint64_t max_seeds = 8;
+constexpr std::size_t device_id_hex_digits = 16;
+
+// Finalizador de MurmurHash3: mezcla completa de 64 bits
+auto mix(uint64_t x) -> uint64_t
+{
+    x ^= x >> 33U;
+    x *= 0xff51afd7ed558ccdU;
+    x ^= x >> 33U;
+    x *= 0xc4ceb9fe1a85ec53U;
+    x ^= x >> 33U;
+    return x;
+}
+
+// Se vuelve a mezclar tras el XOR: con n potencia de dos, dos claves con los
+// mismos bits bajos caerían juntas con cualquier desplazamiento
+auto position_of(uint64_t hash, uint32_t pilot, std::size_t count) -> std::size_t
+{
+    return static_cast<std::size_t>(mix(hash ^ mix(pilot)) % count);
+}
+
+auto hex_value(char c) -> int
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+}  // namespace
+
+auto device_key(std::string_view device_id) -> uint64_t
+{
+    if (device_id.size() == device_id_hex_digits)
+    {
+        uint64_t value = 0;
+        bool hex = true;
+        for (const char c : device_id)
+        {
+            const int digit = hex_value(c);
+            if (digit < 0)
+            {
+                hex = false;
+                break;
+            }
+            value = value << 4U | static_cast<uint64_t>(digit);
+        }
+        if (hex)
+        {
+            return value;
+        }
+    }
+
+    // FNV-1a para ids que no son un DevEUI (p. ej. los de The Things Stack)
+    uint64_t hash = 0xcbf29ce484222325U;
+    for (const char c : device_id)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3U;
+    }
+    return hash;
+}
+
+auto PerfectHash::build(std::span<const uint64_t> keys) -> std::optional<PerfectHash>
+{
+    PerfectHash hash;
+    const std::size_t count = keys.size();
+    hash.count_ = count;
+    if (count == 0)
+    {
+        return hash;
+    }
+
+    const std::size_t bucket_count = (count + bucket_size - 1) / bucket_size;
+    // El último bucket de uno necesita de media `count` intentos: margen amplio
+    const auto max_pilot = static_cast<uint32_t>(std::min<uint64_t>(
+        std::numeric_limits<uint32_t>::max(), std::max<uint64_t>(uint64_t{64} * count, 1U << 16U)));
+
+    std::vector<uint64_t> hashes(count);
+    std::vector<std::size_t> bucket_start(bucket_count + 1);
+    std::vector<std::size_t> members(count);
+    std::vector<std::size_t> buckets(bucket_count);
+    std::vector<bool> taken;
+    std::vector<std::size_t> positions;
+
+    for (uint64_t attempt = 0; attempt < max_seeds; ++attempt)
+    {
+        hash.seed_ = mix(attempt + 0x9e3779b97f4a7c15U);
+        hash.pilots_.assign(bucket_count, 0);
+
+        // Reparto por buckets con counting sort
+        std::ranges::fill(bucket_start, 0);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            hashes[i] = mix(keys[i] ^ hash.seed_);
+            ++bucket_start[hashes[i] % bucket_count + 1];
+        }
+        std::partial_sum(bucket_start.begin(), bucket_start.end(), bucket_start.begin());
+        std::vector<std::size_t> fill(bucket_start.begin(), bucket_start.end() - 1);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            members[fill[hashes[i] % bucket_count]++] = i;
+        }
+
+        // Los buckets grandes primero, mientras la tabla está vacía
+        std::iota(buckets.begin(), buckets.end(), std::size_t{0});
+        std::ranges::stable_sort(buckets, std::greater<>{}, [&](std::size_t b)
+                                 { return bucket_start[b + 1] - bucket_start[b]; });
+
+        taken.assign(count, false);
+        bool placed_all = true;
+        for (const std::size_t bucket : buckets)
+        {
+            const std::span<const std::size_t> keys_in_bucket(
+                members.begin() + static_cast<std::ptrdiff_t>(bucket_start[bucket]),
+                members.begin() + static_cast<std::ptrdiff_t>(bucket_start[bucket + 1]));
+            if (keys_in_bucket.empty())
+            {
+                break;
+            }
+
+            uint32_t pilot = 0;
+            for (; pilot < max_pilot; ++pilot)
+            {
+                positions.clear();
+                for (const std::size_t i : keys_in_bucket)
+                {
+                    const std::size_t position = position_of(hashes[i], pilot, count);
+                    if (taken[position] ||
+                        std::ranges::find(positions, position) != positions.end())
+                    {
+                        break;
+                    }
+                    positions.push_back(position);
+                }
+                if (positions.size() == keys_in_bucket.size())
+                {
+                    break;
+                }
+            }
+            if (pilot == max_pilot)
+            {
+                placed_all = false;
+                break;
+            }
+            hash.pilots_[bucket] = pilot;
+            for (const std::size_t position : positions)
+            {
+                taken[position] = true;
+            }
+        }
+        if (placed_all)
+        {
+            return hash;
+        }
+    }
+    return std::nullopt;
+}
+
+auto PerfectHash::operator()(uint64_t key) const -> std::size_t
+{
+    const uint64_t hash = mix(key ^ seed_);
+    const uint32_t pilot = pilots_[hash % pilots_.size()];
+    return position_of(hash, pilot, count_);
+}
+
+}  // namespace cayene::ingest
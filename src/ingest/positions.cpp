@@ -0,0 +1,320 @@
+/**
+ * @file positions.cpp
+ * @brief Implementation of the last-known-position index
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/positions.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+#include "cayene/ingest/perfect_hash.hpp"
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+constexpr int32_t max_lat = 900'000;
+constexpr int32_t max_lon = 1'800'000;
+constexpr double raw_per_degree = 10000.0;
+// Radio medio de la Tierra (IUGG)
+constexpr double earth_radius = 6'371'008.8;
+constexpr double meters_per_degree = earth_radius * std::numbers::pi / 180.0;
+
+// Generaciones de todos los índices: un hilo que consulta dos no confunde sus snapshots
+std::atomic<uint64_t> next_generation{1};
+
+// Último snapshot visto por el hilo; se recarga solo si cambia la generación
+struct CachedSnapshot
+{
+    uint64_t generation{0};
+    std::shared_ptr<const PositionSnapshot> snapshot;
+};
+
+thread_local CachedSnapshot cached_snapshot;
+
+auto radians(int32_t raw) -> double
+{
+    return raw / raw_per_degree * std::numbers::pi / 180.0;
+}
+
+// Haversine: exacta a cualquier distancia, a diferencia de la proyección plana
+auto distance(GeoPoint a, GeoPoint b) -> double
+{
+    const double lat_a = radians(a.lat);
+    const double lat_b = radians(b.lat);
+    const double sin_lat = std::sin((lat_b - lat_a) / 2);
+    const double sin_lon = std::sin(radians(b.lon - a.lon) / 2);
+    const double h = sin_lat * sin_lat + std::cos(lat_a) * std::cos(lat_b) * sin_lon * sin_lon;
+    return 2 * earth_radius * std::asin(std::min(1.0, std::sqrt(h)));
+}
+
+auto valid(GeoPoint point) -> bool
+{
+    return point.lat >= -max_lat && point.lat <= max_lat && point.lon >= -max_lon &&
+           point.lon <= max_lon;
+}
+
+// Caja que contiene el círculo de @p meters alrededor de @p center
+auto bounding_box(GeoPoint center, double meters) -> std::pair<GeoPoint, GeoPoint>
+{
+    const double lat_delta = meters / meters_per_degree * raw_per_degree + 1;
+    const double lat_min = center.lat - lat_delta;
+    const double lat_max = center.lat + lat_delta;
+    // Cerca de un polo el círculo abarca todas las longitudes
+    const double cos_lat = std::min(std::cos(radians(static_cast<int32_t>(
+                                        std::clamp<double>(lat_min, -max_lat, max_lat)))),
+                                    std::cos(radians(static_cast<int32_t>(
+                                        std::clamp<double>(lat_max, -max_lat, max_lat)))));
+    const double lon_delta = cos_lat > 1e-9 ? lat_delta / cos_lat : 2.0 * max_lon;
+
+    const auto clamp = [](double value, int32_t limit)
+    { return static_cast<int32_t>(std::clamp<double>(value, -limit, limit)); };
+    return {{clamp(lat_min, max_lat), clamp(center.lon - lon_delta, max_lon)},
+            {clamp(lat_max, max_lat), clamp(center.lon + lon_delta, max_lon)}};
+}
+
+}  // namespace
+
+template <typename Visit>
+void PositionSnapshot::visit_box(GeoPoint min, GeoPoint max, Visit&& visit) const
+{
+    min = {std::max(min.lat, -max_lat), std::max(min.lon, -max_lon)};
+    max = {std::min(max.lat, max_lat), std::min(max.lon, max_lon)};
+    if (entries_.empty() || min.lat > max.lat || min.lon > max.lon)
+    {
+        return;
+    }
+
+    const auto index = [this](int32_t coordinate, int32_t limit)
+    { return static_cast<uint64_t>((int64_t{coordinate} + limit) / cell_size_); };
+    const uint64_t first_column = index(min.lon, max_lon);
+    const uint64_t last_column = index(max.lon, max_lon);
+
+    // Cada fila de la rejilla es un tramo contiguo del array: una búsqueda binaria por fila
+    auto begin = entries_.begin();
+    for (uint64_t row = index(min.lat, max_lat); row <= index(max.lat, max_lat); ++row)
+    {
+        const uint64_t last_cell = row * columns_ + last_column;
+        begin = std::ranges::lower_bound(begin, entries_.end(), row * columns_ + first_column, {},
+                                         &Entry::cell);
+        for (; begin != entries_.end() && begin->cell <= last_cell; ++begin)
+        {
+            const GeoPoint point = begin->point;
+            if (point.lat >= min.lat && point.lat <= max.lat && point.lon >= min.lon &&
+                point.lon <= max.lon)
+            {
+                visit(*begin);
+            }
+        }
+    }
+}
+
+auto PositionSnapshot::position(const Entry& entry) const -> TrackedPosition
+{
+    return {std::string_view(names_).substr(entry.name, entry.name_size), entry.point,
+            std::chrono::system_clock::time_point(std::chrono::nanoseconds(entry.seen_ns))};
+}
+
+void PositionSnapshot::within_box(GeoPoint min, GeoPoint max,
+                                  std::vector<TrackedPosition>& positions) const
+{
+    positions.clear();
+    visit_box(min, max, [&](const Entry& entry) { positions.push_back(position(entry)); });
+}
+
+void PositionSnapshot::within_radius(GeoPoint center, double meters,
+                                     std::vector<TrackedPosition>& positions) const
+{
+    positions.clear();
+    const auto [min, max] = bounding_box(center, meters);
+    visit_box(min, max,
+              [&](const Entry& entry)
+              {
+                  if (distance(center, entry.point) <= meters)
+                  {
+                      positions.push_back(position(entry));
+                  }
+              });
+}
+
+void PositionSnapshot::nearest(GeoPoint center, std::size_t count,
+                               std::vector<TrackedPosition>& positions) const
+{
+    positions.clear();
+    count = std::min(count, entries_.size());
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Radio creciente desde una celda: con count candidatas dentro del círculo, las
+    // count más cercanas están entre ellas
+    std::vector<std::pair<double, const Entry*>> candidates;
+    double meters = cell_size_ / raw_per_degree * meters_per_degree;
+    while (true)
+    {
+        candidates.clear();
+        const auto [min, max] = bounding_box(center, meters);
+        visit_box(min, max,
+                  [&](const Entry& entry)
+                  {
+                      const double d = distance(center, entry.point);
+                      if (d <= meters)
+                      {
+                          candidates.emplace_back(d, &entry);
+                      }
+                  });
+        if (candidates.size() >= count || meters > std::numbers::pi * earth_radius)
+        {
+            break;
+        }
+        meters *= 2;
+    }
+
+    const auto end = candidates.begin() + static_cast<std::ptrdiff_t>(count);
+    std::ranges::partial_sort(candidates, end);
+    for (auto candidate = candidates.begin(); candidate != end; ++candidate)
+    {
+        positions.push_back(position(*candidate->second));
+    }
+}
+
+PositionIndex::PositionIndex(PositionIndexConfig config)
+    : config_(config),
+      snapshot_(std::make_shared<const PositionSnapshot>()),
+      generation_(next_generation.fetch_add(1, std::memory_order_relaxed))
+{
+    config_.cell_size = std::clamp(config_.cell_size, 1, max_lon);
+    if (config_.snapshot_interval.count() > 0)
+    {
+        thread_ = std::thread([this] { run(); });
+    }
+}
+
+PositionIndex::~PositionIndex()
+{
+    {
+        const std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+auto PositionIndex::update(std::string_view device_id, GeoPoint point, Clock::time_point now)
+    -> bool
+{
+    if (!valid(point))
+    {
+        return false;
+    }
+    const uint64_t key = device_key(device_id);
+    Shard& shard = shards_[(key ^ key >> 32U) % shard_count];
+    {
+        const std::lock_guard lock(shard.mutex);
+        Latest& latest = shard.devices[key];
+        if (latest.device_id.empty())
+        {
+            latest.device_id = device_id;
+        }
+        latest.point = point;
+        latest.seen = now;
+    }
+    updates_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+auto PositionIndex::update(std::string_view device_id, std::span<const Reading> readings,
+                           Clock::time_point now) -> bool
+{
+    const auto gps = std::ranges::find(readings.rbegin(), readings.rend(), gps_type_id,
+                                       &Reading::type_id);
+    return gps != readings.rend() && update(device_id, GeoPoint{gps->raw[0], gps->raw[1]}, now);
+}
+
+void PositionIndex::publish()
+{
+    // Un solo constructor a la vez; las actualizaciones siguen entrando mientras tanto
+    const std::lock_guard publishing(publish_mutex_);
+    updates_.store(0, std::memory_order_relaxed);
+
+    auto snapshot = std::make_shared<PositionSnapshot>();
+    snapshot->cell_size_ = config_.cell_size;
+    snapshot->columns_ = static_cast<uint64_t>(2 * max_lon / config_.cell_size + 1);
+    snapshot->entries_.reserve(devices());
+    for (Shard& shard : shards_)
+    {
+        const std::lock_guard lock(shard.mutex);
+        for (const auto& [key, latest] : shard.devices)
+        {
+            const auto row = static_cast<uint64_t>((int64_t{latest.point.lat} + max_lat) /
+                                                   config_.cell_size);
+            const auto column = static_cast<uint64_t>((int64_t{latest.point.lon} + max_lon) /
+                                                      config_.cell_size);
+            snapshot->entries_.push_back(
+                {row * snapshot->columns_ + column, latest.point,
+                 std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     latest.seen.time_since_epoch())
+                     .count(),
+                 static_cast<uint32_t>(snapshot->names_.size()),
+                 static_cast<uint16_t>(latest.device_id.size())});
+            snapshot->names_ += latest.device_id;
+        }
+    }
+    std::ranges::sort(snapshot->entries_, {}, &PositionSnapshot::Entry::cell);
+    snapshot->built_ = Clock::now();
+    snapshot_.store(std::move(snapshot), std::memory_order_release);
+    generation_.store(next_generation.fetch_add(1, std::memory_order_relaxed),
+                      std::memory_order_release);
+}
+
+auto PositionIndex::snapshot() const -> const std::shared_ptr<const PositionSnapshot>&
+{
+    // Leer la generación con acquire garantiza ver el snapshot publicado antes que ella
+    const uint64_t generation = generation_.load(std::memory_order_acquire);
+    if (cached_snapshot.generation != generation)
+    {
+        cached_snapshot.snapshot = snapshot_.load(std::memory_order_acquire);
+        cached_snapshot.generation = generation;
+    }
+    return cached_snapshot.snapshot;
+}
+
+auto PositionIndex::devices() const -> std::size_t
+{
+    std::size_t count = 0;
+    for (const Shard& shard : shards_)
+    {
+        const std::lock_guard lock(shard.mutex);
+        count += shard.devices.size();
+    }
+    return count;
+}
+
+void PositionIndex::run()
+{
+    std::unique_lock lock(mutex_);
+    while (!wake_.wait_for(lock, config_.snapshot_interval, [this] { return stopping_; }))
+    {
+        if (updates_.load(std::memory_order_relaxed) == 0)
+        {
+            continue;
+        }
+        lock.unlock();
+        publish();
+        lock.lock();
+    }
+}
+
+}  // namespace cayene::ingest
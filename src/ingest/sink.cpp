@@ -0,0 +1,419 @@
+/**
+ * @file sink.cpp
+ * @brief Double-buffered output sinks flushed with writev/sendmmsg
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/sink.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// Límite de sendmmsg y writev por llamada
+constexpr std::size_t max_batch = UIO_MAXIOV;
+
+auto last_error() -> std::error_code
+{
+    return {errno, std::system_category()};
+}
+
+auto connect_socket(int domain, int type, const sockaddr* address, socklen_t size)
+    -> std::expected<int, std::error_code>
+{
+    const int fd = ::socket(domain, type | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return std::unexpected(last_error());
+    }
+    if (::connect(fd, address, size) < 0)
+    {
+        const auto error = last_error();
+        ::close(fd);
+        return std::unexpected(error);
+    }
+    return fd;
+}
+
+}  // namespace
+
+void OutputSink::Slab::append(std::string_view message, bool newline, std::size_t chunk_size)
+{
+    const std::size_t size = message.size() + (newline ? 1 : 0);
+    auto fits = [size](const Chunk& chunk) { return chunk.capacity - chunk.used >= size; };
+    auto make_chunk = [size, chunk_size]
+    {
+        const std::size_t capacity = std::max(chunk_size, size);
+        return Chunk{std::make_unique_for_overwrite<char[]>(capacity), capacity, 0};
+    };
+
+    // Los mensajes no cruzan chunks: cada uno es un iovec contiguo
+    if (chunks_.empty())
+    {
+        chunks_.push_back(make_chunk());
+    }
+    else if (!fits(chunks_[active_]))
+    {
+        if (chunks_[active_].used != 0)
+        {
+            ++active_;
+        }
+        if (active_ == chunks_.size())
+        {
+            chunks_.push_back(make_chunk());
+        }
+        else if (!fits(chunks_[active_]))
+        {
+            chunks_[active_] = make_chunk();
+        }
+    }
+
+    Chunk& chunk = chunks_[active_];
+    char* destination = chunk.data.get() + chunk.used;
+    std::memcpy(destination, message.data(), message.size());
+    if (newline)
+    {
+        destination[message.size()] = '\n';
+    }
+    chunk.used += size;
+    messages_.push_back({destination, message.size()});
+    bytes_ += size;
+}
+
+void OutputSink::Slab::clear()
+{
+    for (Chunk& chunk : chunks_)
+    {
+        chunk.used = 0;
+    }
+    active_ = 0;
+    messages_.clear();
+    bytes_ = 0;
+}
+
+void OutputSink::Slab::gather_chunks(std::vector<iovec>& out) const
+{
+    out.clear();
+    for (std::size_t i = 0; i < chunks_.size() && i <= active_; ++i)
+    {
+        if (chunks_[i].used != 0)
+        {
+            out.push_back({chunks_[i].data.get(), chunks_[i].used});
+        }
+    }
+}
+
+auto OutputSink::open(std::string_view destination, SinkConfig config)
+    -> std::expected<std::unique_ptr<OutputSink>, std::error_code>
+{
+    if (destination == "stdout")
+    {
+        const int fd = ::fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            return std::unexpected(last_error());
+        }
+        return from_fd(fd, SinkKind::Stream, config);
+    }
+    if (destination.starts_with("unix:"))
+    {
+        return unix_socket(std::string(destination.substr(5)), SinkKind::Stream, config);
+    }
+    if (destination.starts_with("unixgram:"))
+    {
+        return unix_socket(std::string(destination.substr(9)), SinkKind::Datagram, config);
+    }
+    if (destination.starts_with("udp:"))
+    {
+        const std::string_view address = destination.substr(4);
+        const auto colon = address.rfind(':');
+        uint16_t port = 0;
+        if (colon == std::string_view::npos ||
+            std::from_chars(address.data() + colon + 1, address.data() + address.size(), port)
+                    .ec != std::errc{})
+        {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+        return udp(std::string(address.substr(0, colon)), port, config);
+    }
+    return file(std::string(destination), config);
+}
+
+auto OutputSink::file(const std::string& path, SinkConfig config)
+    -> std::expected<std::unique_ptr<OutputSink>, std::error_code>
+{
+    // O_APPEND: varios procesos pueden compartir el fichero sin mezclar líneas de un writev
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return std::unexpected(last_error());
+    }
+    return from_fd(fd, SinkKind::Stream, config);
+}
+
+auto OutputSink::unix_socket(const std::string& path, SinkKind kind, SinkConfig config)
+    -> std::expected<std::unique_ptr<OutputSink>, std::error_code>
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        return std::unexpected(std::make_error_code(std::errc::filename_too_long));
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto fd = connect_socket(AF_UNIX, kind == SinkKind::Stream ? SOCK_STREAM : SOCK_DGRAM,
+                                   reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    if (!fd)
+    {
+        return std::unexpected(fd.error());
+    }
+    return from_fd(*fd, kind, config);
+}
+
+auto OutputSink::udp(const std::string& host, uint16_t port, SinkConfig config)
+    -> std::expected<std::unique_ptr<OutputSink>, std::error_code>
+{
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1)
+    {
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    // Conectado: sendmmsg no necesita dirección por mensaje
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto fd = connect_socket(AF_INET, SOCK_DGRAM,
+                                   reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    if (!fd)
+    {
+        return std::unexpected(fd.error());
+    }
+    return from_fd(*fd, SinkKind::Datagram, config);
+}
+
+auto OutputSink::from_fd(int fd, SinkKind kind, SinkConfig config) -> std::unique_ptr<OutputSink>
+{
+    return std::unique_ptr<OutputSink>(new OutputSink(fd, kind, config));
+}
+
+OutputSink::OutputSink(int fd, SinkKind kind, SinkConfig config)
+    : fd_(fd), kind_(kind), config_(config)
+{
+    struct stat status{};
+    socket_ = ::fstat(fd_, &status) == 0 && S_ISSOCK(status.st_mode);
+    thread_ = std::thread([this] { run(); });
+}
+
+OutputSink::~OutputSink()
+{
+    {
+        const std::lock_guard lock(mutex_);
+        closing_ = true;
+    }
+    flush_wanted_.notify_one();
+    thread_.join();
+    ::close(fd_);
+}
+
+void OutputSink::write(std::string_view message)
+{
+    std::unique_lock lock(mutex_);
+    flush_done_.wait(lock, [this] { return front_.bytes() < config_.max_buffered_bytes; });
+
+    const bool was_empty = front_.empty();
+    if (was_empty)
+    {
+        first_write_ = Clock::now();
+    }
+    front_.append(message, kind_ == SinkKind::Stream, config_.chunk_size);
+    ++written_;
+    ++stats_.messages;
+    stats_.bytes += message.size();
+
+    // El hilo duerme sin plazo con el slab vacío: hay que despertarlo para que arme el timer
+    if (was_empty || front_.bytes() >= config_.flush_bytes)
+    {
+        flush_wanted_.notify_one();
+    }
+}
+
+void OutputSink::flush()
+{
+    std::unique_lock lock(mutex_);
+    const uint64_t target = written_;
+    if (flushed_ >= target)
+    {
+        return;
+    }
+    flush_requested_ = true;
+    flush_wanted_.notify_one();
+    flush_done_.wait(lock, [this, target] { return flushed_ >= target; });
+}
+
+auto OutputSink::stats() const -> SinkStats
+{
+    const std::lock_guard lock(mutex_);
+    return stats_;
+}
+
+void OutputSink::run()
+{
+    std::unique_lock lock(mutex_);
+    while (true)
+    {
+        auto ready = [this]
+        {
+            return closing_ || flush_requested_ || front_.bytes() >= config_.flush_bytes;
+        };
+        if (front_.empty())
+        {
+            flush_wanted_.wait(lock, [&] { return ready() || !front_.empty(); });
+        }
+        else
+        {
+            flush_wanted_.wait_until(lock, first_write_ + config_.flush_interval, ready);
+        }
+
+        if (front_.empty())
+        {
+            flush_requested_ = false;
+            if (closing_)
+            {
+                return;
+            }
+            continue;
+        }
+        if (!ready() && Clock::now() < first_write_ + config_.flush_interval)
+        {
+            continue;
+        }
+
+        // Los productores siguen llenando el otro slab mientras este se escribe
+        std::swap(front_, back_);
+        const uint64_t batch_end = written_;
+        flush_requested_ = false;
+        lock.unlock();
+        flush_done_.notify_all();
+
+        SinkStats delta;
+        if (kind_ == SinkKind::Stream)
+        {
+            write_stream(back_, delta);
+        }
+        else
+        {
+            write_datagrams(back_, delta);
+        }
+        back_.clear();
+
+        lock.lock();
+        flushed_ = batch_end;
+        ++stats_.flushes;
+        stats_.syscalls += delta.syscalls;
+        stats_.errors += delta.errors;
+        flush_done_.notify_all();
+    }
+}
+
+void OutputSink::write_stream(const Slab& slab, SinkStats& delta)
+{
+    slab.gather_chunks(iovecs_);
+    std::size_t next = 0;
+    while (next < iovecs_.size())
+    {
+        const std::size_t count = std::min(iovecs_.size() - next, max_batch);
+        ssize_t written = 0;
+        if (socket_)
+        {
+            msghdr header{};
+            header.msg_iov = iovecs_.data() + next;
+            header.msg_iovlen = count;
+            written = ::sendmsg(fd_, &header, MSG_NOSIGNAL);
+        }
+        else
+        {
+            written = ::writev(fd_, iovecs_.data() + next, static_cast<int>(count));
+        }
+        ++delta.syscalls;
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            // Sin forma de saber qué mensajes llegaron: el slab entero cuenta como perdido
+            delta.errors += slab.message_count();
+            return;
+        }
+
+        // Escritura parcial: avanzar sobre los iovec ya escritos
+        auto remaining = static_cast<std::size_t>(written);
+        while (next < iovecs_.size() && remaining >= iovecs_[next].iov_len)
+        {
+            remaining -= iovecs_[next++].iov_len;
+        }
+        if (remaining != 0)
+        {
+            iovecs_[next].iov_base = static_cast<char*>(iovecs_[next].iov_base) + remaining;
+            iovecs_[next].iov_len -= remaining;
+        }
+    }
+}
+
+void OutputSink::write_datagrams(Slab& slab, SinkStats& delta)
+{
+    std::vector<iovec>& messages = slab.messages();
+    headers_.resize(messages.size());
+    for (std::size_t i = 0; i < messages.size(); ++i)
+    {
+        headers_[i] = mmsghdr{};
+        headers_[i].msg_hdr.msg_iov = &messages[i];
+        headers_[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    std::size_t next = 0;
+    while (next < headers_.size())
+    {
+        const auto count = static_cast<unsigned>(std::min(headers_.size() - next, max_batch));
+        const int sent = ::sendmmsg(fd_, headers_.data() + next, count, MSG_NOSIGNAL);
+        ++delta.syscalls;
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            // El error es del primer mensaje (p. ej. ECONNREFUSED sin receptor UDP): se salta
+            ++delta.errors;
+            ++next;
+            continue;
+        }
+        next += static_cast<std::size_t>(sent);
+    }
+}
+
+}  // namespace cayene::ingest
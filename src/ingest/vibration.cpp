@@ -0,0 +1,255 @@
+/**
+ * @file vibration.cpp
+ * @brief Implementation of the accelerometer vibration statistics
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/vibration.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include <string>
+
+#include "cayene/ingest/perfect_hash.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CAYENE_VIBRATION_AVX2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CAYENE_VIBRATION_NEON 1
+#endif
+
+namespace cayene::ingest
+{
+
+namespace
+{
+
+constexpr double raw_per_g = 1000.0;
+constexpr std::array<const char*, 3> axes = {"x", "y", "z"};
+
+auto axis_stats_scalar(std::span<const int16_t> samples) -> AxisStats
+{
+    AxisStats stats;
+    for (const int16_t sample : samples)
+    {
+        const int32_t value = sample;
+        stats.sum_squares += static_cast<uint64_t>(value * value);
+        stats.peak = std::max(stats.peak, static_cast<uint32_t>(std::abs(value)));
+    }
+    return stats;
+}
+
+#if defined(CAYENE_VIBRATION_AVX2)
+// Compilada para AVX2 aunque el resto no lo esté; solo se llama si la CPU lo tiene
+__attribute__((target("avx2"))) auto axis_stats_avx2(std::span<const int16_t> samples)
+    -> AxisStats
+{
+    __m256i sums = _mm256_setzero_si256();
+    __m256i peaks = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 16 <= samples.size(); i += 16)
+    {
+        const __m256i values =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples.data() + i));
+        // Pares de cuadrados en 32 bits: como mucho 2^31, exactos leídos sin signo
+        const __m256i squares = _mm256_madd_epi16(values, values);
+        sums = _mm256_add_epi64(sums, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(squares)));
+        sums = _mm256_add_epi64(sums, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(squares, 1)));
+        // |-32768| desborda a 0x8000, que sin signo es 32768
+        peaks = _mm256_max_epu16(peaks, _mm256_abs_epi16(values));
+    }
+
+    alignas(32) std::array<uint64_t, 4> lane_sums{};
+    alignas(32) std::array<uint16_t, 16> lane_peaks{};
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lane_sums.data()), sums);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lane_peaks.data()), peaks);
+
+    AxisStats stats = axis_stats_scalar(samples.subspan(i));
+    for (const uint64_t sum : lane_sums)
+    {
+        stats.sum_squares += sum;
+    }
+    stats.peak = std::max<uint32_t>(stats.peak, std::ranges::max(lane_peaks));
+    return stats;
+}
+#elif defined(CAYENE_VIBRATION_NEON)
+auto axis_stats_neon(std::span<const int16_t> samples) -> AxisStats
+{
+    uint64x2_t sums = vdupq_n_u64(0);
+    uint16x8_t peaks = vdupq_n_u16(0);
+    std::size_t i = 0;
+    for (; i + 8 <= samples.size(); i += 8)
+    {
+        const int16x8_t values = vld1q_s16(samples.data() + i);
+        const int32x4_t low = vmull_s16(vget_low_s16(values), vget_low_s16(values));
+        const int32x4_t high = vmull_high_s16(values, values);
+        sums = vpadalq_u32(sums, vreinterpretq_u32_s32(low));
+        sums = vpadalq_u32(sums, vreinterpretq_u32_s32(high));
+        // |-32768| desborda a 0x8000, que sin signo es 32768
+        peaks = vmaxq_u16(peaks, vreinterpretq_u16_s16(vabsq_s16(values)));
+    }
+
+    AxisStats stats = axis_stats_scalar(samples.subspan(i));
+    stats.sum_squares += vaddvq_u64(sums);
+    stats.peak = std::max<uint32_t>(stats.peak, vmaxvq_u16(peaks));
+    return stats;
+}
+#endif
+
+}  // namespace
+
+auto axis_stats(std::span<const int16_t> samples) -> AxisStats
+{
+#if defined(CAYENE_VIBRATION_AVX2)
+    static const bool avx2 = __builtin_cpu_supports("avx2") != 0;
+    return avx2 ? axis_stats_avx2(samples) : axis_stats_scalar(samples);
+#elif defined(CAYENE_VIBRATION_NEON)
+    return axis_stats_neon(samples);
+#else
+    return axis_stats_scalar(samples);
+#endif
+}
+
+VibrationMonitor::VibrationMonitor(VibrationConfig config) : config_(config)
+{
+    config_.window = std::clamp<uint32_t>(config_.window, 1, max_vibration_window);
+    if (config_.hop == 0)
+    {
+        config_.hop = config_.window;
+    }
+}
+
+auto VibrationMonitor::window_features(const Ring& ring) const -> VibrationFeatures
+{
+    VibrationFeatures result{.channel = ring.channel};
+    const std::span<const int16_t> samples(ring.samples);
+    for (std::size_t axis = 0; axis < axes.size(); ++axis)
+    {
+        const AxisStats stats = axis_stats(samples.subspan(axis * config_.window, config_.window));
+        const double rms = std::sqrt(static_cast<double>(stats.sum_squares) / config_.window);
+        result.rms[axis] = rms / raw_per_g;
+        result.peak[axis] = stats.peak / raw_per_g;
+        result.crest[axis] = rms > 0 ? stats.peak / rms : 0.0;
+    }
+    return result;
+}
+
+auto VibrationMonitor::update(std::string_view device_id, std::span<const Reading> readings,
+                              std::vector<VibrationFeatures>& features) -> std::size_t
+{
+    const auto is_sample = [](const Reading& reading)
+    { return reading.type_id == accelerometer_type_id && reading.component_count == 3; };
+    if (std::ranges::none_of(readings, is_sample))
+    {
+        return 0;
+    }
+
+    const uint64_t key = device_key(device_id);
+    Shard& shard = shards_[(key ^ key >> 32U) % shard_count];
+    const std::lock_guard lock(shard.mutex);
+    std::vector<Ring>& rings = shard.devices[key];
+
+    const std::size_t before = features.size();
+    for (const Reading& reading : readings)
+    {
+        if (!is_sample(reading))
+        {
+            continue;
+        }
+        auto ring = std::ranges::find(rings, reading.channel, &Ring::channel);
+        if (ring == rings.end())
+        {
+            rings.push_back({.channel = reading.channel,
+                             .samples = std::vector<int16_t>(3 * std::size_t{config_.window})});
+            ring = std::prev(rings.end());
+        }
+
+        for (std::size_t axis = 0; axis < axes.size(); ++axis)
+        {
+            ring->samples[axis * config_.window + ring->next] =
+                static_cast<int16_t>(reading.raw[axis]);
+        }
+        ring->next = ring->next + 1 == config_.window ? 0 : ring->next + 1;
+        ring->filled = std::min(ring->filled + 1, config_.window);
+        // La ventana completa es todo el búfer: el orden no cambia la suma ni el pico
+        if (++ring->pending >= config_.hop && ring->filled == config_.window)
+        {
+            features.push_back(window_features(*ring));
+            ring->pending = 0;
+        }
+    }
+    return features.size() - before;
+}
+
+auto VibrationMonitor::annotate(const TypeCatalog& catalog, const Uplink& uplink, Json& object)
+    -> std::size_t
+{
+    std::array<Reading, max_payload_readings> readings{};
+    const auto count = catalog.decode_readings(uplink.fport, uplink.payload, readings);
+    if (!count)
+    {
+        return 0;
+    }
+    return annotate(catalog, uplink, std::span(readings).first(*count), object);
+}
+
+auto VibrationMonitor::annotate(const TypeCatalog& catalog, const Uplink& uplink,
+                                std::span<const Reading> readings, Json& object) -> std::size_t
+{
+    // Las muestras quedan en el búfer; la línea lleva solo las ventanas completas
+    const bool standard = catalog.definition(uplink.fport, accelerometer_type_id) == nullptr;
+    if (standard && object.contains("decoded"))
+    {
+        for (const Reading& reading : readings)
+        {
+            if (reading.type_id == accelerometer_type_id)
+            {
+                object["decoded"].erase("Accelerometer_" + std::to_string(reading.channel));
+            }
+        }
+    }
+
+    thread_local std::vector<VibrationFeatures> windows;
+    windows.clear();
+    if (update(uplink.device_id, readings, windows) == 0)
+    {
+        return 0;
+    }
+    const auto per_axis = [](const std::array<double, 3>& values)
+    {
+        Json axis_values = Json::object();
+        for (std::size_t axis = 0; axis < axes.size(); ++axis)
+        {
+            axis_values[axes[axis]] = values[axis];
+        }
+        return axis_values;
+    };
+    Json& list = object["vibration"];
+    for (const VibrationFeatures& window : windows)
+    {
+        list.push_back({{"channel", window.channel},
+                        {"rms", per_axis(window.rms)},
+                        {"peak", per_axis(window.peak)},
+                        {"crest", per_axis(window.crest)}});
+    }
+    return windows.size();
+}
+
+auto VibrationMonitor::devices() const -> std::size_t
+{
+    std::size_t count = 0;
+    for (const Shard& shard : shards_)
+    {
+        const std::lock_guard lock(shard.mutex);
+        count += shard.devices.size();
+    }
+    return count;
+}
+
+}  // namespace cayene::ingest
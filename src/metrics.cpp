@@ -0,0 +1,213 @@
+/**
+ * @file metrics.cpp
+ * @brief Shard registry and snapshot aggregation for decoder metrics
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/metrics.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+#include <time.h>
+
+namespace cayene::metrics
+{
+
+namespace
+{
+
+class ShardRegistry
+{
+public:
+    auto acquire() -> Shard*
+    {
+        std::scoped_lock lock(mutex_);
+        if (!free_.empty())
+        {
+            Shard* shard = free_.back();
+            free_.pop_back();
+            return shard;
+        }
+        // std::deque no invalida punteros al crecer por el final
+        return &shards_.emplace_back();
+    }
+
+    void release(Shard* shard)
+    {
+        std::scoped_lock lock(mutex_);
+        free_.push_back(shard);
+    }
+
+    auto aggregate() -> Snapshot
+    {
+        const double ns_per_tick = Clock::ns_per_tick();
+        uint64_t latency_ticks_total = 0;
+
+        Snapshot result;
+        std::scoped_lock lock(mutex_);
+        for (const Shard& shard : shards_)
+        {
+            result.decode_calls += shard.decode_calls.load(std::memory_order_relaxed);
+            result.bytes_processed += shard.bytes_processed.load(std::memory_order_relaxed);
+            latency_ticks_total += shard.latency_ticks_total.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < type_id_count; ++i)
+            {
+                result.fields_by_type[i] += shard.fields_by_type[i].load(std::memory_order_relaxed);
+            }
+            for (std::size_t i = 0; i < error_code_count; ++i)
+            {
+                result.errors_by_code[i] += shard.errors_by_code[i].load(std::memory_order_relaxed);
+            }
+            for (std::size_t i = 0; i < payload_size_bucket_count; ++i)
+            {
+                result.payload_size_histogram[i] +=
+                    shard.payload_size_histogram[i].load(std::memory_order_relaxed);
+            }
+            for (std::size_t stage = 0; stage < stage_count; ++stage)
+            {
+                add_converted(result.stage_latency_ns[stage], shard.stage_latency_ticks[stage],
+                              ns_per_tick);
+            }
+        }
+        result.latency_ns_total = to_ns(latency_ticks_total, ns_per_tick);
+        result.latency_ns_max = result.latency(Stage::Decode).max();
+        return result;
+    }
+
+private:
+    static auto to_ns(uint64_t ticks, double ns_per_tick) -> uint64_t
+    {
+        return static_cast<uint64_t>(static_cast<double>(ticks) * ns_per_tick);
+    }
+
+    // Re-buckets a tick histogram into nanoseconds using each bucket's midpoint
+    static void add_converted(Histogram& out, const AtomicHistogram& ticks, double ns_per_tick)
+    {
+        for (std::size_t i = 0; i < histogram_bucket_count; ++i)
+        {
+            const uint64_t count = ticks.bucket(i);
+            if (count == 0)
+            {
+                continue;
+            }
+            const uint64_t lower = histogram_bucket_lower(i);
+            const uint64_t midpoint = lower + (histogram_bucket_upper(i) - lower) / 2;
+            out.record(to_ns(midpoint, ns_per_tick), count);
+        }
+        // El máximo se conserva exacto, no el punto medio de su bucket
+        out.record_max(to_ns(ticks.max(), ns_per_tick));
+    }
+
+    std::mutex mutex_;
+    std::deque<Shard> shards_;
+    std::vector<Shard*> free_;
+};
+
+auto registry() -> ShardRegistry&
+{
+    // Never destroyed: thread_local handles may release shards during static teardown
+    static auto* instance = new ShardRegistry();
+    return *instance;
+}
+
+auto monotonic_ns() -> uint64_t
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000U + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+auto calibrate_ns_per_tick() -> double
+{
+#ifdef CAYENE_METRICS_USE_TSC
+    // Cuenta ticks durante ~5 ms de reloj monotónico
+    constexpr uint64_t window_ns = 5'000'000;
+    const uint64_t ns_start = monotonic_ns();
+    const uint64_t ticks_start = Clock::now();
+    uint64_t ns_end = ns_start;
+    while (ns_end - ns_start < window_ns)
+    {
+        ns_end = monotonic_ns();
+    }
+    const uint64_t ticks_end = Clock::now();
+    if (ticks_end <= ticks_start)
+    {
+        return 1.0;
+    }
+    return static_cast<double>(ns_end - ns_start) / static_cast<double>(ticks_end - ticks_start);
+#else
+    return 1.0;
+#endif
+}
+
+}  // namespace
+
+auto Clock::ns_per_tick() -> double
+{
+    static const double value = calibrate_ns_per_tick();
+    return value;
+}
+
+auto stage_name(Stage stage) -> std::string_view
+{
+    switch (stage)
+    {
+        case Stage::Decode:
+            return "decode";
+        case Stage::Key:
+            return "key";
+        case Stage::Serialize:
+            return "serialize";
+    }
+    return "unknown";
+}
+
+auto latency_report(const Snapshot& snap) -> std::string
+{
+    std::string report;
+    for (std::size_t i = 0; i < stage_count; ++i)
+    {
+        const auto stage = static_cast<Stage>(i);
+        const Histogram& histogram = snap.latency(stage);
+        report += std::format(
+            "stage={} count={} p50_ns={} p90_ns={} p99_ns={} p999_ns={} max_ns={}\n",
+            stage_name(stage), histogram.count(), histogram.percentile(0.5),
+            histogram.percentile(0.9), histogram.percentile(0.99), histogram.percentile(0.999),
+            histogram.max());
+    }
+    return report;
+}
+
+auto Snapshot::fields_total() const -> uint64_t
+{
+    return std::accumulate(fields_by_type.begin(), fields_by_type.end(), uint64_t{0});
+}
+
+auto Snapshot::errors_total() const -> uint64_t
+{
+    return std::accumulate(errors_by_code.begin(), errors_by_code.end(), uint64_t{0});
+}
+
+auto acquire_shard() -> Shard*
+{
+    return registry().acquire();
+}
+
+void release_shard(Shard* shard)
+{
+    registry().release(shard);
+}
+
+auto snapshot() -> Snapshot
+{
+    return registry().aggregate();
+}
+
+}  // namespace cayene::metrics
@@ -0,0 +1,35 @@
+#ifndef CAYENE_PROBES_HPP
+#define CAYENE_PROBES_HPP
+
+/**
+ * @file probes.hpp
+ * @brief USDT static tracepoints for the decode path
+ *
+ * With CAYENE_ENABLE_USDT and <sys/sdt.h> available (systemtap-sdt-dev) every
+ * probe is a single nop plus an ELF note, patched into a trap only while a
+ * tracer such as bpftrace is attached. Otherwise the macros expand to nothing
+ * and their arguments are not evaluated.
+ *
+ * Provider: cayene
+ *   decode__entry  (payload pointer, payload length)
+ *   decode__return (payload length, error code, field count)
+ *   decode__field  (channel, type id, field size, byte offset)
+ *   decode__error  (error code, byte offset, type id)
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#if defined(CAYENE_ENABLE_USDT) && __has_include(<sys/sdt.h>)
+    #include <sys/sdt.h>
+
+    #define CAYENE_PROBE2(name, a1, a2) DTRACE_PROBE2(cayene, name, a1, a2)
+    #define CAYENE_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(cayene, name, a1, a2, a3)
+    #define CAYENE_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(cayene, name, a1, a2, a3, a4)
+#else
+    #define CAYENE_PROBE2(name, a1, a2)
+    #define CAYENE_PROBE3(name, a1, a2, a3)
+    #define CAYENE_PROBE4(name, a1, a2, a3, a4)
+#endif
+
+#endif  // CAYENE_PROBES_HPP
@@ -0,0 +1,296 @@
+/**
+ * @file prometheus.cpp
+ * @brief Prometheus rendering and the embedded scrape endpoint
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/prometheus.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <string_view>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "cayene_v1_defintions.hpp"
+
+namespace cayene::metrics
+{
+
+namespace
+{
+
+// Bucket edges for the stage latency histograms, in nanoseconds
+constexpr std::array<uint64_t, 14> latency_edges_ns = {
+    100,     250,     500,       1'000,     2'500,     5'000,      10'000,
+    25'000,  50'000,  100'000,   250'000,   1'000'000, 10'000'000, 100'000'000};
+
+constexpr int poll_interval_ms = 100;
+constexpr std::size_t max_request_size = 8192;
+
+auto type_names() -> const std::array<std::string, type_id_count>&
+{
+    static const auto names = []
+    {
+        std::array<std::string, type_id_count> result{};
+        for (const auto& data_type : definitions::get_v1_standard_data_types())
+        {
+            result[data_type.type_id] = data_type.name;
+        }
+        return result;
+    }();
+    return names;
+}
+
+void append_header(std::string& out, std::string_view name, std::string_view type,
+                   std::string_view help)
+{
+    out += std::format("# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+}
+
+auto seconds(uint64_t nanoseconds) -> double
+{
+    return static_cast<double>(nanoseconds) / 1e9;
+}
+
+// Samples in HDR buckets lying entirely at or below edge. A bucket straddling the
+// edge is left for the next one, which is within the ~3% bucket resolution.
+auto count_at_or_below(const Histogram& histogram, uint64_t edge) -> uint64_t
+{
+    uint64_t total = 0;
+    for (std::size_t i = 0; i < histogram_bucket_count && histogram_bucket_upper(i) <= edge; ++i)
+    {
+        total += histogram.bucket(i);
+    }
+    return total;
+}
+
+auto write_all(int fd, std::string_view data) -> bool
+{
+    while (!data.empty())
+    {
+        const ssize_t written = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+    }
+    return true;
+}
+
+auto http_response(std::string_view status, std::string_view content_type, std::string_view body)
+    -> std::string
+{
+    return std::format(
+        "HTTP/1.0 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}",
+        status, content_type, body.size(), body);
+}
+
+}  // namespace
+
+auto render_prometheus(const Snapshot& snap) -> std::string
+{
+    std::string out;
+    out.reserve(4096);
+
+    append_header(out, "cayene_decode_calls_total", "counter", "Decode calls, Json and readings.");
+    out += std::format("cayene_decode_calls_total {}\n", snap.decode_calls);
+
+    append_header(out, "cayene_decode_bytes_total", "counter", "Payload bytes passed to decode.");
+    out += std::format("cayene_decode_bytes_total {}\n", snap.bytes_processed);
+
+    append_header(out, "cayene_decoded_fields_total", "counter", "Decoded fields by type id.");
+    const auto& names = type_names();
+    for (std::size_t type_id = 0; type_id < type_id_count; ++type_id)
+    {
+        if (snap.fields_by_type[type_id] == 0)
+        {
+            continue;
+        }
+        // Los tipos propios no tienen nombre aquí: sin etiqueta name mejor que vacía
+        if (names[type_id].empty())
+        {
+            out += std::format("cayene_decoded_fields_total{{type_id=\"0x{:02x}\"}} {}\n",
+                               type_id, snap.fields_by_type[type_id]);
+        }
+        else
+        {
+            out += std::format(
+                "cayene_decoded_fields_total{{type_id=\"0x{:02x}\",name=\"{}\"}} {}\n", type_id,
+                names[type_id], snap.fields_by_type[type_id]);
+        }
+    }
+
+    append_header(out, "cayene_decode_errors_total", "counter", "Failed decodes by error code.");
+    for (std::size_t code = 1; code < error_code_count; ++code)
+    {
+        out += std::format("cayene_decode_errors_total{{code=\"{}\"}} {}\n",
+                           error_name(static_cast<Error>(code)), snap.errors_by_code[code]);
+    }
+
+    append_header(out, "cayene_payload_size_bytes", "histogram", "Payload size per decode call.");
+    uint64_t cumulative = 0;
+    for (std::size_t i = 0; i + 1 < payload_size_bucket_count; ++i)
+    {
+        cumulative += snap.payload_size_histogram[i];
+        out += std::format("cayene_payload_size_bytes_bucket{{le=\"{}\"}} {}\n",
+                           (std::size_t{1} << i) - 1, cumulative);
+    }
+    out += std::format("cayene_payload_size_bytes_bucket{{le=\"+Inf\"}} {}\n", snap.decode_calls);
+    out += std::format("cayene_payload_size_bytes_sum {}\n", snap.bytes_processed);
+    out += std::format("cayene_payload_size_bytes_count {}\n", snap.decode_calls);
+
+    append_header(out, "cayene_decode_stage_seconds", "histogram",
+                  "Latency of each decode stage.");
+    for (std::size_t i = 0; i < stage_count; ++i)
+    {
+        const auto stage = static_cast<Stage>(i);
+        const Histogram& histogram = snap.latency(stage);
+        for (uint64_t edge : latency_edges_ns)
+        {
+            out += std::format("cayene_decode_stage_seconds_bucket{{stage=\"{}\",le=\"{}\"}} {}\n",
+                               stage_name(stage), seconds(edge),
+                               count_at_or_below(histogram, edge));
+        }
+        out += std::format("cayene_decode_stage_seconds_bucket{{stage=\"{}\",le=\"+Inf\"}} {}\n",
+                           stage_name(stage), histogram.count());
+        out += std::format("cayene_decode_stage_seconds_sum{{stage=\"{}\"}} {}\n",
+                           stage_name(stage), seconds(histogram.sum()));
+        out += std::format("cayene_decode_stage_seconds_count{{stage=\"{}\"}} {}\n",
+                           stage_name(stage), histogram.count());
+    }
+
+    return out;
+}
+
+PrometheusExporter::PrometheusExporter(uint16_t port, std::string bind_address)
+    : port_(port), bind_address_(std::move(bind_address))
+{
+}
+
+PrometheusExporter::~PrometheusExporter()
+{
+    stop();
+}
+
+auto PrometheusExporter::start() -> std::expected<uint16_t, std::error_code>
+{
+    if (running_.load())
+    {
+        return port_;
+    }
+
+    const auto last_error = [] { return std::error_code(errno, std::system_category()); };
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port_);
+    if (::inet_pton(AF_INET, bind_address_.c_str(), &address.sin_addr) != 1)
+    {
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0)
+    {
+        return std::unexpected(last_error());
+    }
+
+    int reuse = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    auto* generic_address = reinterpret_cast<sockaddr*>(&address);
+    socklen_t address_size = sizeof(address);
+    if (::bind(listen_fd_, generic_address, address_size) < 0 || ::listen(listen_fd_, 16) < 0 ||
+        ::getsockname(listen_fd_, generic_address, &address_size) < 0)
+    {
+        const auto error = last_error();
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return std::unexpected(error);
+    }
+
+    port_ = ntohs(address.sin_port);
+    running_.store(true);
+    thread_ = std::thread([this] { serve(); });
+    return port_;
+}
+
+void PrometheusExporter::stop()
+{
+    if (!running_.exchange(false))
+    {
+        return;
+    }
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+}
+
+void PrometheusExporter::serve()
+{
+    pollfd listener{.fd = listen_fd_, .events = POLLIN, .revents = 0};
+    while (running_.load())
+    {
+        // Timeout corto para que stop() no tenga que despertar al hilo
+        if (::poll(&listener, 1, poll_interval_ms) <= 0)
+        {
+            continue;
+        }
+        const int client_fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client_fd < 0)
+        {
+            continue;
+        }
+        handle_connection(client_fd);
+        ::close(client_fd);
+    }
+}
+
+void PrometheusExporter::handle_connection(int client_fd)
+{
+    timeval timeout{.tv_sec = 1, .tv_usec = 0};
+    ::setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    std::array<char, 1024> buffer{};
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < max_request_size)
+    {
+        const ssize_t received = ::recv(client_fd, buffer.data(), buffer.size(), 0);
+        if (received <= 0)
+        {
+            return;
+        }
+        request.append(buffer.data(), static_cast<std::size_t>(received));
+    }
+
+    const std::string_view request_line =
+        std::string_view(request).substr(0, request.find("\r\n"));
+    if (request_line.starts_with("GET /metrics ") || request_line == "GET /metrics")
+    {
+        write_all(client_fd, http_response("200 OK", "text/plain; version=0.0.4; charset=utf-8",
+                                           render_prometheus(snapshot())));
+        return;
+    }
+    write_all(client_fd, http_response("404 Not Found", "text/plain", "not found\n"));
+}
+
+}  // namespace cayene::metrics
@@ -0,0 +1,491 @@
+/**
+ * @file registry.cpp
+ * @brief Serialization, validation and mapping of registry images
+ *
+ * Image layout, every offset from the start of the image:
+ *
+ *   ImageHeader
+ *   TenantRecord[tenant_count]          sorted by tenant id
+ *   per tenant, 8-byte aligned:
+ *     TypeTable                         sizes[256], standard[256], units[256]
+ *     NameRecord[256]                   into the string pool
+ *   string pool                         tenant ids and type names, deduplicated
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/registry.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cayene
+{
+
+namespace
+{
+
+constexpr std::array<char, 8> registry_magic = {'C', 'A', 'Y', 'R', 'E', 'G', '\0', '\0'};
+constexpr uint32_t byte_order_mark = 0x01020304;
+
+struct ImageHeader
+{
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t image_size;
+    uint32_t tenant_count;
+    uint32_t directory_offset;
+    uint32_t strings_offset;
+    uint32_t strings_size;
+    uint32_t reserved;
+};
+
+struct TenantRecord
+{
+    uint32_t id_offset;
+    uint32_t id_length;
+    uint32_t table_offset;
+    uint32_t names_offset;
+};
+
+struct NameRecord
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+constexpr std::size_t names_size = sizeof(NameRecord) * type_table_size;
+
+// La imagen incrusta TypeTable tal cual: tamaños, flags estándar y unidades de los prefijados
+static_assert(std::is_trivially_copyable_v<TypeTable> && std::is_standard_layout_v<TypeTable>);
+static_assert(sizeof(TypeTable) == 3 * type_table_size && alignof(TypeTable) == 1);
+static_assert(sizeof(bool) == 1);
+
+constexpr auto align8(std::size_t offset) -> std::size_t
+{
+    return (offset + 7) & ~std::size_t{7};
+}
+
+template <typename T>
+auto load(std::span<const std::byte> image, std::size_t offset) -> T
+{
+    T value;
+    std::memcpy(&value, image.data() + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void store(std::vector<std::byte>& image, std::size_t offset, const T& value)
+{
+    std::memcpy(image.data() + offset, &value, sizeof(T));
+}
+
+auto fits(std::size_t offset, std::size_t length, std::size_t size) -> bool
+{
+    return offset <= size && length <= size - offset;
+}
+
+// Tipo estándar con el tamaño esperado: read_raw confía en ese ancho
+auto standard_size(uint8_t type_id) -> std::size_t
+{
+    for (const auto& type : v1_standard_types)
+    {
+        if (type.type_id == type_id)
+        {
+            return type.size;
+        }
+    }
+    return 0;
+}
+
+auto validate_tenant(std::span<const std::byte> image, const TenantRecord& record,
+                     std::size_t strings_size) -> bool
+{
+    if (record.table_offset % 8 != 0 || record.names_offset % 8 != 0 ||
+        !fits(record.table_offset, sizeof(TypeTable), image.size()) ||
+        !fits(record.names_offset, names_size, image.size()) ||
+        !fits(record.id_offset, record.id_length, strings_size))
+    {
+        return false;
+    }
+
+    const std::byte* sizes = image.data() + record.table_offset;
+    const std::byte* standard = sizes + type_table_size;
+    const std::byte* units = standard + type_table_size;
+    for (std::size_t type_id = 0; type_id < type_table_size; ++type_id)
+    {
+        const auto size = static_cast<std::size_t>(sizes[type_id]);
+        const auto flag = static_cast<uint8_t>(standard[type_id]);
+        const auto unit = static_cast<std::size_t>(units[type_id]);
+        // Un flag estándar exige un tipo estándar y su tamaño real, nunca 0
+        const std::size_t expected = standard_size(static_cast<uint8_t>(type_id));
+        if (flag > 1 || (flag == 1 && (expected == 0 || size != expected)))
+        {
+            return false;
+        }
+        // Un tipo es de tamaño fijo o prefijado, nunca las dos cosas ni estándar y prefijado
+        if (unit != 0 && (size != 0 || flag == 1))
+        {
+            return false;
+        }
+
+        const auto name =
+            load<NameRecord>(image, record.names_offset + type_id * sizeof(NameRecord));
+        const bool defined = size != 0 || unit != 0;
+        if (!fits(name.offset, name.length, strings_size) || defined != (name.length != 0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+auto tenant_id(std::span<const std::byte> image, const ImageHeader& header,
+               const TenantRecord& record) -> std::string_view
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto* strings = reinterpret_cast<const char*>(image.data()) + header.strings_offset;
+    return {strings + record.id_offset, record.id_length};
+}
+
+}  // namespace
+
+auto TenantView::name(uint8_t type_id) const -> std::string_view
+{
+    NameRecord record;
+    std::memcpy(&record, names_ + type_id * sizeof(NameRecord), sizeof(record));
+    return strings_.substr(record.offset, record.length);
+}
+
+auto RegistryView::from_bytes(std::span<const std::byte> image)
+    -> std::expected<RegistryView, RegistryError>
+{
+    if (image.size() < sizeof(ImageHeader))
+    {
+        return std::unexpected(RegistryError::Truncated);
+    }
+
+    const auto header = load<ImageHeader>(image, 0);
+    if (header.magic != registry_magic)
+    {
+        return std::unexpected(RegistryError::BadMagic);
+    }
+    if (header.byte_order != byte_order_mark)
+    {
+        return std::unexpected(header.byte_order == std::byteswap(byte_order_mark)
+                                   ? RegistryError::ForeignByteOrder
+                                   : RegistryError::Corrupt);
+    }
+    if (header.version != registry_format_version)
+    {
+        return std::unexpected(RegistryError::UnsupportedVersion);
+    }
+    if (header.image_size != image.size())
+    {
+        return std::unexpected(header.image_size > image.size() ? RegistryError::Truncated
+                                                                : RegistryError::Corrupt);
+    }
+    if (!fits(header.directory_offset,
+              static_cast<std::size_t>(header.tenant_count) * sizeof(TenantRecord),
+              image.size()) ||
+        !fits(header.strings_offset, header.strings_size, image.size()))
+    {
+        return std::unexpected(RegistryError::Corrupt);
+    }
+
+    std::string_view previous_id;
+    for (std::size_t i = 0; i < header.tenant_count; ++i)
+    {
+        const auto record =
+            load<TenantRecord>(image, header.directory_offset + i * sizeof(TenantRecord));
+        if (!validate_tenant(image, record, header.strings_size))
+        {
+            return std::unexpected(RegistryError::Corrupt);
+        }
+
+        // El directorio debe estar ordenado y sin duplicados para la búsqueda binaria
+        const std::string_view id = tenant_id(image, header, record);
+        if (i > 0 && id <= previous_id)
+        {
+            return std::unexpected(RegistryError::Corrupt);
+        }
+        previous_id = id;
+    }
+
+    return RegistryView(image, header.tenant_count);
+}
+
+auto RegistryView::tenant(std::size_t index) const -> TenantView
+{
+    const auto header = load<ImageHeader>(image_, 0);
+    const auto record =
+        load<TenantRecord>(image_, header.directory_offset + index * sizeof(TenantRecord));
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto* types = std::launder(
+        reinterpret_cast<const TypeTable*>(image_.data() + record.table_offset));
+    const std::string_view strings(
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        reinterpret_cast<const char*>(image_.data()) + header.strings_offset, header.strings_size);
+
+    return {tenant_id(image_, header, record), types, image_.data() + record.names_offset,
+            strings};
+}
+
+auto RegistryView::find(std::string_view tenant_id) const -> std::optional<TenantView>
+{
+    std::size_t low = 0;
+    std::size_t high = tenant_count_;
+    while (low < high)
+    {
+        const std::size_t middle = low + (high - low) / 2;
+        const TenantView candidate = tenant(middle);
+        if (candidate.id() == tenant_id)
+        {
+            return candidate;
+        }
+        if (candidate.id() < tenant_id)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return std::nullopt;
+}
+
+auto MappedRegistry::open(const std::string& path) -> std::expected<MappedRegistry, RegistryError>
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return std::unexpected(RegistryError::Io);
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return std::unexpected(RegistryError::Io);
+    }
+
+    const auto size = static_cast<std::size_t>(info.st_size);
+    if (size < sizeof(ImageHeader))
+    {
+        ::close(fd);
+        return std::unexpected(RegistryError::Truncated);
+    }
+
+    // MAP_SHARED y solo lectura: todos los procesos comparten las mismas páginas
+    void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED)
+    {
+        return std::unexpected(RegistryError::Io);
+    }
+
+    auto view = RegistryView::from_bytes({static_cast<const std::byte*>(address), size});
+    if (!view)
+    {
+        munmap(address, size);
+        return std::unexpected(view.error());
+    }
+
+    return MappedRegistry(address, size, *view);
+}
+
+MappedRegistry::MappedRegistry(MappedRegistry&& other) noexcept
+    : address_(std::exchange(other.address_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      view_(other.view_)
+{
+}
+
+MappedRegistry& MappedRegistry::operator=(MappedRegistry&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (address_ != nullptr)
+        {
+            munmap(address_, size_);
+        }
+        address_ = std::exchange(other.address_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        view_ = other.view_;
+    }
+    return *this;
+}
+
+MappedRegistry::~MappedRegistry()
+{
+    if (address_ != nullptr)
+    {
+        munmap(address_, size_);
+    }
+}
+
+auto RegistryBuilder::add_tenant(std::string_view tenant_id) -> std::expected<void, RegistryError>
+{
+    if (tenants_.contains(tenant_id))
+    {
+        return std::unexpected(RegistryError::TenantExists);
+    }
+
+    Tenant tenant{TypeTable::standard(), {}};
+    for (const auto& type : v1_standard_types)
+    {
+        tenant.names.emplace(type.type_id, type.name);
+    }
+    tenants_.emplace(std::string(tenant_id), std::move(tenant));
+    return {};
+}
+
+auto RegistryBuilder::add_type(std::string_view tenant_id, uint8_t type_id, std::string_view name,
+                               std::size_t size) -> std::expected<void, RegistryError>
+{
+    const auto found = tenants_.find(tenant_id);
+    if (found == tenants_.end())
+    {
+        return std::unexpected(RegistryError::UnknownTenant);
+    }
+
+    Tenant& tenant = found->second;
+    if (name.empty() || !tenant.types.add(type_id, size))
+    {
+        return std::unexpected(RegistryError::InvalidType);
+    }
+    tenant.names.emplace(type_id, name);
+    return {};
+}
+
+auto RegistryBuilder::add_prefixed_type(std::string_view tenant_id, uint8_t type_id,
+                                        std::string_view name, std::size_t unit)
+    -> std::expected<void, RegistryError>
+{
+    const auto found = tenants_.find(tenant_id);
+    if (found == tenants_.end())
+    {
+        return std::unexpected(RegistryError::UnknownTenant);
+    }
+
+    Tenant& tenant = found->second;
+    if (name.empty() || !tenant.types.add_prefixed(type_id, unit))
+    {
+        return std::unexpected(RegistryError::InvalidType);
+    }
+    tenant.names.emplace(type_id, name);
+    return {};
+}
+
+auto RegistryBuilder::serialize() const -> std::vector<std::byte>
+{
+    // Pool de cadenas deduplicado: los nombres estándar se guardan una sola vez
+    std::string strings;
+    std::unordered_map<std::string_view, uint32_t> interned;
+    auto intern = [&](std::string_view text) -> NameRecord
+    {
+        const auto found = interned.find(text);
+        if (found != interned.end())
+        {
+            return {found->second, static_cast<uint32_t>(text.size())};
+        }
+        const auto offset = static_cast<uint32_t>(strings.size());
+        strings.append(text);
+        interned.emplace(text, offset);
+        return {offset, static_cast<uint32_t>(text.size())};
+    };
+
+    const std::size_t directory_offset = sizeof(ImageHeader);
+    const std::size_t tables_offset =
+        align8(directory_offset + tenants_.size() * sizeof(TenantRecord));
+    const std::size_t tenant_stride = align8(sizeof(TypeTable)) + names_size;
+    const std::size_t strings_offset = tables_offset + tenants_.size() * tenant_stride;
+
+    std::vector<std::byte> image(strings_offset);
+    std::size_t index = 0;
+    for (const auto& [id, tenant] : tenants_)
+    {
+        const std::size_t table_offset = tables_offset + index * tenant_stride;
+        const std::size_t names_offset = table_offset + align8(sizeof(TypeTable));
+
+        const NameRecord id_record = intern(id);
+        store(image, directory_offset + index * sizeof(TenantRecord),
+              TenantRecord{id_record.offset, id_record.length,
+                           static_cast<uint32_t>(table_offset),
+                           static_cast<uint32_t>(names_offset)});
+        store(image, table_offset, tenant.types);
+        for (const auto& [type_id, name] : tenant.names)
+        {
+            store(image, names_offset + type_id * sizeof(NameRecord), intern(name));
+        }
+        ++index;
+    }
+
+    image.resize(strings_offset + strings.size());
+    std::memcpy(image.data() + strings_offset, strings.data(), strings.size());
+
+    ImageHeader header{};
+    header.magic = registry_magic;
+    header.version = registry_format_version;
+    header.byte_order = byte_order_mark;
+    header.image_size = static_cast<uint32_t>(image.size());
+    header.tenant_count = static_cast<uint32_t>(tenants_.size());
+    header.directory_offset = static_cast<uint32_t>(directory_offset);
+    header.strings_offset = static_cast<uint32_t>(strings_offset);
+    header.strings_size = static_cast<uint32_t>(strings.size());
+    store(image, 0, header);
+
+    return image;
+}
+
+auto RegistryBuilder::write(const std::string& path) const -> std::expected<void, RegistryError>
+{
+    const std::vector<std::byte> image = serialize();
+    const std::string temporary = path + ".tmp";
+
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return std::unexpected(RegistryError::Io);
+    }
+
+    std::size_t written = 0;
+    while (written < image.size())
+    {
+        const ssize_t result = ::write(fd, image.data() + written, image.size() - written);
+        if (result < 0)
+        {
+            ::close(fd);
+            ::unlink(temporary.c_str());
+            return std::unexpected(RegistryError::Io);
+        }
+        written += static_cast<std::size_t>(result);
+    }
+
+    const bool synced = fsync(fd) == 0;
+    // rename() es atómico: los lectores ven la imagen vieja o la nueva, nunca una mezcla
+    if (::close(fd) != 0 || !synced || std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        ::unlink(temporary.c_str());
+        return std::unexpected(RegistryError::Io);
+    }
+    return {};
+}
+
+}  // namespace cayene
@@ -0,0 +1,447 @@
+/**
+ * @file type_config.cpp
+ * @brief Parsing, validation and compilation of type definition files
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/type_config.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+
+namespace cayene
+{
+
+namespace
+{
+
+struct FormatName
+{
+    std::string_view name;
+    FieldFormat format;
+    bool is_signed;
+};
+
+constexpr std::array<FormatName, 8> format_names = {{
+    {"u8", FieldFormat::U8, false},
+    {"i8", FieldFormat::I8, true},
+    {"u16", FieldFormat::U16, false},
+    {"i16", FieldFormat::I16, true},
+    {"u24", FieldFormat::U24, false},
+    {"i24", FieldFormat::I24, true},
+    {"u32", FieldFormat::U32, false},
+    {"i32", FieldFormat::I32, true},
+}};
+
+auto is_signed(FieldFormat format) -> bool
+{
+    return format_names[static_cast<std::size_t>(format)].is_signed;
+}
+
+auto invalid(std::string message) -> std::unexpected<ConfigError>
+{
+    return std::unexpected(ConfigError{ConfigErrorCode::Invalid, std::move(message)});
+}
+
+// Entero 0-255 o cadena "0xNN"
+auto parse_byte(const Json& value) -> std::optional<uint8_t>
+{
+    if (value.is_number_unsigned() && value.get<uint64_t>() <= 0xFF)
+    {
+        return static_cast<uint8_t>(value.get<uint64_t>());
+    }
+    if (value.is_string())
+    {
+        const auto& text = value.get_ref<const std::string&>();
+        if (text.size() > 2 && text.size() <= 4 && text[0] == '0' &&
+            (text[1] == 'x' || text[1] == 'X'))
+        {
+            unsigned parsed = 0;
+            for (char digit : std::string_view(text).substr(2))
+            {
+                const int nibble = std::isdigit(static_cast<unsigned char>(digit))
+                                       ? digit - '0'
+                                       : std::tolower(static_cast<unsigned char>(digit)) - 'a' + 10;
+                if (nibble < 0 || nibble > 15)
+                {
+                    return std::nullopt;
+                }
+                parsed = parsed * 16 + static_cast<unsigned>(nibble);
+            }
+            return static_cast<uint8_t>(parsed);
+        }
+    }
+    return std::nullopt;
+}
+
+auto parse_field(const Json& value, const std::string& where)
+    -> std::expected<FieldLayout, ConfigError>
+{
+    if (!value.is_object())
+    {
+        return invalid(where + ": field must be an object");
+    }
+
+    FieldLayout field;
+    const auto name = value.find("name");
+    if (name == value.end() || !name->is_string() || name->get_ref<const std::string&>().empty())
+    {
+        return invalid(where + ": field needs a non-empty name");
+    }
+    field.name = name->get<std::string>();
+
+    const auto format = value.find("format");
+    if (format == value.end() || !format->is_string())
+    {
+        return invalid(where + ": field needs a format");
+    }
+    bool known = false;
+    for (const auto& candidate : format_names)
+    {
+        if (candidate.name == format->get_ref<const std::string&>())
+        {
+            field.format = candidate.format;
+            known = true;
+        }
+    }
+    if (!known)
+    {
+        return invalid(
+            std::format("{}: unknown format '{}'", where, format->get_ref<const std::string&>()));
+    }
+
+    if (const auto scale = value.find("scale"); scale != value.end())
+    {
+        if (!scale->is_number() || scale->get<double>() <= 0.0)
+        {
+            return invalid(where + ": scale must be a positive number");
+        }
+        field.scale = scale->get<double>();
+    }
+    return field;
+}
+
+auto parse_type(const Json& value, const std::string& where)
+    -> std::expected<TypeDefinition, ConfigError>
+{
+    if (!value.is_object())
+    {
+        return invalid(where + ": type must be an object");
+    }
+
+    TypeDefinition definition;
+    const auto type_id = value.find("type_id");
+    const auto parsed_id = type_id == value.end() ? std::nullopt : parse_byte(*type_id);
+    if (!parsed_id)
+    {
+        return invalid(where + ": type_id must be 0-255 or \"0xNN\"");
+    }
+    definition.type_id = *parsed_id;
+
+    const auto name = value.find("name");
+    if (name == value.end() || !name->is_string() || name->get_ref<const std::string&>().empty())
+    {
+        return invalid(where + ": type needs a non-empty name");
+    }
+    definition.name = name->get<std::string>();
+
+    if (const auto fields = value.find("fields"); fields != value.end())
+    {
+        if (!fields->is_array() || fields->empty())
+        {
+            return invalid(where + ": fields must be a non-empty array");
+        }
+        std::unordered_set<std::string> names;
+        for (std::size_t i = 0; i < fields->size(); ++i)
+        {
+            auto field = parse_field((*fields)[i], std::format("{}.fields[{}]", where, i));
+            if (!field)
+            {
+                return std::unexpected(field.error());
+            }
+            if (!names.insert(field->name).second)
+            {
+                return invalid(std::format("{}.fields[{}]: duplicate name '{}'", where, i,
+                                           field->name));
+            }
+            definition.size += field_width(field->format);
+            definition.fields.push_back(std::move(*field));
+        }
+    }
+
+    // Longitud variable: un byte con el número de unidades y las unidades detrás
+    if (const auto unit = value.find("unit"); unit != value.end())
+    {
+        if (value.contains("size") || !unit->is_number_unsigned() ||
+            (!definition.fields.empty() && unit->get<std::size_t>() != definition.size))
+        {
+            return invalid(where + ": unit must be a positive integer matching the fields, "
+                                   "without a size");
+        }
+        definition.unit = unit->get<std::size_t>();
+        definition.size = 0;
+        if (definition.unit == 0 || definition.unit > max_field_size)
+        {
+            return invalid(
+                std::format("{}: unit must be between 1 and {}", where, max_field_size));
+        }
+        return definition;
+    }
+
+    if (const auto size = value.find("size"); size != value.end())
+    {
+        if (!size->is_number_unsigned() ||
+            (!definition.fields.empty() && size->get<std::size_t>() != definition.size))
+        {
+            return invalid(where + ": size must be a positive integer matching the fields");
+        }
+        definition.size = size->get<std::size_t>();
+    }
+
+    if (definition.size == 0 || definition.size > max_field_size)
+    {
+        return invalid(
+            std::format("{}: type needs fields or a size between 1 and {}", where, max_field_size));
+    }
+    return definition;
+}
+
+// Un perfil: qué definiciones usa y si incluye los tipos estándar
+struct Profile
+{
+    bool standard{true};
+    std::vector<std::size_t> definitions;
+};
+
+}  // namespace
+
+auto TypeDefinition::raw(std::span<const uint8_t> bytes, std::size_t field) const -> int64_t
+{
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < field; ++i)
+    {
+        offset += field_width(fields[i].format);
+    }
+
+    const FieldFormat format = fields[field].format;
+    const std::size_t width = field_width(format);
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < width; ++i)
+    {
+        value = value << 8U | bytes[offset + i];
+    }
+
+    // Extensión de signo desde el ancho del campo
+    if (is_signed(format) && (value >> (width * 8 - 1)) != 0)
+    {
+        return static_cast<int64_t>(value) - (int64_t{1} << (width * 8));
+    }
+    return static_cast<int64_t>(value);
+}
+
+auto TypeDefinition::value(std::span<const uint8_t> bytes, std::size_t field) const -> double
+{
+    return static_cast<double>(raw(bytes, field)) / fields[field].scale;
+}
+
+auto TypeDefinition::to_json(std::span<const uint8_t> bytes) const -> Json
+{
+    // Un objeto con los campos de una unidad (todo el campo si es de tamaño fijo)
+    auto object_of = [this](std::span<const uint8_t> unit_bytes)
+    {
+        Json object = Json::object();
+        for (std::size_t i = 0; i < fields.size(); ++i)
+        {
+            // Sin escala el valor se queda entero, como Luminosity
+            if (fields[i].scale == 1.0)
+            {
+                object[fields[i].name] = raw(unit_bytes, i);
+            }
+            else
+            {
+                object[fields[i].name] = value(unit_bytes, i);
+            }
+        }
+        return object;
+    };
+
+    // Longitud variable: sin el byte de longitud, los bytes tal cual o un objeto por unidad
+    const std::span<const uint8_t> data = unit != 0 ? bytes.subspan(1) : bytes;
+    if (fields.empty())
+    {
+        return Json(std::vector<uint8_t>(data.begin(), data.end()));
+    }
+    if (unit == 0)
+    {
+        return object_of(data);
+    }
+
+    Json array = Json::array();
+    for (std::size_t offset = 0; offset + unit <= data.size(); offset += unit)
+    {
+        array.push_back(object_of(data.subspan(offset, unit)));
+    }
+    return array;
+}
+
+auto TypeCatalog::parse(std::string_view text) -> std::expected<TypeCatalog, ConfigError>
+{
+    const Json root = Json::parse(text, nullptr, false);
+    if (root.is_discarded())
+    {
+        return std::unexpected(ConfigError{ConfigErrorCode::Syntax, "not valid JSON"});
+    }
+    if (!root.is_object())
+    {
+        return invalid("root must be an object");
+    }
+    if (const auto version = root.find("version");
+        version != root.end() && (!version->is_number_unsigned() || version->get<int>() != 1))
+    {
+        return invalid("unsupported version, expected 1");
+    }
+
+    TypeCatalog catalog;
+    auto add_types = [&](const Json& types, const std::string& where,
+                         Profile& profile) -> std::expected<void, ConfigError>
+    {
+        if (!types.is_array())
+        {
+            return invalid(where + ": must be an array");
+        }
+        for (std::size_t i = 0; i < types.size(); ++i)
+        {
+            auto definition = parse_type(types[i], std::format("{}[{}]", where, i));
+            if (!definition)
+            {
+                return std::unexpected(definition.error());
+            }
+            profile.definitions.push_back(catalog.definitions_.size());
+            catalog.definitions_.push_back(std::move(*definition));
+        }
+        return {};
+    };
+
+    // Perfil 0: estándar más los tipos globales, para los puertos sin entrada propia
+    std::vector<Profile> profiles(1);
+    if (const auto types = root.find("types"); types != root.end())
+    {
+        if (auto added = add_types(*types, "types", profiles[0]); !added)
+        {
+            return std::unexpected(added.error());
+        }
+    }
+    const std::vector<std::size_t> global_definitions = profiles[0].definitions;
+
+    std::vector<std::string> profile_names = {"types"};
+    if (const auto fports = root.find("fports"); fports != root.end())
+    {
+        if (!fports->is_object())
+        {
+            return invalid("fports must be an object keyed by port number");
+        }
+        for (const auto& [key, entry] : fports->items())
+        {
+            const std::string where = "fports." + key;
+            unsigned port = 0;
+            const auto [end, parse_error] =
+                std::from_chars(key.data(), key.data() + key.size(), port);
+            if (parse_error != std::errc{} || end != key.data() + key.size() || port < 1 ||
+                port > 255)
+            {
+                return invalid(where + ": port must be 1-255");
+            }
+            if (!entry.is_object())
+            {
+                return invalid(where + ": must be an object");
+            }
+
+            Profile profile;
+            profile.definitions = global_definitions;
+            if (const auto standard = entry.find("standard"); standard != entry.end())
+            {
+                if (!standard->is_boolean())
+                {
+                    return invalid(where + ".standard: must be a boolean");
+                }
+                profile.standard = standard->get<bool>();
+            }
+            if (const auto types = entry.find("types"); types != entry.end())
+            {
+                if (auto added = add_types(*types, where + ".types", profile); !added)
+                {
+                    return std::unexpected(added.error());
+                }
+            }
+
+            catalog.port_profiles_[port] = static_cast<uint16_t>(profiles.size());
+            profiles.push_back(std::move(profile));
+            profile_names.push_back(where);
+        }
+    }
+
+    // Compilación: un Decoder por perfil con tablas planas de 256 entradas
+    catalog.decoders_.reserve(profiles.size());
+    catalog.slots_.resize(profiles.size());
+    for (std::size_t p = 0; p < profiles.size(); ++p)
+    {
+        const Profile& profile = profiles[p];
+        Decoder decoder = profile.standard ? Decoder() : Decoder::without_standard_types();
+        auto& slots = catalog.slots_[p];
+
+        for (std::size_t index : profile.definitions)
+        {
+            const TypeDefinition& definition = catalog.definitions_[index];
+            auto to_json = [definition](std::span<const uint8_t> bytes)
+            { return definition.to_json(bytes); };
+            const bool added =
+                definition.unit != 0
+                    ? decoder.add_prefixed_data_type(definition.type_id, definition.name,
+                                                     definition.unit, std::move(to_json))
+                    : decoder.add_data_type(definition.type_id, definition.name,
+                                            definition.size, std::move(to_json));
+            if (!added)
+            {
+                const bool standard = TypeTable::standard().contains(definition.type_id);
+                return invalid(std::format("{}: type_id 0x{:02x} {}", profile_names[p],
+                                           definition.type_id,
+                                           standard && profile.standard
+                                               ? "collides with a standard type"
+                                               : "is defined twice"));
+            }
+            slots[definition.type_id] = static_cast<uint32_t>(index + 1);
+        }
+        catalog.decoders_.push_back(std::move(decoder));
+    }
+
+    return catalog;
+}
+
+auto TypeCatalog::load(const std::string& path) -> std::expected<TypeCatalog, ConfigError>
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return std::unexpected(ConfigError{ConfigErrorCode::Io, "cannot open " + path});
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return parse(contents.str());
+}
+
+auto TypeCatalog::definition(uint8_t fport, uint8_t type_id) const -> const TypeDefinition*
+{
+    const uint32_t slot = slots_[port_profiles_[fport]][type_id];
+    return slot == 0 ? nullptr : &definitions_[slot - 1];
+}
+
+}  // namespace cayene
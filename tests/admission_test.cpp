@@ -0,0 +1,153 @@
+/**
+ * @file admission_test.cpp
+ * @brief Unit tests for the per-device token buckets
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/admission.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+using Clock = AdmissionControl::Clock;
+using std::chrono::milliseconds;
+
+// Reloj fijo: los tests no dependen de la velocidad de la máquina
+const Clock::time_point start = Clock::time_point(std::chrono::hours(1));
+
+auto admitted(AdmissionControl& admission, std::string_view device, int count,
+              Clock::time_point now) -> int
+{
+    int result = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        result += admission.admit(device, now) ? 1 : 0;
+    }
+    return result;
+}
+
+}  // namespace
+
+TEST(AdmissionTest, BurstThenRate)
+{
+    AdmissionControl admission({.policy = {.rate = 10, .burst = 5}});
+
+    EXPECT_EQ(admitted(admission, "dev", 20, start), 5);
+    // 10 por segundo: un token cada 100 ms
+    EXPECT_EQ(admitted(admission, "dev", 5, start + milliseconds(99)), 0);
+    EXPECT_EQ(admitted(admission, "dev", 5, start + milliseconds(100)), 1);
+    EXPECT_EQ(admitted(admission, "dev", 5, start + milliseconds(400)), 3);
+    // Tras un silencio largo el cubo se llena hasta la ráfaga, no más
+    EXPECT_EQ(admitted(admission, "dev", 20, start + std::chrono::hours(1)), 5);
+
+    const auto device = admission.device("dev");
+    ASSERT_TRUE(device);
+    EXPECT_EQ(device->admitted, 14U);
+    EXPECT_EQ(device->dropped, 41U);
+}
+
+TEST(AdmissionTest, FloodDoesNotStarveOthers)
+{
+    AdmissionControl admission({.policy = {.rate = 1, .burst = 3}});
+
+    EXPECT_EQ(admitted(admission, "broken-firmware", 1000, start), 3);
+    for (int i = 0; i < 50; ++i)
+    {
+        EXPECT_TRUE(admission.admit(std::format("device-{}", i), start));
+    }
+
+    const auto stats = admission.stats();
+    EXPECT_EQ(stats.devices, 51U);
+    EXPECT_EQ(stats.admitted, 53U);
+    EXPECT_EQ(stats.dropped, 997U);
+    EXPECT_EQ(stats.untracked, 0U);
+
+    const auto top = admission.top_dropped(3);
+    ASSERT_EQ(top.size(), 1U);
+    EXPECT_EQ(top[0].device_id, "broken-firmware");
+    EXPECT_EQ(top[0].dropped, 997U);
+}
+
+TEST(AdmissionTest, DevicePolicies)
+{
+    AdmissionConfig config{.policy = {.rate = 1, .burst = 1}};
+    config.device_policies["gateway"] = {.rate = 100, .burst = 50};
+    config.device_policies["unlimited"] = {.rate = 0};
+    AdmissionControl admission(config);
+
+    EXPECT_EQ(admitted(admission, "sensor", 10, start), 1);
+    EXPECT_EQ(admitted(admission, "gateway", 100, start), 50);
+    EXPECT_EQ(admitted(admission, "unlimited", 1000, start), 1000);
+}
+
+TEST(AdmissionTest, FullTable)
+{
+    AdmissionConfig config{.policy = {.rate = 1, .burst = 1}, .capacity = 4, .max_probes = 4};
+    config.admit_untracked = false;
+    AdmissionControl admission(config);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(admission.admit(std::format("device-{}", i), start));
+    }
+    EXPECT_FALSE(admission.admit("one-too-many", start));
+    EXPECT_FALSE(admission.device("one-too-many"));
+    EXPECT_EQ(admission.stats().untracked, 1U);
+    EXPECT_EQ(admission.stats().devices, 4U);
+}
+
+TEST(AdmissionTest, LongDeviceIdsAreTruncatedInReports)
+{
+    AdmissionControl admission({.policy = {.rate = 1, .burst = 1}});
+    const std::string id(40, 'x');
+    EXPECT_EQ(admitted(admission, id, 2, start), 1);
+
+    const auto device = admission.device(id);
+    ASSERT_TRUE(device);
+    EXPECT_EQ(device->device_id, std::string(31, 'x'));
+    EXPECT_EQ(device->dropped, 1U);
+}
+
+TEST(AdmissionTest, ConcurrentAdmitsSpendEachTokenOnce)
+{
+    constexpr int threads = 8;
+    constexpr int per_thread = 10000;
+    AdmissionControl admission({.policy = {.rate = 1, .burst = 100}});
+
+    std::atomic<int> total{0};
+    {
+        std::vector<std::jthread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back(
+                [&]
+                {
+                    total += admitted(admission, "shared", per_thread, start);
+                    // Cada hilo también con su propio dispositivo
+                    admitted(admission, std::format("own-{}", total.load()), 1, start);
+                });
+        }
+    }
+    EXPECT_EQ(total, 100);
+
+    const auto device = admission.device("shared");
+    ASSERT_TRUE(device);
+    EXPECT_EQ(device->admitted, 100U);
+    EXPECT_EQ(device->dropped, threads * per_thread - 100U);
+}
+
+}  // namespace cayene::ingest::test
@@ -0,0 +1,295 @@
+/**
+ * @file alloc_counter.cpp
+ * @brief Global allocation hooks backing alloc_counter.hpp
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "alloc_counter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+    #define CAYENE_TEST_SANITIZED 1
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || \
+        __has_feature(memory_sanitizer)
+        #define CAYENE_TEST_SANITIZED 1
+    #endif
+#endif
+
+// Sanitizers ship their own malloc, replacing it again would break them
+#if defined(__GLIBC__) && !defined(CAYENE_TEST_SANITIZED)
+    #define CAYENE_TEST_INTERPOSE_MALLOC 1
+#endif
+
+namespace
+{
+
+// Trivial thread_local state: safe to touch from inside malloc
+thread_local bool counting = false;
+thread_local cayene::test::AllocationStats counters;
+
+void note_allocation(std::size_t size)
+{
+    if (counting)
+    {
+        ++counters.allocations;
+        counters.bytes += size;
+    }
+}
+
+void note_deallocation()
+{
+    if (counting)
+    {
+        ++counters.deallocations;
+    }
+}
+
+auto allocate(std::size_t size) -> void*
+{
+#ifndef CAYENE_TEST_INTERPOSE_MALLOC
+    note_allocation(size);
+#endif
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+auto allocate_aligned(std::size_t size, std::align_val_t alignment) -> void*
+{
+    // aligned_alloc is never interposed, count it here in both modes
+    note_allocation(size);
+    const auto align = static_cast<std::size_t>(alignment);
+    const std::size_t rounded = (size + align - 1) / align * align;
+    return std::aligned_alloc(align, rounded == 0 ? align : rounded);
+}
+
+void deallocate(void* pointer)
+{
+#ifndef CAYENE_TEST_INTERPOSE_MALLOC
+    if (pointer != nullptr)
+    {
+        note_deallocation();
+    }
+#endif
+    std::free(pointer);
+}
+
+// Sin excepciones (CAYENE_EMBEDDED) no hay bad_alloc que lanzar
+[[noreturn]] void out_of_memory()
+{
+#if defined(__cpp_exceptions)
+    throw std::bad_alloc();
+#else
+    std::abort();
+#endif
+}
+
+auto allocate_or_throw(std::size_t size) -> void*
+{
+    void* pointer = allocate(size);
+    if (pointer == nullptr)
+    {
+        out_of_memory();
+    }
+    return pointer;
+}
+
+auto allocate_aligned_or_throw(std::size_t size, std::align_val_t alignment) -> void*
+{
+    void* pointer = allocate_aligned(size, alignment);
+    if (pointer == nullptr)
+    {
+        out_of_memory();
+    }
+    return pointer;
+}
+
+}  // namespace
+
+#ifdef CAYENE_TEST_INTERPOSE_MALLOC
+
+extern "C"
+{
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t count, std::size_t size);
+    void* __libc_realloc(void* pointer, std::size_t size);
+    void __libc_free(void* pointer);
+
+    void* malloc(std::size_t size) noexcept
+    {
+        note_allocation(size);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size) noexcept
+    {
+        note_allocation(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, std::size_t size) noexcept
+    {
+        note_allocation(size);
+        if (pointer != nullptr)
+        {
+            note_deallocation();
+        }
+        return __libc_realloc(pointer, size);
+    }
+
+    void free(void* pointer) noexcept
+    {
+        if (pointer != nullptr)
+        {
+            note_deallocation();
+        }
+        __libc_free(pointer);
+    }
+}
+
+#endif
+
+// NOLINTBEGIN(cppcoreguidelines-no-malloc,cppcoreguidelines-owning-memory)
+void* operator new(std::size_t size)
+{
+    return allocate_or_throw(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate_or_throw(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t& /*tag*/) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& /*tag*/) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate_aligned_or_throw(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocate_aligned_or_throw(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t& /*tag*/) noexcept
+{
+    return allocate_aligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t& /*tag*/) noexcept
+{
+    return allocate_aligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t /*size*/) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t /*size*/) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t& /*tag*/) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t& /*tag*/) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t /*alignment*/) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t /*alignment*/) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t /*size*/,
+                       std::align_val_t /*alignment*/) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t /*alignment*/,
+                     const std::nothrow_t& /*tag*/) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t /*alignment*/,
+                       const std::nothrow_t& /*tag*/) noexcept
+{
+    deallocate(pointer);
+}
+// NOLINTEND(cppcoreguidelines-no-malloc,cppcoreguidelines-owning-memory)
+
+namespace cayene::test
+{
+
+AllocationScope::AllocationScope() : start_(counters), previously_active_(counting)
+{
+    counting = true;
+}
+
+AllocationScope::~AllocationScope()
+{
+    counting = previously_active_;
+}
+
+auto AllocationScope::stats() const -> AllocationStats
+{
+    return {
+        .allocations = counters.allocations - start_.allocations,
+        .deallocations = counters.deallocations - start_.deallocations,
+        .bytes = counters.bytes - start_.bytes,
+    };
+}
+
+auto malloc_interposed() -> bool
+{
+#ifdef CAYENE_TEST_INTERPOSE_MALLOC
+    return true;
+#else
+    return false;
+#endif
+}
+
+}  // namespace cayene::test
@@ -0,0 +1,83 @@
+#ifndef CAYENE_TEST_ALLOC_COUNTER_HPP
+#define CAYENE_TEST_ALLOC_COUNTER_HPP
+
+/**
+ * @file alloc_counter.hpp
+ * @brief Heap allocation counting for tests and benchmarks
+ *
+ * Linking alloc_counter.cpp replaces the global operator new/delete family
+ * and, on glibc without sanitizers, interposes malloc/calloc/realloc/free.
+ * Counting is per thread and only active inside an AllocationScope, so
+ * unrelated threads (and the test framework itself) are not attributed.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <cstdint>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+namespace cayene::test
+{
+
+struct AllocationStats
+{
+    uint64_t allocations{0};
+    uint64_t deallocations{0};
+    uint64_t bytes{0};
+};
+
+/**
+ * @brief Counts allocations made by the current thread while alive
+ */
+class AllocationScope
+{
+public:
+    AllocationScope();
+    ~AllocationScope();
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+    AllocationScope(AllocationScope&&) = delete;
+    AllocationScope& operator=(AllocationScope&&) = delete;
+
+    [[nodiscard]] auto stats() const -> AllocationStats;
+
+private:
+    AllocationStats start_;
+    bool previously_active_;
+};
+
+// True when malloc itself is hooked, false when only operator new is
+auto malloc_interposed() -> bool;
+
+template <typename Function>
+auto count_allocations(Function&& function) -> AllocationStats
+{
+    AllocationScope scope;
+    std::forward<Function>(function)();
+    return scope.stats();
+}
+
+}  // namespace cayene::test
+
+// The expression's result is discarded inside the counted scope, so its own
+// destruction is included in the count
+#define EXPECT_ALLOCATIONS_EQ(expected, expression)                                               \
+    EXPECT_EQ(static_cast<uint64_t>(expected),                                                    \
+              ::cayene::test::count_allocations([&] { (void)(expression); }).allocations)         \
+        << "while evaluating " #expression
+
+#define ASSERT_ALLOCATIONS_EQ(expected, expression)                                               \
+    ASSERT_EQ(static_cast<uint64_t>(expected),                                                    \
+              ::cayene::test::count_allocations([&] { (void)(expression); }).allocations)         \
+        << "while evaluating " #expression
+
+#define EXPECT_ALLOCATIONS_LE(limit, expression)                                                  \
+    EXPECT_LE(::cayene::test::count_allocations([&] { (void)(expression); }).allocations,         \
+              static_cast<uint64_t>(limit))                                                       \
+        << "while evaluating " #expression
+
+#endif  // CAYENE_TEST_ALLOC_COUNTER_HPP
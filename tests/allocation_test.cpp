@@ -0,0 +1,115 @@
+/**
+ * @file allocation_test.cpp
+ * @brief Heap allocation budgets of the decode paths
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "alloc_counter.hpp"
+#include "cayene/core.hpp"
+#include "cayene/decoder.hpp"
+
+namespace cayene::test
+{
+
+namespace
+{
+
+// Escape hatches so the optimizer cannot elide the allocations under test
+std::unique_ptr<int> int_sink;
+void* volatile raw_sink = nullptr;
+
+auto single_field_payload(const StandardType& type) -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> payload = {0x01, type.type_id};
+    payload.resize(2 + type.size, 0x01);
+    return payload;
+}
+
+}  // namespace
+
+// Test that the harness sees operator new and, when interposed, malloc
+TEST(AllocationTest, HarnessCountsAllocations)
+{
+    EXPECT_ALLOCATIONS_EQ(1, int_sink = std::make_unique<int>(7));
+    EXPECT_ALLOCATIONS_EQ(0, int_sink.reset());
+
+    const auto stats = count_allocations(
+        []
+        {
+            int_sink = std::make_unique<int>(7);
+            int_sink.reset();
+        });
+    EXPECT_EQ(stats.allocations, 1U);
+    EXPECT_EQ(stats.deallocations, 1U);
+    EXPECT_EQ(stats.bytes, sizeof(int));
+
+    if (malloc_interposed())
+    {
+        // NOLINTBEGIN(cppcoreguidelines-no-malloc,cppcoreguidelines-owning-memory)
+        EXPECT_ALLOCATIONS_EQ(1, raw_sink = std::malloc(32));
+        std::free(raw_sink);
+        // NOLINTEND(cppcoreguidelines-no-malloc,cppcoreguidelines-owning-memory)
+    }
+}
+
+// Test that decode_readings never touches the heap, including error paths
+TEST(AllocationTest, ReadingsPathIsAllocationFree)
+{
+    Decoder decoder;
+    std::array<Reading, 16> readings{};
+
+    std::vector<uint8_t> payload;
+    for (const auto& type : v1_standard_types)
+    {
+        auto field = single_field_payload(type);
+        payload.insert(payload.end(), field.begin(), field.end());
+    }
+    std::span<const uint8_t> view(payload);
+
+    // La primera llamada del hilo reserva su shard de métricas (CAYENE_ENABLE_METRICS)
+    (void)decoder.decode_readings(view, readings);
+
+    EXPECT_ALLOCATIONS_EQ(0, decoder.decode_readings(view, readings));
+    ASSERT_EQ(decoder.decode_readings(view, readings).value(), v1_standard_types.size());
+
+    const std::vector<uint8_t> truncated = {0x01, 0x67, 0x01};
+    const std::vector<uint8_t> unknown = {0x01, 0xFF, 0x00};
+    const std::vector<uint8_t> empty;
+    EXPECT_ALLOCATIONS_EQ(0, decoder.decode_readings(truncated, readings));
+    EXPECT_ALLOCATIONS_EQ(0, decoder.decode_readings(unknown, readings));
+    EXPECT_ALLOCATIONS_EQ(0, decoder.decode_readings(empty, readings));
+    EXPECT_ALLOCATIONS_EQ(0, decoder.decode_readings(view, std::span(readings).first(2)));
+}
+
+// Report heap traffic of the Json path per standard type
+TEST(AllocationTest, JsonPathReportPerType)
+{
+    Decoder decoder;
+    for (const auto& type : v1_standard_types)
+    {
+        auto payload = single_field_payload(type);
+        const auto stats = count_allocations([&] { (void)decoder.decode(payload); });
+
+        RecordProperty(std::format("allocations_0x{:02x}", type.type_id),
+                       std::to_string(stats.allocations));
+        RecordProperty(std::format("bytes_0x{:02x}", type.type_id), std::to_string(stats.bytes));
+
+        // Techo holgado: clave, objeto Json y como mucho un objeto anidado
+        EXPECT_LE(stats.allocations, 10U) << type.name;
+        EXPECT_EQ(stats.allocations, stats.deallocations) << type.name;
+    }
+}
+
+}  // namespace cayene::test
@@ -0,0 +1,245 @@
+/**
+ * @file batcher_test.cpp
+ * @brief Unit tests for the adaptive micro-batching stage
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/batcher.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+// Temperatura 27.2 en el canal 3
+constexpr std::array<uint8_t, 4> temperature{0x03, 0x67, 0x01, 0x10};
+constexpr std::array<uint8_t, 2> truncated{0x03, 0x67};
+
+auto catalog() -> TypeCatalog
+{
+    return *TypeCatalog::parse("{}");
+}
+
+auto uplink(std::string_view device, std::span<const uint8_t> payload) -> Uplink
+{
+    return Uplink{EnvelopeFormat::ChirpStack, device, 2, payload};
+}
+
+// Guarda los tamaños de lote y los dispositivos recibidos
+struct Recorder
+{
+    std::mutex mutex;
+    std::vector<std::size_t> sizes;
+    std::vector<std::string> devices;
+
+    auto handler() -> BatchHandler
+    {
+        return [this](std::span<const BatchedUplink> batch)
+        {
+            const std::lock_guard lock(mutex);
+            sizes.push_back(batch.size());
+            for (const auto& entry : batch)
+            {
+                devices.emplace_back(entry.uplink.device_id);
+                EXPECT_DOUBLE_EQ(entry.decoded["Temperature_3"].get<double>(), 27.2);
+            }
+        };
+    }
+};
+
+}  // namespace
+
+TEST(BatcherTest, LightTrafficIsNotHeldBack)
+{
+    Recorder recorder;
+    MicroBatcher batcher({.latency_budget = std::chrono::seconds(1)}, catalog(),
+                         recorder.handler());
+
+    // Un uplink suelto con objetivo 1 se entrega sin esperar al plazo
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(batcher.submit(uplink("solo", temperature)));
+    batcher.drain();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+
+    const auto stats = batcher.stats();
+    EXPECT_EQ(stats.uplinks, 1U);
+    EXPECT_EQ(stats.size_closed, 1U);
+    EXPECT_EQ(recorder.devices, (std::vector<std::string>{"solo"}));
+}
+
+TEST(BatcherTest, BurstGrowsBatches)
+{
+    constexpr std::size_t count = 5000;
+    Recorder recorder;
+    BatcherConfig config{
+        .latency_budget = std::chrono::milliseconds(50), .max_batch = 64, .max_queued = count};
+    MicroBatcher batcher(config, catalog(), recorder.handler());
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        ASSERT_TRUE(batcher.submit(uplink(std::to_string(i), temperature)));
+    }
+    batcher.drain();
+
+    const auto stats = batcher.stats();
+    EXPECT_EQ(stats.uplinks, count);
+    EXPECT_EQ(stats.dropped, 0U);
+    EXPECT_GT(stats.target_batch, 1U);
+    EXPECT_LE(stats.target_batch, config.max_batch);
+    EXPECT_LT(stats.batches, count / 4);
+    EXPECT_EQ(stats.batch_sizes.count(), stats.batches);
+    EXPECT_LE(stats.batch_sizes.max(), config.max_batch);
+    EXPECT_EQ(stats.queue_delay.count(), count);
+
+    // El orden de llegada se conserva
+    ASSERT_EQ(recorder.devices.size(), count);
+    EXPECT_EQ(recorder.devices.front(), "0");
+    EXPECT_EQ(recorder.devices.back(), std::to_string(count - 1));
+}
+
+TEST(BatcherTest, DeadlineClosesShortBatch)
+{
+    Recorder recorder;
+    BatcherConfig config{.latency_budget = std::chrono::milliseconds(20), .min_batch = 8};
+    MicroBatcher batcher(config, catalog(), recorder.handler());
+
+    for (const char* device : {"a", "b", "c"})
+    {
+        ASSERT_TRUE(batcher.submit(uplink(device, temperature)));
+    }
+    // drain() cerraría el lote en el acto: se espera a que lo cierre el plazo
+    const auto limit = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (batcher.stats().batches == 0 && std::chrono::steady_clock::now() < limit)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    batcher.drain();
+
+    const auto stats = batcher.stats();
+    EXPECT_EQ(stats.deadline_closed, 1U);
+    EXPECT_EQ(stats.size_closed, 0U);
+    EXPECT_EQ(recorder.sizes, (std::vector<std::size_t>{3}));
+    // Esperaron el plazo, pero no mucho más
+    EXPECT_GE(stats.queue_delay.max(), 10'000'000U);
+    EXPECT_LT(stats.queue_delay.percentile(0.5), 1'000'000'000U);
+}
+
+TEST(BatcherTest, RejectedPayloadsAreCounted)
+{
+    Recorder recorder;
+    MicroBatcher batcher({}, catalog(), recorder.handler());
+
+    ASSERT_TRUE(batcher.submit(uplink("bad", truncated)));
+    ASSERT_TRUE(batcher.submit(uplink("good", temperature)));
+    batcher.drain();
+
+    const auto stats = batcher.stats();
+    EXPECT_EQ(stats.uplinks, 1U);
+    EXPECT_EQ(stats.rejected, 1U);
+    EXPECT_EQ(recorder.devices, (std::vector<std::string>{"good"}));
+}
+
+TEST(BatcherTest, FullQueueRefuses)
+{
+    std::mutex gate;
+    std::unique_lock blocked(gate);
+    BatcherConfig config{.max_batch = 1, .max_queued = 4};
+    // El handler retiene al worker para que la cola se llene
+    MicroBatcher batcher(config, catalog(),
+                         [&gate](std::span<const BatchedUplink>)
+                         { const std::lock_guard held(gate); });
+
+    constexpr std::size_t attempts = 20;
+    std::size_t accepted = 0;
+    for (std::size_t i = 0; i < attempts; ++i)
+    {
+        accepted += batcher.submit(uplink("dev", temperature)) ? 1U : 0U;
+    }
+    // Como mucho un lote en el handler más una cola llena
+    EXPECT_LE(accepted, 1 + config.max_queued);
+    EXPECT_EQ(batcher.stats().dropped, attempts - accepted);
+
+    blocked.unlock();
+    batcher.drain();
+    EXPECT_EQ(batcher.stats().uplinks, accepted);
+}
+
+TEST(BatcherTest, DrainClosesOpenBatch)
+{
+    Recorder recorder;
+    MicroBatcher batcher({.latency_budget = std::chrono::hours(1), .min_batch = 100},
+                         catalog(), recorder.handler());
+    ASSERT_TRUE(batcher.submit(uplink("first", temperature)));
+
+    // Sin el cierre inmediato drain() esperaría la hora del presupuesto
+    const auto start = std::chrono::steady_clock::now();
+    batcher.drain();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    EXPECT_EQ(recorder.devices, (std::vector<std::string>{"first"}));
+
+    // Lo que llega después vuelve a esperar su plazo
+    ASSERT_TRUE(batcher.submit(uplink("second", temperature)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(batcher.stats().batches, 1U);
+    batcher.drain();
+    EXPECT_EQ(recorder.devices, (std::vector<std::string>{"first", "second"}));
+}
+
+TEST(BatcherTest, DoneReportsEveryTag)
+{
+    std::mutex mutex;
+    std::vector<std::string> sources;
+    std::vector<uint64_t> handled;
+    std::vector<uint64_t> done;
+    MicroBatcher batcher(
+        {}, catalog(),
+        [&](std::span<const BatchedUplink> batch)
+        {
+            const std::lock_guard lock(mutex);
+            for (const auto& entry : batch)
+            {
+                sources.emplace_back(entry.source);
+                handled.push_back(entry.tag);
+            }
+        },
+        [&](std::span<const uint64_t> tags)
+        {
+            const std::lock_guard lock(mutex);
+            done.insert(done.end(), tags.begin(), tags.end());
+        });
+
+    ASSERT_TRUE(batcher.submit(uplink("good", temperature), "topic/good", 7));
+    ASSERT_TRUE(batcher.submit(uplink("bad", truncated), "topic/bad", 8));
+    batcher.drain();
+
+    // El rechazado no llega al handler pero sí se da por terminado
+    EXPECT_EQ(sources, (std::vector<std::string>{"topic/good"}));
+    EXPECT_EQ(handled, (std::vector<uint64_t>{7}));
+    EXPECT_EQ(done, (std::vector<uint64_t>{7, 8}));
+}
+
+TEST(BatcherTest, DestructorHandsOverQueued)
+{
+    Recorder recorder;
+    {
+        MicroBatcher batcher({.latency_budget = std::chrono::hours(1), .min_batch = 100},
+                             catalog(), recorder.handler());
+        ASSERT_TRUE(batcher.submit(uplink("last", temperature)));
+    }
+    EXPECT_EQ(recorder.devices, (std::vector<std::string>{"last"}));
+}
+
+}  // namespace cayene::ingest::test
@@ -0,0 +1,226 @@
+/**
+ * @file calibration_test.cpp
+ * @brief Unit tests for the per-sensor calibration table
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/calibration.hpp"
+
+#include <array>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "cayene/core.hpp"
+#include "cayene/decoder.hpp"
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+constexpr const char* device = "70B3D57ED0000001";
+
+// Temperatura 27.2 en el canal 1, humedad 50 % en el 2, entrada analógica 3.27 en el 3
+const std::vector<uint8_t> payload = {0x01, 0x67, 0x01, 0x10, 0x02, 0x68,
+                                      0x01, 0xf4, 0x03, 0x02, 0x01, 0x47};
+
+auto decode(std::span<Reading> readings) -> std::size_t
+{
+    const CoreDecoder decoder;
+    auto count = decoder.decode(payload, readings);
+    EXPECT_TRUE(count);
+    return count.value_or(0);
+}
+
+}  // namespace
+
+TEST(CalibrationTest, AppliesGainAndOffsetOfEachSensor)
+{
+    const std::vector<CalibrationEntry> entries = {
+        {device, 1, 0x67, 1.02, -0.5},
+        {device, 3, 0x02, 2.0},
+        // Otro canal del mismo tipo: no se aplica al canal 1
+        {device, 4, 0x67, 10.0, 10.0},
+    };
+    auto table = CalibrationTable::build(entries);
+    ASSERT_TRUE(table) << table.error().message;
+    EXPECT_EQ(table->size(), 3U);
+    EXPECT_EQ(table->devices(), 1U);
+
+    std::array<Reading, 8> readings{};
+    const std::size_t count = decode(readings);
+    ASSERT_EQ(count, 3U);
+
+    std::array<double, 8> values{};
+    const auto written = table->calibrate(device, std::span(readings).first(count), values);
+    ASSERT_TRUE(written);
+    ASSERT_EQ(*written, 3U);
+    EXPECT_DOUBLE_EQ(values[0], 27.2 * 1.02 - 0.5);
+    // La humedad no tiene coeficientes: solo la escala
+    EXPECT_DOUBLE_EQ(values[1], 50.0);
+    EXPECT_DOUBLE_EQ(values[2], 3.27 * 2.0);
+}
+
+TEST(CalibrationTest, UnknownDeviceGetsPlainScale)
+{
+    auto table = CalibrationTable::build(std::vector<CalibrationEntry>{{device, 1, 0x67, 3.0}});
+    ASSERT_TRUE(table);
+
+    std::array<Reading, 8> readings{};
+    const std::size_t count = decode(readings);
+    std::array<double, 8> values{};
+    for (const auto& calibration : {*table, CalibrationTable{}})
+    {
+        const auto written =
+            calibration.calibrate("70B3D57ED0000002", std::span(readings).first(count), values);
+        ASSERT_TRUE(written);
+        for (std::size_t i = 0; i < *written; ++i)
+        {
+            EXPECT_DOUBLE_EQ(values[i], readings[i].value());
+        }
+    }
+}
+
+TEST(CalibrationTest, EveryComponentOfMultiComponentTypes)
+{
+    auto table =
+        CalibrationTable::build(std::vector<CalibrationEntry>{{device, 5, 0x88, 1.0, 1.0}});
+    ASSERT_TRUE(table);
+
+    // GPS: 42.3519, -87.9094, 10 m
+    const std::vector<uint8_t> gps = {0x05, 0x88, 0x06, 0x76, 0x5f, 0xf2,
+                                      0x96, 0x0a, 0x00, 0x03, 0xe8};
+    std::array<Reading, 1> readings{};
+    ASSERT_TRUE(CoreDecoder().decode(gps, readings));
+
+    std::array<double, 3> values{};
+    const auto written = table->calibrate(device, readings, values);
+    ASSERT_TRUE(written);
+    ASSERT_EQ(*written, 3U);
+    EXPECT_DOUBLE_EQ(values[0], 42.3519 + 1.0);
+    EXPECT_DOUBLE_EQ(values[1], -87.9094 + 1.0);
+    EXPECT_DOUBLE_EQ(values[2], 10.0 + 1.0);
+
+    std::array<double, 2> short_values{};
+    const auto too_small = table->calibrate(device, readings, short_values);
+    ASSERT_FALSE(too_small);
+    EXPECT_EQ(too_small.error(), Error::BufferTooSmall);
+}
+
+TEST(CalibrationTest, AnnotateRewritesCalibratedSensors)
+{
+    const std::vector<CalibrationEntry> entries = {
+        {device, 1, 0x67, 1.0, -0.5},
+        {device, 5, 0x88, 1.0, 1.0},
+    };
+    auto table = CalibrationTable::build(entries);
+    ASSERT_TRUE(table);
+
+    // Temperatura 27.2 en el canal 1, humedad 50 % en el 2 y GPS en el 5
+    const std::vector<uint8_t> mixed = {0x01, 0x67, 0x01, 0x10, 0x02, 0x68, 0x01, 0xf4, 0x05,
+                                        0x88, 0x06, 0x76, 0x5f, 0xf2, 0x96, 0x0a, 0x00, 0x03,
+                                        0xe8};
+    std::array<Reading, 4> readings{};
+    const auto count = CoreDecoder().decode(mixed, readings);
+    ASSERT_TRUE(count);
+    const auto decoded = Decoder().decode(mixed);
+    ASSERT_TRUE(decoded);
+
+    Json line{{"device_id", device}, {"decoded", *decoded}};
+    const Uplink uplink{EnvelopeFormat::ChirpStack, device, 2, mixed};
+    EXPECT_EQ(table->annotate(uplink, std::span(readings).first(*count), line), 2U);
+    EXPECT_DOUBLE_EQ(line["decoded"]["Temperature_1"].get<double>(), 26.7);
+    // Sin coeficientes: el valor del decoder intacto
+    EXPECT_EQ(line["decoded"]["Humidity_2"], (*decoded)["Humidity_2"]);
+    EXPECT_DOUBLE_EQ(line["decoded"]["GPS_5"]["latitude"].get<double>(), 43.3519);
+    EXPECT_DOUBLE_EQ(line["decoded"]["GPS_5"]["longitude"].get<double>(), -86.9094);
+    EXPECT_DOUBLE_EQ(line["decoded"]["GPS_5"]["altitude"].get<double>(), 11.0);
+
+    // Otro dispositivo: la línea no cambia
+    Json other{{"decoded", *decoded}};
+    const Uplink unknown{EnvelopeFormat::ChirpStack, "70B3D57ED0000002", 2, mixed};
+    EXPECT_EQ(table->annotate(unknown, std::span(readings).first(*count), other), 0U);
+    EXPECT_EQ(other["decoded"], *decoded);
+}
+
+TEST(CalibrationTest, ManyDevicesAndBatches)
+{
+    constexpr std::size_t count = 10'000;
+    std::vector<CalibrationEntry> entries;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        entries.push_back({std::format("70B3D57ED{:07X}", i), 1, 0x67,
+                           1.0 + static_cast<double>(i % 10) / 10, static_cast<double>(i % 3)});
+    }
+    auto table = CalibrationTable::build(entries);
+    ASSERT_TRUE(table) << table.error().message;
+    EXPECT_EQ(table->devices(), count);
+
+    // Más lecturas que un lote interno
+    std::vector<Reading> readings(150, Reading{1, 0x67, 1, {272, 0, 0}, {}});
+    std::vector<double> values(readings.size());
+    for (std::size_t i = 0; i < count; i += 997)
+    {
+        const auto written = table->calibrate(entries[i].device_id, readings, values);
+        ASSERT_TRUE(written);
+        ASSERT_EQ(*written, readings.size());
+        for (const double value : values)
+        {
+            EXPECT_DOUBLE_EQ(value, 27.2 * entries[i].gain + entries[i].offset);
+        }
+    }
+}
+
+TEST(CalibrationTest, ParseCalibrationFile)
+{
+    auto table = CalibrationTable::parse("# device_id,channel,type_id,gain,offset\r\n"
+                                         "70B3D57ED0000001,1,0x67,1.02,-0.5\r\n"
+                                         "\n"
+                                         "70B3D57ED0000001,3,2,2\n"
+                                         "my-sensor,1,103,1\n");
+    ASSERT_TRUE(table) << table.error().message;
+    EXPECT_EQ(table->size(), 3U);
+    EXPECT_EQ(table->devices(), 2U);
+
+    std::array<Reading, 8> readings{};
+    const std::size_t count = decode(readings);
+    std::array<double, 8> values{};
+    ASSERT_TRUE(table->calibrate(device, std::span(readings).first(count), values));
+    EXPECT_DOUBLE_EQ(values[0], 27.2 * 1.02 - 0.5);
+    EXPECT_DOUBLE_EQ(values[2], 3.27 * 2.0);
+}
+
+TEST(CalibrationTest, ParseErrors)
+{
+    auto fields = CalibrationTable::parse("70B3D57ED0000001,1,0x67,1\n70B3D57ED0000001,1\n");
+    ASSERT_FALSE(fields);
+    EXPECT_EQ(fields.error().code, ConfigErrorCode::Syntax);
+    EXPECT_EQ(fields.error().message, "line 2: expected device_id,channel,type_id,gain[,offset]");
+
+    auto channel = CalibrationTable::parse("70B3D57ED0000001,256,0x67,1\n");
+    ASSERT_FALSE(channel);
+    EXPECT_EQ(channel.error().message, "line 1: bad channel");
+
+    auto type = CalibrationTable::parse("70B3D57ED0000001,1,0x,1\n");
+    ASSERT_FALSE(type);
+    EXPECT_EQ(type.error().message, "line 1: bad type_id");
+
+    auto duplicate =
+        CalibrationTable::parse("70B3D57ED0000001,1,0x67,1\n70b3d57ed0000001,1,0x67,2\n");
+    ASSERT_FALSE(duplicate);
+    EXPECT_EQ(duplicate.error().code, ConfigErrorCode::Invalid);
+    EXPECT_EQ(duplicate.error().message, "duplicate sensor 70B3D57ED0000001 channel 1 type 0x67");
+
+    auto missing = CalibrationTable::load("/nonexistent/calibration.csv");
+    ASSERT_FALSE(missing);
+    EXPECT_EQ(missing.error().code, ConfigErrorCode::Io);
+}
+
+}  // namespace cayene::ingest::test
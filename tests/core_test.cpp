@@ -0,0 +1,341 @@
+/**
+ * @file core_test.cpp
+ * @brief Unit tests for the allocation-free decoder core
+ *
+ * Links only cayene_core, so it also runs in CAYENE_EMBEDDED builds.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/core.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "alloc_counter.hpp"
+
+namespace cayene::test
+{
+
+// Test the standard table and custom registration
+TEST(CoreTest, TypeTable)
+{
+    constexpr TypeTable table = TypeTable::standard();
+    static_assert(table.size(0x67) == 2);
+    static_assert(table.size(0x88) == 9);
+    static_assert(!table.contains(0xFF));
+
+    TypeTable custom = table;
+    EXPECT_TRUE(custom.add(0xC8, 4));
+    EXPECT_EQ(custom.size(0xC8), 4U);
+    EXPECT_FALSE(custom.is_standard(0xC8));
+    EXPECT_TRUE(custom.is_standard(0x67));
+
+    EXPECT_FALSE(custom.add(0x67, 4));  // Already registered
+    EXPECT_FALSE(custom.add(0xC9, 0));
+    EXPECT_FALSE(custom.add(0xC9, max_field_size + 1));
+    EXPECT_FALSE(custom.contains(0xC9));
+
+    EXPECT_TRUE(custom.add_prefixed(0xCA, 6));
+    EXPECT_TRUE(custom.contains(0xCA));
+    EXPECT_TRUE(custom.is_prefixed(0xCA));
+    EXPECT_EQ(custom.size(0xCA), 0U);
+    EXPECT_EQ(custom.prefixed_size(0xCA, 3), 19U);
+    EXPECT_EQ(custom.prefixed_size(0xC8, 3), 0U);
+    EXPECT_FALSE(custom.add_prefixed(0xCA, 6));  // Already registered
+    EXPECT_FALSE(custom.add_prefixed(0xC8, 1));
+    EXPECT_FALSE(custom.add(0xCA, 4));
+    EXPECT_FALSE(custom.add_prefixed(0xCB, 0));
+    EXPECT_FALSE(custom.add_prefixed(0xCB, max_field_size + 1));
+}
+
+// Test decoding into a fixed-size buffer
+TEST(CoreTest, DecodeIntoBuffer)
+{
+    const CoreDecoder decoder;
+    // Temperature, accelerometer and GPS
+    const std::vector<uint8_t> payload = {0x03, 0x67, 0x01, 0x10, 0x06, 0x71, 0x04, 0xD2, 0xFB,
+                                          0x2E, 0x00, 0x00, 0x01, 0x88, 0x06, 0x76, 0x5f, 0x0d,
+                                          0x69, 0xf6, 0x00, 0x03, 0xe8};
+
+    ReadingBuffer<8> buffer;
+    auto res = decoder.decode(payload, buffer);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(*res, 3U);
+    ASSERT_EQ(buffer.size(), 3U);
+
+    EXPECT_EQ(buffer[0].channel, 0x03);
+    EXPECT_DOUBLE_EQ(buffer[0].value(), 27.2);
+
+    EXPECT_EQ(buffer[1].component_count, 3);
+    EXPECT_DOUBLE_EQ(buffer[1].value(0), 1.234);
+    EXPECT_DOUBLE_EQ(buffer[1].value(1), -1.234);
+
+    EXPECT_DOUBLE_EQ(buffer[2].value(0), 42.3519);
+    EXPECT_DOUBLE_EQ(buffer[2].value(1), 87.9094);
+    EXPECT_DOUBLE_EQ(buffer[2].value(2), 10.0);
+
+    std::size_t visited = 0;
+    for (const Reading& reading : buffer)
+    {
+        // Las lecturas apuntan dentro del payload, sin copias
+        EXPECT_GE(reading.bytes.data(), payload.data());
+        EXPECT_LE(reading.bytes.data() + reading.bytes.size(), payload.data() + payload.size());
+        ++visited;
+    }
+    EXPECT_EQ(visited, 3U);
+}
+
+// Test the error paths and that a failed decode leaves the buffer empty
+TEST(CoreTest, DecodeErrors)
+{
+    const CoreDecoder decoder;
+    ReadingBuffer<1> buffer;
+
+    const std::vector<uint8_t> empty;
+    EXPECT_EQ(decoder.decode(empty, buffer).error(), Error::PayloadEmpty);
+
+    const std::vector<uint8_t> unknown = {0x01, 0xFF, 0x00};
+    EXPECT_EQ(decoder.decode(unknown, buffer).error(), Error::UnkwownDataType);
+
+    const std::vector<uint8_t> truncated = {0x01, 0x67, 0x01};
+    EXPECT_EQ(decoder.decode(truncated, buffer).error(), Error::BadPayloadFormat);
+
+    const std::vector<uint8_t> two_fields = {0x01, 0x67, 0x01, 0x10, 0x02, 0x66, 0x01};
+    EXPECT_EQ(decoder.decode(two_fields, buffer).error(), Error::BufferTooSmall);
+    EXPECT_TRUE(buffer.empty());
+}
+
+// Test decoding fragments, with straddling fields copied to scratch
+TEST(CoreTest, DecodeFragments)
+{
+    const CoreDecoder decoder;
+    // Temperature y GPS, partidos dentro de la temperatura y del GPS
+    const std::vector<uint8_t> payload = {0x03, 0x67, 0x01, 0x10, 0x01, 0x88, 0x06, 0x76,
+                                          0x5f, 0x0d, 0x69, 0xf6, 0x00, 0x03, 0xe8};
+    const std::span<const uint8_t> bytes(payload);
+    const std::array<std::span<const uint8_t>, 3> fragments = {
+        bytes.first(3), bytes.subspan(3, 7), bytes.subspan(10)};
+
+    std::array<Reading, 4> readings{};
+    std::array<uint8_t, 16> scratch{};
+    auto res = decoder.decode(fragments, readings, scratch);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(*res, 2U);
+    EXPECT_DOUBLE_EQ(readings[0].value(), 27.2);
+    EXPECT_DOUBLE_EQ(readings[1].value(0), 42.3519);
+    EXPECT_DOUBLE_EQ(readings[1].value(2), 10.0);
+    EXPECT_EQ(readings[0].bytes.data(), scratch.data());
+    EXPECT_EQ(readings[1].bytes.data(), scratch.data() + 2);
+
+    // Sin campos partidos no hace falta scratch
+    const std::array<std::span<const uint8_t>, 2> aligned = {bytes.first(4), bytes.subspan(4)};
+    res = decoder.decode(aligned, readings, {});
+    ASSERT_TRUE(res);
+    EXPECT_EQ(readings[1].bytes.data(), payload.data() + 6);
+
+    EXPECT_EQ(decoder.decode(fragments, readings, std::span(scratch).first(8)).error(),
+              Error::BufferTooSmall);
+    EXPECT_EQ(decoder.decode(PayloadFragments(), readings, scratch).error(),
+              Error::PayloadEmpty);
+    const std::array<std::span<const uint8_t>, 2> truncated = {bytes.first(3), bytes.subspan(3, 2)};
+    EXPECT_EQ(decoder.decode(truncated, readings, scratch).error(), Error::BadPayloadFormat);
+}
+
+// Test that custom types decode to their bytes only
+TEST(CoreTest, DecodeCustomType)
+{
+    CoreDecoder decoder;
+    ASSERT_TRUE(decoder.add_type(0xC8, 3));
+    EXPECT_FALSE(decoder.add_type(0xC8, 3));
+
+    const std::vector<uint8_t> payload = {0x04, 0xC8, 0xAA, 0xBB, 0xCC};
+    ReadingBuffer<4> buffer;
+    ASSERT_TRUE(decoder.decode(payload, buffer));
+    ASSERT_EQ(buffer.size(), 1U);
+    EXPECT_EQ(buffer[0].type_id, 0xC8);
+    EXPECT_EQ(buffer[0].component_count, 0);
+    ASSERT_EQ(buffer[0].bytes.size(), 3U);
+    EXPECT_EQ(buffer[0].bytes[2], 0xCC);
+}
+
+// Test length-prefixed types: the first byte counts the units after it
+TEST(CoreTest, DecodeLengthPrefixedType)
+{
+    CoreDecoder decoder;
+    ASSERT_TRUE(decoder.add_prefixed_type(0xCA, 2));
+    EXPECT_FALSE(decoder.add_prefixed_type(0xCA, 2));
+
+    // Dos puntos de 2 bytes, una lista vacía y una temperatura detrás
+    const std::vector<uint8_t> payload = {0x05, 0xCA, 0x02, 0x11, 0x22, 0x33, 0x44, 0x06,
+                                          0xCA, 0x00, 0x01, 0x67, 0x01, 0x10};
+    ReadingBuffer<4> buffer;
+    ASSERT_TRUE(decoder.decode(payload, buffer));
+    ASSERT_EQ(buffer.size(), 3U);
+    EXPECT_EQ(buffer[0].component_count, 0);
+    ASSERT_EQ(buffer[0].bytes.size(), 5U);
+    EXPECT_EQ(buffer[0].bytes[0], 0x02);
+    EXPECT_EQ(buffer[0].bytes[4], 0x44);
+    EXPECT_EQ(buffer[1].channel, 6);
+    EXPECT_EQ(buffer[1].bytes.size(), 1U);
+    EXPECT_DOUBLE_EQ(buffer[2].value(), 27.2);
+    EXPECT_EQ(decoder.validate(payload).value_or(0), 3U);
+
+    // Partido dentro de la lista, con el byte de longitud en otro fragmento
+    const std::span<const uint8_t> bytes(payload);
+    const std::array<std::span<const uint8_t>, 3> fragments = {
+        bytes.first(2), bytes.subspan(2, 2), bytes.subspan(4)};
+    std::array<Reading, 4> readings{};
+    std::array<uint8_t, 16> scratch{};
+    const auto res = decoder.decode(fragments, readings, scratch);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(*res, 3U);
+    EXPECT_EQ(readings[0].bytes.size(), 5U);
+    EXPECT_EQ(readings[0].bytes[3], 0x33);
+
+    // La longitud pide más bytes de los que quedan
+    const std::vector<uint8_t> truncated = {0x05, 0xCA, 0x03, 0x11, 0x22, 0x33, 0x44};
+    EXPECT_EQ(decoder.decode(truncated, buffer).error(), Error::BadPayloadFormat);
+    EXPECT_EQ(decoder.validate(truncated).error(), Error::BadPayloadFormat);
+
+    // 1 + 255 * 2 bytes no cabe en un campo, aunque la trama los tuviera
+    CoreDecoder wide;
+    ASSERT_TRUE(wide.add_prefixed_type(0xCB, 2));
+    std::vector<uint8_t> oversized = {0x01, 0xCB, 0xFF};
+    oversized.resize(3 + 255 * 2);
+    EXPECT_EQ(wide.decode(oversized, buffer).error(), Error::BadPayloadFormat);
+    EXPECT_EQ(wide.validate(oversized).error(), Error::BadPayloadFormat);
+}
+
+// Test that validate classifies payloads exactly like decode
+TEST(CoreTest, ValidateMatchesDecode)
+{
+    CoreDecoder decoder;
+    ASSERT_TRUE(decoder.add_type(0xC8, 3));
+    ASSERT_TRUE(decoder.add_prefixed_type(0xCA, 2));
+    const std::vector<std::vector<uint8_t>> payloads = {
+        {},
+        {0x01},
+        {0x01, 0x67},
+        {0x01, 0xFF, 0x00},
+        {0x01, 0x67, 0x01},
+        {0x01, 0x67, 0x01, 0x10},
+        {0x01, 0x67, 0x01, 0x10, 0x02},
+        {0x01, 0x67, 0x01, 0x10, 0x02, 0x66},
+        {0x01, 0x67, 0x01, 0x10, 0x02, 0xFF, 0x00},
+        {0x01, 0x67, 0x01, 0x10, 0x02, 0x88, 0x00},
+        {0x04, 0xC8, 0xAA, 0xBB, 0xCC, 0x02, 0x66, 0x01},
+        {0x04, 0xC9, 0xAA, 0xBB, 0xCC},
+        {0x04, 0xCA, 0x01, 0xAA, 0xBB, 0x02, 0x66, 0x01},
+        {0x04, 0xCA, 0x02, 0xAA, 0xBB},
+        {0x04, 0xCA, 0x00},
+    };
+
+    for (const auto& payload : payloads)
+    {
+        ReadingBuffer<8> buffer;
+        const auto decoded = decoder.decode(payload, buffer);
+        const auto validated = decoder.validate(payload);
+        ASSERT_EQ(validated.has_value(), decoded.has_value()) << payload.size();
+        if (decoded)
+        {
+            EXPECT_EQ(*validated, *decoded);
+        }
+        else
+        {
+            EXPECT_EQ(validated.error(), decoded.error());
+        }
+    }
+
+    // Sin tabla usa los tipos estándar
+    EXPECT_EQ(validate(payloads[5]).value_or(0), 1U);
+    EXPECT_EQ(validate(payloads[10]).error(), Error::UnkwownDataType);
+}
+
+// Test validating a batch
+TEST(CoreTest, ValidateBatch)
+{
+    const std::vector<uint8_t> good = {0x01, 0x67, 0x01, 0x10, 0x02, 0x66, 0x01};
+    const std::vector<uint8_t> unknown = {0x01, 0xFF, 0x00};
+    const std::vector<uint8_t> truncated = {0x01, 0x88, 0x00};
+    const std::array<std::span<const uint8_t>, 4> payloads = {good, unknown, {}, truncated};
+
+    std::array<Validation, 4> results{};
+    auto valid = validate_batch(TypeTable::standard(), payloads, results);
+    ASSERT_TRUE(valid);
+    EXPECT_EQ(*valid, 1U);
+    EXPECT_EQ(results[0].error, Error::None);
+    EXPECT_EQ(results[0].field_count, 2U);
+    EXPECT_EQ(results[1].error, Error::UnkwownDataType);
+    EXPECT_EQ(results[2].error, Error::PayloadEmpty);
+    EXPECT_EQ(results[3].error, Error::BadPayloadFormat);
+    EXPECT_EQ(results[3].field_count, 0U);
+
+    EXPECT_EQ(validate_batch(TypeTable::standard(), payloads, std::span(results).first(3)).error(),
+              Error::BufferTooSmall);
+}
+
+// Test splitting a multi-sample payload into timestamped records
+TEST(CoreTest, DecodeTimestampedRecords)
+{
+    const CoreDecoder decoder;
+    // Temperatura sin fecha, y dos muestras tras sendas marcas de tiempo
+    const std::vector<uint8_t> payload = {
+        0x03, 0x67, 0x01, 0x10,                    // 27.2, before any Unix Time
+        0x00, 0x85, 0x65, 0x5F, 0x1A, 0x00,        // 1700731392
+        0x03, 0x67, 0x00, 0xF0,                    // 24.0
+        0x00, 0x85, 0x65, 0x5F, 0x1A, 0x3C,        // 60 s later
+        0x03, 0x67, 0x00, 0xFA, 0x02, 0x68, 0x01, 0xF4};  // 25.0 and 50 %
+
+    std::array<TimedReading, 8> records{};
+    auto res = decoder.decode_records(payload, records, 7);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(*res, 4U);
+    EXPECT_EQ(records[0].timestamp, 7U);
+    EXPECT_EQ(records[0].reading.raw[0], 272);
+    EXPECT_EQ(records[1].timestamp, 1700731392U);
+    EXPECT_EQ(records[1].reading.channel, 0x03);
+    EXPECT_EQ(records[1].reading.raw[0], 240);
+    EXPECT_EQ(records[2].timestamp, 1700731452U);
+    EXPECT_EQ(records[2].reading.raw[0], 250);
+    EXPECT_EQ(records[3].timestamp, 1700731452U);
+    EXPECT_EQ(records[3].reading.type_id, 0x68);
+    EXPECT_DOUBLE_EQ(records[3].reading.value(), 50.0);
+
+    // Las marcas no ocupan sitio en la salida, las lecturas sí
+    EXPECT_EQ(decoder.decode_records(payload, std::span(records).first(3)).error(),
+              Error::BufferTooSmall);
+    const std::vector<uint8_t> truncated = {0x03, 0x67, 0x01, 0x10, 0x00, 0x85, 0x65, 0x5F};
+    EXPECT_EQ(decoder.decode_records(truncated, records).error(), Error::BadPayloadFormat);
+
+    // Fuera de este modo 0x85 sigue sin ser un tipo estándar
+    std::array<Reading, 8> readings{};
+    EXPECT_EQ(decoder.decode(payload, readings).error(), Error::UnkwownDataType);
+}
+
+// Test that the core never touches the heap
+TEST(CoreTest, DecodeIsAllocationFree)
+{
+    const CoreDecoder decoder;
+    const std::vector<uint8_t> payload = {0x03, 0x67, 0x01, 0x10, 0x01, 0x88, 0x06, 0x76,
+                                          0x5f, 0x0d, 0x69, 0xf6, 0x00, 0x03, 0xe8};
+    const std::vector<uint8_t> unknown = {0x01, 0xFF, 0x00};
+    ReadingBuffer<4> buffer;
+
+    // La primera llamada del hilo reserva su shard de métricas (CAYENE_ENABLE_METRICS)
+    (void)decoder.decode(payload, buffer);
+
+    EXPECT_ALLOCATIONS_EQ(0, decoder.decode(payload, buffer));
+    EXPECT_ALLOCATIONS_EQ(0, decoder.decode(unknown, buffer));
+    EXPECT_ALLOCATIONS_EQ(0, decoder.validate(payload));
+    std::array<TimedReading, 4> records{};
+    EXPECT_ALLOCATIONS_EQ(0, decoder.decode_records(payload, records));
+    EXPECT_ALLOCATIONS_EQ(0, CoreDecoder());
+}
+
+}  // namespace cayene::test
@@ -251,4 +251,160 @@ TEST(DecoderTest, DecodeHumidity)
     EXPECT_DOUBLE_EQ(decoded5["Humidity_5"], 466.0);
 }
 
+// Test raw readings against the Json values
+TEST(DecoderTest, DecodeReadings)
+{
+    Decoder decoder;
+    std::vector<uint8_t> data = {0x03, 0x67, 0xFF, 0x9C, 0x06, 0x71, 0x04, 0xD2, 0xFB,
+                                 0x2E, 0x00, 0x00, 0x01, 0x88, 0x06, 0x76, 0x5f, 0x0d,
+                                 0x69, 0xf6, 0x00, 0x03, 0xe8};
+    std::array<Reading, 4> readings{};
+    auto res = decoder.decode_readings(data, readings);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res.value(), 3U);
+
+    EXPECT_EQ(readings[0].channel, 0x03);
+    EXPECT_EQ(readings[0].type_id, 0x67);
+    EXPECT_EQ(readings[0].component_count, 1);
+    EXPECT_EQ(readings[0].raw[0], -100);
+    EXPECT_DOUBLE_EQ(readings[0].value(), -10.0);
+
+    EXPECT_EQ(readings[1].component_count, 3);
+    EXPECT_DOUBLE_EQ(readings[1].value(0), 1.234);
+    EXPECT_DOUBLE_EQ(readings[1].value(1), -1.234);
+    EXPECT_DOUBLE_EQ(readings[1].value(2), 0.0);
+
+    auto json = decoder.decode(data);
+    ASSERT_TRUE(json);
+    EXPECT_DOUBLE_EQ(readings[2].value(0), json.value()["GPS_1"]["latitude"]);
+    EXPECT_DOUBLE_EQ(readings[2].value(1), json.value()["GPS_1"]["longitude"]);
+    EXPECT_DOUBLE_EQ(readings[2].value(2), json.value()["GPS_1"]["altitude"]);
+    EXPECT_EQ(readings[2].bytes.size(), 9U);
+}
+
+// Test readings error classification
+TEST(DecoderTest, DecodeReadingsErrors)
+{
+    Decoder decoder;
+    std::array<Reading, 1> readings{};
+
+    std::vector<uint8_t> empty;
+    EXPECT_EQ(decoder.decode_readings(empty, readings).error(), Error::PayloadEmpty);
+
+    std::vector<uint8_t> truncated = {0x01, 0x67, 0x01};
+    EXPECT_EQ(decoder.decode_readings(truncated, readings).error(), Error::BadPayloadFormat);
+
+    std::vector<uint8_t> unknown = {0x01, 0xFF, 0x00};
+    EXPECT_EQ(decoder.decode_readings(unknown, readings).error(), Error::UnkwownDataType);
+
+    std::vector<uint8_t> two_fields = {0x01, 0x66, 0x01, 0x02, 0x66, 0x00};
+    EXPECT_EQ(decoder.decode_readings(two_fields, readings).error(), Error::BufferTooSmall);
+}
+
+// Test that the largest payload of 1-byte fields fits max_payload_readings readings
+TEST(DecoderTest, DecodeReadingsOfLargestPayload)
+{
+    Decoder decoder;
+    std::vector<uint8_t> presences;
+    while (presences.size() + 3 <= max_payload_bytes)
+    {
+        presences.insert(presences.end(), {0x01, 0x66, 0x01});
+    }
+    ASSERT_GT(presences.size(), 242U);
+    std::array<Reading, max_payload_readings> readings{};
+    const auto count = decoder.decode_readings(presences, readings);
+    ASSERT_TRUE(count);
+    EXPECT_EQ(*count, max_payload_readings);
+}
+
+// Test that validate agrees with the Json decode, custom types included
+TEST(DecoderTest, ValidateMatchesDecode)
+{
+    Decoder decoder;
+    ASSERT_TRUE(decoder.add_data_type(0xC8, "Raw", 2));
+
+    std::vector<uint8_t> payload = {0x01, 0x67, 0x01, 0x10, 0x02, 0xC8, 0x12, 0x34};
+    ASSERT_TRUE(decoder.decode(payload));
+    EXPECT_EQ(decoder.validate(payload).value_or(0), 2U);
+
+    const std::vector<std::vector<uint8_t>> bad_payloads = {
+        {}, {0x01, 0xC9, 0x00}, {0x01, 0xC8, 0x12}, {0x01, 0x67, 0x01, 0x10, 0x02}};
+    for (auto bad : bad_payloads)
+    {
+        EXPECT_EQ(decoder.validate(bad).error(), decoder.decode(bad).error());
+    }
+}
+
+// Test decoding read-only buffers of other byte types without copies
+TEST(DecoderTest, DecodeConstInputs)
+{
+    const Decoder decoder;
+    const std::vector<uint8_t> payload = {0x01, 0x67, 0x01, 0x10};
+    auto expected = decoder.decode(payload);
+    ASSERT_TRUE(expected);
+
+    const std::string_view text("\x01\x67\x01\x10", 4);
+    EXPECT_EQ(decoder.decode(text), expected);
+
+    const std::array<std::byte, 4> bytes = {std::byte{0x01}, std::byte{0x67}, std::byte{0x01},
+                                            std::byte{0x10}};
+    EXPECT_EQ(decoder.decode(std::span(bytes)), expected);
+}
+
+// Test that every split of a payload into fragments decodes like the whole
+TEST(DecoderTest, DecodeFragments)
+{
+    Decoder decoder;
+    ASSERT_TRUE(decoder.add_data_type(0xC8, "Raw", 3));
+    const std::vector<uint8_t> payload = {0x03, 0x67, 0x01, 0x10, 0x01, 0x88, 0x06, 0x76,
+                                          0x5f, 0x0d, 0x69, 0xf6, 0x00, 0x03, 0xe8, 0x02,
+                                          0xC8, 0xAA, 0xBB, 0xCC};
+    const auto whole = decoder.decode(payload);
+    ASSERT_TRUE(whole);
+
+    const std::span<const uint8_t> bytes(payload);
+    for (std::size_t first = 0; first <= payload.size(); ++first)
+    {
+        for (std::size_t second = first; second <= payload.size(); ++second)
+        {
+            const std::array<std::span<const uint8_t>, 3> fragments = {
+                bytes.subspan(0, first), bytes.subspan(first, second - first),
+                bytes.subspan(second)};
+            EXPECT_EQ(decoder.decode(PayloadFragments(fragments)), whole) << first << " " << second;
+        }
+    }
+
+    // Los errores también coinciden con el caso contiguo
+    const std::array<std::span<const uint8_t>, 2> truncated = {bytes.first(5), bytes.subspan(5, 3)};
+    EXPECT_EQ(decoder.decode(PayloadFragments(truncated)).error(), Error::BadPayloadFormat);
+    EXPECT_EQ(decoder.decode(PayloadFragments()).error(), Error::PayloadEmpty);
+
+    std::array<iovec, 2> buffers = {
+        iovec{const_cast<uint8_t*>(payload.data()), 7},
+        iovec{const_cast<uint8_t*>(payload.data()) + 7, payload.size() - 7}};
+    EXPECT_EQ(decoder.decode(std::span<const iovec>(buffers)), whole);
+}
+
+// Test a decoder built from one tenant of a registry image
+TEST(DecoderTest, DecoderFromRegistryTenant)
+{
+    RegistryBuilder builder;
+    ASSERT_TRUE(builder.add_tenant("acme"));
+    ASSERT_TRUE(builder.add_type("acme", 0xC8, "Soil Moisture", 2));
+    const auto image = builder.serialize();
+    auto view = RegistryView::from_bytes(image);
+    ASSERT_TRUE(view);
+
+    Decoder decoder(*view->find("acme"));
+    std::vector<uint8_t> payload = {0x01, 0x67, 0x01, 0x10};
+    auto res = decoder.decode(payload);
+    ASSERT_TRUE(res);
+    EXPECT_DOUBLE_EQ(res.value()["Temperature_1"], 27.2);
+
+    std::vector<uint8_t> custom = {0x02, 0xC8, 0x12, 0x34};
+    std::array<Reading, 1> readings{};
+    ASSERT_TRUE(decoder.decode_readings(custom, readings));
+    EXPECT_EQ(readings[0].bytes.size(), 2U);
+}
+
 }  // namespace cayene::test
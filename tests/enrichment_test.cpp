@@ -0,0 +1,210 @@
+/**
+ * @file enrichment_test.cpp
+ * @brief Unit tests for the device metadata index
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/enrichment.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+auto eui(std::size_t i) -> std::string
+{
+    return std::format("70B3D57ED{:07X}", i);
+}
+
+auto fleet(std::size_t count) -> std::vector<DeviceMetadata>
+{
+    std::vector<DeviceMetadata> devices;
+    devices.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        devices.push_back({eui(i), std::format("site-{}", i % 100), std::format("tenant-{}", i % 7),
+                           1.0F + static_cast<float>(i % 10) / 10, static_cast<float>(i % 3)});
+    }
+    return devices;
+}
+
+void write_file(const std::string& path, const std::string& contents)
+{
+    // Se escribe aparte y se renombra, como lo haría un despliegue
+    const std::string temporary = path + ".tmp";
+    std::ofstream(temporary) << contents;
+    std::filesystem::rename(temporary, path);
+}
+
+}  // namespace
+
+TEST(EnrichmentTest, DeviceKey)
+{
+    EXPECT_EQ(device_key("70B3D57ED0000001"), 0x70B3D57ED0000001U);
+    EXPECT_EQ(device_key("70b3d57ed0000001"), 0x70B3D57ED0000001U);
+    // Otros ids se convierten con un hash
+    EXPECT_NE(device_key("my-sensor"), device_key("my-sensor-2"));
+    EXPECT_NE(device_key("70B3D57ED000000G"), device_key("70B3D57ED000000F"));
+}
+
+TEST(EnrichmentTest, EveryDeviceFoundInItsSlot)
+{
+    constexpr std::size_t count = 100'000;
+    const auto devices = fleet(count);
+    auto index = DeviceIndex::build(devices);
+    ASSERT_TRUE(index) << index.error().message;
+    EXPECT_EQ(index->size(), count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const auto info = index->find(devices[i].device_id);
+        ASSERT_TRUE(info) << devices[i].device_id;
+        EXPECT_EQ(info->site, devices[i].site);
+        EXPECT_EQ(info->tenant, devices[i].tenant);
+        EXPECT_EQ(info->gain, devices[i].gain);
+        EXPECT_EQ(info->offset, devices[i].offset);
+    }
+    EXPECT_FALSE(index->find(eui(count)));
+    EXPECT_FALSE(index->find("unknown"));
+
+    // 24 bytes de registro y ~1 de desplazamiento por dispositivo, más 107 nombres
+    EXPECT_LT(index->memory_bytes(), count * 26 + 107 * 64);
+}
+
+TEST(EnrichmentTest, EmptyAndSmallIndexes)
+{
+    auto empty = DeviceIndex::build({});
+    ASSERT_TRUE(empty);
+    EXPECT_FALSE(empty->find("70B3D57ED0000001"));
+
+    for (std::size_t count = 1; count < 20; ++count)
+    {
+        const auto devices = fleet(count);
+        auto index = DeviceIndex::build(devices);
+        ASSERT_TRUE(index);
+        for (const auto& device : devices)
+        {
+            EXPECT_TRUE(index->find(device.device_id)) << count;
+        }
+    }
+}
+
+TEST(EnrichmentTest, DuplicateDevices)
+{
+    const std::vector<DeviceMetadata> devices = {{"70B3D57ED0000001", "a", "t"},
+                                                 {"70b3d57ed0000001", "b", "t"}};
+    auto index = DeviceIndex::build(devices);
+    ASSERT_FALSE(index);
+    EXPECT_EQ(index.error().code, ConfigErrorCode::Invalid);
+    EXPECT_NE(index.error().message.find("duplicate device"), std::string::npos);
+}
+
+TEST(EnrichmentTest, ParseDeviceList)
+{
+    auto index = DeviceIndex::parse("# device_id,site,tenant,gain,offset\r\n"
+                                    "70B3D57ED0000001,plant-a,acme,1.5,-2\r\n"
+                                    "\n"
+                                    "my-sensor,plant-b,acme\n");
+    ASSERT_TRUE(index) << index.error().message;
+    EXPECT_EQ(index->size(), 2U);
+
+    const auto info = index->find("70B3D57ED0000001");
+    ASSERT_TRUE(info);
+    EXPECT_EQ(info->site, "plant-a");
+    EXPECT_EQ(info->gain, 1.5F);
+    EXPECT_EQ(info->offset, -2.0F);
+
+    Json line{{"device_id", "my-sensor"}};
+    EXPECT_TRUE(index->enrich("my-sensor", line));
+    EXPECT_EQ(line["device"]["site"], "plant-b");
+    EXPECT_EQ(line["device"]["tenant"], "acme");
+    EXPECT_EQ(line["device"]["calibration"]["gain"], 1.0);
+    EXPECT_FALSE(index->enrich("other", line));
+}
+
+TEST(EnrichmentTest, ParseErrors)
+{
+    auto fields = DeviceIndex::parse("70B3D57ED0000001,plant-a,acme\nonly,two\n");
+    ASSERT_FALSE(fields);
+    EXPECT_EQ(fields.error().code, ConfigErrorCode::Syntax);
+    EXPECT_EQ(fields.error().message, "line 2: expected device_id,site,tenant[,gain[,offset]]");
+
+    auto gain = DeviceIndex::parse("70B3D57ED0000001,plant-a,acme,fast\n");
+    ASSERT_FALSE(gain);
+    EXPECT_EQ(gain.error().message, "line 1: bad gain");
+
+    auto missing = DeviceIndex::load("/nonexistent/devices.csv");
+    ASSERT_FALSE(missing);
+    EXPECT_EQ(missing.error().code, ConfigErrorCode::Io);
+}
+
+TEST(EnrichmentTest, EnricherReloadsChangedFile)
+{
+    const std::string path = (std::filesystem::temp_directory_path() /
+                              std::format("cayene_devices_{}.csv", ::getpid()))
+                                 .string();
+    write_file(path, "70B3D57ED0000001,plant-a,acme\n");
+
+    auto enricher = DeviceEnricher::open(path, std::chrono::hours(1));
+    ASSERT_TRUE(enricher) << enricher.error().message;
+    const auto before = (*enricher)->index();
+    EXPECT_TRUE(before->find("70B3D57ED0000001"));
+    EXPECT_FALSE(before->find("70B3D57ED0000002"));
+
+    write_file(path, "70B3D57ED0000001,plant-a,acme\n70B3D57ED0000002,plant-b,acme\n");
+    (*enricher)->reload();
+    EXPECT_TRUE((*enricher)->index()->find("70B3D57ED0000002"));
+    // Quien tenía el índice anterior lo sigue usando
+    EXPECT_FALSE(before->find("70B3D57ED0000002"));
+    EXPECT_EQ((*enricher)->stats().reloads, 1U);
+    EXPECT_EQ((*enricher)->stats().devices, 2U);
+
+    // Un fichero roto no sustituye al índice bueno
+    write_file(path, "70B3D57ED0000001,plant-a\n");
+    (*enricher)->reload();
+    EXPECT_TRUE((*enricher)->index()->find("70B3D57ED0000002"));
+    const auto stats = (*enricher)->stats();
+    EXPECT_EQ(stats.failed_reloads, 1U);
+    EXPECT_EQ(stats.last_error, "line 1: expected device_id,site,tenant[,gain[,offset]]");
+    std::remove(path.c_str());
+}
+
+TEST(EnrichmentTest, EnricherWatchesFile)
+{
+    const std::string path = (std::filesystem::temp_directory_path() /
+                              std::format("cayene_watch_{}.csv", ::getpid()))
+                                 .string();
+    write_file(path, "70B3D57ED0000001,plant-a,acme\n");
+    auto enricher = DeviceEnricher::open(path, std::chrono::milliseconds(5));
+    ASSERT_TRUE(enricher);
+
+    // Fecha distinta aunque el sistema de ficheros tenga poca resolución
+    write_file(path, "70B3D57ED0000003,plant-c,acme\n");
+    std::filesystem::last_write_time(
+        path, std::filesystem::last_write_time(path) + std::chrono::seconds(10));
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!(*enricher)->index()->find("70B3D57ED0000003") &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE((*enricher)->index()->find("70B3D57ED0000003"));
+    std::remove(path.c_str());
+}
+
+}  // namespace cayene::ingest::test
@@ -0,0 +1,152 @@
+/**
+ * @file envelope_test.cpp
+ * @brief Unit tests for webhook envelope parsing and base64 decoding
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/envelope.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+// Temperatura 27.2 y humedad 40 %
+constexpr std::string_view ttn_uplink = R"({
+    "end_device_ids": {
+        "device_id": "eui-70b3d57ed0000001",
+        "application_ids": { "application_id": "farm" },
+        "dev_eui": "70B3D57ED0000001"
+    },
+    "correlation_ids": ["as:up:01H", "gs:uplink:01H"],
+    "received_at": "2024-05-01T10:00:00Z",
+    "uplink_message": {
+        "f_port": 2,
+        "f_cnt": 17,
+        "frm_payload": "A2cBEAVoAZA=",
+        "rx_metadata": [ { "gateway_ids": { "gateway_id": "gw-1" }, "rssi": -42, "snr": 9.5 } ],
+        "settings": { "data_rate": { "lora": { "bandwidth": 125000 } } }
+    }
+})";
+
+constexpr std::string_view chirpstack_uplink = R"({
+    "deduplicationId": "3ac7e3c4-4401-4b8d-9386-a5c902f9202d",
+    "time": "2024-05-01T10:00:00Z",
+    "deviceInfo": { "tenantName": "farm", "deviceName": "soil-1",
+                    "devEui": "0101010101010101", "tags": {} },
+    "devAddr": "00189440",
+    "fCnt": 10,
+    "fPort": 5,
+    "data": "AWcA/w==",
+    "rxInfo": [ { "gatewayId": "0016c001f153a14c", "rssi": -60 } ]
+})";
+
+}  // namespace
+
+// Test pulling the uplink out of a The Things Stack webhook
+TEST(EnvelopeTest, TheThingsStack)
+{
+    std::array<uint8_t, 64> storage{};
+    auto uplink = parse_envelope(ttn_uplink, storage);
+    ASSERT_TRUE(uplink) << envelope_error_name(uplink.error());
+    EXPECT_EQ(uplink->format, EnvelopeFormat::TheThingsStack);
+    EXPECT_EQ(uplink->device_id, "eui-70b3d57ed0000001");
+    EXPECT_EQ(uplink->fport, 2);
+    const std::vector<uint8_t> expected = {0x03, 0x67, 0x01, 0x10,
+                                          0x05, 0x68, 0x01, 0x90};
+    EXPECT_EQ(std::vector<uint8_t>(uplink->payload.begin(), uplink->payload.end()), expected);
+    EXPECT_EQ(uplink->payload.data(), storage.data());
+}
+
+// Test pulling the uplink out of a ChirpStack webhook
+TEST(EnvelopeTest, ChirpStack)
+{
+    std::array<uint8_t, 64> storage{};
+    auto uplink = parse_envelope(chirpstack_uplink, storage);
+    ASSERT_TRUE(uplink) << envelope_error_name(uplink.error());
+    EXPECT_EQ(uplink->format, EnvelopeFormat::ChirpStack);
+    EXPECT_EQ(uplink->device_id, "0101010101010101");
+    EXPECT_EQ(uplink->fport, 5);
+    const std::vector<uint8_t> expected = {0x01, 0x67, 0x00, 0xFF};
+    EXPECT_EQ(std::vector<uint8_t>(uplink->payload.begin(), uplink->payload.end()), expected);
+}
+
+// Test that uplinks without application payload are reported as such
+TEST(EnvelopeTest, MissingPayload)
+{
+    std::array<uint8_t, 16> storage{};
+    constexpr std::string_view mac_only =
+        R"({"end_device_ids":{"device_id":"d"},"uplink_message":{"f_cnt":3}})";
+    EXPECT_EQ(parse_envelope(mac_only, storage).error(), EnvelopeError::MissingPayload);
+
+    constexpr std::string_view no_data = R"({"deviceInfo":{"devEui":"01"},"fPort":0})";
+    EXPECT_EQ(parse_envelope(no_data, storage).error(), EnvelopeError::MissingPayload);
+}
+
+// Test rejection of malformed and unknown envelopes
+TEST(EnvelopeTest, Errors)
+{
+    std::array<uint8_t, 4> storage{};
+    EXPECT_EQ(parse_envelope("", storage).error(), EnvelopeError::Malformed);
+    EXPECT_EQ(parse_envelope("[1, 2]", storage).error(), EnvelopeError::Malformed);
+    EXPECT_EQ(parse_envelope(R"({"uplink_message": )", storage).error(),
+              EnvelopeError::Malformed);
+    EXPECT_EQ(parse_envelope(R"({"hello": "world"})", storage).error(),
+              EnvelopeError::UnknownFormat);
+
+    // f_port fuera de rango y payload que no es una cadena
+    EXPECT_EQ(parse_envelope(R"({"deviceInfo":{"devEui":"01"},"fPort":300,"data":"AQ=="})",
+                             storage)
+                  .error(),
+              EnvelopeError::Malformed);
+    EXPECT_EQ(parse_envelope(R"({"deviceInfo":{"devEui":"01"},"fPort":1,"data":7})", storage)
+                  .error(),
+              EnvelopeError::Malformed);
+
+    EXPECT_EQ(parse_envelope(R"({"deviceInfo":{"devEui":"01"},"fPort":1,"data":"A*=="})",
+                             storage)
+                  .error(),
+              EnvelopeError::BadBase64);
+    EXPECT_EQ(parse_envelope(R"({"deviceInfo":{"devEui":"01"},"fPort":1,"data":"AQIDBAU="})",
+                             storage)
+                  .error(),
+              EnvelopeError::PayloadTooLarge);
+}
+
+// Test base64 decoding edge cases
+TEST(EnvelopeTest, Base64)
+{
+    std::array<uint8_t, 8> out{};
+    EXPECT_EQ(base64_decode("", out), 0U);
+    EXPECT_EQ(base64_decode("AQ==", out), 1U);
+    EXPECT_EQ(out[0], 0x01);
+    EXPECT_EQ(base64_decode("AQID", out), 3U);
+    EXPECT_EQ(out[2], 0x03);
+
+    // Sin relleno, y con "\/" escapado por el serializador JSON
+    EXPECT_EQ(base64_decode("AP8", out), 2U);
+    EXPECT_EQ(out[1], 0xFF);
+    EXPECT_EQ(base64_decode(R"(A\/8=)", out), 2U);
+    EXPECT_EQ(out[1], 0xFF);
+
+    EXPECT_EQ(base64_decode("A", out).error(), EnvelopeError::BadBase64);
+    EXPECT_EQ(base64_decode("AR==", out).error(), EnvelopeError::BadBase64);
+    EXPECT_EQ(base64_decode("AQ==AQ==", out).error(), EnvelopeError::BadBase64);
+    EXPECT_EQ(base64_decode("AQ===", out).error(), EnvelopeError::BadBase64);
+
+    static_assert(base64_decoded_size(4) == 3);
+    static_assert(base64_decoded_size(3) == 3);
+    static_assert(base64_decoded_size(0) == 0);
+}
+
+}  // namespace cayene::ingest::test
@@ -0,0 +1,313 @@
+/**
+ * @file geofence_test.cpp
+ * @brief Unit tests for the geofence index and tracker
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/geofence.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "cayene/core.hpp"
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+auto square(std::string name, int32_t lat, int32_t lon, int32_t side) -> Geofence
+{
+    return {std::move(name), {{lat, lon}, {lat, lon + side}, {lat + side, lon + side},
+                              {lat + side, lon}}};
+}
+
+// Referencia sin rejilla en coma flotante; nullopt sobre un borde, que cae de cualquier lado
+auto inside_reference(const Geofence& fence, GeoPoint point) -> std::optional<bool>
+{
+    bool inside = false;
+    const auto& polygon = fence.polygon;
+    for (std::size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+    {
+        const GeoPoint& a = polygon[i];
+        const GeoPoint& b = polygon[j];
+        const int64_t cross = (int64_t{b.lon} - a.lon) * (int64_t{point.lat} - a.lat) -
+                              (int64_t{b.lat} - a.lat) * (int64_t{point.lon} - a.lon);
+        if (cross == 0 && point.lat >= std::min(a.lat, b.lat) &&
+            point.lat <= std::max(a.lat, b.lat) && point.lon >= std::min(a.lon, b.lon) &&
+            point.lon <= std::max(a.lon, b.lon))
+        {
+            return std::nullopt;
+        }
+        if ((a.lat > point.lat) != (b.lat > point.lat))
+        {
+            const double lon = a.lon + static_cast<double>(point.lat - a.lat) * (b.lon - a.lon) /
+                                           (b.lat - a.lat);
+            if (point.lon < lon)
+            {
+                inside = !inside;
+            }
+        }
+    }
+    return inside;
+}
+
+}  // namespace
+
+TEST(GeofenceTest, PointInPolygon)
+{
+    // Una "L": el hueco de la esquina queda fuera
+    std::vector<Geofence> fences = {
+        {"ell", {{0, 0}, {0, 200}, {100, 200}, {100, 100}, {200, 100}, {200, 0}}},
+        square("overlap", 50, 50, 100),
+    };
+    auto index = GeofenceIndex::build(std::move(fences));
+    ASSERT_TRUE(index) << index.error().message;
+    EXPECT_EQ(index->size(), 2U);
+
+    std::vector<uint32_t> inside;
+    index->containing({10, 10}, inside);
+    EXPECT_EQ(inside, std::vector<uint32_t>{0});
+    index->containing({75, 75}, inside);
+    EXPECT_EQ(inside, (std::vector<uint32_t>{0, 1}));
+    index->containing({140, 140}, inside);
+    EXPECT_EQ(inside, std::vector<uint32_t>{1});
+    index->containing({180, 180}, inside);
+    EXPECT_TRUE(inside.empty());
+    index->containing({-10, 10}, inside);
+    EXPECT_TRUE(inside.empty());
+    EXPECT_EQ(index->name(1), "overlap");
+}
+
+TEST(GeofenceTest, GridMatchesBruteForce)
+{
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int32_t> position(-20'000, 20'000);
+    std::uniform_int_distribution<int32_t> size(10, 2'000);
+
+    // Triángulos y cuadrados repartidos por unos 4x4 grados
+    std::vector<Geofence> fences;
+    for (std::size_t i = 0; i < 2'000; ++i)
+    {
+        const int32_t lat = position(random);
+        const int32_t lon = position(random);
+        const int32_t side = size(random);
+        if (i % 2 == 0)
+        {
+            fences.push_back(square(std::format("square-{}", i), lat, lon, side));
+        }
+        else
+        {
+            fences.push_back({std::format("triangle-{}", i),
+                              {{lat, lon}, {lat + side, lon + side / 3}, {lat, lon + side}}});
+        }
+    }
+    auto index = GeofenceIndex::build(fences);
+    ASSERT_TRUE(index);
+    EXPECT_GE(index->cells(), 1'000U);
+
+    std::vector<uint32_t> inside;
+    std::size_t hits = 0;
+    for (std::size_t i = 0; i < 20'000; ++i)
+    {
+        const GeoPoint point{position(random), position(random)};
+        std::vector<uint32_t> expected;
+        bool on_edge = false;
+        for (uint32_t fence = 0; fence < fences.size(); ++fence)
+        {
+            const auto reference = inside_reference(fences[fence], point);
+            on_edge = on_edge || !reference;
+            if (reference.value_or(false))
+            {
+                expected.push_back(fence);
+            }
+        }
+        if (on_edge)
+        {
+            continue;
+        }
+        index->containing(point, inside);
+        EXPECT_EQ(inside, expected) << point.lat << "," << point.lon;
+        hits += inside.size();
+    }
+    EXPECT_GT(hits, 0U);
+}
+
+TEST(GeofenceTest, TrackerReportsTransitionsOnly)
+{
+    auto index = GeofenceIndex::build({square("yard", 0, 0, 100), square("dock", 50, 50, 100)});
+    ASSERT_TRUE(index);
+    GeofenceTracker tracker(std::make_shared<const GeofenceIndex>(std::move(*index)));
+
+    std::vector<GeofenceEvent> events;
+    EXPECT_EQ(tracker.update("70B3D57ED0000001", GeoPoint{-10, -10}, events), 0U);
+    EXPECT_EQ(tracker.devices(), 0U);
+
+    EXPECT_EQ(tracker.update("70B3D57ED0000001", GeoPoint{10, 10}, events), 1U);
+    ASSERT_EQ(events.size(), 1U);
+    EXPECT_EQ(events[0].fence, 0U);
+    EXPECT_EQ(events[0].transition, GeofenceTransition::Enter);
+
+    // Sigue dentro: nada que contar
+    EXPECT_EQ(tracker.update("70B3D57ED0000001", GeoPoint{20, 20}, events), 0U);
+
+    events.clear();
+    EXPECT_EQ(tracker.update("70B3D57ED0000001", GeoPoint{120, 120}, events), 2U);
+    ASSERT_EQ(events.size(), 2U);
+    EXPECT_EQ(events[0].fence, 0U);
+    EXPECT_EQ(events[0].transition, GeofenceTransition::Exit);
+    EXPECT_EQ(events[1].fence, 1U);
+    EXPECT_EQ(events[1].transition, GeofenceTransition::Enter);
+    EXPECT_EQ(tracker.devices(), 1U);
+
+    events.clear();
+    EXPECT_EQ(tracker.update("70B3D57ED0000001", GeoPoint{500, 500}, events), 1U);
+    EXPECT_EQ(events[0].transition, GeofenceTransition::Exit);
+    EXPECT_EQ(tracker.devices(), 0U);
+}
+
+TEST(GeofenceTest, TrackerReadsRawGpsReadings)
+{
+    // 42.3519, -87.9094 dentro de un cuadrado de 0.01 grados
+    auto index = GeofenceIndex::build({square("plant", 423500, -879100, 100)});
+    ASSERT_TRUE(index);
+    GeofenceTracker tracker(std::make_shared<const GeofenceIndex>(std::move(*index)));
+
+    const std::vector<uint8_t> payload = {0x03, 0x67, 0x01, 0x10, 0x05, 0x88, 0x06, 0x76,
+                                          0x5f, 0xf2, 0x96, 0x0a, 0x00, 0x03, 0xe8};
+    std::array<Reading, 4> readings{};
+    const auto count = CoreDecoder().decode(payload, readings);
+    ASSERT_TRUE(count);
+
+    std::vector<GeofenceEvent> events;
+    EXPECT_EQ(tracker.update("tracker-1", std::span(readings).first(*count), events), 1U);
+    EXPECT_EQ(tracker.index().name(events[0].fence), "plant");
+}
+
+TEST(GeofenceTest, AnnotateUplink)
+{
+    auto index = GeofenceIndex::build({square("plant", 423500, -879100, 100)});
+    ASSERT_TRUE(index);
+    GeofenceTracker tracker(std::make_shared<const GeofenceIndex>(std::move(*index)));
+    const auto catalog = TypeCatalog::parse("{}");
+    ASSERT_TRUE(catalog);
+
+    const std::vector<uint8_t> inside = {0x05, 0x88, 0x06, 0x76, 0x5f, 0xf2,
+                                         0x96, 0x0a, 0x00, 0x03, 0xe8};
+    Json line = Json::object();
+    Uplink uplink{EnvelopeFormat::ChirpStack, "70B3D57ED0000001", 2, inside};
+    EXPECT_EQ(tracker.annotate(*catalog, uplink, line), 1U);
+    EXPECT_EQ(line["geofence"], Json::parse(R"([{"fence": "plant", "event": "enter"}])"));
+
+    // Misma posición: la línea queda como estaba
+    Json unchanged = Json::object();
+    EXPECT_EQ(tracker.annotate(*catalog, uplink, unchanged), 0U);
+    EXPECT_FALSE(unchanged.contains("geofence"));
+
+    // Tramas que no se decodifican no cambian el estado
+    const std::vector<uint8_t> truncated = {0x05, 0x88, 0x00};
+    uplink.payload = truncated;
+    EXPECT_EQ(tracker.annotate(*catalog, uplink, unchanged), 0U);
+    EXPECT_EQ(tracker.devices(), 1U);
+
+    // Lecturas ya decodificadas por quien llama, compartidas con otras etapas
+    std::array<Reading, 4> readings{};
+    const auto count = catalog->decode_readings(2, inside, readings);
+    ASSERT_TRUE(count);
+    Uplink other{EnvelopeFormat::ChirpStack, "70B3D57ED0000002", 2, inside};
+    Json shared = Json::object();
+    EXPECT_EQ(tracker.annotate(other, std::span(readings).first(*count), shared), 1U);
+    EXPECT_EQ(shared["geofence"], Json::parse(R"([{"fence": "plant", "event": "enter"}])"));
+    EXPECT_EQ(tracker.devices(), 2U);
+}
+
+TEST(GeofenceTest, TrackerFromManyThreads)
+{
+    auto index = GeofenceIndex::build({square("zone", 0, 0, 100)});
+    ASSERT_TRUE(index);
+    GeofenceTracker tracker(std::make_shared<const GeofenceIndex>(std::move(*index)));
+
+    constexpr std::size_t threads = 4;
+    constexpr std::size_t devices = 1'000;
+    std::array<std::size_t, threads> counts{};
+    std::vector<std::jthread> workers;
+    for (std::size_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(
+            [&, t]
+            {
+                std::vector<GeofenceEvent> events;
+                for (std::size_t d = t; d < devices; d += threads)
+                {
+                    const std::string device = std::format("device-{}", d);
+                    for (int step = 0; step < 10; ++step)
+                    {
+                        const int32_t lat = step % 2 == 0 ? 50 : 150;
+                        counts[t] += tracker.update(device, GeoPoint{lat, 50}, events);
+                    }
+                }
+            });
+    }
+    workers.clear();
+
+    std::size_t total = 0;
+    for (const std::size_t count : counts)
+    {
+        total += count;
+    }
+    // Cada dispositivo entra y sale cinco veces
+    EXPECT_EQ(total, devices * 10);
+    EXPECT_EQ(tracker.devices(), 0U);
+}
+
+TEST(GeofenceTest, ParseGeofenceFile)
+{
+    auto index = GeofenceIndex::parse(R"({"fences": [
+        {"name": "depot", "polygon": [[42.35, -87.91], [42.35, -87.90], [42.36, -87.90]]}
+    ]})");
+    ASSERT_TRUE(index) << index.error().message;
+    std::vector<uint32_t> inside;
+    index->containing({423560, -879020}, inside);
+    EXPECT_EQ(inside, std::vector<uint32_t>{0});
+}
+
+TEST(GeofenceTest, ParseErrors)
+{
+    auto json = GeofenceIndex::parse("{");
+    ASSERT_FALSE(json);
+    EXPECT_EQ(json.error().code, ConfigErrorCode::Syntax);
+
+    auto vertex = GeofenceIndex::parse(
+        R"({"fences": [{"name": "a", "polygon": [[0, 0], [0, 1], [91, 0]]}]})");
+    ASSERT_FALSE(vertex);
+    EXPECT_EQ(vertex.error().message, "fences[0].polygon[2]: expected [lat, lon] in degrees");
+
+    auto small =
+        GeofenceIndex::parse(R"({"fences": [{"name": "a", "polygon": [[0, 0], [0, 1]]}]})");
+    ASSERT_FALSE(small);
+    EXPECT_EQ(small.error().message, "fence 'a': polygon needs at least 3 vertices");
+
+    auto duplicate = GeofenceIndex::build({square("a", 0, 0, 1), square("a", 5, 5, 1)});
+    ASSERT_FALSE(duplicate);
+    EXPECT_EQ(duplicate.error().message, "duplicate fence 'a'");
+
+    auto missing = GeofenceIndex::load("/nonexistent/fences.json");
+    ASSERT_FALSE(missing);
+    EXPECT_EQ(missing.error().code, ConfigErrorCode::Io);
+}
+
+}  // namespace cayene::ingest::test
@@ -0,0 +1,98 @@
+/**
+ * @file histogram_test.cpp
+ * @brief Unit tests for the log-linear latency histograms
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/histogram.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+
+#include <gtest/gtest.h>
+
+#include "cayene/metrics.hpp"
+
+namespace cayene::test
+{
+
+using namespace cayene::metrics;
+
+// Test that every value falls inside the bounds of its bucket
+TEST(HistogramTest, BucketBoundsContainValue)
+{
+    for (uint64_t value : std::initializer_list<uint64_t>{0, 1, 63, 64, 65, 127, 128, 1000, 123456,
+                                                        987654321, histogram_max_value})
+    {
+        const auto index = histogram_bucket_index(value);
+        EXPECT_LE(histogram_bucket_lower(index), value);
+        EXPECT_GE(histogram_bucket_upper(index), value);
+    }
+    EXPECT_EQ(histogram_bucket_index(histogram_max_value + 1000), histogram_bucket_count - 1);
+}
+
+// Test that buckets are contiguous and relative error is bounded
+TEST(HistogramTest, BucketsAreContiguous)
+{
+    for (std::size_t i = 0; i + 1 < histogram_bucket_count; ++i)
+    {
+        EXPECT_EQ(histogram_bucket_upper(i) + 1, histogram_bucket_lower(i + 1));
+        const auto lower = histogram_bucket_lower(i);
+        if (lower >= (uint64_t{1} << histogram_sub_bucket_bits))
+        {
+            const double width = static_cast<double>(histogram_bucket_upper(i) - lower + 1);
+            EXPECT_LE(width / static_cast<double>(lower), 1.0 / 32.0);
+        }
+    }
+}
+
+// Test percentile queries
+TEST(HistogramTest, Percentiles)
+{
+    Histogram histogram;
+    EXPECT_EQ(histogram.percentile(0.99), 0U);
+
+    for (uint64_t i = 1; i <= 1000; ++i)
+    {
+        histogram.record(i * 1000);
+    }
+    EXPECT_EQ(histogram.count(), 1000U);
+    EXPECT_EQ(histogram.max(), 1'000'000U);
+    EXPECT_NEAR(static_cast<double>(histogram.percentile(0.5)), 500'000.0, 500'000.0 / 32.0);
+    EXPECT_NEAR(static_cast<double>(histogram.percentile(0.99)), 990'000.0, 990'000.0 / 32.0);
+    EXPECT_EQ(histogram.percentile(1.0), 1'000'000U);
+}
+
+// Test merging histograms recorded separately
+TEST(HistogramTest, Merge)
+{
+    Histogram fast;
+    Histogram slow;
+    for (int i = 0; i < 990; ++i)
+    {
+        fast.record(50);
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+        slow.record(50'000);
+    }
+    fast.merge(slow);
+    EXPECT_EQ(fast.count(), 1000U);
+    EXPECT_EQ(fast.percentile(0.5), 50U);
+    EXPECT_GE(fast.percentile(0.999), 49'000U);
+}
+
+// Test the text dump
+TEST(HistogramTest, LatencyReport)
+{
+    Snapshot snap;
+    snap.stage_latency_ns[static_cast<std::size_t>(Stage::Decode)].record(42);
+    const auto report = latency_report(snap);
+    EXPECT_NE(report.find("stage=decode count=1 p50_ns=42"), std::string::npos);
+    EXPECT_NE(report.find("stage=key count=0"), std::string::npos);
+    EXPECT_NE(report.find("stage=serialize count=0"), std::string::npos);
+}
+
+}  // namespace cayene::test
@@ -0,0 +1,385 @@
+/**
+ * @file http_test.cpp
+ * @brief Unit tests for the HTTP parser and the webhook ingest server
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/http.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "cayene/ingest/http_server.hpp"
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+constexpr std::size_t max_body = 1024;
+
+auto post(std::string_view target, std::string_view body, std::string_view extra = {})
+    -> std::string
+{
+    return std::format("POST {} HTTP/1.1\r\nHost: test\r\n{}Content-Length: {}\r\n\r\n{}",
+                       target, extra, body.size(), body);
+}
+
+auto ttn_body(std::string_view device, int fport, std::string_view payload) -> std::string
+{
+    return std::format(R"({{"end_device_ids":{{"device_id":"{}"}},)"
+                       R"("uplink_message":{{"f_port":{},"frm_payload":"{}"}}}})",
+                       device, fport, payload);
+}
+
+// Cliente TCP bloqueante con timeout para no colgar el test
+class Client
+{
+public:
+    explicit Client(uint16_t port)
+    {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        timeval timeout{.tv_sec = 5, .tv_usec = 0};
+        ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        connected_ = ::connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    ~Client() { ::close(fd_); }
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+    Client(Client&&) = delete;
+    Client& operator=(Client&&) = delete;
+
+    [[nodiscard]] auto connected() const -> bool { return connected_; }
+
+    void send(std::string_view data) const
+    {
+        ASSERT_EQ(::send(fd_, data.data(), data.size(), MSG_NOSIGNAL),
+                  static_cast<ssize_t>(data.size()));
+    }
+
+    // Status lines of the next @p count responses
+    auto statuses(std::size_t count) -> std::vector<std::string>
+    {
+        std::vector<std::string> result;
+        while (result.size() < count)
+        {
+            const auto header_end = input_.find("\r\n\r\n");
+            if (header_end != std::string::npos)
+            {
+                std::size_t body = 0;
+                if (const auto length = input_.find("Content-Length: ");
+                    length != std::string::npos && length < header_end)
+                {
+                    body = std::stoul(input_.substr(length + 16));
+                }
+                if (input_.size() >= header_end + 4 + body)
+                {
+                    result.push_back(input_.substr(9, input_.find("\r\n") - 9));
+                    input_.erase(0, header_end + 4 + body);
+                    continue;
+                }
+            }
+            if (!receive())
+            {
+                break;
+            }
+        }
+        return result;
+    }
+
+    // Whether the server closed the connection
+    auto closed() -> bool { return input_.empty() && !receive(); }
+
+private:
+    auto receive() -> bool
+    {
+        std::array<char, 4096> buffer{};
+        const ssize_t received = ::recv(fd_, buffer.data(), buffer.size(), 0);
+        if (received <= 0)
+        {
+            return false;
+        }
+        input_.append(buffer.data(), static_cast<std::size_t>(received));
+        return true;
+    }
+
+    int fd_{-1};
+    bool connected_{false};
+    std::string input_;
+};
+
+}  // namespace
+
+// Test parsing a complete request in place
+TEST(HttpTest, ParseRequest)
+{
+    const std::string text = post("/uplink?token=1", "{}", "content-type: application/json\r\n");
+    HttpRequest request;
+    auto consumed = parse_request(text, request, max_body);
+    ASSERT_TRUE(consumed);
+    EXPECT_EQ(*consumed, text.size());
+    EXPECT_EQ(request.method, "POST");
+    EXPECT_EQ(request.target, "/uplink?token=1");
+    EXPECT_EQ(request.version_minor, 1);
+    EXPECT_EQ(request.header_count, 3U);
+    EXPECT_EQ(request.header("Content-Type"), "application/json");
+    EXPECT_EQ(request.header("HOST"), "test");
+    EXPECT_EQ(request.header("X-Missing"), "");
+    EXPECT_EQ(request.body, "{}");
+    EXPECT_TRUE(request.keep_alive);
+    EXPECT_GE(request.body.data(), text.data());
+    EXPECT_LT(request.body.data(), text.data() + text.size());
+}
+
+// Test that partial requests ask for more data and pipelined ones are split
+TEST(HttpTest, ParsePartialAndPipelined)
+{
+    const std::string first = post("/a", "12345");
+    const std::string text = first + post("/b", "");
+    HttpRequest request;
+
+    EXPECT_EQ(parse_request(std::string_view(text).substr(0, 10), request, max_body), 0U);
+    EXPECT_EQ(parse_request(std::string_view(first).substr(0, first.size() - 1), request,
+                            max_body),
+              0U);
+
+    auto consumed = parse_request(text, request, max_body);
+    ASSERT_TRUE(consumed);
+    EXPECT_EQ(*consumed, first.size());
+    EXPECT_EQ(request.body, "12345");
+    consumed = parse_request(std::string_view(text).substr(*consumed), request, max_body);
+    ASSERT_TRUE(consumed);
+    EXPECT_EQ(request.target, "/b");
+    EXPECT_EQ(request.body, "");
+}
+
+// Test keep-alive rules for HTTP/1.0 and HTTP/1.1
+TEST(HttpTest, ParseKeepAlive)
+{
+    HttpRequest request;
+    ASSERT_TRUE(parse_request("GET / HTTP/1.1\r\nConnection: close\r\n\r\n", request, max_body));
+    EXPECT_FALSE(request.keep_alive);
+    ASSERT_TRUE(parse_request("GET / HTTP/1.0\r\n\r\n", request, max_body));
+    EXPECT_EQ(request.version_minor, 0);
+    EXPECT_FALSE(request.keep_alive);
+    ASSERT_TRUE(parse_request("GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n", request,
+                              max_body));
+    EXPECT_TRUE(request.keep_alive);
+}
+
+// Test rejection of invalid and oversized requests
+TEST(HttpTest, ParseErrors)
+{
+    HttpRequest request;
+    EXPECT_EQ(parse_request("POST\r\n\r\n", request, max_body).error(), HttpError::Malformed);
+    EXPECT_EQ(parse_request("POST / HTTP/2.0\r\n\r\n", request, max_body).error(),
+              HttpError::Malformed);
+    EXPECT_EQ(parse_request("POST / HTTP/1.1\r\nno colon\r\n\r\n", request, max_body).error(),
+              HttpError::Malformed);
+    EXPECT_EQ(parse_request("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n", request, max_body)
+                  .error(),
+              HttpError::Malformed);
+    EXPECT_EQ(parse_request("POST / HTTP/1.1\r\nContent-Length: 2000\r\n\r\n", request, max_body)
+                  .error(),
+              HttpError::TooLarge);
+    // Dos longitudes distintas: cada extremo podría cortar el cuerpo en un sitio
+    EXPECT_EQ(parse_request("POST / HTTP/1.1\r\nContent-Length: 2\r\ncontent-length: 5\r\n\r\n"
+                            "{}abc",
+                            request, max_body)
+                  .error(),
+              HttpError::Malformed);
+    // Repetida con el mismo valor sí se acepta
+    const auto repeated = parse_request(
+        "POST / HTTP/1.1\r\nContent-Length: 2\r\nContent-Length: 2\r\n\r\n{}", request, max_body);
+    ASSERT_TRUE(repeated);
+    EXPECT_EQ(request.body, "{}");
+    EXPECT_EQ(parse_request("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n", request,
+                            max_body)
+                  .error(),
+              HttpError::NotImplemented);
+    EXPECT_EQ(parse_request(std::string(9000, 'a'), request, max_body).error(),
+              HttpError::TooLarge);
+    // Cabecera completa pero mayor que el límite, recibida en una sola lectura
+    const std::string long_header =
+        "GET / HTTP/1.1\r\nX-Long: " + std::string(9000, 'a') + "\r\n\r\n";
+    EXPECT_EQ(parse_request(long_header, request, max_body).error(), HttpError::TooLarge);
+
+    std::string many = "GET / HTTP/1.1\r\n";
+    for (std::size_t i = 0; i <= max_http_headers; ++i)
+    {
+        many += std::format("X-{}: {}\r\n", i, i);
+    }
+    EXPECT_EQ(parse_request(many + "\r\n", request, max_body).error(), HttpError::TooLarge);
+    EXPECT_EQ(http_status(HttpError::NotImplemented), "501 Not Implemented");
+}
+
+// Test the server end to end: pipelining, keep-alive, errors and the handler
+TEST(HttpServerTest, ServeUplinks)
+{
+    std::mutex mutex;
+    std::vector<std::string> lines;
+    auto catalog = TypeCatalog::parse("{}");
+    ASSERT_TRUE(catalog);
+
+    HttpServer server(HttpServerConfig{.threads = 2}, std::move(*catalog),
+                      [&](const Uplink& uplink, const Json& decoded)
+                      {
+                          const std::lock_guard lock(mutex);
+                          lines.push_back(std::format("{} {} {}", uplink.device_id,
+                                                      uplink.fport, decoded.dump()));
+                      });
+    auto port = server.start();
+    ASSERT_TRUE(port) << port.error().message();
+    EXPECT_NE(*port, 0);
+    EXPECT_TRUE(server.running());
+
+    Client client(*port);
+    ASSERT_TRUE(client.connected());
+
+    // Todas en un solo envío: cada respuesta en orden
+    std::string batch;
+    batch += post("/uplink", ttn_body("dev-1", 2, "A2cBEA=="));
+    batch += post("/uplink?x=1", ttn_body("dev-2", 3, "BWgBkA=="));
+    batch += post("/other", "{}");
+    batch += "GET /uplink HTTP/1.1\r\n\r\n";
+    batch += post("/uplink", ttn_body("dev-3", 2, "A2c="));
+    batch += post("/uplink", ttn_body("dev-4", 2, "!!"));
+    batch += post("/uplink", R"({"end_device_ids":{"device_id":"d"},"uplink_message":{}})");
+    client.send(batch);
+
+    const std::vector<std::string> expected = {
+        "204 No Content",  "204 No Content",  "404 Not Found",  "405 Method Not Allowed",
+        "400 Bad Request", "400 Bad Request", "204 No Content"};
+    EXPECT_EQ(client.statuses(expected.size()), expected);
+
+    // La conexión sigue abierta hasta "Connection: close"
+    client.send(post("/uplink", ttn_body("dev-5", 2, "A2cBEA=="), "Connection: close\r\n"));
+    EXPECT_EQ(client.statuses(1), std::vector<std::string>{"204 No Content"});
+    EXPECT_TRUE(client.closed());
+
+    server.stop();
+    EXPECT_FALSE(server.running());
+
+    const auto stats = server.stats();
+    EXPECT_EQ(stats.connections, 1U);
+    EXPECT_EQ(stats.requests, 8U);
+    EXPECT_EQ(stats.uplinks, 3U);
+    EXPECT_EQ(stats.rejected, 2U);
+    EXPECT_EQ(stats.bad_requests, 0U);
+
+    ASSERT_EQ(lines.size(), 3U);
+    EXPECT_EQ(lines[0], R"(dev-1 2 {"Temperature_3":27.2})");
+    EXPECT_EQ(lines[1], R"(dev-2 3 {"Humidity_5":40.0})");
+    EXPECT_EQ(lines[2], R"(dev-5 2 {"Temperature_3":27.2})");
+}
+
+// Test that a client that pipelines without reading is paused, not buffered without limit
+TEST(HttpServerTest, PausePipelinedClient)
+{
+    auto catalog = TypeCatalog::parse("{}");
+    ASSERT_TRUE(catalog);
+    HttpServer server(HttpServerConfig{.max_pending_output = 512}, std::move(*catalog));
+    auto port = server.start();
+    ASSERT_TRUE(port);
+
+    Client client(*port);
+    ASSERT_TRUE(client.connected());
+    // Muchas más respuestas que el tope y que los buffers del socket
+    constexpr std::size_t requests = 20'000;
+    std::string batch;
+    for (std::size_t i = 0; i < requests; ++i)
+    {
+        batch += "GET /other HTTP/1.1\r\n\r\n";
+    }
+    // El envío se bloquea mientras el servidor no lee: otro hilo
+    std::thread sender([&] { client.send(batch); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const auto statuses = client.statuses(requests);
+    sender.join();
+    ASSERT_EQ(statuses.size(), requests);
+    EXPECT_EQ(statuses.back(), "404 Not Found");
+
+    server.stop();
+    EXPECT_EQ(server.stats().requests, requests);
+}
+
+// Test that unparseable HTTP closes the connection
+TEST(HttpServerTest, BadRequestClosesConnection)
+{
+    auto catalog = TypeCatalog::parse("{}");
+    ASSERT_TRUE(catalog);
+    HttpServer server(HttpServerConfig{}, std::move(*catalog));
+    auto port = server.start();
+    ASSERT_TRUE(port);
+
+    Client client(*port);
+    ASSERT_TRUE(client.connected());
+    client.send("POST /uplink HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n");
+    EXPECT_EQ(client.statuses(1), std::vector<std::string>{"501 Not Implemented"});
+    EXPECT_TRUE(client.closed());
+
+    server.stop();
+    EXPECT_EQ(server.stats().bad_requests, 1U);
+}
+
+// Test that a device over its rate gets 429 without starving the others
+TEST(HttpServerTest, ThrottleFloodingDevice)
+{
+    auto catalog = TypeCatalog::parse("{}");
+    ASSERT_TRUE(catalog);
+    HttpServerConfig config;
+    config.admission = AdmissionConfig{.policy = {.rate = 0.001, .burst = 2}};
+    HttpServer server(config, std::move(*catalog));
+    auto port = server.start();
+    ASSERT_TRUE(port);
+
+    Client client(*port);
+    ASSERT_TRUE(client.connected());
+    std::string batch;
+    for (int i = 0; i < 4; ++i)
+    {
+        batch += post("/uplink", ttn_body("flood", 2, "A2cBEA=="));
+    }
+    batch += post("/uplink", ttn_body("quiet", 2, "A2cBEA=="));
+    client.send(batch);
+
+    const std::vector<std::string> expected = {"204 No Content", "204 No Content",
+                                               "429 Too Many Requests", "429 Too Many Requests",
+                                               "204 No Content"};
+    EXPECT_EQ(client.statuses(expected.size()), expected);
+
+    server.stop();
+    EXPECT_EQ(server.stats().throttled, 2U);
+    EXPECT_EQ(server.stats().uplinks, 3U);
+    ASSERT_NE(server.admission(), nullptr);
+    const auto flood = server.admission()->device("flood");
+    ASSERT_TRUE(flood);
+    EXPECT_EQ(flood->dropped, 2U);
+}
+
+}  // namespace cayene::ingest::test
@@ -0,0 +1,144 @@
+/**
+ * @file lanes_test.cpp
+ * @brief Unit tests for the priority lanes
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/lanes.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+constexpr std::size_t peek_fields = 4;
+
+// Temperatura y GPS: telemetría
+constexpr std::array<uint8_t, 15> telemetry{0x03, 0x67, 0x01, 0x10, 0x01, 0x88, 0x06, 0x76,
+                                            0x5f, 0x0d, 0x69, 0xf6, 0x00, 0x03, 0xe8};
+// Presencia detrás de una temperatura
+constexpr std::array<uint8_t, 7> presence{0x03, 0x67, 0x01, 0x10, 0x05, 0x66, 0x01};
+constexpr std::array<uint8_t, 3> digital_input{0x01, 0x00, 0x01};
+
+auto uplink(std::span<const uint8_t> payload) -> Uplink
+{
+    return Uplink{EnvelopeFormat::ChirpStack, "dev", 2, payload};
+}
+
+}  // namespace
+
+TEST(LanesTest, ClassifyByHeaderPeek)
+{
+    const TypeTable types = TypeTable::standard();
+    const AlarmTypes alarms;
+
+    EXPECT_EQ(classify_lane(telemetry, types, alarms, peek_fields), Lane::Bulk);
+    EXPECT_EQ(classify_lane(presence, types, alarms, peek_fields), Lane::Alarm);
+    EXPECT_EQ(classify_lane(digital_input, types, alarms, peek_fields), Lane::Alarm);
+    // Solo se miran los primeros campos
+    EXPECT_EQ(classify_lane(presence, types, alarms, 1), Lane::Bulk);
+    EXPECT_EQ(classify_lane({}, types, alarms, peek_fields), Lane::Bulk);
+}
+
+TEST(LanesTest, MalformedPayloadsGoToBulk)
+{
+    const TypeTable types = TypeTable::standard();
+    const AlarmTypes alarms;
+
+    // Tipo desconocido antes de la presencia: no se puede saltar
+    constexpr std::array<uint8_t, 6> unknown{0x01, 0xEE, 0x00, 0x05, 0x66, 0x01};
+    EXPECT_EQ(classify_lane(unknown, types, alarms, peek_fields), Lane::Bulk);
+
+    // Un tipo de longitud variable se salta con su byte de longitud
+    TypeTable prefixed = types;
+    ASSERT_TRUE(prefixed.add_prefixed(0xEE, 2));
+    constexpr std::array<uint8_t, 8> listed{0x01, 0xEE, 0x01, 0xAA, 0xBB, 0x05, 0x66, 0x01};
+    EXPECT_EQ(classify_lane(listed, prefixed, alarms, peek_fields), Lane::Alarm);
+    EXPECT_EQ(classify_lane(unknown, prefixed, alarms, peek_fields), Lane::Alarm);
+    constexpr std::array<uint8_t, 7> too_long{0x01, 0xEE, 0x02, 0xAA, 0xBB, 0x05, 0x66};
+    EXPECT_EQ(classify_lane(too_long, prefixed, alarms, peek_fields), Lane::Bulk);
+    // Temperatura truncada
+    constexpr std::array<uint8_t, 3> truncated{0x03, 0x67, 0x01};
+    EXPECT_EQ(classify_lane(truncated, types, alarms, peek_fields), Lane::Bulk);
+    // La cabecera basta para reconocer la alarma aunque falten los datos
+    constexpr std::array<uint8_t, 2> header_only{0x05, 0x66};
+    EXPECT_EQ(classify_lane(header_only, types, alarms, peek_fields), Lane::Alarm);
+}
+
+TEST(LanesTest, CustomAlarmTypes)
+{
+    const TypeTable types = TypeTable::standard();
+    const AlarmTypes gps_alarm{0x88};
+
+    EXPECT_EQ(classify_lane(telemetry, types, gps_alarm, peek_fields), Lane::Alarm);
+    EXPECT_EQ(classify_lane(presence, types, gps_alarm, peek_fields), Lane::Bulk);
+}
+
+TEST(LanesTest, AlarmsOvertakeSlowBulk)
+{
+    constexpr std::size_t bulk_count = 400;
+    constexpr std::size_t alarm_count = 20;
+
+    std::atomic<std::size_t> alarms_seen{0};
+    std::atomic<std::size_t> bulk_seen{0};
+    LaneConfig config;
+    config.bulk.max_batch = 16;
+    config.bulk.max_queued = bulk_count;
+    LanedBatcher lanes(config, *TypeCatalog::parse("{}"),
+                       [&](Lane lane, std::span<const BatchedUplink> batch)
+                       {
+                           if (lane == Lane::Alarm)
+                           {
+                               alarms_seen += batch.size();
+                               return;
+                           }
+                           // Consumidor de telemetría lento: la cola bulk se acumula
+                           std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                           bulk_seen += batch.size();
+                       });
+
+    for (std::size_t i = 0; i < bulk_count; ++i)
+    {
+        ASSERT_TRUE(lanes.submit(uplink(telemetry)));
+        if (i % (bulk_count / alarm_count) == 0)
+        {
+            ASSERT_TRUE(lanes.submit(uplink(presence)));
+        }
+    }
+
+    // Las alarmas salen mientras el bulk sigue atascado
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (alarms_seen < alarm_count && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(alarms_seen, alarm_count);
+    EXPECT_LT(bulk_seen, bulk_count);
+
+    lanes.drain();
+    const auto alarm = lanes.stats(Lane::Alarm);
+    const auto bulk = lanes.stats(Lane::Bulk);
+    EXPECT_EQ(alarm.uplinks, alarm_count);
+    EXPECT_EQ(bulk.uplinks, bulk_count);
+    EXPECT_LT(alarm.queue_delay.percentile(0.99), bulk.queue_delay.percentile(0.99));
+}
+
+TEST(LanesTest, LaneNames)
+{
+    EXPECT_EQ(lane_name(Lane::Alarm), "alarm");
+    EXPECT_EQ(lane_name(Lane::Bulk), "bulk");
+}
+
+}  // namespace cayene::ingest::test
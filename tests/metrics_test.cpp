@@ -0,0 +1,100 @@
+/**
+ * @file metrics_test.cpp
+ * @brief Unit tests for the decoder metrics
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/metrics.hpp"
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "cayene/decoder.hpp"
+
+namespace cayene::test
+{
+
+// Test payload size bucketing
+TEST(MetricsTest, PayloadSizeBucket)
+{
+    EXPECT_EQ(metrics::payload_size_bucket(0), 0U);
+    EXPECT_EQ(metrics::payload_size_bucket(1), 1U);
+    EXPECT_EQ(metrics::payload_size_bucket(3), 2U);
+    EXPECT_EQ(metrics::payload_size_bucket(4), 3U);
+    EXPECT_EQ(metrics::payload_size_bucket(51), 6U);
+    EXPECT_EQ(metrics::payload_size_bucket(1U << 20U), metrics::payload_size_bucket_count - 1);
+}
+
+// Test that counters recorded on several threads are summed by snapshot
+TEST(MetricsTest, ShardsAreAggregated)
+{
+    const auto before = metrics::snapshot();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back(
+            []
+            {
+                for (int i = 0; i < 1000; ++i)
+                {
+                    const auto start = metrics::ShardedPolicy::now();
+                    metrics::ShardedPolicy::record_field(0x67);
+                    metrics::ShardedPolicy::record_decode(4, Error::None, start);
+                }
+                metrics::ShardedPolicy::record_decode(3, Error::BadPayloadFormat,
+                                                      metrics::ShardedPolicy::now());
+            });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    const auto after = metrics::snapshot();
+    EXPECT_EQ(after.fields_by_type[0x67] - before.fields_by_type[0x67], 4000U);
+    EXPECT_EQ(after.decode_calls - before.decode_calls, 4004U);
+    EXPECT_EQ(after.bytes_processed - before.bytes_processed, 4U * 4000U + 4U * 3U);
+    EXPECT_EQ(after.errors_by_code[static_cast<std::size_t>(Error::BadPayloadFormat)] -
+                  before.errors_by_code[static_cast<std::size_t>(Error::BadPayloadFormat)],
+              4U);
+    EXPECT_EQ(after.payload_size_histogram[3] - before.payload_size_histogram[3], 4000U);
+    EXPECT_EQ(after.latency(metrics::Stage::Decode).count() -
+                  before.latency(metrics::Stage::Decode).count(),
+              4004U);
+}
+
+// Test that the decoder feeds the configured policy
+TEST(MetricsTest, DecoderRecordsWhenEnabled)
+{
+    if constexpr (!metrics::Policy::enabled)
+    {
+        GTEST_SKIP() << "Built without CAYENE_ENABLE_METRICS";
+    }
+
+    Decoder decoder;
+    const auto before = metrics::snapshot();
+
+    std::vector<uint8_t> payload = {0x03, 0x67, 0x01, 0x10, 0x05, 0x67, 0x00, 0xFF};
+    ASSERT_TRUE(decoder.decode(payload));
+    std::vector<uint8_t> unknown = {0x01, 0xFF, 0x00};
+    ASSERT_FALSE(decoder.decode(unknown));
+
+    const auto after = metrics::snapshot();
+    EXPECT_EQ(after.decode_calls - before.decode_calls, 2U);
+    EXPECT_EQ(after.bytes_processed - before.bytes_processed, 11U);
+    EXPECT_EQ(after.fields_by_type[0x67] - before.fields_by_type[0x67], 2U);
+    EXPECT_EQ(after.errors_total() - before.errors_total(), 1U);
+    EXPECT_EQ(after.latency(metrics::Stage::Key).count() -
+                  before.latency(metrics::Stage::Key).count(),
+              2U);
+    EXPECT_EQ(after.errors_by_code[static_cast<std::size_t>(Error::UnkwownDataType)] -
+                  before.errors_by_code[static_cast<std::size_t>(Error::UnkwownDataType)],
+              1U);
+}
+
+}  // namespace cayene::test
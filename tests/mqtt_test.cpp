@@ -0,0 +1,477 @@
+/**
+ * @file mqtt_test.cpp
+ * @brief Unit tests for the MQTT codec and subscriber, against a stub broker
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/mqtt.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "cayene/ingest/mqtt_subscriber.hpp"
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+constexpr std::size_t max_packet = 64 * 1024;
+
+auto bytes(std::string_view text) -> std::span<const uint8_t>
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return {reinterpret_cast<const uint8_t*>(text.data()), text.size()};
+}
+
+auto chirpstack_body(std::string_view dev_eui, int fport, std::string_view data) -> std::string
+{
+    return std::format(R"({{"deviceInfo":{{"devEui":"{}"}},"fPort":{},"data":"{}"}})", dev_eui,
+                       fport, data);
+}
+
+/**
+ * One-connection broker: answers CONNECT and SUBSCRIBE, publishes the
+ * queued messages with QoS 1 in a single write and collects the PUBACKs.
+ * Delayed messages follow in a second write once their delay has passed.
+ */
+class StubBroker
+{
+public:
+    StubBroker()
+    {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        auto* generic_address = reinterpret_cast<sockaddr*>(&address);
+        socklen_t size = sizeof(address);
+        ::bind(listen_fd_, generic_address, size);
+        ::listen(listen_fd_, 1);
+        ::getsockname(listen_fd_, generic_address, &size);
+        port_ = ntohs(address.sin_port);
+    }
+
+    ~StubBroker()
+    {
+        if (late_thread_.joinable())
+        {
+            late_thread_.join();
+        }
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+        ::close(listen_fd_);
+    }
+
+    StubBroker(const StubBroker&) = delete;
+    StubBroker& operator=(const StubBroker&) = delete;
+    StubBroker(StubBroker&&) = delete;
+    StubBroker& operator=(StubBroker&&) = delete;
+
+    // With @p delay, sent that long after the SUBSCRIBE; all delayed messages share one delay
+    void publish(std::string_view topic, std::string_view payload,
+                 std::chrono::milliseconds delay = {})
+    {
+        if (delay.count() == 0)
+        {
+            append_publish(publishes_, topic, bytes(payload), 1, ++published_);
+            return;
+        }
+        late_delay_ = delay;
+        append_publish(late_publishes_, topic, bytes(payload), 1, ++published_);
+    }
+
+    void start(uint8_t connack_code = 0)
+    {
+        thread_ = std::thread([this, connack_code] { serve(connack_code); });
+    }
+
+    // Packet ids acknowledged, in order; waits for the client to disconnect
+    auto acks() -> const std::vector<uint16_t>&
+    {
+        thread_.join();
+        return acks_;
+    }
+
+    [[nodiscard]] auto port() const -> uint16_t { return port_; }
+    [[nodiscard]] auto subscription() const -> const std::string& { return subscription_; }
+    [[nodiscard]] auto disconnected() const -> bool { return disconnected_; }
+
+private:
+    void serve(uint8_t connack_code)
+    {
+        const int fd = ::accept(listen_fd_, nullptr, nullptr);
+        std::vector<uint8_t> input;
+        std::array<uint8_t, 4096> buffer{};
+        MqttPacket packet;
+
+        while (true)
+        {
+            std::size_t offset = 0;
+            while (true)
+            {
+                const auto consumed = parse_packet(std::span(input).subspan(offset), packet,
+                                                   max_packet);
+                if (!consumed || *consumed == 0)
+                {
+                    break;
+                }
+                offset += *consumed;
+                std::vector<uint8_t> out;
+                switch (packet.type)
+                {
+                    case MqttPacketType::Connect:
+                        append_connack(out, connack_code);
+                        break;
+                    case MqttPacketType::Subscribe:
+                        // Filtro tras el packet id y su longitud
+                        subscription_.assign(packet.body.begin() + 4, packet.body.end() - 1);
+                        append_suback(out, packet.packet_id, packet.body.back());
+                        out.insert(out.end(), publishes_.begin(), publishes_.end());
+                        if (!late_publishes_.empty())
+                        {
+                            late_thread_ = std::thread(
+                                [this, fd]
+                                {
+                                    std::this_thread::sleep_for(late_delay_);
+                                    ::send(fd, late_publishes_.data(), late_publishes_.size(),
+                                           MSG_NOSIGNAL);
+                                });
+                        }
+                        break;
+                    case MqttPacketType::Puback:
+                        acks_.push_back(packet.packet_id);
+                        break;
+                    case MqttPacketType::Disconnect:
+                        disconnected_ = true;
+                        break;
+                    default:
+                        break;
+                }
+                ::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+            }
+            input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(offset));
+
+            const ssize_t received = ::recv(fd, buffer.data(), buffer.size(), 0);
+            if (received <= 0)
+            {
+                break;
+            }
+            input.insert(input.end(), buffer.begin(), buffer.begin() + received);
+        }
+        if (late_thread_.joinable())
+        {
+            late_thread_.join();
+        }
+        ::close(fd);
+    }
+
+    int listen_fd_{-1};
+    uint16_t port_{0};
+    std::thread thread_;
+    std::vector<uint8_t> publishes_;
+    std::vector<uint8_t> late_publishes_;
+    std::chrono::milliseconds late_delay_{0};
+    std::thread late_thread_;
+    uint16_t published_{0};
+    std::string subscription_;
+    std::vector<uint16_t> acks_;
+    bool disconnected_{false};
+};
+
+}  // namespace
+
+// Test that packets survive a serialize/parse round trip
+TEST(MqttTest, PacketRoundTrip)
+{
+    std::vector<uint8_t> out;
+    const std::string payload(300, 'x');
+    append_publish(out, "application/1/device/abc/event/up", bytes(payload), 1, 0x1234);
+    append_puback(out, 7);
+    append_pingresp(out);
+
+    MqttPacket packet;
+    auto consumed = parse_packet(out, packet, max_packet);
+    ASSERT_TRUE(consumed);
+    // Longitud restante de 2 bytes: 2 + 33 + 2 + 300 = 337
+    EXPECT_EQ(*consumed, 3U + 337U);
+    EXPECT_EQ(packet.type, MqttPacketType::Publish);
+    EXPECT_EQ(packet.qos, 1);
+    EXPECT_EQ(packet.packet_id, 0x1234);
+    EXPECT_EQ(packet.topic, "application/1/device/abc/event/up");
+    EXPECT_EQ(packet.payload.size(), payload.size());
+    EXPECT_EQ(packet.payload.data(), out.data() + 3 + 2 + 33 + 2);
+
+    std::span<const uint8_t> rest = std::span(out).subspan(*consumed);
+    consumed = parse_packet(rest, packet, max_packet);
+    ASSERT_TRUE(consumed);
+    EXPECT_EQ(packet.type, MqttPacketType::Puback);
+    EXPECT_EQ(packet.packet_id, 7);
+
+    consumed = parse_packet(rest.subspan(*consumed), packet, max_packet);
+    ASSERT_TRUE(consumed);
+    EXPECT_EQ(packet.type, MqttPacketType::Pingresp);
+
+    // Cualquier prefijo está incompleto
+    for (std::size_t size = 0; size < 340; size += 17)
+    {
+        EXPECT_EQ(parse_packet(std::span(out).first(size), packet, max_packet), 0U);
+    }
+}
+
+// Test rejection of malformed, oversized and unsupported packets
+TEST(MqttTest, ParseErrors)
+{
+    MqttPacket packet;
+    const std::vector<uint8_t> bad_length = {0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x01};
+    EXPECT_EQ(parse_packet(bad_length, packet, max_packet).error(), MqttError::Malformed);
+
+    std::vector<uint8_t> large;
+    append_publish(large, "t", bytes(std::string(100, 'x')), 0, 0);
+    EXPECT_EQ(parse_packet(large, packet, 64).error(), MqttError::TooLarge);
+
+    std::vector<uint8_t> qos2;
+    append_publish(qos2, "t", {}, 2, 1);
+    EXPECT_EQ(parse_packet(qos2, packet, max_packet).error(), MqttError::Unsupported);
+
+    const std::vector<uint8_t> auth = {0xF0, 0x00};
+    EXPECT_EQ(parse_packet(auth, packet, max_packet).error(), MqttError::Unsupported);
+
+    const std::vector<uint8_t> short_topic = {0x30, 0x02, 0x00, 0x05};
+    EXPECT_EQ(parse_packet(short_topic, packet, max_packet).error(), MqttError::Malformed);
+    const std::vector<uint8_t> long_ping = {0xD0, 0x01, 0x00};
+    EXPECT_EQ(parse_packet(long_ping, packet, max_packet).error(), MqttError::Malformed);
+}
+
+// Test subscription filter matching
+TEST(MqttTest, TopicMatches)
+{
+    constexpr std::string_view chirpstack = "application/+/device/+/event/up";
+    EXPECT_TRUE(topic_matches(chirpstack, "application/7/device/0101/event/up"));
+    EXPECT_FALSE(topic_matches(chirpstack, "application/7/device/0101/event/join"));
+    EXPECT_FALSE(topic_matches(chirpstack, "application/7/device/0101/event"));
+    EXPECT_FALSE(topic_matches(chirpstack, "application/7/device/0101/event/up/x"));
+
+    EXPECT_TRUE(topic_matches("v3/#", "v3/app/devices/dev/up"));
+    EXPECT_TRUE(topic_matches("v3/#", "v3"));
+    EXPECT_TRUE(topic_matches("#", "a/b"));
+    EXPECT_FALSE(topic_matches("#", "$SYS/broker/load"));
+    EXPECT_TRUE(topic_matches("+/b", "/b"));
+    EXPECT_TRUE(topic_matches("a/b", "a/b"));
+    EXPECT_FALSE(topic_matches("a/b", "a/c"));
+}
+
+// Test batched decode and QoS 1 acknowledgement against the stub broker
+TEST(MqttSubscriberTest, DecodeBatches)
+{
+    StubBroker broker;
+    // Temperatura 27.2 y humedad 40.0
+    broker.publish("application/1/device/01/event/up", chirpstack_body("01", 2, "A2cBEA=="));
+    broker.publish("application/1/device/02/event/up", chirpstack_body("02", 2, "BWgBkA=="));
+    broker.publish("application/1/device/01/event/join", R"({"deviceInfo":{}})");
+    broker.publish("application/1/device/03/event/up", chirpstack_body("03", 2, "A2c="));
+    broker.publish("application/1/device/04/event/up", R"({"deviceInfo":{"devEui":"04"}})");
+    broker.publish("application/1/device/05/event/up", chirpstack_body("05", 2, "A2cBEA=="));
+    broker.publish("application/1/device/06/event/up", chirpstack_body("06", 3, "A2cBEA=="));
+    broker.publish("application/1/device/07/event/up", "not json");
+    broker.start();
+
+    auto catalog = TypeCatalog::parse("{}");
+    ASSERT_TRUE(catalog);
+    std::vector<std::string> lines;
+    std::vector<std::size_t> batch_sizes;
+    MqttConfig config{.port = broker.port(), .client_id = "test", .max_batch = 2};
+    MqttSubscriber subscriber(config, std::move(*catalog),
+                              [&](std::span<const MqttUplink> batch)
+                              {
+                                  batch_sizes.push_back(batch.size());
+                                  for (const auto& entry : batch)
+                                  {
+                                      lines.push_back(std::format("{} {} {}", entry.topic,
+                                                                  entry.uplink.device_id,
+                                                                  entry.decoded.dump()));
+                                  }
+                              });
+
+    auto connected = subscriber.connect();
+    ASSERT_TRUE(connected) << connected.error().message();
+
+    std::size_t delivered = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (subscriber.stats().messages < 8 && std::chrono::steady_clock::now() < deadline)
+    {
+        auto polled = subscriber.poll(std::chrono::milliseconds(100));
+        ASSERT_TRUE(polled) << polled.error().message();
+        delivered += *polled;
+    }
+    subscriber.disconnect();
+    EXPECT_EQ(subscriber.fd(), -1);
+
+    EXPECT_EQ(broker.acks(), (std::vector<uint16_t>{1, 2, 3, 4, 5, 6, 7, 8}));
+    EXPECT_TRUE(broker.disconnected());
+    EXPECT_EQ(broker.subscription(), "application/+/device/+/event/up");
+
+    EXPECT_EQ(delivered, 4U);
+    const auto& stats = subscriber.stats();
+    EXPECT_EQ(stats.messages, 8U);
+    EXPECT_EQ(stats.uplinks, 4U);
+    // Payload truncado y envoltorio que no es JSON
+    EXPECT_EQ(stats.rejected, 2U);
+    // Los lotes dependen de cómo lleguen los segmentos TCP, pero nunca pasan de max_batch
+    EXPECT_EQ(stats.batches, batch_sizes.size());
+    for (const std::size_t size : batch_sizes)
+    {
+        EXPECT_LE(size, 2U);
+    }
+
+    ASSERT_EQ(lines.size(), 4U);
+    EXPECT_EQ(lines[0], R"(application/1/device/01/event/up 01 {"Temperature_3":27.2})");
+    EXPECT_EQ(lines[1], R"(application/1/device/02/event/up 02 {"Humidity_5":40.0})");
+    EXPECT_EQ(lines[3], R"(application/1/device/06/event/up 06 {"Temperature_3":27.2})");
+}
+
+// Test that lanes decode on their workers and the PUBACKs follow the hand-over
+TEST(MqttSubscriberTest, LanedDelivery)
+{
+    StubBroker broker;
+    // Entrada digital 1 (carril de alarmas), temperatura 27.2 y un payload truncado
+    broker.publish("application/1/device/01/event/up", chirpstack_body("01", 2, "AQAB"));
+    broker.publish("application/1/device/02/event/up", chirpstack_body("02", 2, "A2cBEA=="));
+    broker.publish("application/1/device/03/event/up", chirpstack_body("03", 2, "A2c="));
+    broker.start();
+
+    auto catalog = TypeCatalog::parse("{}");
+    ASSERT_TRUE(catalog);
+    // Los dos carriles llaman al handler a la vez
+    std::mutex mutex;
+    std::vector<std::string> lines;
+    MqttConfig config{.port = broker.port(), .client_id = "test", .lanes = LaneConfig{}};
+    MqttSubscriber subscriber(config, std::move(*catalog),
+                              [&](std::span<const MqttUplink> batch)
+                              {
+                                  const std::lock_guard lock(mutex);
+                                  for (const auto& entry : batch)
+                                  {
+                                      lines.push_back(std::format("{} {} {}", entry.topic,
+                                                                  entry.uplink.device_id,
+                                                                  entry.decoded.dump()));
+                                  }
+                              });
+    ASSERT_NE(subscriber.lanes(), nullptr);
+
+    auto connected = subscriber.connect();
+    ASSERT_TRUE(connected) << connected.error().message();
+    // poll() no espera a los carriles: cuenta lo que entregaron desde la llamada anterior
+    std::size_t delivered = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (delivered < 2 && std::chrono::steady_clock::now() < deadline)
+    {
+        auto polled = subscriber.poll(std::chrono::milliseconds(100));
+        ASSERT_TRUE(polled) << polled.error().message();
+        delivered += *polled;
+    }
+    subscriber.disconnect();
+
+    // Cada carril confirma lo suyo: el orden entre ellos no está fijado
+    auto acks = broker.acks();
+    std::ranges::sort(acks);
+    EXPECT_EQ(acks, (std::vector<uint16_t>{1, 2, 3}));
+    EXPECT_EQ(delivered, 2U);
+    EXPECT_EQ(subscriber.stats().uplinks, 2U);
+    EXPECT_EQ(subscriber.stats().rejected, 1U);
+    EXPECT_EQ(subscriber.lanes()->stats(Lane::Alarm).uplinks, 1U);
+    EXPECT_EQ(subscriber.lanes()->stats(Lane::Bulk).uplinks, 1U);
+
+    // Los carriles entregan en paralelo: el orden entre ellos no está fijado
+    std::ranges::sort(lines);
+    ASSERT_EQ(lines.size(), 2U);
+    EXPECT_EQ(lines[0], R"(application/1/device/01/event/up 01 {"Digital Input_1":1})");
+    EXPECT_EQ(lines[1], R"(application/1/device/02/event/up 02 {"Temperature_3":27.2})");
+}
+
+// Test that poll() keeps reading while a slow bulk batch is in the handler
+TEST(MqttSubscriberTest, SlowBulkLaneDoesNotDelayAlarm)
+{
+    StubBroker broker;
+    // La temperatura tarda 300 ms en el handler; la entrada digital llega 50 ms después
+    broker.publish("application/1/device/02/event/up", chirpstack_body("02", 2, "A2cBEA=="));
+    broker.publish("application/1/device/01/event/up", chirpstack_body("01", 2, "AQAB"),
+                   std::chrono::milliseconds(50));
+    broker.start();
+
+    auto catalog = TypeCatalog::parse("{}");
+    ASSERT_TRUE(catalog);
+    std::mutex mutex;
+    std::vector<std::string> handled;
+    MqttConfig config{.port = broker.port(), .client_id = "test", .lanes = LaneConfig{}};
+    MqttSubscriber subscriber(config, std::move(*catalog),
+                              [&](std::span<const MqttUplink> batch)
+                              {
+                                  for (const auto& entry : batch)
+                                  {
+                                      if (entry.uplink.device_id == "02")
+                                      {
+                                          std::this_thread::sleep_for(
+                                              std::chrono::milliseconds(300));
+                                      }
+                                      const std::lock_guard lock(mutex);
+                                      handled.emplace_back(entry.uplink.device_id);
+                                  }
+                              });
+
+    auto connected = subscriber.connect();
+    ASSERT_TRUE(connected) << connected.error().message();
+    std::size_t delivered = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (delivered < 2 && std::chrono::steady_clock::now() < deadline)
+    {
+        auto polled = subscriber.poll(std::chrono::milliseconds(100));
+        ASSERT_TRUE(polled) << polled.error().message();
+        delivered += *polled;
+    }
+    subscriber.disconnect();
+
+    // La alarma llegó después pero no esperó al lote bulk
+    EXPECT_EQ(handled, (std::vector<std::string>{"01", "02"}));
+    EXPECT_EQ(broker.acks(), (std::vector<uint16_t>{2, 1}));
+}
+
+// Test that a refused CONNACK fails connect()
+TEST(MqttSubscriberTest, ConnectionRefused)
+{
+    StubBroker broker;
+    // 5: not authorized
+    broker.start(5);
+
+    auto catalog = TypeCatalog::parse("{}");
+    ASSERT_TRUE(catalog);
+    MqttSubscriber subscriber(MqttConfig{.port = broker.port()}, std::move(*catalog));
+    auto connected = subscriber.connect();
+    ASSERT_FALSE(connected);
+    EXPECT_EQ(connected.error(), std::errc::connection_refused);
+    EXPECT_EQ(subscriber.fd(), -1);
+    EXPECT_FALSE(subscriber.poll(std::chrono::milliseconds(0)));
+}
+
+}  // namespace cayene::ingest::test
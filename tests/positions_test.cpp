@@ -0,0 +1,250 @@
+/**
+ * @file positions_test.cpp
+ * @brief Unit tests for the last-known-position index
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/positions.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "cayene/core.hpp"
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+auto ids(const std::vector<TrackedPosition>& positions) -> std::vector<std::string>
+{
+    std::vector<std::string> result;
+    for (const TrackedPosition& position : positions)
+    {
+        result.emplace_back(position.device_id);
+    }
+    std::ranges::sort(result);
+    return result;
+}
+
+// Distancia de referencia por la ley de los cosenos esférica
+auto reference_distance(GeoPoint a, GeoPoint b) -> double
+{
+    constexpr double to_radians = 3.14159265358979323846 / 180.0 / 10000.0;
+    const double lat_a = a.lat * to_radians;
+    const double lat_b = b.lat * to_radians;
+    const double lon = (b.lon - a.lon) * to_radians;
+    const double cosine =
+        std::sin(lat_a) * std::sin(lat_b) + std::cos(lat_a) * std::cos(lat_b) * std::cos(lon);
+    return 6'371'008.8 * std::acos(std::clamp(cosine, -1.0, 1.0));
+}
+
+}  // namespace
+
+TEST(PositionsTest, BoxQuery)
+{
+    PositionIndex index({.cell_size = 100, .snapshot_interval = std::chrono::milliseconds(0)});
+    EXPECT_TRUE(index.update("a", GeoPoint{10, 10}));
+    EXPECT_TRUE(index.update("b", GeoPoint{150, 10}));
+    EXPECT_TRUE(index.update("c", GeoPoint{10, 450}));
+    EXPECT_TRUE(index.update("d", GeoPoint{-500, -500}));
+    EXPECT_FALSE(index.update("e", GeoPoint{900'001, 0}));
+
+    // Sin publicar, la instantánea inicial está vacía
+    std::vector<TrackedPosition> positions;
+    index.snapshot()->within_box({-1000, -1000}, {1000, 1000}, positions);
+    EXPECT_TRUE(positions.empty());
+
+    index.publish();
+    const auto snapshot = index.snapshot();
+    EXPECT_EQ(snapshot->size(), 4U);
+    snapshot->within_box({0, 0}, {200, 200}, positions);
+    EXPECT_EQ(ids(positions), (std::vector<std::string>{"a", "b"}));
+    snapshot->within_box({0, 0}, {10, 450}, positions);
+    EXPECT_EQ(ids(positions), (std::vector<std::string>{"a", "c"}));
+    snapshot->within_box({-900'000, -1'800'000}, {900'000, 1'800'000}, positions);
+    EXPECT_EQ(positions.size(), 4U);
+    snapshot->within_box({200, 200}, {0, 0}, positions);
+    EXPECT_TRUE(positions.empty());
+}
+
+TEST(PositionsTest, LatestPositionWins)
+{
+    PositionIndex index({.snapshot_interval = std::chrono::milliseconds(0)});
+    const auto seen = PositionIndex::Clock::time_point(std::chrono::seconds(1'700'000'000));
+    index.update("70B3D57ED0000001", GeoPoint{0, 0}, seen);
+    index.update("70B3D57ED0000001", GeoPoint{5000, 5000}, seen + std::chrono::seconds(1));
+    EXPECT_EQ(index.devices(), 1U);
+    index.publish();
+
+    std::vector<TrackedPosition> positions;
+    index.snapshot()->within_box({4000, 4000}, {6000, 6000}, positions);
+    ASSERT_EQ(positions.size(), 1U);
+    EXPECT_EQ(positions[0].device_id, "70B3D57ED0000001");
+    EXPECT_EQ(positions[0].seen, seen + std::chrono::seconds(1));
+    index.snapshot()->within_box({-10, -10}, {10, 10}, positions);
+    EXPECT_TRUE(positions.empty());
+}
+
+TEST(PositionsTest, RadiusAndNearestMatchBruteForce)
+{
+    std::mt19937 random(11);
+    std::uniform_int_distribution<int32_t> lat(400'000, 420'000);
+    std::uniform_int_distribution<int32_t> lon(-40'000, -20'000);
+
+    PositionIndex index({.snapshot_interval = std::chrono::milliseconds(0)});
+    std::vector<GeoPoint> points;
+    for (std::size_t i = 0; i < 5'000; ++i)
+    {
+        points.push_back({lat(random), lon(random)});
+        index.update(std::format("device-{}", i), points.back());
+    }
+    index.publish();
+    const auto snapshot = index.snapshot();
+
+    std::vector<TrackedPosition> positions;
+    for (std::size_t query = 0; query < 50; ++query)
+    {
+        const GeoPoint center{lat(random), lon(random)};
+        const double meters = 5'000.0 + 1'000.0 * static_cast<double>(query);
+
+        std::vector<std::string> expected;
+        std::vector<double> distances;
+        for (std::size_t i = 0; i < points.size(); ++i)
+        {
+            const double d = reference_distance(center, points[i]);
+            distances.push_back(d);
+            // Fuera de la franja de redondeo entre las dos fórmulas
+            if (d <= meters - 0.01)
+            {
+                expected.push_back(std::format("device-{}", i));
+            }
+        }
+        std::ranges::sort(expected);
+        snapshot->within_radius(center, meters + 0.01, positions);
+        auto found = ids(positions);
+        std::erase_if(found,
+                      [&](const std::string& id)
+                      {
+                          const auto i = std::stoul(id.substr(7));
+                          return distances[i] > meters - 0.01;
+                      });
+        EXPECT_EQ(found, expected);
+
+        snapshot->nearest(center, 10, positions);
+        ASSERT_EQ(positions.size(), 10U);
+        std::ranges::sort(distances);
+        for (std::size_t k = 0; k < positions.size(); ++k)
+        {
+            EXPECT_NEAR(reference_distance(center, positions[k].point), distances[k], 0.01);
+        }
+    }
+
+    // Más vecinos de los que hay: todos, desde el otro lado del mundo
+    snapshot->nearest({-410'000, 150'000}, 10'000, positions);
+    EXPECT_EQ(positions.size(), points.size());
+}
+
+TEST(PositionsTest, UpdateFromGpsReadings)
+{
+    PositionIndex index({.snapshot_interval = std::chrono::milliseconds(0)});
+    const std::vector<uint8_t> payload = {0x03, 0x67, 0x01, 0x10, 0x05, 0x88, 0x06, 0x76,
+                                          0x5f, 0xf2, 0x96, 0x0a, 0x00, 0x03, 0xe8};
+    std::array<Reading, 4> readings{};
+    const auto count = CoreDecoder().decode(payload, readings);
+    ASSERT_TRUE(count);
+    EXPECT_TRUE(index.update("tracker-1", std::span(readings).first(*count)));
+    EXPECT_FALSE(index.update("tracker-2", std::span(readings).first(1)));
+
+    index.publish();
+    std::vector<TrackedPosition> positions;
+    index.snapshot()->nearest({423500, -879100}, 1, positions);
+    ASSERT_EQ(positions.size(), 1U);
+    EXPECT_EQ(positions[0].point.lat, 423519);
+    EXPECT_EQ(positions[0].point.lon, -879094);
+}
+
+TEST(PositionsTest, SnapshotCacheFollowsPublish)
+{
+    PositionIndex first({.snapshot_interval = std::chrono::milliseconds(0)});
+    PositionIndex second({.snapshot_interval = std::chrono::milliseconds(0)});
+    first.update("a", GeoPoint{10, 10});
+    second.update("b", GeoPoint{20, 20});
+    second.update("c", GeoPoint{30, 30});
+
+    // Un snapshot copiado sigue vivo aunque la caché del hilo avance
+    const auto empty = first.snapshot();
+    EXPECT_EQ(first.snapshot(), empty);
+    first.publish();
+    EXPECT_EQ(empty->size(), 0U);
+    EXPECT_EQ(first.snapshot()->size(), 1U);
+
+    // La caché del hilo no confunde dos índices
+    second.publish();
+    EXPECT_EQ(second.snapshot()->size(), 2U);
+    EXPECT_EQ(first.snapshot()->size(), 1U);
+    first.update("d", GeoPoint{40, 40});
+    first.publish();
+    EXPECT_EQ(second.snapshot()->size(), 2U);
+    EXPECT_EQ(first.snapshot()->size(), 2U);
+}
+
+TEST(PositionsTest, QueriesDuringUpdates)
+{
+    PositionIndex index({.snapshot_interval = std::chrono::milliseconds(1)});
+    constexpr std::size_t devices = 2'000;
+    std::atomic<bool> done{false};
+
+    std::vector<std::jthread> workers;
+    for (std::size_t t = 0; t < 2; ++t)
+    {
+        workers.emplace_back(
+            [&, t]
+            {
+                for (int32_t step = 0; step < 20; ++step)
+                {
+                    for (std::size_t d = t; d < devices; d += 2)
+                    {
+                        index.update(std::format("device-{}", d),
+                                     GeoPoint{step * 10, static_cast<int32_t>(d)});
+                    }
+                }
+            });
+    }
+    std::jthread reader(
+        [&]
+        {
+            std::vector<TrackedPosition> positions;
+            while (!done.load())
+            {
+                // Una instantánea nunca cambia mientras se consulta
+                const auto snapshot = index.snapshot();
+                snapshot->within_box({-900'000, -1'800'000}, {900'000, 1'800'000}, positions);
+                EXPECT_EQ(positions.size(), snapshot->size());
+            }
+        });
+    workers.clear();
+    done = true;
+    reader.join();
+
+    index.publish();
+    std::vector<TrackedPosition> positions;
+    index.snapshot()->within_box({190, 0}, {190, 1'000'000}, positions);
+    EXPECT_EQ(positions.size(), devices);
+}
+
+}  // namespace cayene::ingest::test
@@ -0,0 +1,102 @@
+/**
+ * @file prometheus_test.cpp
+ * @brief Unit tests for the Prometheus exposition
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/prometheus.hpp"
+
+#include <array>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace cayene::test
+{
+
+namespace
+{
+
+auto http_get(uint16_t port, const std::string& path) -> std::string
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        ::close(fd);
+        return {};
+    }
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ::send(fd, request.data(), request.size(), 0);
+
+    std::string response;
+    std::array<char, 4096> buffer{};
+    ssize_t received = 0;
+    while ((received = ::recv(fd, buffer.data(), buffer.size(), 0)) > 0)
+    {
+        response.append(buffer.data(), static_cast<std::size_t>(received));
+    }
+    ::close(fd);
+    return response;
+}
+
+}  // namespace
+
+// Test the text format of a rendered snapshot
+TEST(PrometheusTest, RenderSnapshot)
+{
+    metrics::Snapshot snap;
+    snap.decode_calls = 3;
+    snap.bytes_processed = 20;
+    snap.fields_by_type[0x67] = 5;
+    snap.fields_by_type[0xC8] = 2;
+    snap.errors_by_code[static_cast<std::size_t>(Error::BadPayloadFormat)] = 1;
+    snap.payload_size_histogram[metrics::payload_size_bucket(4)] = 2;
+    snap.payload_size_histogram[metrics::payload_size_bucket(12)] = 1;
+    snap.stage_latency_ns[0].record(800);
+
+    const auto text = metrics::render_prometheus(snap);
+    EXPECT_NE(text.find("# TYPE cayene_decode_calls_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("cayene_decode_calls_total 3\n"), std::string::npos);
+    EXPECT_NE(text.find("cayene_decode_bytes_total 20\n"), std::string::npos);
+    EXPECT_NE(text.find("cayene_decoded_fields_total{type_id=\"0x67\",name=\"Temperature\"} 5\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("cayene_decoded_fields_total{type_id=\"0xc8\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("cayene_decode_errors_total{code=\"BadPayloadFormat\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("cayene_payload_size_bytes_bucket{le=\"7\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("cayene_payload_size_bytes_bucket{le=\"15\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("cayene_decode_stage_seconds_bucket{stage=\"decode\",le=\"1e-06\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("cayene_decode_stage_seconds_count{stage=\"decode\"} 1\n"),
+              std::string::npos);
+}
+
+// Test scraping the endpoint over loopback
+TEST(PrometheusTest, ServeOverLoopback)
+{
+    metrics::PrometheusExporter exporter(0);
+    auto port = exporter.start();
+    ASSERT_TRUE(port) << port.error().message();
+    EXPECT_NE(*port, 0);
+
+    const auto response = http_get(*port, "/metrics");
+    EXPECT_TRUE(response.starts_with("HTTP/1.0 200 OK\r\n"));
+    EXPECT_NE(response.find("cayene_decode_calls_total"), std::string::npos);
+
+    EXPECT_TRUE(http_get(*port, "/").starts_with("HTTP/1.0 404"));
+
+    exporter.stop();
+    EXPECT_FALSE(exporter.running());
+}
+
+}  // namespace cayene::test
@@ -0,0 +1,178 @@
+/**
+ * @file registry_test.cpp
+ * @brief Unit tests for registry images
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/registry.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+namespace cayene::test
+{
+
+namespace
+{
+
+auto two_tenant_builder() -> RegistryBuilder
+{
+    RegistryBuilder builder;
+    EXPECT_TRUE(builder.add_tenant("beta"));
+    EXPECT_TRUE(builder.add_tenant("acme"));
+    EXPECT_TRUE(builder.add_type("acme", 0xC8, "Soil Moisture", 2));
+    EXPECT_TRUE(builder.add_type("beta", 0xC8, "Counter", 4));
+    EXPECT_TRUE(builder.add_prefixed_type("beta", 0xCA, "Track", 6));
+    return builder;
+}
+
+}  // namespace
+
+// Test building and reading an image in memory
+TEST(RegistryTest, RoundTrip)
+{
+    const auto image = two_tenant_builder().serialize();
+    auto view = RegistryView::from_bytes(image);
+    ASSERT_TRUE(view);
+    ASSERT_EQ(view->tenant_count(), 2U);
+    EXPECT_EQ(view->tenant(0).id(), "acme");
+    EXPECT_EQ(view->tenant(1).id(), "beta");
+
+    auto acme = view->find("acme");
+    ASSERT_TRUE(acme);
+    EXPECT_EQ(acme->types().size(0xC8), 2U);
+    EXPECT_FALSE(acme->types().is_standard(0xC8));
+    EXPECT_EQ(acme->name(0xC8), "Soil Moisture");
+    EXPECT_EQ(acme->name(0x67), "Temperature");
+    EXPECT_EQ(acme->name(0xC9), "");
+
+    auto beta = view->find("beta");
+    ASSERT_TRUE(beta);
+    EXPECT_EQ(beta->types().size(0xC8), 4U);
+    EXPECT_EQ(beta->name(0xC8), "Counter");
+    EXPECT_EQ(beta->types().unit(0xCA), 6U);
+    EXPECT_EQ(beta->name(0xCA), "Track");
+    EXPECT_FALSE(acme->types().contains(0xCA));
+
+    EXPECT_FALSE(view->find("gamma"));
+    EXPECT_FALSE(view->find(""));
+}
+
+// Test decoding straight from the table inside the image
+TEST(RegistryTest, DecodeWithTenantTable)
+{
+    const auto image = two_tenant_builder().serialize();
+    auto view = RegistryView::from_bytes(image);
+    ASSERT_TRUE(view);
+
+    const std::vector<uint8_t> payload = {0x01, 0x67, 0x01, 0x10, 0x02, 0xC8, 0x12, 0x34};
+    ReadingBuffer<4> readings;
+
+    auto acme = decode_readings(view->find("acme")->types(), payload, readings);
+    ASSERT_TRUE(acme);
+    EXPECT_EQ(*acme, 2U);
+    EXPECT_DOUBLE_EQ(readings[0].value(), 27.2);
+    EXPECT_EQ(readings[1].bytes.size(), 2U);
+
+    // beta declares 0xC8 with 4 bytes, the payload is too short for it
+    auto beta = decode_readings(view->find("beta")->types(), payload, readings);
+    ASSERT_FALSE(beta);
+    EXPECT_EQ(beta.error(), Error::BadPayloadFormat);
+}
+
+// Test the builder's error paths
+TEST(RegistryTest, BuilderErrors)
+{
+    RegistryBuilder builder;
+    ASSERT_TRUE(builder.add_tenant("acme"));
+    EXPECT_EQ(builder.add_tenant("acme").error(), RegistryError::TenantExists);
+    EXPECT_EQ(builder.add_type("nobody", 0xC8, "X", 1).error(), RegistryError::UnknownTenant);
+    EXPECT_EQ(builder.add_type("acme", 0x67, "X", 2).error(), RegistryError::InvalidType);
+    EXPECT_EQ(builder.add_type("acme", 0xC8, "", 2).error(), RegistryError::InvalidType);
+    EXPECT_EQ(builder.add_type("acme", 0xC8, "X", 0).error(), RegistryError::InvalidType);
+    EXPECT_EQ(builder.add_prefixed_type("acme", 0x67, "X", 2).error(),
+              RegistryError::InvalidType);
+    EXPECT_EQ(builder.add_prefixed_type("acme", 0xCA, "X", 0).error(),
+              RegistryError::InvalidType);
+    EXPECT_EQ(builder.tenant_count(), 1U);
+}
+
+// Test that damaged images are rejected
+TEST(RegistryTest, RejectsBadImages)
+{
+    const auto image = two_tenant_builder().serialize();
+
+    EXPECT_EQ(RegistryView::from_bytes(std::span(image).first(16)).error(),
+              RegistryError::Truncated);
+    EXPECT_EQ(RegistryView::from_bytes(std::span(image).first(image.size() - 1)).error(),
+              RegistryError::Truncated);
+
+    auto bad_magic = image;
+    bad_magic[0] = std::byte{'X'};
+    EXPECT_EQ(RegistryView::from_bytes(bad_magic).error(), RegistryError::BadMagic);
+
+    // Bytes 8-11: version, 12-15: byte order mark
+    auto bad_version = image;
+    bad_version[8] = std::byte{99};
+    EXPECT_EQ(RegistryView::from_bytes(bad_version).error(), RegistryError::UnsupportedVersion);
+
+    auto swapped = image;
+    std::swap(swapped[12], swapped[15]);
+    std::swap(swapped[13], swapped[14]);
+    EXPECT_EQ(RegistryView::from_bytes(swapped).error(), RegistryError::ForeignByteOrder);
+
+    // Cualquier byte de las tablas marcado como estándar con un tamaño ajeno
+    auto view = RegistryView::from_bytes(image);
+    ASSERT_TRUE(view);
+    const auto* table = reinterpret_cast<const std::byte*>(&view->find("acme")->types());
+    const auto table_offset = static_cast<std::size_t>(table - image.data());
+
+    auto wrong_standard_size = image;
+    wrong_standard_size[table_offset + 0x88] = std::byte{1};  // GPS with 1 byte
+    EXPECT_EQ(RegistryView::from_bytes(wrong_standard_size).error(), RegistryError::Corrupt);
+
+    auto bad_flag = image;
+    bad_flag[table_offset + type_table_size + 0x67] = std::byte{2};
+    EXPECT_EQ(RegistryView::from_bytes(bad_flag).error(), RegistryError::Corrupt);
+
+    // Flag estándar en un tipo que no lo es, con tamaño 0
+    auto standard_unknown = image;
+    standard_unknown[table_offset + type_table_size + 0xC9] = std::byte{1};
+    EXPECT_EQ(RegistryView::from_bytes(standard_unknown).error(), RegistryError::Corrupt);
+
+    // Un tipo con tamaño fijo y unidad a la vez
+    auto sized_and_prefixed = image;
+    sized_and_prefixed[table_offset + 2 * type_table_size + 0xC8] = std::byte{1};
+    EXPECT_EQ(RegistryView::from_bytes(sized_and_prefixed).error(), RegistryError::Corrupt);
+}
+
+// Test writing an image to disk and mapping it
+TEST(RegistryTest, WriteAndMap)
+{
+    const std::string path = testing::TempDir() + "cayene_registry_" +
+                             std::to_string(getpid()) + ".bin";
+    ASSERT_TRUE(two_tenant_builder().write(path));
+
+    auto mapped = MappedRegistry::open(path);
+    ASSERT_TRUE(mapped);
+    EXPECT_EQ(mapped->view().tenant_count(), 2U);
+
+    // El mapeo sigue siendo válido tras moverlo
+    MappedRegistry moved = std::move(*mapped);
+    auto acme = moved.view().find("acme");
+    ASSERT_TRUE(acme);
+    EXPECT_EQ(acme->name(0xC8), "Soil Moisture");
+
+    std::remove(path.c_str());
+    EXPECT_EQ(MappedRegistry::open(path).error(), RegistryError::Io);
+}
+
+}  // namespace cayene::test
@@ -0,0 +1,238 @@
+/**
+ * @file sink_test.cpp
+ * @brief Unit tests for the batched output sinks
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/sink.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+auto temp_path(const std::string& name) -> std::string
+{
+    return (std::filesystem::temp_directory_path() /
+            std::format("cayene_{}_{}", name, ::getpid()))
+        .string();
+}
+
+auto read_lines(const std::string& path) -> std::vector<std::string>
+{
+    std::ifstream input(path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(input, line);)
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// Socket de datagramas con timeout para no colgar el test
+void set_receive_timeout(int fd)
+{
+    timeval timeout{.tv_sec = 5, .tv_usec = 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+auto receive_all(int fd, std::size_t count) -> std::vector<std::string>
+{
+    std::vector<std::string> received;
+    std::array<char, 2048> buffer{};
+    while (received.size() < count)
+    {
+        const ssize_t size = ::recv(fd, buffer.data(), buffer.size(), 0);
+        if (size < 0)
+        {
+            break;
+        }
+        received.emplace_back(buffer.data(), static_cast<std::size_t>(size));
+    }
+    return received;
+}
+
+}  // namespace
+
+TEST(SinkTest, FileFromManyThreads)
+{
+    constexpr std::size_t threads = 4;
+    constexpr std::size_t per_thread = 5000;
+    const std::string path = temp_path("sink_file");
+    std::remove(path.c_str());
+    {
+        auto sink = OutputSink::file(path);
+        ASSERT_TRUE(sink.has_value()) << sink.error().message();
+
+        std::vector<std::jthread> producers;
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            producers.emplace_back(
+                [&sink, t]
+                {
+                    for (std::size_t i = 0; i < per_thread; ++i)
+                    {
+                        (*sink)->write(std::format(R"({{"thread":{},"seq":{}}})", t, i));
+                    }
+                });
+        }
+        producers.clear();
+        (*sink)->flush();
+
+        const auto stats = (*sink)->stats();
+        EXPECT_EQ(stats.messages, threads * per_thread);
+        EXPECT_EQ(stats.errors, 0U);
+        // El objetivo del sink: muchas líneas por llamada al sistema
+        EXPECT_LT(stats.syscalls, stats.messages / 10);
+    }
+
+    const auto lines = read_lines(path);
+    ASSERT_EQ(lines.size(), threads * per_thread);
+    const std::set<std::string> unique(lines.begin(), lines.end());
+    EXPECT_EQ(unique.size(), lines.size());
+    EXPECT_TRUE(unique.contains(R"({"thread":3,"seq":4999})"));
+    std::remove(path.c_str());
+}
+
+TEST(SinkTest, DestructorFlushes)
+{
+    const std::string path = temp_path("sink_close");
+    std::remove(path.c_str());
+    {
+        auto sink = OutputSink::file(path, {.flush_interval = std::chrono::hours(1)});
+        ASSERT_TRUE(sink.has_value());
+        (*sink)->write("first");
+        (*sink)->write("second");
+    }
+    EXPECT_EQ(read_lines(path), (std::vector<std::string>{"first", "second"}));
+    std::remove(path.c_str());
+}
+
+TEST(SinkTest, FlushWritesBeforeThresholds)
+{
+    const std::string path = temp_path("sink_flush");
+    std::remove(path.c_str());
+    auto sink = OutputSink::file(path, {.flush_interval = std::chrono::hours(1)});
+    ASSERT_TRUE(sink.has_value());
+
+    (*sink)->write("one");
+    (*sink)->flush();
+    EXPECT_EQ(read_lines(path), (std::vector<std::string>{"one"}));
+    EXPECT_EQ((*sink)->stats().flushes, 1U);
+
+    // Sin nada pendiente flush() no despierta al hilo
+    (*sink)->flush();
+    EXPECT_EQ((*sink)->stats().flushes, 1U);
+    std::remove(path.c_str());
+}
+
+TEST(SinkTest, IntervalFlush)
+{
+    const std::string path = temp_path("sink_interval");
+    std::remove(path.c_str());
+    auto sink = OutputSink::file(path, {.flush_interval = std::chrono::milliseconds(10)});
+    ASSERT_TRUE(sink.has_value());
+
+    (*sink)->write("late");
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (read_lines(path).empty() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(read_lines(path), (std::vector<std::string>{"late"}));
+    std::remove(path.c_str());
+}
+
+TEST(SinkTest, UnixDatagramKeepsBoundaries)
+{
+    const std::string path = temp_path("sink_dgram");
+    ::unlink(path.c_str());
+    const int receiver = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    ASSERT_GE(receiver, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::snprintf(address.sun_path, sizeof(address.sun_path), "%s", path.c_str());
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    ASSERT_EQ(::bind(receiver, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    set_receive_timeout(receiver);
+
+    // La cola del receptor es corta: send bloquea hasta que se lee, como un stream
+    constexpr std::size_t count = 1000;
+    std::vector<std::string> received;
+    std::jthread reader([&] { received = receive_all(receiver, count); });
+    {
+        auto sink = OutputSink::open("unixgram:" + path);
+        ASSERT_TRUE(sink.has_value()) << sink.error().message();
+        EXPECT_EQ((*sink)->kind(), SinkKind::Datagram);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            (*sink)->write(std::format(R"({{"seq":{}}})", i));
+        }
+        (*sink)->flush();
+        EXPECT_LT((*sink)->stats().syscalls, count);
+    }
+
+    reader.join();
+    ASSERT_EQ(received.size(), count);
+    // Un datagrama por mensaje y sin salto de línea
+    EXPECT_EQ(received.front(), R"({"seq":0})");
+    EXPECT_EQ(received.back(), R"({"seq":999})");
+    ::close(receiver);
+    ::unlink(path.c_str());
+}
+
+TEST(SinkTest, Udp)
+{
+    const int receiver = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(receiver, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+    ASSERT_EQ(::bind(receiver, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    socklen_t size = sizeof(address);
+    ::getsockname(receiver, reinterpret_cast<sockaddr*>(&address), &size);
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    set_receive_timeout(receiver);
+
+    auto sink = OutputSink::open(std::format("udp:127.0.0.1:{}", ntohs(address.sin_port)));
+    ASSERT_TRUE(sink.has_value()) << sink.error().message();
+    (*sink)->write("alpha");
+    (*sink)->write("beta");
+    (*sink)->flush();
+
+    EXPECT_EQ(receive_all(receiver, 2), (std::vector<std::string>{"alpha", "beta"}));
+    ::close(receiver);
+}
+
+TEST(SinkTest, BadDestinations)
+{
+    EXPECT_FALSE(OutputSink::open("udp:127.0.0.1").has_value());
+    EXPECT_FALSE(OutputSink::open("udp:not-an-address:9000").has_value());
+    EXPECT_FALSE(OutputSink::open("unix:/nonexistent/cayene.sock").has_value());
+    EXPECT_FALSE(OutputSink::open("/nonexistent/dir/out.ndjson").has_value());
+}
+
+}  // namespace cayene::ingest::test
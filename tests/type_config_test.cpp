@@ -0,0 +1,207 @@
+/**
+ * @file type_config_test.cpp
+ * @brief Unit tests for type definition files
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/type_config.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+namespace cayene::test
+{
+
+namespace
+{
+
+constexpr std::string_view example_config = R"({
+    "version": 1,
+    "types": [
+        { "type_id": "0xC8", "name": "Soil",
+          "fields": [ { "name": "moisture", "format": "u16", "scale": 10 },
+                      { "name": "offset", "format": "i8" } ] },
+        { "type_id": 201, "name": "Blob", "size": 2 }
+    ],
+    "fports": {
+        "10": { "standard": false,
+                "types": [ { "type_id": "0x67", "name": "Counter",
+                             "fields": [ { "name": "count", "format": "u32" } ] } ] },
+        "11": {}
+    }
+})";
+
+}  // namespace
+
+// Test decoding custom layouts on the default profile
+TEST(TypeConfigTest, DecodeDefaultProfile)
+{
+    auto catalog = TypeCatalog::parse(example_config);
+    ASSERT_TRUE(catalog) << catalog.error().message;
+    EXPECT_EQ(catalog->definition_count(), 3U);
+    EXPECT_EQ(catalog->profile_count(), 3U);
+
+    // Soil: 0x0190 = 400 -> 40.0, 0xFE = -2; Blob; standard Temperature
+    std::vector<uint8_t> payload = {0x01, 0xC8, 0x01, 0x90, 0xFE, 0x02, 0xC9,
+                                    0xAB, 0xCD, 0x03, 0x67, 0x01, 0x10};
+    auto res = catalog->decode(1, payload);
+    ASSERT_TRUE(res);
+    EXPECT_DOUBLE_EQ((*res)["Soil_1"]["moisture"], 40.0);
+    EXPECT_EQ((*res)["Soil_1"]["offset"], -2);
+    EXPECT_EQ((*res)["Blob_2"], Json::array({0xAB, 0xCD}));
+    EXPECT_DOUBLE_EQ((*res)["Temperature_3"], 27.2);
+
+    std::array<Reading, 4> readings{};
+    auto count = catalog->decode_readings(1, payload, readings);
+    ASSERT_TRUE(count);
+    ASSERT_EQ(*count, 3U);
+    const TypeDefinition* soil = catalog->definition(1, readings[0].type_id);
+    ASSERT_NE(soil, nullptr);
+    EXPECT_DOUBLE_EQ(soil->value(readings[0].bytes, 0), 40.0);
+    EXPECT_EQ(soil->raw(readings[0].bytes, 1), -2);
+    EXPECT_EQ(catalog->definition(1, 0x67), nullptr);
+}
+
+// Test that an fPort entry replaces the type set
+TEST(TypeConfigTest, DecodePerPortProfile)
+{
+    auto catalog = TypeCatalog::parse(example_config);
+    ASSERT_TRUE(catalog);
+
+    // On port 10 0x67 is a u32 counter and the standard types are gone
+    std::vector<uint8_t> counter = {0x01, 0x67, 0x00, 0x01, 0x00, 0x00};
+    auto res = catalog->decode(10, counter);
+    ASSERT_TRUE(res);
+    EXPECT_EQ((*res)["Counter_1"]["count"], 65536);
+
+    std::vector<uint8_t> humidity = {0x01, 0x68, 0x00, 0x50};
+    EXPECT_EQ(catalog->decode(10, humidity).error(), Error::UnkwownDataType);
+    EXPECT_TRUE(catalog->decode(11, humidity));
+
+    // Global types are still available on port 10
+    std::vector<uint8_t> soil = {0x01, 0xC8, 0x01, 0x90, 0x00};
+    EXPECT_TRUE(catalog->decode(10, soil));
+}
+
+// Test that invalid files are rejected with a location
+TEST(TypeConfigTest, RejectsInvalidFiles)
+{
+    struct Case
+    {
+        std::string_view text;
+        std::string_view message;
+    };
+    const std::array<Case, 10> cases = {{
+        {R"({"types": [{"type_id": 300, "name": "X", "size": 1}]})", "types[0]: type_id"},
+        {R"({"types": [{"type_id": "0xC8", "size": 1}]})", "types[0]: type needs a non-empty"},
+        {R"({"types": [{"type_id": 200, "name": "X"}]})", "types[0]: type needs fields"},
+        {R"({"types": [{"type_id": 200, "name": "X",
+             "fields": [{"name": "a", "format": "f32"}]}]})",
+         "types[0].fields[0]: unknown format 'f32'"},
+        {R"({"types": [{"type_id": 200, "name": "X", "size": 3,
+             "fields": [{"name": "a", "format": "u8"}]}]})",
+         "types[0]: size must"},
+        {R"({"types": [{"type_id": 200, "name": "X", "unit": 2,
+             "fields": [{"name": "a", "format": "u8"}]}]})",
+         "types[0]: unit must be a positive integer"},
+        {R"({"types": [{"type_id": 200, "name": "X", "unit": 0}]})",
+         "types[0]: unit must be between 1 and 255"},
+        {R"({"types": [{"type_id": 103, "name": "X", "size": 1}]})", "collides with a standard"},
+        {R"({"fports": {"0": {}}})", "fports.0: port must be 1-255"},
+        {R"({"fports": {"5": {"types": [{"type_id": 200, "name": "A", "size": 1},
+                                       {"type_id": 200, "name": "B", "size": 1}]}}})",
+         "fports.5: type_id 0xc8 is defined twice"},
+    }};
+
+    for (const auto& test_case : cases)
+    {
+        auto catalog = TypeCatalog::parse(test_case.text);
+        ASSERT_FALSE(catalog) << test_case.text;
+        EXPECT_EQ(catalog.error().code, ConfigErrorCode::Invalid);
+        EXPECT_NE(catalog.error().message.find(test_case.message), std::string::npos)
+            << catalog.error().message;
+    }
+
+    EXPECT_EQ(TypeCatalog::parse("{").error().code, ConfigErrorCode::Syntax);
+    EXPECT_EQ(TypeCatalog::load("/nonexistent/types.json").error().code, ConfigErrorCode::Io);
+}
+
+// Test length-prefixed types: a count byte, then that many units
+TEST(TypeConfigTest, DecodeVariableLengthTypes)
+{
+    auto catalog = TypeCatalog::parse(R"({
+        "types": [
+            { "type_id": "0xCA", "name": "Track", "unit": 4,
+              "fields": [ { "name": "lat", "format": "i16", "scale": 100 },
+                          { "name": "lon", "format": "i16", "scale": 100 } ] },
+            { "type_id": "0xCB", "name": "Text", "unit": 1 }
+        ]
+    })");
+    ASSERT_TRUE(catalog) << catalog.error().message;
+    EXPECT_EQ(catalog->definition(1, 0xCA)->unit, 4U);
+
+    // Dos puntos, un texto de 2 bytes y una temperatura
+    std::vector<uint8_t> payload = {0x01, 0xCA, 0x02, 0x10, 0x68, 0xFF, 0x9C, 0x10,
+                                    0xCC, 0x00, 0x64, 0x02, 0xCB, 0x02, 'o',  'k',
+                                    0x03, 0x67, 0x01, 0x10};
+    auto res = catalog->decode(1, payload);
+    ASSERT_TRUE(res);
+    ASSERT_EQ((*res)["Track_1"].size(), 2U);
+    EXPECT_DOUBLE_EQ((*res)["Track_1"][0]["lat"], 42.0);
+    EXPECT_DOUBLE_EQ((*res)["Track_1"][0]["lon"], -1.0);
+    EXPECT_DOUBLE_EQ((*res)["Track_1"][1]["lat"], 43.0);
+    EXPECT_EQ((*res)["Text_2"], Json::array({'o', 'k'}));
+    EXPECT_DOUBLE_EQ((*res)["Temperature_3"], 27.2);
+
+    std::array<Reading, 4> readings{};
+    EXPECT_EQ(catalog->decode_readings(1, payload, readings).value_or(0), 3U);
+
+    payload.resize(10);
+    EXPECT_FALSE(catalog->decode(1, payload));
+}
+
+// Test loading from a file
+TEST(TypeConfigTest, LoadFile)
+{
+    const std::string path =
+        testing::TempDir() + "cayene_types_" + std::to_string(getpid()) + ".json";
+    std::ofstream(path) << example_config;
+
+    auto catalog = TypeCatalog::load(path);
+    std::remove(path.c_str());
+    ASSERT_TRUE(catalog);
+    EXPECT_EQ(catalog->definition_count(), 3U);
+}
+
+// Test that custom types added from C++ decode to their bytes
+TEST(TypeConfigTest, AddDataTypeWithoutLayout)
+{
+    Decoder decoder;
+    EXPECT_TRUE(decoder.add_data_type(0xC8, "Raw", 2));
+    EXPECT_FALSE(decoder.add_data_type(0xC8, "Raw", 2));
+    EXPECT_FALSE(decoder.add_data_type(0x67, "Temperature", 2));
+
+    std::vector<uint8_t> payload = {0x01, 0xC8, 0x12, 0x34};
+    auto res = decoder.decode(payload);
+    ASSERT_TRUE(res);
+    EXPECT_EQ((*res)["Raw_1"], Json::array({0x12, 0x34}));
+
+    // Con longitud variable los bytes incluyen el de longitud
+    EXPECT_TRUE(decoder.add_prefixed_data_type(0xC9, "List", 1));
+    EXPECT_FALSE(decoder.add_prefixed_data_type(0xC8, "List", 1));
+    payload = {0x02, 0xC9, 0x02, 0x12, 0x34};
+    res = decoder.decode(payload);
+    ASSERT_TRUE(res);
+    EXPECT_EQ((*res)["List_2"], Json::array({0x02, 0x12, 0x34}));
+}
+
+}  // namespace cayene::test
@@ -0,0 +1,165 @@
+/**
+ * @file vibration_test.cpp
+ * @brief Unit tests for the accelerometer vibration statistics
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "cayene/ingest/vibration.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace cayene::ingest::test
+{
+
+namespace
+{
+
+auto sample(uint8_t channel, int32_t x, int32_t y, int32_t z) -> Reading
+{
+    return {channel, accelerometer_type_id, 3, {x, y, z}, {}};
+}
+
+}  // namespace
+
+TEST(VibrationTest, KernelMatchesScalarLoop)
+{
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int32_t> value(std::numeric_limits<int16_t>::min(),
+                                                 std::numeric_limits<int16_t>::max());
+    // Longitudes que no son múltiplo del ancho del vector, y el valor más negativo
+    for (const std::size_t size : {0U, 1U, 7U, 16U, 33U, 256U, 1000U})
+    {
+        std::vector<int16_t> samples(size);
+        for (int16_t& s : samples)
+        {
+            s = static_cast<int16_t>(value(random));
+        }
+        if (size > 3)
+        {
+            samples[3] = std::numeric_limits<int16_t>::min();
+        }
+
+        uint64_t sum_squares = 0;
+        uint32_t peak = 0;
+        for (const int16_t s : samples)
+        {
+            sum_squares += static_cast<uint64_t>(int64_t{s} * s);
+            peak = std::max(peak, static_cast<uint32_t>(std::abs(int32_t{s})));
+        }
+        const AxisStats stats = axis_stats(samples);
+        EXPECT_EQ(stats.sum_squares, sum_squares) << size;
+        EXPECT_EQ(stats.peak, peak) << size;
+    }
+
+    // Todo -32768: cada par de cuadrados llega a 2^31
+    const std::vector<int16_t> extreme(64, std::numeric_limits<int16_t>::min());
+    const AxisStats stats = axis_stats(extreme);
+    EXPECT_EQ(stats.sum_squares, 64ULL * 32768 * 32768);
+    EXPECT_EQ(stats.peak, 32768U);
+}
+
+TEST(VibrationTest, SineWindow)
+{
+    VibrationMonitor monitor({.window = 64});
+    std::vector<VibrationFeatures> features;
+    std::vector<Reading> readings;
+    for (int i = 0; i < 64; ++i)
+    {
+        // x: seno de 1 g con 16 muestras por periodo; y: constante; z: quieto
+        const auto x = static_cast<int32_t>(std::lround(1000 * std::sin(i * std::numbers::pi / 8)));
+        readings.push_back(sample(1, x, 500, 0));
+    }
+    EXPECT_EQ(monitor.update("70B3D57ED0000001", std::span(readings).first(63), features), 0U);
+    EXPECT_EQ(monitor.update("70B3D57ED0000001", std::span(readings).last(1), features), 1U);
+
+    ASSERT_EQ(features.size(), 1U);
+    EXPECT_EQ(features[0].channel, 1);
+    EXPECT_NEAR(features[0].rms[0], 1.0 / std::sqrt(2.0), 1e-3);
+    EXPECT_NEAR(features[0].peak[0], 1.0, 1e-9);
+    EXPECT_NEAR(features[0].crest[0], std::sqrt(2.0), 1e-2);
+    EXPECT_NEAR(features[0].rms[1], 0.5, 1e-9);
+    EXPECT_NEAR(features[0].crest[1], 1.0, 1e-9);
+    EXPECT_EQ(features[0].rms[2], 0.0);
+    EXPECT_EQ(features[0].crest[2], 0.0);
+}
+
+TEST(VibrationTest, HopAndChannels)
+{
+    VibrationMonitor monitor({.window = 8, .hop = 2});
+    // Una ventana enorme reservaría gigas por dispositivo: se acota
+    EXPECT_EQ(VibrationMonitor({.window = 0xFFFFFFFF}).config().window, max_vibration_window);
+    std::vector<VibrationFeatures> features;
+    std::vector<Reading> readings;
+    for (int32_t i = 0; i < 12; ++i)
+    {
+        readings.push_back(sample(1, i, 0, 0));
+        // Otro canal, con su propio búfer
+        readings.push_back(sample(2, 100, 0, 0));
+    }
+    readings.push_back({1, 0x67, 1, {250, 0, 0}, {}});
+
+    // Una ventana al llenarse y otra cada 2 muestras nuevas: 8, 10 y 12
+    EXPECT_EQ(monitor.update("device", readings, features), 6U);
+    EXPECT_EQ(monitor.devices(), 1U);
+    std::vector<VibrationFeatures> first_channel;
+    for (const VibrationFeatures& window : features)
+    {
+        if (window.channel == 1)
+        {
+            first_channel.push_back(window);
+        }
+        else
+        {
+            EXPECT_DOUBLE_EQ(window.peak[0], 0.1);
+        }
+    }
+    ASSERT_EQ(first_channel.size(), 3U);
+    // La última ventana tiene las muestras 4..11
+    EXPECT_DOUBLE_EQ(first_channel[2].peak[0], 0.011);
+    const double rms = std::sqrt((16 + 25 + 36 + 49 + 64 + 81 + 100 + 121) / 8.0) / 1000.0;
+    EXPECT_NEAR(first_channel[2].rms[0], rms, 1e-12);
+}
+
+TEST(VibrationTest, AnnotateReplacesSamples)
+{
+    VibrationMonitor monitor({.window = 2});
+    const auto catalog = TypeCatalog::parse("{}");
+    ASSERT_TRUE(catalog);
+
+    // Acelerómetro (canal 3) y temperatura (canal 1)
+    const std::vector<uint8_t> payload = {0x03, 0x71, 0x03, 0xe8, 0x00, 0x00, 0xfc, 0x18,
+                                          0x01, 0x67, 0x01, 0x10};
+    Uplink uplink{EnvelopeFormat::ChirpStack, "70B3D57ED0000001", 2, payload};
+    Json line{{"decoded", {{"Accelerometer_3", {{"x", 1.0}}}, {"Temperature_1", 27.2}}}};
+    EXPECT_EQ(monitor.annotate(*catalog, uplink, line), 0U);
+    EXPECT_FALSE(line["decoded"].contains("Accelerometer_3"));
+    EXPECT_TRUE(line["decoded"].contains("Temperature_1"));
+    EXPECT_FALSE(line.contains("vibration"));
+
+    // Las mismas lecturas, decodificadas una vez por quien llama
+    std::array<Reading, 4> readings{};
+    const auto count = catalog->decode_readings(2, payload, readings);
+    ASSERT_TRUE(count);
+    Json second{{"decoded", Json::object()}};
+    EXPECT_EQ(monitor.annotate(*catalog, uplink, std::span(readings).first(*count), second), 1U);
+    ASSERT_EQ(second["vibration"].size(), 1U);
+    const Json& window = second["vibration"][0];
+    EXPECT_EQ(window["channel"], 3);
+    EXPECT_DOUBLE_EQ(window["rms"]["x"].get<double>(), 1.0);
+    EXPECT_DOUBLE_EQ(window["peak"]["z"].get<double>(), 1.0);
+    EXPECT_DOUBLE_EQ(window["crest"]["y"].get<double>(), 0.0);
+}
+
+}  // namespace cayene::ingest::test
@@ -0,0 +1,318 @@
+/**
+ * @file cayene_http_load.cpp
+ * @brief cayene_http_load: webhook load generator for cayene_httpd
+ *
+ * Opens N keep-alive connections, one thread each, and posts uplink
+ * envelopes in pipelined batches for a fixed time. Reports requests per
+ * second, non-2xx responses and the batch round-trip latency.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int exit_ok = 0;
+constexpr int exit_error = 1;
+constexpr int exit_usage = 2;
+
+// Temperatura, humedad y GPS en base64
+constexpr std::string_view sample_payload = "A2cBEAVoAZABiAZ2Xw1p9gAD6A==";
+
+struct Options
+{
+    std::string host{"127.0.0.1"};
+    uint16_t port{8080};
+    std::string path{"/uplink"};
+    unsigned connections{4};
+    unsigned pipeline{16};
+    double seconds{5.0};
+    bool chirpstack{false};
+};
+
+struct Result
+{
+    uint64_t responses{0};
+    uint64_t failures{0};
+    std::vector<double> batch_us;
+    bool connect_failed{false};
+};
+
+void usage()
+{
+    std::println(stderr,
+                 "usage: cayene_http_load [options]\n"
+                 "\n"
+                 "options:\n"
+                 "  --host ADDR        server IPv4 address (default 127.0.0.1)\n"
+                 "  --port N           server port (default 8080)\n"
+                 "  --path PATH        webhook target (default /uplink)\n"
+                 "  --connections N    keep-alive connections, one thread each (default 4)\n"
+                 "  --pipeline N       requests sent per batch (default 16)\n"
+                 "  --seconds S        test duration (default 5)\n"
+                 "  --format F         ttn or chirpstack (default ttn)");
+}
+
+auto parse_options(int argc, char** argv) -> std::optional<Options>
+{
+    Options options;
+    const std::vector<std::string_view> arguments(argv + 1, argv + argc);
+    for (std::size_t i = 0; i + 1 < arguments.size(); i += 2)
+    {
+        const std::string_view argument = arguments[i];
+        const std::string value(arguments[i + 1]);
+        if (argument == "--host")
+        {
+            options.host = value;
+        }
+        else if (argument == "--port")
+        {
+            options.port = static_cast<uint16_t>(std::atoi(value.c_str()));
+        }
+        else if (argument == "--path")
+        {
+            options.path = value;
+        }
+        else if (argument == "--connections")
+        {
+            options.connections = static_cast<unsigned>(std::max(1, std::atoi(value.c_str())));
+        }
+        else if (argument == "--pipeline")
+        {
+            options.pipeline = static_cast<unsigned>(std::max(1, std::atoi(value.c_str())));
+        }
+        else if (argument == "--seconds")
+        {
+            options.seconds = std::atof(value.c_str());
+        }
+        else if (argument == "--format" && (value == "ttn" || value == "chirpstack"))
+        {
+            options.chirpstack = value == "chirpstack";
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+    if (arguments.size() % 2 != 0)
+    {
+        return std::nullopt;
+    }
+    return options;
+}
+
+auto envelope(const Options& options, unsigned device) -> std::string
+{
+    if (options.chirpstack)
+    {
+        return std::format(R"({{"deduplicationId":"{:08x}","deviceInfo":{{"devEui":"{:016x}",)"
+                           R"("deviceName":"load-{}"}},"fCnt":1,"fPort":2,"data":"{}"}})",
+                           device, device, device, sample_payload);
+    }
+    return std::format(R"({{"end_device_ids":{{"device_id":"load-{}","dev_eui":"{:016X}"}},)"
+                       R"("uplink_message":{{"f_port":2,"f_cnt":1,"frm_payload":"{}",)"
+                       R"("rx_metadata":[{{"gateway_ids":{{"gateway_id":"gw"}},"rssi":-42}}]}}}})",
+                       device, device, sample_payload);
+}
+
+auto connect_to(const Options& options) -> int
+{
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    if (::inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1)
+    {
+        return -1;
+    }
+    const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        return -1;
+    }
+    int enable = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return fd;
+}
+
+/**
+ * Consumes complete responses from the front of @p buffer, counting the
+ * non-2xx ones in @p failures. Returns how many were consumed.
+ */
+auto consume_responses(std::string& buffer, uint64_t& failures) -> unsigned
+{
+    unsigned count = 0;
+    std::size_t offset = 0;
+    while (true)
+    {
+        const std::string_view rest = std::string_view(buffer).substr(offset);
+        const auto header_end = rest.find("\r\n\r\n");
+        if (header_end == std::string_view::npos)
+        {
+            break;
+        }
+        std::size_t body_size = 0;
+        if (const auto length = rest.substr(0, header_end).find("Content-Length: ");
+            length != std::string_view::npos)
+        {
+            const char* digits = rest.data() + length + 16;
+            std::from_chars(digits, rest.data() + header_end, body_size);
+        }
+        if (rest.size() < header_end + 4 + body_size)
+        {
+            break;
+        }
+        // "HTTP/1.1 2xx"
+        if (rest.size() < 10 || rest[9] != '2')
+        {
+            ++failures;
+        }
+        offset += header_end + 4 + body_size;
+        ++count;
+    }
+    buffer.erase(0, offset);
+    return count;
+}
+
+auto run_connection(const Options& options, unsigned index, Clock::time_point deadline)
+    -> Result
+{
+    Result result;
+    const int fd = connect_to(options);
+    if (fd < 0)
+    {
+        result.connect_failed = true;
+        return result;
+    }
+
+    const std::string body = envelope(options, index);
+    const std::string request =
+        std::format("POST {} HTTP/1.1\r\nHost: {}\r\nContent-Type: application/json\r\n"
+                    "Content-Length: {}\r\n\r\n{}",
+                    options.path, options.host, body.size(), body);
+    std::string batch;
+    for (unsigned i = 0; i < options.pipeline; ++i)
+    {
+        batch += request;
+    }
+
+    std::string input;
+    std::array<char, 64 * 1024> buffer{};
+    while (Clock::now() < deadline)
+    {
+        const auto start = Clock::now();
+        if (::send(fd, batch.data(), batch.size(), MSG_NOSIGNAL) !=
+            static_cast<ssize_t>(batch.size()))
+        {
+            break;
+        }
+
+        unsigned pending = options.pipeline;
+        while (pending > 0)
+        {
+            const ssize_t received = ::recv(fd, buffer.data(), buffer.size(), 0);
+            if (received <= 0)
+            {
+                ::close(fd);
+                return result;
+            }
+            input.append(buffer.data(), static_cast<std::size_t>(received));
+            const unsigned done = consume_responses(input, result.failures);
+            pending -= std::min(done, pending);
+            result.responses += done;
+        }
+        result.batch_us.push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    ::close(fd);
+    return result;
+}
+
+auto percentile(std::vector<double>& values, double fraction) -> double
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+    const auto last = static_cast<double>(values.size() - 1);
+    const auto index = static_cast<std::size_t>(fraction * last);
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index),
+                     values.end());
+    return values[index];
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const auto options = parse_options(argc, argv);
+    if (!options)
+    {
+        usage();
+        return exit_usage;
+    }
+
+    const auto start = Clock::now();
+    const auto deadline =
+        start + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(options->seconds));
+
+    std::vector<Result> results(options->connections);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < options->connections; ++i)
+    {
+        threads.emplace_back([&, i] { results[i] = run_connection(*options, i, deadline); });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Result total;
+    for (auto& result : results)
+    {
+        if (result.connect_failed)
+        {
+            std::println(stderr, "error: cannot connect to {}:{}", options->host, options->port);
+            return exit_error;
+        }
+        total.responses += result.responses;
+        total.failures += result.failures;
+        total.batch_us.insert(total.batch_us.end(), result.batch_us.begin(),
+                              result.batch_us.end());
+    }
+
+    std::println("requests: {} in {:.2f} s ({:.0f} req/s), non-2xx: {}", total.responses,
+                 elapsed, static_cast<double>(total.responses) / elapsed, total.failures);
+    std::println("batch of {} round trip: p50 {:.1f} us, p99 {:.1f} us", options->pipeline,
+                 percentile(total.batch_us, 0.5), percentile(total.batch_us, 0.99));
+    return total.failures == 0 ? exit_ok : exit_error;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file cayene_httpd.cpp
+ * @brief cayene_httpd: webhook ingest server for The Things Stack and ChirpStack
+ *
+ * Receives uplink webhooks, decodes their LPP payloads and writes one JSON
+ * line per uplink to the configured output sink. Runs until SIGINT or SIGTERM
+ * and prints its counters on exit.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+
+#include "cayene/ingest/http_server.hpp"
+#include "cayene/type_config.hpp"
+#include "daemon_stages.hpp"
+
+namespace
+{
+
+using cayene::Json;
+using cayene::TypeCatalog;
+using cayene::ingest::HttpServer;
+using cayene::ingest::HttpServerConfig;
+using cayene::ingest::OutputSink;
+using cayene::ingest::Uplink;
+using cayene::ingest::UplinkHandler;
+using cayene::tools::LineStages;
+using cayene::tools::OptionStatus;
+using cayene::tools::StageOptions;
+
+constexpr int exit_ok = 0;
+constexpr int exit_error = 1;
+constexpr int exit_usage = 2;
+
+struct Options
+{
+    HttpServerConfig server;
+    StageOptions stages;
+};
+
+void usage()
+{
+    std::println(stderr,
+                 "usage: cayene_httpd [options]\n"
+                 "\n"
+                 "options:\n"
+                 "  --bind ADDR        IPv4 address to listen on (default 127.0.0.1)\n"
+                 "  --port N           TCP port (default 8080)\n"
+                 "  --threads N        worker threads, 0 for one per CPU (default 0)\n"
+                 "  --pin              pin worker i to CPU i\n"
+                 "  --path PATH        webhook target (default /uplink)\n"
+                 "{}",
+                 cayene::tools::stage_usage);
+}
+
+auto parse_options(int argc, char** argv) -> std::optional<Options>
+{
+    Options options;
+    options.server.port = 8080;
+    options.server.threads = 0;
+
+    const std::vector<std::string_view> arguments(argv + 1, argv + argc);
+    for (std::size_t i = 0; i < arguments.size(); ++i)
+    {
+        const std::string_view argument = arguments[i];
+        if (argument == "--pin")
+        {
+            options.server.pin_threads = true;
+            continue;
+        }
+        if (i + 1 >= arguments.size())
+        {
+            return std::nullopt;
+        }
+        const std::string value(arguments[++i]);
+
+        if (argument == "--bind")
+        {
+            options.server.bind_address = value;
+        }
+        else if (argument == "--port")
+        {
+            options.server.port = static_cast<uint16_t>(std::atoi(value.c_str()));
+        }
+        else if (argument == "--threads")
+        {
+            options.server.threads = static_cast<unsigned>(std::atoi(value.c_str()));
+        }
+        else if (argument == "--path")
+        {
+            options.server.path = value;
+        }
+        else if (cayene::tools::parse_stage_option(argument, value, options.stages,
+                                                   options.server.admission) !=
+                 OptionStatus::Consumed)
+        {
+            return std::nullopt;
+        }
+    }
+    return options;
+}
+
+// Una línea JSON por uplink; el sink agrupa las escrituras de todos los workers
+auto line_writer(OutputSink& sink, const LineStages& stages) -> UplinkHandler
+{
+    return [&sink, &stages](const Uplink& uplink, const Json& decoded)
+    {
+        Json line{{"device_id", uplink.device_id}, {"f_port", uplink.fport}, {"decoded", decoded}};
+        if (stages.enricher != nullptr)
+        {
+            stages.enricher->enrich(uplink.device_id, line);
+        }
+        cayene::tools::annotate_line(stages, uplink, line);
+        sink.write(line.dump());
+    };
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const auto options = parse_options(argc, argv);
+    if (!options)
+    {
+        usage();
+        return exit_usage;
+    }
+
+    auto catalog = options->stages.types.empty() ? TypeCatalog::parse("{}")
+                                                 : TypeCatalog::load(options->stages.types);
+    if (!catalog)
+    {
+        std::println(stderr, "error: {}", catalog.error().message);
+        return exit_usage;
+    }
+
+    // Las señales se esperan con sigwait; los workers las heredan bloqueadas
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    auto opened = cayene::tools::open_stages(options->stages);
+    if (!opened)
+    {
+        std::println(stderr, "error: {}", opened.error());
+        return exit_usage;
+    }
+    OutputSink* output = opened->output.get();
+
+    LineStages stages = opened->line_stages();
+    HttpServer server(options->server, std::move(*catalog),
+                      output != nullptr ? line_writer(*output, stages) : nullptr);
+    stages.catalog = &server.catalog();
+    const auto port = server.start();
+    if (!port)
+    {
+        std::println(stderr, "error: cannot listen: {}", port.error().message());
+        return exit_error;
+    }
+    std::println(stderr, "cayene_httpd listening on {}:{}{}", options->server.bind_address,
+                 *port, options->server.path);
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server.stop();
+
+    const auto stats = server.stats();
+    std::println(stderr,
+                 "connections={} requests={} uplinks={} rejected={} bad_requests={} "
+                 "throttled={}",
+                 stats.connections, stats.requests, stats.uplinks, stats.rejected,
+                 stats.bad_requests, stats.throttled);
+    cayene::tools::print_admission(server.admission());
+    cayene::tools::print_output(output);
+    return exit_ok;
+}
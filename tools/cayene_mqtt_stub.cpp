@@ -0,0 +1,279 @@
+/**
+ * @file cayene_mqtt_stub.cpp
+ * @brief cayene_mqtt_stub: single-client MQTT broker stub for load tests
+ *
+ * Accepts one subscriber, and once it subscribes publishes N uplink
+ * envelopes with QoS 1 on a ChirpStack or The Things Stack topic, keeping
+ * at most W of them unacknowledged. Reports the rate from the SUBSCRIBE to
+ * the last PUBACK. Speaks just enough MQTT 3.1.1 for cayene_mqttd.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <optional>
+#include <print>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "cayene/ingest/mqtt.hpp"
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using cayene::ingest::append_connack;
+using cayene::ingest::append_pingresp;
+using cayene::ingest::append_publish;
+using cayene::ingest::append_suback;
+using cayene::ingest::MqttPacket;
+using cayene::ingest::MqttPacketType;
+
+constexpr int exit_ok = 0;
+constexpr int exit_error = 1;
+constexpr int exit_usage = 2;
+
+constexpr std::size_t max_packet = 64 * 1024;
+// PUBLISH por escritura
+constexpr std::size_t publish_chunk = 256;
+constexpr unsigned device_count = 1000;
+
+// Temperatura, humedad y GPS en base64
+constexpr std::string_view sample_payload = "A2cBEAVoAZABiAZ2Xw1p9gAD6A==";
+
+struct Options
+{
+    uint16_t port{1883};
+    uint64_t messages{100000};
+    unsigned inflight{1000};
+    bool ttn{false};
+};
+
+void usage()
+{
+    std::println(stderr,
+                 "usage: cayene_mqtt_stub [options]\n"
+                 "\n"
+                 "options:\n"
+                 "  --port N           TCP port on 127.0.0.1 (default 1883)\n"
+                 "  --messages N       uplinks to publish (default 100000)\n"
+                 "  --inflight N       unacknowledged uplinks allowed (default 1000)\n"
+                 "  --format F         chirpstack or ttn (default chirpstack)");
+}
+
+auto parse_options(int argc, char** argv) -> std::optional<Options>
+{
+    Options options;
+    const std::vector<std::string_view> arguments(argv + 1, argv + argc);
+    if (arguments.size() % 2 != 0)
+    {
+        return std::nullopt;
+    }
+    for (std::size_t i = 0; i < arguments.size(); i += 2)
+    {
+        const std::string_view argument = arguments[i];
+        const std::string value(arguments[i + 1]);
+        if (argument == "--port")
+        {
+            options.port = static_cast<uint16_t>(std::atoi(value.c_str()));
+        }
+        else if (argument == "--messages")
+        {
+            options.messages = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (argument == "--inflight")
+        {
+            // Los packet id en vuelo deben ser distintos
+            options.inflight =
+                static_cast<unsigned>(std::clamp(std::atoi(value.c_str()), 1, 65535));
+        }
+        else if (argument == "--format" && (value == "ttn" || value == "chirpstack"))
+        {
+            options.ttn = value == "ttn";
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+    return options;
+}
+
+// Tema y envoltorio del mensaje i
+void append_uplink(std::vector<uint8_t>& out, const Options& options, uint64_t index)
+{
+    const auto device = static_cast<unsigned>(index % device_count);
+    const std::string topic =
+        options.ttn ? std::format("v3/load@ttn/devices/load-{}/up", device)
+                    : std::format("application/1/device/{:016x}/event/up", device);
+    const std::string body =
+        options.ttn
+            ? std::format(R"({{"end_device_ids":{{"device_id":"load-{}"}},)"
+                          R"("uplink_message":{{"f_port":2,"frm_payload":"{}"}}}})",
+                          device, sample_payload)
+            : std::format(R"({{"deviceInfo":{{"devEui":"{:016x}"}},"fPort":2,"data":"{}"}})",
+                          device, sample_payload);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const std::span payload(reinterpret_cast<const uint8_t*>(body.data()), body.size());
+    append_publish(out, topic, payload, 1, static_cast<uint16_t>(index % 65535 + 1));
+}
+
+auto listen_on(uint16_t port) -> int
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int enable = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(fd, 1) < 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+auto send_all(int fd, std::vector<uint8_t>& out) -> bool
+{
+    const bool sent = out.empty() || ::send(fd, out.data(), out.size(), MSG_NOSIGNAL) ==
+                                         static_cast<ssize_t>(out.size());
+    out.clear();
+    return sent;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const auto options = parse_options(argc, argv);
+    if (!options)
+    {
+        usage();
+        return exit_usage;
+    }
+
+    const int listen_fd = listen_on(options->port);
+    if (listen_fd < 0)
+    {
+        std::println(stderr, "error: cannot listen on 127.0.0.1:{}", options->port);
+        return exit_error;
+    }
+    std::println(stderr, "cayene_mqtt_stub waiting on 127.0.0.1:{}", options->port);
+    const int fd = ::accept(listen_fd, nullptr, nullptr);
+    ::close(listen_fd);
+
+    std::vector<uint8_t> input;
+    std::vector<uint8_t> output;
+    std::array<uint8_t, 64 * 1024> buffer{};
+    bool subscribed = false;
+    bool done = false;
+    uint64_t published = 0;
+    uint64_t acked = 0;
+    Clock::time_point start;
+
+    while (!done)
+    {
+        // Rellenar la ventana de mensajes sin confirmar
+        if (subscribed && published < options->messages)
+        {
+            const uint64_t window = options->inflight - (published - acked);
+            const uint64_t count =
+                std::min({window, options->messages - published, uint64_t{publish_chunk}});
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                append_uplink(output, *options, published++);
+            }
+            if (!send_all(fd, output))
+            {
+                break;
+            }
+        }
+
+        pollfd descriptor{.fd = fd, .events = POLLIN, .revents = 0};
+        const bool window_full = published - acked >= options->inflight;
+        if (::poll(&descriptor, 1, subscribed && !window_full ? 0 : 1000) == 0)
+        {
+            continue;
+        }
+        const ssize_t received = ::recv(fd, buffer.data(), buffer.size(), 0);
+        if (received <= 0)
+        {
+            break;
+        }
+        input.insert(input.end(), buffer.begin(), buffer.begin() + received);
+
+        std::size_t offset = 0;
+        MqttPacket packet;
+        while (true)
+        {
+            const auto consumed =
+                parse_packet(std::span(input).subspan(offset), packet, max_packet);
+            if (!consumed)
+            {
+                std::println(stderr, "error: {}", mqtt_error_name(consumed.error()));
+                return exit_error;
+            }
+            if (*consumed == 0)
+            {
+                break;
+            }
+            offset += *consumed;
+
+            switch (packet.type)
+            {
+                case MqttPacketType::Connect:
+                    append_connack(output, 0);
+                    break;
+                case MqttPacketType::Subscribe:
+                    append_suback(output, packet.packet_id, 1);
+                    subscribed = true;
+                    start = Clock::now();
+                    break;
+                case MqttPacketType::Puback:
+                    ++acked;
+                    break;
+                case MqttPacketType::Pingreq:
+                    append_pingresp(output);
+                    break;
+                case MqttPacketType::Disconnect:
+                    done = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+        input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(offset));
+        if (!send_all(fd, output))
+        {
+            break;
+        }
+
+        if (subscribed && acked == options->messages && published == acked)
+        {
+            const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            std::println("messages: {} acked in {:.2f} s ({:.0f} msg/s, window {})", acked,
+                         elapsed, static_cast<double>(acked) / elapsed, options->inflight);
+            done = true;
+        }
+    }
+    ::close(fd);
+    return acked == options->messages ? exit_ok : exit_error;
+}
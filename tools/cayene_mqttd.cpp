@@ -0,0 +1,246 @@
+/**
+ * @file cayene_mqttd.cpp
+ * @brief cayene_mqttd: MQTT uplink subscriber for ChirpStack and The Things Stack
+ *
+ * Subscribes to the uplink topic of a broker with QoS 1, decodes the LPP
+ * payloads in batches and writes one JSON line per uplink to the
+ * configured output sink. Reconnects after a second when the broker goes away.
+ * Runs until SIGINT or SIGTERM and prints its counters on exit.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <print>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cayene/ingest/lanes.hpp"
+#include "cayene/ingest/mqtt_subscriber.hpp"
+#include "cayene/type_config.hpp"
+#include "daemon_stages.hpp"
+
+namespace
+{
+
+using cayene::Json;
+using cayene::TypeCatalog;
+using cayene::ingest::Lane;
+using cayene::ingest::LanedBatcher;
+using cayene::ingest::MqttBatchHandler;
+using cayene::ingest::MqttConfig;
+using cayene::ingest::MqttSubscriber;
+using cayene::ingest::MqttUplink;
+using cayene::ingest::OutputSink;
+using cayene::tools::LineStages;
+using cayene::tools::OptionStatus;
+using cayene::tools::StageOptions;
+
+constexpr int exit_ok = 0;
+constexpr int exit_usage = 2;
+
+constexpr auto poll_interval = std::chrono::milliseconds(500);
+constexpr auto reconnect_delay = std::chrono::seconds(1);
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+struct Options
+{
+    MqttConfig mqtt;
+    StageOptions stages;
+};
+
+void usage()
+{
+    std::println(stderr,
+                 "usage: cayene_mqttd [options]\n"
+                 "\n"
+                 "options:\n"
+                 "  --host ADDR        broker IPv4 address (default 127.0.0.1)\n"
+                 "  --port N           broker port (default 1883)\n"
+                 "  --client-id ID     MQTT client identifier (default cayene)\n"
+                 "  --topic FILTER     subscription (default application/+/device/+/event/up)\n"
+                 "  --keep-alive S     keep-alive in seconds (default 60)\n"
+                 "  --persistent       keep the session (clean session off)\n"
+                 "  --batch N          uplinks decoded per batch (default 64)\n"
+                 "  --lanes            decode presence and digital input alarms on their own\n"
+                 "                     lane, ahead of bulk telemetry\n"
+                 "{}",
+                 cayene::tools::stage_usage);
+}
+
+auto parse_options(int argc, char** argv) -> std::optional<Options>
+{
+    Options options;
+    const std::vector<std::string_view> arguments(argv + 1, argv + argc);
+    for (std::size_t i = 0; i < arguments.size(); ++i)
+    {
+        const std::string_view argument = arguments[i];
+        if (argument == "--persistent")
+        {
+            options.mqtt.clean_session = false;
+            continue;
+        }
+        if (argument == "--lanes")
+        {
+            options.mqtt.lanes.emplace();
+            continue;
+        }
+        if (i + 1 >= arguments.size())
+        {
+            return std::nullopt;
+        }
+        const std::string value(arguments[++i]);
+
+        if (argument == "--host")
+        {
+            options.mqtt.host = value;
+        }
+        else if (argument == "--port")
+        {
+            options.mqtt.port = static_cast<uint16_t>(std::atoi(value.c_str()));
+        }
+        else if (argument == "--client-id")
+        {
+            options.mqtt.client_id = value;
+        }
+        else if (argument == "--topic")
+        {
+            options.mqtt.topic = value;
+        }
+        else if (argument == "--keep-alive")
+        {
+            options.mqtt.keep_alive = static_cast<uint16_t>(std::atoi(value.c_str()));
+        }
+        else if (argument == "--batch")
+        {
+            options.mqtt.max_batch = static_cast<std::size_t>(std::atoi(value.c_str()));
+        }
+        else if (cayene::tools::parse_stage_option(argument, value, options.stages,
+                                                   options.mqtt.admission) !=
+                 OptionStatus::Consumed)
+        {
+            return std::nullopt;
+        }
+    }
+    return options;
+}
+
+// Lotes de cada carril
+void print_lanes(const LanedBatcher* lanes)
+{
+    if (lanes == nullptr)
+    {
+        return;
+    }
+    for (const Lane lane : {Lane::Alarm, Lane::Bulk})
+    {
+        const auto stats = lanes->stats(lane);
+        std::println(stderr, "lane {}: uplinks={} batches={} dropped={}", lane_name(lane),
+                     stats.uplinks, stats.batches, stats.dropped);
+    }
+}
+
+// Una línea JSON por uplink; el sink agrupa las de varios lotes en cada escritura
+auto batch_writer(OutputSink& sink, const LineStages& stages) -> MqttBatchHandler
+{
+    return [&sink, &stages](std::span<const MqttUplink> batch)
+    {
+        // Un mismo índice para todo el lote aunque se recargue a la vez
+        const auto index = stages.enricher != nullptr ? stages.enricher->index() : nullptr;
+        for (const auto& entry : batch)
+        {
+            Json line{{"device_id", entry.uplink.device_id},
+                      {"f_port", entry.uplink.fport},
+                      {"topic", entry.topic},
+                      {"decoded", entry.decoded}};
+            if (index)
+            {
+                index->enrich(entry.uplink.device_id, line);
+            }
+            cayene::tools::annotate_line(stages, entry.uplink, line);
+            sink.write(line.dump());
+        }
+    };
+}
+
+void request_stop(int /*signal*/)
+{
+    stop_requested = 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const auto options = parse_options(argc, argv);
+    if (!options)
+    {
+        usage();
+        return exit_usage;
+    }
+
+    auto catalog = options->stages.types.empty() ? TypeCatalog::parse("{}")
+                                                 : TypeCatalog::load(options->stages.types);
+    if (!catalog)
+    {
+        std::println(stderr, "error: {}", catalog.error().message);
+        return exit_usage;
+    }
+
+    auto opened = cayene::tools::open_stages(options->stages);
+    if (!opened)
+    {
+        std::println(stderr, "error: {}", opened.error());
+        return exit_usage;
+    }
+    OutputSink* output = opened->output.get();
+
+    // Sin SA_RESTART: la señal interrumpe el poll() y el bucle termina
+    struct sigaction action{};
+    action.sa_handler = request_stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    LineStages stages = opened->line_stages();
+    MqttSubscriber subscriber(options->mqtt, std::move(*catalog),
+                              output != nullptr ? batch_writer(*output, stages) : nullptr);
+    stages.catalog = &subscriber.catalog();
+    while (stop_requested == 0)
+    {
+        if (subscriber.fd() < 0)
+        {
+            if (auto connected = subscriber.connect(); !connected)
+            {
+                std::println(stderr, "error: cannot connect to {}:{}: {}", options->mqtt.host,
+                             options->mqtt.port, connected.error().message());
+                std::this_thread::sleep_for(reconnect_delay);
+                continue;
+            }
+            std::println(stderr, "cayene_mqttd subscribed to {} on {}:{}", options->mqtt.topic,
+                         options->mqtt.host, options->mqtt.port);
+        }
+        if (auto polled = subscriber.poll(poll_interval); !polled)
+        {
+            std::println(stderr, "error: connection lost: {}", polled.error().message());
+        }
+    }
+    subscriber.disconnect();
+
+    const auto& stats = subscriber.stats();
+    std::println(stderr, "messages={} uplinks={} rejected={} throttled={} batches={}",
+                 stats.messages, stats.uplinks, stats.rejected, stats.throttled, stats.batches);
+    cayene::tools::print_admission(subscriber.admission());
+    print_lanes(subscriber.lanes());
+    cayene::tools::print_output(output);
+    return exit_ok;
+}
@@ -0,0 +1,261 @@
+/**
+ * @file daemon_stages.cpp
+ * @brief Options and line stages shared by cayene_httpd and cayene_mqttd
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include "daemon_stages.hpp"
+
+#include <array>
+#include <charconv>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <print>
+#include <span>
+#include <system_error>
+#include <utility>
+
+#include <pthread.h>
+
+#include "cayene/reading.hpp"
+
+namespace cayene::tools
+{
+
+namespace
+{
+
+using ingest::AdmissionConfig;
+using ingest::CalibrationTable;
+using ingest::DeviceEnricher;
+using ingest::GeofenceIndex;
+using ingest::GeofenceTracker;
+using ingest::OutputSink;
+using ingest::Uplink;
+using ingest::VibrationConfig;
+using ingest::VibrationMonitor;
+
+constexpr std::size_t top_dropped_devices = 5;
+
+// --rate y --burst activan el control de admisión
+auto admission_config(std::optional<AdmissionConfig>& config) -> AdmissionConfig&
+{
+    if (!config)
+    {
+        config.emplace();
+    }
+    return *config;
+}
+
+// Lecturas crudas de @p uplink, una sola decodificación para todas las etapas
+auto raw_readings(const LineStages& stages, const Uplink& uplink, std::span<Reading> readings)
+    -> std::span<const Reading>
+{
+    if (stages.calibration == nullptr && stages.geofences == nullptr &&
+        stages.vibration == nullptr)
+    {
+        return {};
+    }
+    const auto count = stages.catalog->decode_readings(uplink.fport, uplink.payload, readings);
+    return readings.first(count.value_or(0));
+}
+
+// El hilo de recarga nace con las señales bloqueadas: deben llegar al hilo principal
+auto open_enricher(const std::string& path)
+    -> std::expected<std::unique_ptr<DeviceEnricher>, std::string>
+{
+    sigset_t signals;
+    sigset_t previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    auto opened = DeviceEnricher::open(path);
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    if (!opened)
+    {
+        return std::unexpected(opened.error().message);
+    }
+    return std::move(*opened);
+}
+
+}  // namespace
+
+const char* const stage_usage =
+    "  --rate R           per-device uplinks per second, the excess is dropped\n"
+    "                     before decoding (default unlimited)\n"
+    "  --burst N          uplinks a device may send back to back (default 10)\n"
+    "  --devices FILE     device list to add site, tenant and calibration to\n"
+    "                     every line, reloaded when it changes\n"
+    "  --calibration FILE per-sensor gain and offset, see calibration.hpp; the\n"
+    "                     decoded values of those sensors are calibrated\n"
+    "  --geofences FILE   geofence file, adds the enter/exit events of GPS\n"
+    "                     readings to their line\n"
+    "  --vibration N      accelerometer window of 1 to 4096 samples; lines carry\n"
+    "                     the RMS, peak and crest factor of every window instead\n"
+    "                     of the samples\n"
+    "  --types FILE       type definition file, see type_config.hpp\n"
+    "  --output DEST      none, stdout, udp:HOST:PORT, unix:PATH, unixgram:PATH\n"
+    "                     or a file to append to (default stdout)";
+
+auto parse_stage_option(std::string_view argument, const std::string& value,
+                        StageOptions& options, std::optional<AdmissionConfig>& admission)
+    -> OptionStatus
+{
+    if (argument == "--rate")
+    {
+        admission_config(admission).policy.rate = std::atof(value.c_str());
+    }
+    else if (argument == "--burst")
+    {
+        admission_config(admission).policy.burst = std::atof(value.c_str());
+    }
+    else if (argument == "--devices")
+    {
+        options.devices = value;
+    }
+    else if (argument == "--calibration")
+    {
+        options.calibration = value;
+    }
+    else if (argument == "--geofences")
+    {
+        options.geofences = value;
+    }
+    else if (argument == "--vibration")
+    {
+        // Un anillo de window muestras por dispositivo y canal: ni negativos ni enormes
+        uint32_t window = 0;
+        const char* end = value.data() + value.size();
+        const auto parsed = std::from_chars(value.data(), end, window);
+        if (parsed.ec != std::errc{} || parsed.ptr != end || window == 0 ||
+            window > ingest::max_vibration_window)
+        {
+            return OptionStatus::Invalid;
+        }
+        options.vibration_window = window;
+    }
+    else if (argument == "--types")
+    {
+        options.types = value;
+    }
+    else if (argument == "--output")
+    {
+        options.output = value;
+    }
+    else
+    {
+        return OptionStatus::Unknown;
+    }
+    return OptionStatus::Consumed;
+}
+
+void annotate_line(const LineStages& stages, const Uplink& uplink, Json& line)
+{
+    std::array<Reading, max_payload_readings> storage{};
+    const auto readings = raw_readings(stages, uplink, storage);
+    if (stages.calibration != nullptr)
+    {
+        stages.calibration->annotate(uplink, readings, line);
+    }
+    if (stages.geofences != nullptr)
+    {
+        stages.geofences->annotate(uplink, readings, line);
+    }
+    if (stages.vibration != nullptr)
+    {
+        stages.vibration->annotate(*stages.catalog, uplink, readings, line);
+    }
+}
+
+auto Stages::line_stages() const -> LineStages
+{
+    return LineStages{enricher.get(), calibration ? &*calibration : nullptr, geofences.get(),
+                      vibration.get()};
+}
+
+auto open_stages(const StageOptions& options) -> std::expected<Stages, std::string>
+{
+    Stages stages;
+    if (options.output != "none")
+    {
+        auto sink = OutputSink::open(options.output);
+        if (!sink)
+        {
+            return std::unexpected("cannot open " + options.output + ": " +
+                                   sink.error().message());
+        }
+        stages.output = std::move(*sink);
+    }
+
+    if (!options.devices.empty())
+    {
+        auto enricher = open_enricher(options.devices);
+        if (!enricher)
+        {
+            return std::unexpected(std::move(enricher.error()));
+        }
+        stages.enricher = std::move(*enricher);
+    }
+
+    if (!options.calibration.empty())
+    {
+        auto table = CalibrationTable::load(options.calibration);
+        if (!table)
+        {
+            return std::unexpected(table.error().message);
+        }
+        stages.calibration = std::move(*table);
+    }
+
+    if (!options.geofences.empty())
+    {
+        auto index = GeofenceIndex::load(options.geofences);
+        if (!index)
+        {
+            return std::unexpected(index.error().message);
+        }
+        stages.geofences = std::make_unique<GeofenceTracker>(
+            std::make_shared<const GeofenceIndex>(std::move(*index)));
+    }
+
+    if (options.vibration_window > 0)
+    {
+        stages.vibration = std::make_unique<VibrationMonitor>(
+            VibrationConfig{.window = options.vibration_window});
+    }
+    return stages;
+}
+
+void print_admission(const ingest::AdmissionControl* admission)
+{
+    if (admission == nullptr)
+    {
+        return;
+    }
+    const auto stats = admission->stats();
+    std::println(stderr, "admission: devices={} admitted={} dropped={} untracked={}",
+                 stats.devices, stats.admitted, stats.dropped, stats.untracked);
+    for (const auto& device : admission->top_dropped(top_dropped_devices))
+    {
+        std::println(stderr, "  {} admitted={} dropped={}", device.device_id, device.admitted,
+                     device.dropped);
+    }
+}
+
+void print_output(OutputSink* output)
+{
+    if (output == nullptr)
+    {
+        return;
+    }
+    output->flush();
+    const auto sink = output->stats();
+    std::println(stderr, "output: messages={} flushes={} syscalls={} errors={}", sink.messages,
+                 sink.flushes, sink.syscalls, sink.errors);
+}
+
+}  // namespace cayene::tools
@@ -0,0 +1,121 @@
+#ifndef CAYENE_TOOLS_DAEMON_STAGES_HPP
+#define CAYENE_TOOLS_DAEMON_STAGES_HPP
+
+/**
+ * @file daemon_stages.hpp
+ * @brief Options and line stages shared by cayene_httpd and cayene_mqttd
+ *
+ * Both daemons write one JSON line per uplink and complete it with the same
+ * optional stages: device enrichment, calibration, geofence events and
+ * vibration windows. The options that turn them on, their setup and the
+ * exit counters live here so the daemons only add their transport.
+ *
+ * This library is licensed under the GNU General Public License v2 (GPLv2).
+ * See LICENSE file for details.
+ */
+
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "cayene/decoder.hpp"
+#include "cayene/ingest/admission.hpp"
+#include "cayene/ingest/calibration.hpp"
+#include "cayene/ingest/enrichment.hpp"
+#include "cayene/ingest/envelope.hpp"
+#include "cayene/ingest/geofence.hpp"
+#include "cayene/ingest/sink.hpp"
+#include "cayene/ingest/vibration.hpp"
+#include "cayene/type_config.hpp"
+
+namespace cayene::tools
+{
+
+// Usage lines of the options parse_stage_option() accepts
+extern const char* const stage_usage;
+
+struct StageOptions
+{
+    std::string types;
+    std::string devices;
+    std::string calibration;
+    std::string geofences;
+    // Accelerometer window in samples, 0 to pass the samples through
+    uint32_t vibration_window{0};
+    // "none" or an OutputSink destination
+    std::string output{"stdout"};
+};
+
+enum class OptionStatus : std::uint8_t
+{
+    Consumed,
+    Unknown,
+    Invalid
+};
+
+/**
+ * @brief Parse one of the shared options and its value
+ *
+ * --rate and --burst fill @p admission, the others @p options. Returns
+ * Unknown for options the daemon has to handle itself.
+ */
+auto parse_stage_option(std::string_view argument, const std::string& value,
+                        StageOptions& options,
+                        std::optional<ingest::AdmissionConfig>& admission) -> OptionStatus;
+
+/**
+ * @brief Optional stages that complete each line before it is written
+ */
+struct LineStages
+{
+    const ingest::DeviceEnricher* enricher{nullptr};
+    const ingest::CalibrationTable* calibration{nullptr};
+    ingest::GeofenceTracker* geofences{nullptr};
+    ingest::VibrationMonitor* vibration{nullptr};
+    // Catalog of the receiver, set before it starts: decodes the raw readings
+    const TypeCatalog* catalog{nullptr};
+};
+
+/**
+ * @brief Add calibration, geofence and vibration fields of @p uplink to @p line
+ *
+ * Decodes the raw readings once for all the stages, and not at all when
+ * none is on. Enrichment is left to the caller.
+ */
+void annotate_line(const LineStages& stages, const ingest::Uplink& uplink, Json& line);
+
+/**
+ * @brief Output sink and stages opened from StageOptions
+ */
+struct Stages
+{
+    std::unique_ptr<ingest::OutputSink> output;
+    std::unique_ptr<ingest::DeviceEnricher> enricher;
+    std::optional<ingest::CalibrationTable> calibration;
+    std::unique_ptr<ingest::GeofenceTracker> geofences;
+    std::unique_ptr<ingest::VibrationMonitor> vibration;
+
+    // The catalog is still unset: the receiver owns it
+    [[nodiscard]] auto line_stages() const -> LineStages;
+};
+
+/**
+ * @brief Open the output and the stages turned on in @p options
+ *
+ * The device list reload thread starts with SIGINT and SIGTERM blocked,
+ * so the signals reach the daemon's main thread.
+ */
+auto open_stages(const StageOptions& options) -> std::expected<Stages, std::string>;
+
+// Admission counters and the most throttled devices
+void print_admission(const ingest::AdmissionControl* admission);
+
+// Counters of the output sink, after flushing it
+void print_output(ingest::OutputSink* output);
+
+}  // namespace cayene::tools
+
+#endif  // CAYENE_TOOLS_DAEMON_STAGES_HPP